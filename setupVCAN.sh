@@ -0,0 +1,10 @@
+#!/bin/sh
+# Sets up a virtual CAN interface for running the bridge against
+# can_device_simulator (see tfr_can/launch/can_simulator.launch).
+sudo modprobe can
+sudo modprobe can_raw
+sudo modprobe vcan
+sudo ip link add dev vcan0 type vcan
+sudo ip link set up vcan0
+sudo ifconfig vcan0 txqueuelen 1000
+echo "Done"
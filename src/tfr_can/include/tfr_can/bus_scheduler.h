@@ -0,0 +1,196 @@
+/****************************************************************************************
+ * File:            bus_scheduler.h
+ *
+ * Purpose:         Schedules the polled (SDO backed) publishers of the CAN bridge.
+ *
+ *                  kaco::Bridge::add_publisher() gives every publisher its own thread
+ *                  that polls as fast as its rate allows, so all of the 32 Hz entries
+ *                  fire at the same instant and nothing decides who goes first when the
+ *                  bus is full. Instead of that, every polled entry is registered here
+ *                  with a rate and a priority:
+ *
+ *                  - Time is split into slots (slot_rate per second). Each entry is
+ *                    given a phase, chosen so the expected bits per slot are as even as
+ *                    possible, and is due every rate/slot_rate slots after that.
+ *                  - At every slot the due entries are released in priority order.
+ *                    CRITICAL entries are always released, NORMAL entries are held
+ *                    back to the next slot when the slot's bit budget is used up.
+ *                  - Each CAN node gets its own worker lane, since SDO transfers to one
+ *                    node are sequential anyway, but different nodes can be polled in
+ *                    parallel.
+ *
+ *                  Writes don't go through the scheduler, the bridge makes them when a
+ *                  message arrives. Their expected share of the bus is reserved up
+ *                  front and taken off the budget of the polled entries.
+ *
+ *                  The expected bus utilization is computed from the configured
+ *                  entries and reservations, and the live bus load is measured by
+ *                  listening on the bus.
+ *
+ * Published Topics:
+ *  - can_bus/expected_load (std_msgs/Float64) fraction of the bitrate the configured
+ *    entries and reservations should use.
+ *  - can_bus/load (std_msgs/Float64) measured fraction of the bitrate in use.
+ *  - can_bus/diagnostics (diagnostic_msgs/DiagnosticArray) per entry rate, latency
+ *    and deferral statistics.
+ ***************************************************************************************/
+#ifndef BUS_SCHEDULER_H
+#define BUS_SCHEDULER_H
+
+#include <ros/ros.h>
+#include "publisher.h"
+#include "can_socket.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tfr_can
+{
+    /**
+     * How important an entry is for closing the control loops.
+     * Lower values win when the bus is busy. Configuration that only
+     * changes on a write isn't polled, see CachedEntry (cached_entry.h).
+     * */
+    enum class Priority
+    {
+        CRITICAL,   // position feedback and target reached flags
+        NORMAL,     // other live feedback: torque, current, velocity
+    };
+
+    class BusScheduler
+    {
+    public:
+        /**
+         * bitrate: bits per second of the bus (250000 for our 250K bus)
+         * slot_rate: how many scheduling slots per second
+         * load_budget: fraction of the bus polled entries and reservations may use
+         * */
+        BusScheduler(ros::NodeHandle& n, unsigned bitrate, double slot_rate, double load_budget);
+        ~BusScheduler();
+        BusScheduler(const BusScheduler&) = delete;
+        BusScheduler& operator=(const BusScheduler&) = delete;
+        BusScheduler(BusScheduler&&) = delete;
+        BusScheduler& operator=(BusScheduler&&) = delete;
+
+        /**
+         * Registers a polled publisher, replaces kaco::Bridge::add_publisher().
+         *
+         * frames_per_poll is the number of frames one publish() puts on the
+         * bus, an expedited SDO upload is a request and a response.
+         * Entries can only be added before start().
+         * */
+        void add(std::shared_ptr<kaco::Publisher> publisher, const std::string& name,
+                uint8_t node_id, double rate, Priority priority, unsigned frames_per_poll = 2);
+
+        /**
+         * Sets aside bus time for frames other nodes make the bridge write,
+         * e.g. the setpoints streamed to set_joint_state. rate is how often
+         * one write happens and frames how many frames it puts on the bus.
+         * The polled entries get the budget that is left over. Reservations
+         * can only be made before start().
+         * */
+        void reserve(const std::string& name, double rate, unsigned frames);
+
+        /**
+         * Expected fraction of the bitrate used by the registered entries
+         * and the reservations.
+         * */
+        double expectedUtilization() const;
+
+        /**
+         * Assigns the slots, advertises the publishers and starts polling.
+         * If busname is not empty the live bus load is measured on it.
+         * */
+        void start(const std::string& busname);
+
+        void stop();
+
+        /**
+         * Stops releasing the entries of one node, e.g. while it is being
+         * reset, and starts again when paused is false.
+         * */
+        void pauseNode(uint8_t node_id, bool paused);
+
+    private:
+        struct Entry
+        {
+            std::shared_ptr<kaco::Publisher> publisher;
+            std::string name;
+            uint8_t node_id;
+            double rate;
+            Priority priority;
+            unsigned bits_per_poll;
+
+            // Assigned by start()
+            unsigned period_slots;
+            unsigned phase;
+
+            // Written by the lanes, read by the statistics
+            std::atomic<bool> in_flight;
+            std::chrono::steady_clock::time_point released;
+            uint64_t polls;
+            uint64_t deferred;
+            uint64_t skipped;
+            double latency_mean;
+            double latency_max;
+        };
+
+        /*
+         * A worker thread that polls the entries of one CAN node in the order
+         * they were released.
+         * */
+        struct Lane
+        {
+            std::deque<Entry*> queue;
+            std::mutex mutex;
+            std::condition_variable ready;
+            std::thread thread;
+            std::atomic<bool> paused{false};
+        };
+
+        struct Reservation
+        {
+            std::string name;
+            double bits_per_second;
+        };
+
+        double reservedBitsPerSecond() const;
+        void assignSlots();
+        void dispatch();
+        void runLane(Lane& lane);
+        void listen(const std::string& busname);
+        void publishStatistics(double elapsed);
+
+        ros::Publisher expected_load_publisher;
+        ros::Publisher load_publisher;
+        ros::Publisher diagnostics_publisher;
+
+        const unsigned bitrate;
+        const double slot_rate;
+        const double load_budget;
+
+        // Assigned by start(), what the reservations leave of the load budget
+        unsigned slot_budget_bits;
+
+        std::vector<std::unique_ptr<Entry>> entries;
+        std::vector<Reservation> reservations;
+        std::map<uint8_t, std::unique_ptr<Lane>> lanes;
+        std::mutex statistics_mutex;
+
+        std::atomic<bool> running;
+        std::atomic<uint64_t> bus_bits;
+        std::thread dispatcher;
+        std::thread listener;
+    };
+}
+
+#endif // BUS_SCHEDULER_H
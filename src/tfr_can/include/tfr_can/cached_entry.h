@@ -0,0 +1,141 @@
+/****************************************************************************************
+ * File:            cached_entry.h
+ *
+ * Purpose:         On-change publication for CAN entries that rarely change.
+ *
+ *                  Configuration values such as max_torque or profile_velocity only
+ *                  change when we write them, so polling them over SDO every second is
+ *                  wasted bus time. A CachedEntry replaces the EntryPublisher and
+ *                  EntrySubscriber pair of such an entry:
+ *
+ *                  - The entry is read once when the bridge is configured and the value
+ *                    is kept here.
+ *                  - It is published on a latched topic with the same name kacanopen
+ *                    would use, device<id>/get_<entry>, so late subscribers still get
+ *                    the value.
+ *                  - Writes arrive on device<id>/set_<entry>. After a write the entry is
+ *                    read back from the device, and published only if it changed.
+ *                  - Any message on can_bus/refresh_cached_entries reads every cached
+ *                    entry again, for when a device was reconfigured by hand.
+ *                  - restore() writes the cached value back after the device was reset.
+ *
+ *                  Message is the std_msgs type matching the entry's type in the object
+ *                  dictionary, e.g. std_msgs::UInt16 for an UNSIGNED16.
+ ***************************************************************************************/
+#ifndef CACHED_ENTRY_H
+#define CACHED_ENTRY_H
+
+#include <ros/ros.h>
+#include <std_msgs/Empty.h>
+#include "device.h"
+#include "logger.h"
+#include "subscriber.h"
+
+#include <mutex>
+#include <string>
+
+namespace tfr_can
+{
+    template <typename Message>
+    class CachedEntry : public kaco::Subscriber
+    {
+    public:
+        CachedEntry(kaco::Device& device, const std::string& entry_name) :
+            device(device),
+            entry_name(entry_name),
+            has_value{false}
+        {
+        }
+        CachedEntry(const CachedEntry&) = delete;
+        CachedEntry& operator=(const CachedEntry&) = delete;
+        CachedEntry(CachedEntry&&) = delete;
+        CachedEntry& operator=(CachedEntry&&) = delete;
+
+        /**
+         * Reads the entry and sets up the topics, called by
+         * kaco::Bridge::add_subscriber().
+         * */
+        void advertise() override
+        {
+            ros::NodeHandle n;
+            const std::string prefix = "device" + std::to_string(device.get_node_id()) + "/";
+            publisher = n.advertise<Message>(prefix + "get_" + entry_name, 1, true);
+            set_subscriber = n.subscribe(prefix + "set_" + entry_name, 5, &CachedEntry::set, this);
+            refresh_subscriber = n.subscribe("can_bus/refresh_cached_entries", 5, &CachedEntry::refresh, this);
+            update();
+        }
+
+        /**
+         * Reads the entry from the device and publishes it if it changed.
+         * */
+        void update()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            Message message;
+            try
+            {
+                message.data = device.get_entry(entry_name, kaco::ReadAccessMethod::sdo);
+            }
+            catch (const std::exception& error)
+            {
+                ERROR("CachedEntry: reading " << entry_name << " of device "
+                        << static_cast<int>(device.get_node_id()) << " failed: " << error.what());
+                return;
+            }
+
+            if (has_value && message.data == value.data)
+            {
+                return;
+            }
+            value = message;
+            has_value = true;
+            publisher.publish(value);
+        }
+
+        /**
+         * Writes the cached value back to the device, used after the device
+         * was reset. Does nothing if the entry was never read.
+         * */
+        void restore()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (has_value)
+            {
+                device.set_entry(entry_name, kaco::Value(value.data), kaco::WriteAccessMethod::sdo);
+            }
+        }
+
+    private:
+        void set(const Message& message)
+        {
+            try
+            {
+                device.set_entry(entry_name, kaco::Value(message.data), kaco::WriteAccessMethod::sdo);
+            }
+            catch (const std::exception& error)
+            {
+                ERROR("CachedEntry: writing " << entry_name << " of device "
+                        << static_cast<int>(device.get_node_id()) << " failed: " << error.what());
+            }
+            update();
+        }
+
+        void refresh(const std_msgs::Empty&)
+        {
+            update();
+        }
+
+        kaco::Device& device;
+        const std::string entry_name;
+
+        ros::Publisher publisher;
+        ros::Subscriber set_subscriber;
+        ros::Subscriber refresh_subscriber;
+
+        std::mutex mutex;
+        Message value;
+        bool has_value;
+    };
+}
+
+#endif // CACHED_ENTRY_H
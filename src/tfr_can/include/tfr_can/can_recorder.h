@@ -0,0 +1,142 @@
+/****************************************************************************************
+ * File:            can_recorder.h
+ *
+ * Purpose:         Flight recorder for the CAN bus.
+ *
+ *                  CanRecorder listens on the bus with its own raw socket and writes
+ *                  every frame, received from the devices or sent by the bridge, into a
+ *                  ring file that is memory mapped. Writing a frame is a copy of 24 bytes
+ *                  into the mapping, the kernel flushes the pages in the background, and
+ *                  the recording survives the bridge crashing, so the recorder can be left
+ *                  on for the whole mission. When the ring is full the oldest frames are
+ *                  overwritten.
+ *
+ *                  CanRecording reads a ring file back in the order the frames were
+ *                  recorded, it is used by the can_replay tool.
+ *
+ *                  File layout (little endian, as written by the Jetson):
+ *                    RecordingHeader
+ *                    FrameRecord[capacity]
+ ***************************************************************************************/
+#ifndef CAN_RECORDER_H
+#define CAN_RECORDER_H
+
+#include "can_socket.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+namespace tfr_can
+{
+    const char RECORDING_MAGIC[8] = {'T', 'F', 'R', 'C', 'A', 'N', 'R', 'B'};
+    const uint32_t RECORDING_VERSION = 1;
+
+    struct RecordingHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t record_size;
+        uint64_t capacity;
+        // Total number of frames ever written, the newest frame is at
+        // (written - 1) % capacity. Updated after the frame is in place.
+        uint64_t written;
+    };
+
+    struct FrameRecord
+    {
+        enum Flags : uint8_t
+        {
+            OUTGOING = 0x01,    // sent by this machine (the bridge or a tool)
+        };
+
+        int64_t stamp_us;       // kernel receive time, microseconds since the epoch
+        uint32_t can_id;        // including the EFF/RTR/ERR flags
+        uint8_t dlc;
+        uint8_t flags;
+        uint8_t reserved[2];
+        uint8_t data[8];
+    };
+    static_assert(sizeof(FrameRecord) == 24, "FrameRecord must stay 24 bytes");
+    static_assert(sizeof(RecordingHeader) == 32, "RecordingHeader must stay 32 bytes");
+
+    class CanRecorder
+    {
+    public:
+        CanRecorder();
+        ~CanRecorder();
+        CanRecorder(const CanRecorder&) = delete;
+        CanRecorder& operator=(const CanRecorder&) = delete;
+        CanRecorder(CanRecorder&&) = delete;
+        CanRecorder& operator=(CanRecorder&&) = delete;
+
+        /**
+         * Creates the ring file with room for capacity frames and starts
+         * recording everything on busname.
+         *
+         * An existing recording at path is kept as path + ".prev", so the
+         * run before a crash or a restart is not lost. Returns false if the
+         * file or the socket can't be opened.
+         * */
+        bool start(const std::string& path, size_t capacity, const std::string& busname);
+
+        /**
+         * Stops recording and flushes the file.
+         * */
+        void stop();
+
+        /**
+         * Number of frames recorded since start().
+         * */
+        uint64_t framesRecorded() const;
+
+    private:
+        void record();
+        void unmap();
+
+        CanSocket socket;
+        RecordingHeader* header;
+        FrameRecord* records;
+        size_t mapped_size;
+        std::atomic<bool> running;
+        std::thread worker;
+    };
+
+    class CanRecording
+    {
+    public:
+        CanRecording();
+        ~CanRecording();
+        CanRecording(const CanRecording&) = delete;
+        CanRecording& operator=(const CanRecording&) = delete;
+        CanRecording(CanRecording&&) = delete;
+        CanRecording& operator=(CanRecording&&) = delete;
+
+        /**
+         * Maps a recording read only. Returns false if the file is missing
+         * or is not a recording.
+         * */
+        bool open(const std::string& path);
+
+        /**
+         * Number of frames still in the ring.
+         * */
+        size_t size() const;
+
+        /**
+         * The i-th oldest frame in the ring.
+         * */
+        const FrameRecord& at(size_t i) const;
+
+    private:
+        const RecordingHeader* header;
+        const FrameRecord* records;
+        size_t mapped_size;
+        uint64_t first;
+        size_t count;
+    };
+}
+
+#endif // CAN_RECORDER_H
@@ -0,0 +1,76 @@
+/****************************************************************************************
+ * File:            can_socket.h
+ *
+ * Purpose:         Thin wrapper around a raw SocketCAN socket.
+ *
+ *                  Kacanopen owns the socket it uses to talk to the devices, and it does
+ *                  not let us see the frames it sends. A second raw socket on the same
+ *                  interface receives every frame on the bus, including the ones sent
+ *                  from this machine (the kernel loops them back to other sockets), so
+ *                  this is what the bus tooling in tfr_can uses to listen to traffic.
+ *                  It is also used to put frames on a vcan interface for the simulator
+ *                  and the replay tool.
+ ***************************************************************************************/
+#ifndef CAN_SOCKET_H
+#define CAN_SOCKET_H
+
+#include <linux/can.h>
+#include <sys/time.h>
+#include <cstdint>
+#include <string>
+
+namespace tfr_can
+{
+    /**
+     * Number of bits a classic CAN frame with an 11 bit identifier occupies
+     * on the wire, including the worst case amount of bit stuffing.
+     * */
+    inline unsigned frameBits(uint8_t dlc)
+    {
+        const unsigned data_bits = 8 * static_cast<unsigned>(dlc);
+        return 47 + data_bits + (34 + data_bits - 1) / 4;
+    }
+
+    class CanSocket
+    {
+    public:
+        CanSocket();
+        ~CanSocket();
+        CanSocket(const CanSocket&) = delete;
+        CanSocket& operator=(const CanSocket&) = delete;
+        CanSocket(CanSocket&&) = delete;
+        CanSocket& operator=(CanSocket&&) = delete;
+
+        /**
+         * Opens a raw socket bound to the interface, e.g. "can1" or "vcan0".
+         * Frames are stamped by the kernel when they are received.
+         *
+         * If receive_own is set the socket also gets back the frames it sent
+         * itself. Returns false if the interface does not exist.
+         * */
+        bool open(const std::string& busname, bool receive_own = false);
+
+        void close();
+
+        bool isOpen() const;
+
+        /**
+         * Waits up to timeout_ms for a frame.
+         *
+         * stamp is the kernel receive time, and outgoing is true when the
+         * frame was sent by a socket on this machine rather than by another
+         * node on the bus. Returns false on timeout or error.
+         * */
+        bool read(can_frame& frame, timeval& stamp, bool& outgoing, int timeout_ms);
+
+        /**
+         * Sends one frame, returns false if the kernel did not take it.
+         * */
+        bool write(const can_frame& frame);
+
+    private:
+        int fd;
+    };
+}
+
+#endif // CAN_SOCKET_H
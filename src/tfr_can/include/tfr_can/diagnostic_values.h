@@ -0,0 +1,28 @@
+/****************************************************************************************
+ * File:            diagnostic_values.h
+ *
+ * Purpose:         Helper for filling in the values of the diagnostic_msgs the CAN
+ *                  tooling publishes (scheduler, watchdog, simulator).
+ ***************************************************************************************/
+#ifndef DIAGNOSTIC_VALUES_H
+#define DIAGNOSTIC_VALUES_H
+
+#include <diagnostic_msgs/KeyValue.h>
+
+#include <sstream>
+#include <string>
+
+namespace tfr_can
+{
+    inline diagnostic_msgs::KeyValue keyValue(const std::string& key, double value)
+    {
+        diagnostic_msgs::KeyValue kv;
+        kv.key = key;
+        std::ostringstream stream;
+        stream << value;
+        kv.value = stream.str();
+        return kv;
+    }
+}
+
+#endif // DIAGNOSTIC_VALUES_H
@@ -0,0 +1,108 @@
+/****************************************************************************************
+ * File:            lpms_imu_publisher.h
+ *
+ * Purpose:         Publishes the LPMS-CU2 IMU as sensor_msgs/Imu, straight from its PDOs.
+ *
+ *                  With the LPMS-CU2_32BitDataSettings.eds mapping the sensor sends each
+ *                  sample as a burst of four transmit PDOs, two 32 bit floats in each:
+ *
+ *                  - TPDO1 (0x180 + id): gyroscope x, gyroscope y
+ *                  - TPDO2 (0x280 + id): gyroscope z, euler x
+ *                  - TPDO3 (0x380 + id): euler y, euler z
+ *                  - TPDO4 (0x480 + id): linear acceleration x, linear acceleration y
+ *
+ *                  The frames are collected into one sample and published once the
+ *                  last one arrives, at the rate the sensor sends them, with no polling.
+ *                  The PDOs carry no time, so the sample is stamped with the time its
+ *                  first frame was received. A burst that is missing a frame is dropped.
+ *
+ *                  The four PDOs have no room for the vertical acceleration, it is
+ *                  published as 0 with a variance large enough that it is not used.
+ *
+ *                  The openzen ig1_node of sensor_platform.launch publishes
+ *                  /sensors/imu in frame imu, so this one has a topic and frame of its
+ *                  own. sensor_platform.launch publishes the transform to lpms_imu,
+ *                  and the sensor fusion takes it as imu1 (tfr_sensor fusion.yaml),
+ *                  without removing gravity again.
+ *
+ * Parameters:
+ *  - ~imu/topic (string, default: /sensors/lpms_imu)
+ *  - ~imu/frame_id (string, default: lpms_imu)
+ *  - ~imu/gyro_scale: to rad/s (double, default: pi/180, the LPMS sends deg/s)
+ *  - ~imu/euler_scale: to rad (double, default: pi/180, the LPMS sends degrees)
+ *  - ~imu/acceleration_scale: to m/s^2 (double, default: 9.80665, the LPMS sends g)
+ *
+ * Published Topics:
+ *  - ~imu/topic (sensor_msgs/Imu) orientation, angular velocity and linear
+ *    acceleration (gravity removed by the sensor) in frame_id.
+ ***************************************************************************************/
+#ifndef LPMS_IMU_PUBLISHER_H
+#define LPMS_IMU_PUBLISHER_H
+
+#include <ros/ros.h>
+#include <sensor_msgs/Imu.h>
+#include "core.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace tfr_can
+{
+    class LpmsImuPublisher
+    {
+    public:
+        struct Parameters
+        {
+            std::string topic = "/sensors/lpms_imu";
+            std::string frame_id = "lpms_imu";
+            double gyro_scale = 3.14159265358979 / 180.0;
+            double euler_scale = 3.14159265358979 / 180.0;
+            double acceleration_scale = 9.80665;
+        };
+
+        LpmsImuPublisher(ros::NodeHandle& n, kaco::Core& core, uint8_t node_id,
+                const Parameters& parameters);
+        ~LpmsImuPublisher();
+        LpmsImuPublisher(const LpmsImuPublisher&) = delete;
+        LpmsImuPublisher& operator=(const LpmsImuPublisher&) = delete;
+        LpmsImuPublisher(LpmsImuPublisher&&) = delete;
+        LpmsImuPublisher& operator=(LpmsImuPublisher&&) = delete;
+
+        /**
+         * Reads the parameters listed above from the private namespace.
+         * */
+        static Parameters loadParameters();
+
+        void start();
+
+        void stop();
+
+    private:
+        static const int PDO_COUNT = 4;
+        static const uint8_t ALL_PDOS = (1 << PDO_COUNT) - 1;
+
+        void receive(uint16_t cob_id, const uint8_t* data, uint8_t length);
+        void publishSample();
+
+        ros::Publisher publisher;
+        kaco::Core& core;
+        const uint8_t node_id;
+        const Parameters parameters;
+
+        std::mutex mutex;
+        // the two floats of each pdo of the burst being collected
+        float values[PDO_COUNT][2];
+        // bit i is set once pdo i of the burst was received
+        uint8_t received;
+        ros::Time first_frame;
+        sensor_msgs::Imu sample;
+        uint64_t dropped;
+
+        std::atomic<bool> running;
+        bool callback_registered;
+    };
+}
+
+#endif // LPMS_IMU_PUBLISHER_H
@@ -0,0 +1,138 @@
+/****************************************************************************************
+ * File:            node_watchdog.h
+ *
+ * Purpose:         Watches the heartbeats and emergency messages of the CAN nodes and
+ *                  brings a node back without restarting the bridge.
+ *
+ *                  Every watched node is told to send a heartbeat (producer_heartbeat_time)
+ *                  and is considered:
+ *                  - LOST when no heartbeat arrived for missed_heartbeats periods,
+ *                  - FAULTED when it sends an emergency message with an error code, or a
+ *                    boot-up message we did not ask for (it was reset or lost power).
+ *
+ *                  A lost or faulted node is recovered on its own while the other nodes
+ *                  keep running: its polled entries are paused in the BusScheduler, it
+ *                  is sent an NMT reset, and once its boot-up message arrives it is
+ *                  started, its heartbeat is configured again and the reinitialize
+ *                  function given to watch() runs (mode of operation, cached
+ *                  configuration, enable operation). If no boot-up arrives the recovery
+ *                  is retried.
+ *
+ * Published Topics:
+ *  - can_bus/node_health (diagnostic_msgs/DiagnosticArray) state, heartbeat age,
+ *    emergency and recovery counts per node, once a second.
+ *  - can_bus/recovery_time (std_msgs/Float64) seconds from detecting a problem to the
+ *    node running again, published after each recovery.
+ ***************************************************************************************/
+#ifndef NODE_WATCHDOG_H
+#define NODE_WATCHDOG_H
+
+#include <ros/ros.h>
+#include "core.h"
+#include "device.h"
+#include "bus_scheduler.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace tfr_can
+{
+    class NodeWatchdog
+    {
+    public:
+        enum class Health
+        {
+            OK,
+            LOST,
+            FAULTED,
+            RECOVERING,
+        };
+
+        /**
+         * heartbeat_time_ms: heartbeat period the nodes are configured with
+         * missed_heartbeats: periods without a heartbeat before a node is lost
+         * boot_timeout: seconds to wait for the boot-up message after a reset
+         * */
+        NodeWatchdog(ros::NodeHandle& n, kaco::Core& core, BusScheduler& scheduler,
+                uint16_t heartbeat_time_ms, double missed_heartbeats, double boot_timeout);
+        ~NodeWatchdog();
+        NodeWatchdog(const NodeWatchdog&) = delete;
+        NodeWatchdog& operator=(const NodeWatchdog&) = delete;
+        NodeWatchdog(NodeWatchdog&&) = delete;
+        NodeWatchdog& operator=(NodeWatchdog&&) = delete;
+
+        /**
+         * Writes producer_heartbeat_time to the device. Call it while setting
+         * up the device, before its entries are read.
+         * */
+        void configureHeartbeat(kaco::Device& device);
+
+        /**
+         * Watches a configured device. reinitialize is run after the node was
+         * reset and started again, it must bring the device back into the
+         * state the bridge set it up in. Nodes can only be added before start().
+         * */
+        void watch(kaco::Device& device, std::function<void()> reinitialize);
+
+        void start();
+
+        void stop();
+
+    private:
+        using clock = std::chrono::steady_clock;
+
+        struct Node
+        {
+            kaco::Device* device;
+            std::function<void()> reinitialize;
+
+            Health health;
+            std::string reason;
+            clock::time_point last_heartbeat;
+            clock::time_point detected;
+            clock::time_point next_attempt;
+            uint8_t nmt_state;
+            bool booted;
+
+            uint64_t emergencies;
+            uint16_t last_emergency_code;
+            uint64_t recoveries;
+            uint64_t failed_recoveries;
+            double last_recovery_time;
+            double max_recovery_time;
+        };
+
+        void receive(uint16_t cob_id, const uint8_t* data, uint8_t length);
+        void markFaulted(Node& node, const std::string& reason, clock::time_point now);
+        void monitor();
+        void recoverNodes();
+        void recover(uint8_t node_id);
+        void publishHealth();
+
+        ros::Publisher health_publisher;
+        ros::Publisher recovery_time_publisher;
+
+        kaco::Core& core;
+        BusScheduler& scheduler;
+        const uint16_t heartbeat_time_ms;
+        const clock::duration heartbeat_timeout;
+        const clock::duration boot_timeout;
+
+        std::map<uint8_t, Node> nodes;
+        std::mutex mutex;
+        std::condition_variable changed;
+
+        std::atomic<bool> running;
+        std::thread monitor_thread;
+        std::thread recovery_thread;
+    };
+}
+
+#endif // NODE_WATCHDOG_H
@@ -0,0 +1,221 @@
+/****************************************************************************************
+ * File:            simulated_device.h
+ *
+ * Purpose:         CANopen devices for the virtual bus simulator (can_device_simulator).
+ *
+ *                  SimulatedDevice is a minimal CANopen slave: an object dictionary, the
+ *                  NMT state machine with boot-up and heartbeat messages, an SDO server
+ *                  (expedited and segmented upload, expedited download) and one receive
+ *                  and one transmit PDO. The subclasses fill in the dictionary of the
+ *                  real device and model the actuator it drives:
+ *
+ *                  - Ds402Axis: a DS402 profile position drive. Used for the Ultra Motion
+ *                    servo cylinders (SC_MC630R11 dictionary) and the EPOS4 turntable.
+ *                  - RoboteqController: the two channel Roboteq SBL2360 on the treads.
+ *
+ *                  The actuators are first order systems with a velocity limit, which is
+ *                  enough to exercise the bridge, RobotInterface and the digging queue.
+ ***************************************************************************************/
+#ifndef SIMULATED_DEVICE_H
+#define SIMULATED_DEVICE_H
+
+#include <linux/can.h>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace tfr_can
+{
+    class SimulatedDevice
+    {
+    public:
+        enum class NmtState : uint8_t
+        {
+            BOOTUP = 0x00,
+            STOPPED = 0x04,
+            OPERATIONAL = 0x05,
+            PRE_OPERATIONAL = 0x7F,
+        };
+
+        SimulatedDevice(uint8_t node_id, uint32_t device_type, const std::string& name);
+        virtual ~SimulatedDevice() = default;
+        SimulatedDevice(const SimulatedDevice&) = delete;
+        SimulatedDevice& operator=(const SimulatedDevice&) = delete;
+
+        uint8_t getNodeId() const;
+
+        /**
+         * Handles one frame from the bus, any replies are appended to out.
+         * Returns true if the frame changed a set-point of the device.
+         * */
+        bool handleFrame(const can_frame& frame, std::vector<can_frame>& out);
+
+        /**
+         * Advances the model by dt seconds and appends the heartbeat when it
+         * is due.
+         * */
+        void step(double dt, std::vector<can_frame>& out);
+
+        /**
+         * Called when a SYNC is seen, appends the transmit PDO when the node
+         * is operational.
+         * */
+        void sync(std::vector<can_frame>& out);
+
+        /**
+         * Powers the device back up, as if it had been reset.
+         * */
+        void bootUp(std::vector<can_frame>& out);
+
+        /**
+         * True when the last SDO upload read the feedback entry of this
+         * device (position or encoder count).
+         * */
+        bool takeFeedbackRead();
+
+        /**
+         * Fault injection: sends an emergency message with the error code and
+         * puts the device in its fault state.
+         * */
+        void emergency(uint16_t error_code, std::vector<can_frame>& out);
+
+        /**
+         * Fault injection: an offline device is silent, as if it was unplugged.
+         * Coming back online it boots like after a power cycle.
+         * */
+        void setOnline(bool online, std::vector<can_frame>& out);
+
+    protected:
+        /*
+         * Size in bytes and value of one object in the dictionary. Strings are
+         * only used for the identification objects.
+         * */
+        struct Object
+        {
+            uint8_t size;
+            bool is_signed;
+            bool writable;
+            int64_t value;
+            std::string text;
+        };
+
+        static uint32_t key(uint16_t index, uint8_t subindex);
+
+        void addObject(uint16_t index, uint8_t subindex, uint8_t size, bool is_signed,
+                bool writable, int64_t value);
+        void addString(uint16_t index, uint8_t subindex, const std::string& text);
+
+        int64_t get(uint16_t index, uint8_t subindex) const;
+        void set(uint16_t index, uint8_t subindex, int64_t value);
+
+        /*
+         * Maps an object into the transmit or receive PDO, in order.
+         * */
+        void mapTransmit(uint16_t index, uint8_t subindex);
+        void mapReceive(uint16_t index, uint8_t subindex);
+        void setFeedbackObject(uint16_t index, uint8_t subindex);
+
+        /*
+         * Hooks for the device models. onWrite() returns true if the write is
+         * a new set-point.
+         * */
+        virtual bool onWrite(uint16_t index, uint8_t subindex) = 0;
+        virtual void updateModel(double dt) = 0;
+        virtual void onReset() = 0;
+        virtual void onFault() {}
+
+    private:
+        void handleNmt(const can_frame& frame, std::vector<can_frame>& out);
+        bool handleSdo(const can_frame& frame, std::vector<can_frame>& out);
+        bool handleReceivePdo(const can_frame& frame);
+        void sdoAbort(uint16_t index, uint8_t subindex, uint32_t code, std::vector<can_frame>& out);
+        can_frame sdoFrame() const;
+
+        const uint8_t node_id;
+        NmtState nmt_state;
+        bool online;
+        double heartbeat_elapsed;
+
+        std::map<uint32_t, Object> dictionary;
+        std::vector<uint32_t> transmit_mapping;
+        std::vector<uint32_t> receive_mapping;
+        uint32_t feedback_object;
+        bool feedback_read;
+
+        // segmented upload in progress
+        std::string segment_data;
+        size_t segment_offset;
+    };
+
+    /**
+     * DS402 drive in profile position mode.
+     *
+     * position_min/max are the limits of the actuator in encoder counts and
+     * max_velocity is in counts per second.
+     * */
+    class Ds402Axis : public SimulatedDevice
+    {
+    public:
+        Ds402Axis(uint8_t node_id, uint32_t device_type, const std::string& name,
+                int32_t position_min, int32_t position_max, double max_velocity, double time_constant);
+
+        /**
+         * Adds the manufacturer specific averaged torque object the EPOS4
+         * has (0x30D2 sub 1).
+         * */
+        void addAveragedTorque();
+
+    protected:
+        bool onWrite(uint16_t index, uint8_t subindex) override;
+        void updateModel(double dt) override;
+        void onReset() override;
+        void onFault() override;
+
+    private:
+        enum class DriveState
+        {
+            SWITCH_ON_DISABLED,
+            READY_TO_SWITCH_ON,
+            SWITCHED_ON,
+            OPERATION_ENABLED,
+        };
+
+        void updateStatusword();
+
+        const int32_t position_min;
+        const int32_t position_max;
+        const double max_velocity;
+        const double time_constant;
+        bool has_averaged_torque;
+
+        DriveState drive_state;
+        double position;
+        double velocity;
+        int32_t setpoint;
+        bool fault;
+        uint16_t last_controlword;
+    };
+
+    /**
+     * Roboteq SBL2360 with two brushless channels driven by cmd_cango.
+     * */
+    class RoboteqController : public SimulatedDevice
+    {
+    public:
+        RoboteqController(uint8_t node_id, double max_counts_per_second, double time_constant);
+
+    protected:
+        bool onWrite(uint16_t index, uint8_t subindex) override;
+        void updateModel(double dt) override;
+        void onReset() override;
+
+    private:
+        const double max_counts_per_second;
+        const double time_constant;
+        double speed[2];
+        double count[2];
+    };
+}
+
+#endif // SIMULATED_DEVICE_H
@@ -0,0 +1,456 @@
+/****************************************************************************************
+ * File:            bus_scheduler.cpp
+ *
+ * Purpose:         Implementation of BusScheduler, see
+ *                  tfr_can/include/tfr_can/bus_scheduler.h for details.
+ ***************************************************************************************/
+#include "bus_scheduler.h"
+#include "diagnostic_values.h"
+#include "logger.h"
+
+#include <std_msgs/Float64.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include <algorithm>
+#include <limits>
+
+namespace tfr_can
+{
+    namespace
+    {
+        unsigned gcd(unsigned a, unsigned b)
+        {
+            while (b != 0)
+            {
+                unsigned t = a % b;
+                a = b;
+                b = t;
+            }
+            return a;
+        }
+    }
+
+    BusScheduler::BusScheduler(ros::NodeHandle& n, unsigned bitrate, double slot_rate, double load_budget) :
+        expected_load_publisher{n.advertise<std_msgs::Float64>("can_bus/expected_load", 1, true)},
+        load_publisher{n.advertise<std_msgs::Float64>("can_bus/load", 5)},
+        diagnostics_publisher{n.advertise<diagnostic_msgs::DiagnosticArray>("can_bus/diagnostics", 5)},
+        bitrate{bitrate},
+        slot_rate{slot_rate},
+        load_budget{load_budget},
+        slot_budget_bits{static_cast<unsigned>(bitrate * load_budget / slot_rate)},
+        running{false},
+        bus_bits{0}
+    {
+    }
+
+    BusScheduler::~BusScheduler()
+    {
+        stop();
+    }
+
+    void BusScheduler::add(std::shared_ptr<kaco::Publisher> publisher, const std::string& name,
+            uint8_t node_id, double rate, Priority priority, unsigned frames_per_poll)
+    {
+        if (running)
+        {
+            ERROR("BusScheduler: can't add " << name << " while the scheduler is running.");
+            return;
+        }
+
+        std::unique_ptr<Entry> entry{new Entry{}};
+        entry->publisher = publisher;
+        entry->name = name;
+        entry->node_id = node_id;
+        entry->rate = rate;
+        entry->priority = priority;
+        entry->bits_per_poll = frames_per_poll * frameBits(8);
+        entry->in_flight = false;
+        entry->polls = 0;
+        entry->deferred = 0;
+        entry->skipped = 0;
+        entry->latency_mean = 0;
+        entry->latency_max = 0;
+        entries.push_back(std::move(entry));
+
+        if (lanes.find(node_id) == lanes.end())
+        {
+            lanes[node_id] = std::unique_ptr<Lane>{new Lane{}};
+        }
+    }
+
+    void BusScheduler::reserve(const std::string& name, double rate, unsigned frames)
+    {
+        if (running)
+        {
+            ERROR("BusScheduler: can't reserve " << name << " while the scheduler is running.");
+            return;
+        }
+        reservations.push_back(Reservation{name, rate * frames * frameBits(8)});
+    }
+
+    double BusScheduler::reservedBitsPerSecond() const
+    {
+        double bits_per_second = 0;
+        for (const auto& reservation : reservations)
+        {
+            bits_per_second += reservation.bits_per_second;
+        }
+        return bits_per_second;
+    }
+
+    double BusScheduler::expectedUtilization() const
+    {
+        double bits_per_second = reservedBitsPerSecond();
+        for (const auto& entry : entries)
+        {
+            bits_per_second += entry->rate * entry->bits_per_poll;
+        }
+        return bits_per_second / bitrate;
+    }
+
+    void BusScheduler::start(const std::string& busname)
+    {
+        if (running)
+        {
+            return;
+        }
+
+        const double polled_bits_per_second = bitrate * load_budget - reservedBitsPerSecond();
+        if (polled_bits_per_second < 0)
+        {
+            ERROR("BusScheduler: the reservations need more than the load budget. "
+                    "Only CRITICAL entries will be polled.");
+        }
+        slot_budget_bits = static_cast<unsigned>(std::max(0.0, polled_bits_per_second) / slot_rate);
+        for (const auto& reservation : reservations)
+        {
+            PRINT("BusScheduler: reserved " << reservation.bits_per_second / bitrate * 100
+                    << "% of the bus for " << reservation.name << ".");
+        }
+
+        assignSlots();
+
+        for (auto& entry : entries)
+        {
+            entry->publisher->advertise();
+        }
+
+        const double utilization = expectedUtilization();
+        std_msgs::Float64 expected;
+        expected.data = utilization;
+        expected_load_publisher.publish(expected);
+        PRINT("BusScheduler: " << entries.size() << " polled entries, expected bus load "
+                << utilization * 100 << "% of " << bitrate << " bit/s.");
+        if (utilization > 1.0)
+        {
+            ERROR("BusScheduler: the configured entries need more than the whole bus. "
+                    "NORMAL entries will be deferred.");
+        }
+
+        running = true;
+        for (auto& lane : lanes)
+        {
+            Lane& l = *lane.second;
+            l.thread = std::thread{&BusScheduler::runLane, this, std::ref(l)};
+        }
+        dispatcher = std::thread{&BusScheduler::dispatch, this};
+        if (!busname.empty())
+        {
+            listener = std::thread{&BusScheduler::listen, this, busname};
+        }
+    }
+
+    void BusScheduler::stop()
+    {
+        if (!running)
+        {
+            return;
+        }
+        running = false;
+
+        if (dispatcher.joinable())
+        {
+            dispatcher.join();
+        }
+        for (auto& lane : lanes)
+        {
+            {
+                std::lock_guard<std::mutex> lock(lane.second->mutex);
+            }
+            lane.second->ready.notify_all();
+            if (lane.second->thread.joinable())
+            {
+                lane.second->thread.join();
+            }
+        }
+        if (listener.joinable())
+        {
+            listener.join();
+        }
+    }
+
+    void BusScheduler::pauseNode(uint8_t node_id, bool paused)
+    {
+        auto it = lanes.find(node_id);
+        if (it != lanes.end())
+        {
+            it->second->paused = paused;
+        }
+    }
+
+    /*
+     * Gives every entry a period in slots and a phase. The entries are placed
+     * fastest and most important first, each at the phase that keeps the
+     * busiest slot it touches as empty as possible.
+     * */
+    void BusScheduler::assignSlots()
+    {
+        unsigned hyperperiod = 1;
+        for (auto& entry : entries)
+        {
+            entry->period_slots = std::max(1u,
+                    static_cast<unsigned>(slot_rate / entry->rate + 0.5));
+            hyperperiod = hyperperiod / gcd(hyperperiod, entry->period_slots) * entry->period_slots;
+        }
+
+        std::vector<Entry*> order;
+        for (auto& entry : entries)
+        {
+            order.push_back(entry.get());
+        }
+        std::stable_sort(order.begin(), order.end(), [](const Entry* a, const Entry* b)
+                {
+                    if (a->priority != b->priority)
+                        return a->priority < b->priority;
+                    return a->rate > b->rate;
+                });
+
+        std::vector<unsigned> slot_bits(hyperperiod, 0);
+        for (Entry* entry : order)
+        {
+            unsigned best_phase = 0;
+            unsigned best_peak = std::numeric_limits<unsigned>::max();
+            for (unsigned phase = 0; phase < entry->period_slots; phase++)
+            {
+                unsigned peak = 0;
+                for (unsigned slot = phase; slot < hyperperiod; slot += entry->period_slots)
+                {
+                    peak = std::max(peak, slot_bits[slot]);
+                }
+                if (peak < best_peak)
+                {
+                    best_peak = peak;
+                    best_phase = phase;
+                }
+            }
+
+            entry->phase = best_phase;
+            for (unsigned slot = best_phase; slot < hyperperiod; slot += entry->period_slots)
+            {
+                slot_bits[slot] += entry->bits_per_poll;
+            }
+        }
+
+        const unsigned peak = *std::max_element(slot_bits.begin(), slot_bits.end());
+        PRINT("BusScheduler: " << hyperperiod << " slots at " << slot_rate << " Hz, busiest slot "
+                << peak << " bits, budget " << slot_budget_bits << " bits.");
+    }
+
+    /*
+     * Releases the entries that are due in each slot to their lanes.
+     * */
+    void BusScheduler::dispatch()
+    {
+        using clock = std::chrono::steady_clock;
+        const auto slot_period = std::chrono::duration_cast<clock::duration>(
+                std::chrono::duration<double>(1.0 / slot_rate));
+        const unsigned slots_per_report = std::max(1u, static_cast<unsigned>(slot_rate));
+
+        uint64_t slot = 0;
+        std::vector<Entry*> held_back;
+        std::vector<Entry*> due;
+        auto next = clock::now();
+        auto last_report = next;
+
+        while (running && ros::ok())
+        {
+            next += slot_period;
+            std::this_thread::sleep_until(next);
+            const auto now = clock::now();
+            if (now - next > slot_period)
+            {
+                // We fell behind, don't try to catch up with a burst.
+                next = now;
+            }
+
+            due.swap(held_back);
+            held_back.clear();
+            for (auto& entry : entries)
+            {
+                if (slot % entry->period_slots != entry->phase)
+                    continue;
+
+                if (lanes[entry->node_id]->paused)
+                    continue;
+
+                if (entry->in_flight)
+                {
+                    // The last poll has not finished, skip this one instead
+                    // of letting the lane queue grow.
+                    std::lock_guard<std::mutex> lock(statistics_mutex);
+                    entry->skipped++;
+                    continue;
+                }
+                entry->in_flight = true;
+                entry->released = now;
+                due.push_back(entry.get());
+            }
+
+            std::stable_sort(due.begin(), due.end(), [](const Entry* a, const Entry* b)
+                    {
+                        return a->priority < b->priority;
+                    });
+
+            unsigned used_bits = 0;
+            for (Entry* entry : due)
+            {
+                if (lanes[entry->node_id]->paused)
+                {
+                    // Held back from an earlier slot, and the node was
+                    // paused since then. It is due again when it resumes.
+                    entry->in_flight = false;
+                    continue;
+                }
+                if (entry->priority != Priority::CRITICAL &&
+                        used_bits + entry->bits_per_poll > slot_budget_bits)
+                {
+                    std::lock_guard<std::mutex> lock(statistics_mutex);
+                    entry->deferred++;
+                    held_back.push_back(entry);
+                    continue;
+                }
+                used_bits += entry->bits_per_poll;
+
+                Lane& lane = *lanes[entry->node_id];
+                {
+                    std::lock_guard<std::mutex> lock(lane.mutex);
+                    lane.queue.push_back(entry);
+                }
+                lane.ready.notify_one();
+            }
+            due.clear();
+
+            slot++;
+            if (slot % slots_per_report == 0)
+            {
+                publishStatistics(std::chrono::duration<double>(now - last_report).count());
+                last_report = now;
+            }
+        }
+    }
+
+    void BusScheduler::runLane(Lane& lane)
+    {
+        while (running)
+        {
+            Entry* entry = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(lane.mutex);
+                lane.ready.wait(lock, [this, &lane]{ return !running || !lane.queue.empty(); });
+                if (!running)
+                    return;
+                entry = lane.queue.front();
+                lane.queue.pop_front();
+            }
+
+            try
+            {
+                entry->publisher->publish();
+            }
+            catch (const std::exception& error)
+            {
+                ERROR("BusScheduler: polling " << entry->name << " failed: " << error.what());
+            }
+
+            const double latency = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - entry->released).count();
+            {
+                std::lock_guard<std::mutex> lock(statistics_mutex);
+                entry->polls++;
+                // exponential moving average over roughly the last 32 polls
+                entry->latency_mean += (latency - entry->latency_mean) / 32.0;
+                entry->latency_max = std::max(entry->latency_max, latency);
+            }
+            entry->in_flight = false;
+        }
+    }
+
+    /*
+     * Counts the bits of every frame on the bus, sent or received.
+     * */
+    void BusScheduler::listen(const std::string& busname)
+    {
+        CanSocket socket;
+        if (!socket.open(busname))
+        {
+            ERROR("BusScheduler: could not open " << busname << " to measure the bus load.");
+            return;
+        }
+
+        can_frame frame;
+        timeval stamp;
+        bool outgoing;
+        while (running)
+        {
+            if (socket.read(frame, stamp, outgoing, 100))
+            {
+                bus_bits += frameBits(frame.can_dlc);
+            }
+        }
+    }
+
+    void BusScheduler::publishStatistics(double elapsed)
+    {
+        if (elapsed <= 0)
+            return;
+
+        std_msgs::Float64 load;
+        load.data = bus_bits.exchange(0) / (bitrate * elapsed);
+        load_publisher.publish(load);
+
+        diagnostic_msgs::DiagnosticArray array;
+        array.header.stamp = ros::Time::now();
+        {
+            std::lock_guard<std::mutex> lock(statistics_mutex);
+            for (auto& entry : entries)
+            {
+                diagnostic_msgs::DiagnosticStatus status;
+                status.name = entry->name;
+                status.hardware_id = "device" + std::to_string(entry->node_id);
+                const double achieved_rate = entry->polls / elapsed;
+                if (entry->skipped > 0 || achieved_rate < 0.9 * entry->rate)
+                {
+                    status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+                    status.message = "falling behind";
+                }
+                else
+                {
+                    status.level = diagnostic_msgs::DiagnosticStatus::OK;
+                    status.message = "ok";
+                }
+                status.values.push_back(keyValue("rate_requested", entry->rate));
+                status.values.push_back(keyValue("rate_achieved", achieved_rate));
+                status.values.push_back(keyValue("latency_mean_ms", entry->latency_mean * 1000));
+                status.values.push_back(keyValue("latency_max_ms", entry->latency_max * 1000));
+                status.values.push_back(keyValue("deferred", entry->deferred));
+                status.values.push_back(keyValue("skipped", entry->skipped));
+                array.status.push_back(status);
+
+                entry->polls = 0;
+                entry->deferred = 0;
+                entry->skipped = 0;
+                entry->latency_max = 0;
+            }
+        }
+        diagnostics_publisher.publish(array);
+    }
+}
@@ -0,0 +1,250 @@
+/****************************************************************************************
+ * File:    can_device_simulator.cpp
+ * Node:    can_device_simulator
+ *
+ * Purpose: Emulates the CANopen devices on the robot on a virtual CAN interface, so
+ *          that the bridge (create_ros_topics_for_can_nodes), RobotInterface and the
+ *          digging queue can run on a developer machine without hardware.
+ *
+ *          Emulated nodes (see simulated_device.h):
+ *            - 23, 45, 56, 77, 88: Ultra Motion servo cylinders (DS402)
+ *            - 1: EPOS4 turntable (DS402)
+ *            - 8: Roboteq SBL2360 tread controller
+ *
+ *          To set up the interface:
+ *              ./setupVCAN.sh
+ *          and start the bridge with its ~busname parameter set to vcan0, see
+ *          tfr_can/launch/can_simulator.launch.
+ *
+ *          The time from a new set-point arriving at a device to the next time
+ *          the bridge reads that device's feedback is measured and published, this
+ *          is the command-to-feedback latency the bridge adds.
+ *
+ * Parameters:
+ *   - ~busname: the interface to attach to (string, default: "vcan0")
+ *   - ~rate: how fast to step the actuator models in hz (double, default: 1000)
+ *   - ~simulate_bin: emulate the two bin servo cylinders too (bool, default: true)
+ * Published topics:
+ *   - can_simulator/diagnostics (diagnostic_msgs/DiagnosticArray) command-to-feedback
+ *     latency per device, once a second
+ * Subscribed topics, for fault injection (std_msgs/UInt8 with the node id):
+ *   - can_simulator/emergency the device sends an emergency message and faults
+ *   - can_simulator/disconnect the device goes silent, as if unplugged
+ *   - can_simulator/reconnect the device comes back and boots
+ ***************************************************************************************/
+#include <ros/ros.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include <std_msgs/UInt8.h>
+#include "can_socket.h"
+#include "diagnostic_values.h"
+#include "simulated_device.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace
+{
+    const canid_t SYNC_ID = 0x080;
+
+    /*
+     * Command-to-feedback latency of one device.
+     * */
+    struct LatencyStats
+    {
+        bool command_pending = false;
+        timeval command_stamp{};
+        uint64_t samples = 0;
+        double sum = 0;
+        double max = 0;
+    };
+
+    // Generic error, as reported by the drives for faults without a more
+    // specific code.
+    const uint16_t INJECTED_ERROR_CODE = 0x1000;
+
+    double secondsBetween(const timeval& from, const timeval& to)
+    {
+        return (to.tv_sec - from.tv_sec) + (to.tv_usec - from.tv_usec) / 1e6;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    ros::init(argc, argv, "can_device_simulator");
+    ros::NodeHandle n;
+
+    std::string busname;
+    double rate;
+    bool simulate_bin;
+    ros::param::param<std::string>("~busname", busname, "vcan0");
+    ros::param::param<double>("~rate", rate, 1000.0);
+    ros::param::param<bool>("~simulate_bin", simulate_bin, true);
+    if (rate <= 0)
+    {
+        ROS_ERROR("Parameter 'rate' must be a positive value.");
+        return 1;
+    }
+
+    tfr_can::CanSocket socket;
+    if (!socket.open(busname))
+    {
+        ROS_ERROR("can_device_simulator: could not open %s, run setupVCAN.sh first.", busname.c_str());
+        return 1;
+    }
+
+    ros::Publisher diagnostics_publisher = n.advertise<diagnostic_msgs::DiagnosticArray>("can_simulator/diagnostics", 5);
+
+    // Servo cylinders: 47104 counts of stroke, full stroke in about 5 seconds.
+    // Turntable: 1024 counts * 4.3 gear * 70 worm gear per revolution, half a
+    // revolution in about 5 seconds.
+    // Treads: 3200 counts per revolution, about 3 revolutions per second.
+    std::vector<std::unique_ptr<tfr_can::SimulatedDevice>> devices;
+    std::vector<uint8_t> servo_cylinders{23, 45, 56};
+    if (simulate_bin)
+    {
+        servo_cylinders.push_back(77);
+        servo_cylinders.push_back(88);
+    }
+    for (uint8_t node_id : servo_cylinders)
+    {
+        devices.emplace_back(new tfr_can::Ds402Axis{node_id, 0x00020192, "SC_MC630R11", 0, 47104, 9400, 0.2});
+    }
+    auto turntable = new tfr_can::Ds402Axis{1, 0x00020192, "EPOS4", -308224, 308224, 30000, 0.3};
+    turntable->addAveragedTorque();
+    devices.emplace_back(turntable);
+    devices.emplace_back(new tfr_can::RoboteqController{8, 9600, 0.3});
+
+    std::map<uint8_t, LatencyStats> latency;
+    std::vector<can_frame> out;
+
+    for (auto& device : devices)
+    {
+        device->bootUp(out);
+    }
+
+    auto findDevice = [&devices](uint8_t node_id) -> tfr_can::SimulatedDevice*
+    {
+        for (auto& device : devices)
+        {
+            if (device->getNodeId() == node_id)
+                return device.get();
+        }
+        ROS_WARN("can_device_simulator: no device with node id %d", node_id);
+        return nullptr;
+    };
+    boost::function<void(const std_msgs::UInt8&)> emergency = [&](const std_msgs::UInt8& msg)
+    {
+        if (auto device = findDevice(msg.data))
+            device->emergency(INJECTED_ERROR_CODE, out);
+    };
+    boost::function<void(const std_msgs::UInt8&)> disconnect = [&](const std_msgs::UInt8& msg)
+    {
+        if (auto device = findDevice(msg.data))
+            device->setOnline(false, out);
+    };
+    boost::function<void(const std_msgs::UInt8&)> reconnect = [&](const std_msgs::UInt8& msg)
+    {
+        if (auto device = findDevice(msg.data))
+            device->setOnline(true, out);
+    };
+    ros::Subscriber emergency_subscriber = n.subscribe<std_msgs::UInt8>("can_simulator/emergency", 5, emergency);
+    ros::Subscriber disconnect_subscriber = n.subscribe<std_msgs::UInt8>("can_simulator/disconnect", 5, disconnect);
+    ros::Subscriber reconnect_subscriber = n.subscribe<std_msgs::UInt8>("can_simulator/reconnect", 5, reconnect);
+
+    ROS_INFO("can_device_simulator: %zu devices on %s", devices.size(), busname.c_str());
+
+    using clock = std::chrono::steady_clock;
+    const auto step_period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / rate));
+    auto next_step = clock::now();
+    auto last_report = next_step;
+
+    while (ros::ok())
+    {
+        for (const can_frame& frame : out)
+        {
+            socket.write(frame);
+        }
+        out.clear();
+
+        const auto now = clock::now();
+        if (now >= next_step)
+        {
+            const double dt = std::chrono::duration<double>(step_period).count();
+            for (auto& device : devices)
+            {
+                device->step(dt, out);
+            }
+            next_step += step_period;
+            ros::spinOnce();
+            if (now - next_step > 10 * step_period)
+            {
+                next_step = now;
+            }
+        }
+
+        if (now - last_report >= std::chrono::seconds(1))
+        {
+            diagnostic_msgs::DiagnosticArray array;
+            array.header.stamp = ros::Time::now();
+            for (auto& entry : latency)
+            {
+                diagnostic_msgs::DiagnosticStatus status;
+                status.name = "device" + std::to_string(entry.first) + "/command_to_feedback";
+                status.hardware_id = "device" + std::to_string(entry.first);
+                status.level = diagnostic_msgs::DiagnosticStatus::OK;
+                status.values.push_back(tfr_can::keyValue("samples", entry.second.samples));
+                status.values.push_back(tfr_can::keyValue("latency_mean_ms",
+                            entry.second.samples ? 1000 * entry.second.sum / entry.second.samples : 0));
+                status.values.push_back(tfr_can::keyValue("latency_max_ms", 1000 * entry.second.max));
+                array.status.push_back(status);
+                entry.second.samples = 0;
+                entry.second.sum = 0;
+                entry.second.max = 0;
+            }
+            diagnostics_publisher.publish(array);
+            last_report = now;
+        }
+
+        const int timeout_ms = static_cast<int>(std::max<int64_t>(0,
+                    std::chrono::duration_cast<std::chrono::milliseconds>(next_step - clock::now()).count()));
+
+        can_frame frame;
+        timeval stamp;
+        bool outgoing;
+        if (!socket.read(frame, stamp, outgoing, timeout_ms))
+        {
+            continue;
+        }
+
+        if ((frame.can_id & CAN_SFF_MASK) == SYNC_ID)
+        {
+            for (auto& device : devices)
+            {
+                device->sync(out);
+            }
+            continue;
+        }
+
+        for (auto& device : devices)
+        {
+            LatencyStats& stats = latency[device->getNodeId()];
+            if (device->handleFrame(frame, out))
+            {
+                stats.command_pending = true;
+                stats.command_stamp = stamp;
+            }
+            if (device->takeFeedbackRead() && stats.command_pending)
+            {
+                const double seconds = secondsBetween(stats.command_stamp, stamp);
+                stats.command_pending = false;
+                stats.samples++;
+                stats.sum += seconds;
+                stats.max = std::max(stats.max, seconds);
+            }
+        }
+    }
+    return 0;
+}
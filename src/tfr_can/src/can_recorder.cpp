@@ -0,0 +1,216 @@
+/****************************************************************************************
+ * File:            can_recorder.cpp
+ *
+ * Purpose:         Implementation of CanRecorder and CanRecording, see
+ *                  tfr_can/include/tfr_can/can_recorder.h
+ ***************************************************************************************/
+#include "can_recorder.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+
+namespace tfr_can
+{
+    CanRecorder::CanRecorder() :
+        header{nullptr},
+        records{nullptr},
+        mapped_size{0},
+        running{false}
+    {
+    }
+
+    CanRecorder::~CanRecorder()
+    {
+        stop();
+    }
+
+    bool CanRecorder::start(const std::string& path, size_t capacity, const std::string& busname)
+    {
+        stop();
+        if (capacity == 0)
+        {
+            return false;
+        }
+
+        if (!socket.open(busname))
+        {
+            return false;
+        }
+
+        std::rename(path.c_str(), (path + ".prev").c_str());
+        const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+            socket.close();
+            return false;
+        }
+
+        const size_t size = sizeof(RecordingHeader) + capacity * sizeof(FrameRecord);
+        void* mapping = MAP_FAILED;
+        if (::ftruncate(fd, size) == 0)
+        {
+            mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        // The mapping keeps the file open.
+        ::close(fd);
+        if (mapping == MAP_FAILED)
+        {
+            socket.close();
+            return false;
+        }
+
+        mapped_size = size;
+        header = static_cast<RecordingHeader*>(mapping);
+        records = reinterpret_cast<FrameRecord*>(header + 1);
+
+        std::memcpy(header->magic, RECORDING_MAGIC, sizeof(header->magic));
+        header->version = RECORDING_VERSION;
+        header->record_size = sizeof(FrameRecord);
+        header->capacity = capacity;
+        header->written = 0;
+
+        running = true;
+        worker = std::thread{&CanRecorder::record, this};
+        return true;
+    }
+
+    void CanRecorder::stop()
+    {
+        running = false;
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+        socket.close();
+        unmap();
+    }
+
+    uint64_t CanRecorder::framesRecorded() const
+    {
+        return header == nullptr ? 0 : __atomic_load_n(&header->written, __ATOMIC_ACQUIRE);
+    }
+
+    void CanRecorder::record()
+    {
+        const uint64_t capacity = header->capacity;
+        uint64_t written = 0;
+
+        can_frame frame;
+        timeval stamp;
+        bool outgoing;
+        while (running)
+        {
+            if (!socket.read(frame, stamp, outgoing, 100))
+            {
+                continue;
+            }
+
+            FrameRecord& record = records[written % capacity];
+            record.stamp_us = static_cast<int64_t>(stamp.tv_sec) * 1000000 + stamp.tv_usec;
+            record.can_id = frame.can_id;
+            record.dlc = frame.can_dlc;
+            record.flags = outgoing ? FrameRecord::OUTGOING : 0;
+            record.reserved[0] = 0;
+            record.reserved[1] = 0;
+            std::memcpy(record.data, frame.data, sizeof(record.data));
+
+            written++;
+            // Publish the count only once the frame is complete, so a reader
+            // of a recording cut short by a crash never sees a partial frame.
+            __atomic_store_n(&header->written, written, __ATOMIC_RELEASE);
+        }
+    }
+
+    void CanRecorder::unmap()
+    {
+        if (header != nullptr)
+        {
+            ::msync(header, mapped_size, MS_SYNC);
+            ::munmap(header, mapped_size);
+            header = nullptr;
+            records = nullptr;
+            mapped_size = 0;
+        }
+    }
+
+    CanRecording::CanRecording() :
+        header{nullptr},
+        records{nullptr},
+        mapped_size{0},
+        first{0},
+        count{0}
+    {
+    }
+
+    CanRecording::~CanRecording()
+    {
+        if (header != nullptr)
+        {
+            ::munmap(const_cast<RecordingHeader*>(header), mapped_size);
+        }
+    }
+
+    bool CanRecording::open(const std::string& path)
+    {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        struct stat info;
+        void* mapping = MAP_FAILED;
+        if (::fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(RecordingHeader))
+        {
+            mapping = ::mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (mapping == MAP_FAILED)
+        {
+            return false;
+        }
+
+        const RecordingHeader* candidate = static_cast<const RecordingHeader*>(mapping);
+        const size_t size = info.st_size;
+        if (std::memcmp(candidate->magic, RECORDING_MAGIC, sizeof(candidate->magic)) != 0 ||
+                candidate->version != RECORDING_VERSION ||
+                candidate->record_size != sizeof(FrameRecord) ||
+                candidate->capacity == 0 ||
+                size < sizeof(RecordingHeader) + candidate->capacity * sizeof(FrameRecord))
+        {
+            ::munmap(mapping, size);
+            return false;
+        }
+
+        header = candidate;
+        records = reinterpret_cast<const FrameRecord*>(header + 1);
+        mapped_size = size;
+
+        const uint64_t written = header->written;
+        if (written > header->capacity)
+        {
+            first = written % header->capacity;
+            count = header->capacity;
+        }
+        else
+        {
+            first = 0;
+            count = written;
+        }
+        return true;
+    }
+
+    size_t CanRecording::size() const
+    {
+        return count;
+    }
+
+    const FrameRecord& CanRecording::at(size_t i) const
+    {
+        return records[(first + i) % header->capacity];
+    }
+}
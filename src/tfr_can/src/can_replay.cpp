@@ -0,0 +1,152 @@
+/****************************************************************************************
+ * File:    can_replay.cpp
+ *
+ * Purpose: Plays a recording made by the bridge's flight recorder (see can_recorder.h)
+ *          back onto a virtual CAN interface, so it can be looked at with candump,
+ *          fed to the bridge or to the bus tooling.
+ *
+ *          Usage:
+ *              can_replay <recording> [interface] [speed]
+ *              can_replay --print <recording>
+ *
+ *          interface defaults to vcan0. speed is a multiplier on the original timing,
+ *          2 plays twice as fast, 0 sends the frames back to back. --print writes the
+ *          recording to stdout in the same format as "candump -t a".
+ *
+ *          Only vcan interfaces are accepted, replaying a recording onto the real bus
+ *          would move the robot.
+ ***************************************************************************************/
+#include "can_recorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+namespace
+{
+    void usage()
+    {
+        std::fprintf(stderr,
+                "usage: can_replay <recording> [interface=vcan0] [speed=1]\n"
+                "       can_replay --print <recording>\n");
+    }
+
+    void print(const tfr_can::FrameRecord& record)
+    {
+        const bool extended = record.can_id & CAN_EFF_FLAG;
+        const canid_t id = record.can_id & (extended ? CAN_EFF_MASK : CAN_SFF_MASK);
+        std::printf(" (%lld.%06lld)  %s  %0*X   [%u] ",
+                static_cast<long long>(record.stamp_us / 1000000),
+                static_cast<long long>(record.stamp_us % 1000000),
+                (record.flags & tfr_can::FrameRecord::OUTGOING) ? "TX" : "RX",
+                extended ? 8 : 3, id, record.dlc);
+        for (unsigned i = 0; i < record.dlc && i < 8; i++)
+        {
+            std::printf(" %02X", record.data[i]);
+        }
+        std::printf("\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        usage();
+        return 1;
+    }
+
+    const bool print_only = std::string{argv[1]} == "--print";
+    if (print_only && argc < 3)
+    {
+        usage();
+        return 1;
+    }
+
+    const std::string path = print_only ? argv[2] : argv[1];
+    tfr_can::CanRecording recording;
+    if (!recording.open(path))
+    {
+        std::fprintf(stderr, "can_replay: %s is not a CAN recording.\n", path.c_str());
+        return 1;
+    }
+
+    if (print_only)
+    {
+        for (size_t i = 0; i < recording.size(); i++)
+        {
+            print(recording.at(i));
+        }
+        return 0;
+    }
+
+    const std::string busname = argc > 2 ? argv[2] : "vcan0";
+    const double speed = argc > 3 ? std::atof(argv[3]) : 1.0;
+    if (busname.compare(0, 4, "vcan") != 0)
+    {
+        std::fprintf(stderr, "can_replay: refusing to replay onto %s, only vcan interfaces are allowed.\n",
+                busname.c_str());
+        return 1;
+    }
+    if (speed < 0)
+    {
+        std::fprintf(stderr, "can_replay: speed must not be negative.\n");
+        return 1;
+    }
+
+    tfr_can::CanSocket socket;
+    if (!socket.open(busname))
+    {
+        std::fprintf(stderr, "can_replay: could not open %s, run setupVCAN.sh first.\n", busname.c_str());
+        return 1;
+    }
+
+    if (recording.size() == 0)
+    {
+        return 0;
+    }
+
+    std::printf("can_replay: %zu frames, %.1f s, onto %s\n", recording.size(),
+            (recording.at(recording.size() - 1).stamp_us - recording.at(0).stamp_us) / 1e6,
+            busname.c_str());
+
+    using clock = std::chrono::steady_clock;
+    const auto start = clock::now();
+    const int64_t first_stamp = recording.at(0).stamp_us;
+    size_t dropped = 0;
+    for (size_t i = 0; i < recording.size(); i++)
+    {
+        const tfr_can::FrameRecord& record = recording.at(i);
+        if (speed > 0)
+        {
+            const double offset = (record.stamp_us - first_stamp) / 1e6 / speed;
+            std::this_thread::sleep_until(start +
+                    std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(offset)));
+        }
+
+        can_frame frame{};
+        frame.can_id = record.can_id;
+        frame.can_dlc = record.dlc;
+        std::copy(record.data, record.data + sizeof(record.data), frame.data);
+        while (!socket.write(frame))
+        {
+            // The vcan queue is full. At the original timing the frame is
+            // counted as lost, back to back we give the readers a moment.
+            if (speed > 0)
+            {
+                dropped++;
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+
+    if (dropped > 0)
+    {
+        std::fprintf(stderr, "can_replay: %zu frames could not be sent.\n", dropped);
+    }
+    return 0;
+}
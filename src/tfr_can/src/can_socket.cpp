@@ -0,0 +1,130 @@
+/****************************************************************************************
+ * File:            can_socket.cpp
+ *
+ * Purpose:         Implementation of CanSocket, see tfr_can/include/tfr_can/can_socket.h
+ ***************************************************************************************/
+#include "can_socket.h"
+
+#include <linux/can/raw.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cstring>
+
+namespace tfr_can
+{
+    CanSocket::CanSocket() : fd{-1}
+    {
+    }
+
+    CanSocket::~CanSocket()
+    {
+        close();
+    }
+
+    bool CanSocket::open(const std::string& busname, bool receive_own)
+    {
+        close();
+
+        fd = ::socket(PF_CAN, SOCK_RAW, CAN_RAW);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        ifreq ifr{};
+        std::strncpy(ifr.ifr_name, busname.c_str(), IFNAMSIZ - 1);
+        if (::ioctl(fd, SIOCGIFINDEX, &ifr) < 0)
+        {
+            close();
+            return false;
+        }
+
+        const int enable = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_TIMESTAMP, &enable, sizeof(enable));
+        if (receive_own)
+        {
+            ::setsockopt(fd, SOL_CAN_RAW, CAN_RAW_RECV_OWN_MSGS, &enable, sizeof(enable));
+        }
+
+        sockaddr_can addr{};
+        addr.can_family = AF_CAN;
+        addr.can_ifindex = ifr.ifr_ifindex;
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void CanSocket::close()
+    {
+        if (fd >= 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    bool CanSocket::isOpen() const
+    {
+        return fd >= 0;
+    }
+
+    bool CanSocket::read(can_frame& frame, timeval& stamp, bool& outgoing, int timeout_ms)
+    {
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        pollfd pfd{fd, POLLIN, 0};
+        if (::poll(&pfd, 1, timeout_ms) <= 0)
+        {
+            return false;
+        }
+
+        iovec iov{&frame, sizeof(frame)};
+        char control[CMSG_SPACE(sizeof(timeval))];
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (::recvmsg(fd, &msg, 0) < static_cast<ssize_t>(sizeof(frame)))
+        {
+            return false;
+        }
+
+        // Frames looped back from another socket on this machine are flagged
+        // with MSG_DONTROUTE by the kernel.
+        outgoing = (msg.msg_flags & MSG_DONTROUTE) != 0;
+
+        stamp = timeval{};
+        for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_TIMESTAMP)
+            {
+                std::memcpy(&stamp, CMSG_DATA(cmsg), sizeof(stamp));
+            }
+        }
+        if (stamp.tv_sec == 0 && stamp.tv_usec == 0)
+        {
+            ::gettimeofday(&stamp, nullptr);
+        }
+        return true;
+    }
+
+    bool CanSocket::write(const can_frame& frame)
+    {
+        if (fd < 0)
+        {
+            return false;
+        }
+        return ::write(fd, &frame, sizeof(frame)) == static_cast<ssize_t>(sizeof(frame));
+    }
+}
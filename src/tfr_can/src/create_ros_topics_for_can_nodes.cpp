@@ -5,6 +5,14 @@
 #include "joint_state_subscriber.h"
 #include "entry_publisher.h"
 #include "entry_subscriber.h"
+#include "bus_scheduler.h"
+#include "can_recorder.h"
+#include "cached_entry.h"
+#include "node_watchdog.h"
+#include "lpms_imu_publisher.h"
+
+#include <std_msgs/UInt16.h>
+#include <std_msgs/UInt32.h>
 
 #include <thread>
 #include <chrono>
@@ -14,7 +22,9 @@
 //#include <ros/package.h> // for looking up the location of the current package, in order to find our EDS files.
 //#include <ros>
 
-const std::string busname = "can1";
+// Can be overridden with the ~busname parameter, e.g. vcan0 to run against
+// can_device_simulator.
+const std::string default_busname = "can1";
 
 // Set the baudrate of your CAN bus. Most drivers support the values
 // "1M", "500K", "125K", "100K", "50K", "20K", "10K" and "5K".
@@ -23,7 +33,25 @@ const std::string baudrate = "250K";
 const size_t num_devices_required = 5;
 
 const double loop_rate = 32; // 32 Hz
-const int slow_loop_rate = 1; // 1 Hz
+
+// The polled entries are spread over slots of 1/128 s, four per fast loop,
+// and together with the reserved writes may use up to 80% of the bus so that
+// PDOs, heartbeats and commands always find room.
+const unsigned bitrate = 250000;
+const double scheduler_slot_rate = 128;
+const double scheduler_load_budget = 0.8;
+
+// Every node sends a heartbeat every 100 ms (about 2% of the bus for all of
+// them), a node is lost after 2.5 periods without one. A reset node has 3
+// seconds to send its boot-up message.
+const uint16_t heartbeat_time_ms = 100;
+const double missed_heartbeats = 2.5;
+const double boot_timeout = 3.0;
+
+// The flight recorder keeps the last 4M frames (96 MB), about 40 minutes of a
+// fully loaded 250K bus. A relative path ends up in ROS_HOME (~/.ros).
+const std::string default_flight_recorder_path = "can_flight_recording.bin";
+const int default_flight_recorder_frames = 4 * 1024 * 1024;
 
 // CANopen node IDs:
 const int SERVO_CYLINDER_LOWER_ARM = 23;
@@ -32,97 +60,122 @@ const int SERVO_CYLINDER_SCOOP = 56;
 const int TURNTABLE = 1;
 const int SERVO_CYLINDER_BIN_LEFT = 77; 
 const int SERVO_CYLINDER_BIN_RIGHT = 88; 
+const int LPMS_IMU = 120;
+
+// The digging action server streams setpoints to set_joint_state of the four
+// arm actuators at its ~stream_rate, ~setpoint_rate has to match it. Each one
+// is written by kacanopen as the target position download and two controlword
+// read-modify-writes for the new set-point handshake, five expedited SDO
+// transfers of two frames. At 10 Hz that is 54 kbit/s, over a fifth of the
+// bus, which is reserved in the scheduler budget.
+const double default_setpoint_rate = 10;
+const unsigned frames_per_setpoint = 10;
+const int streamed_actuators[] = {SERVO_CYLINDER_LOWER_ARM, SERVO_CYLINDER_UPPER_ARM,
+    SERVO_CYLINDER_SCOOP, TURNTABLE};
+
+// Name used for an entry in the bus scheduler statistics, matches the topic
+// prefix kacanopen uses, e.g. "device23/torque_actual_value".
+std::string deviceEntryName(kaco::Device& device, const std::string& entry)
+{
+    return "device" + std::to_string(device.get_node_id()) + "/" + entry;
+}
+
+// Puts a DS402 device in profile position mode and enables it, done at setup
+// and again when the watchdog recovers the node.
+void enableProfilePosition(kaco::Device& device)
+{
+    PRINT("Set position mode");
+    device.set_entry("modes_of_operation", device.get_constant("profile_position_mode"));
+
+    PRINT("Enable operation");
+    device.execute("enable_operation");
+}
 
 // initialize the topics for any Servo Cylinder actuator 
-void setupServoCylinderDevice(kaco::Device& device, kaco::Bridge& bridge, std::string& eds_files_path)
+void setupServoCylinderDevice(kaco::Device& device, kaco::Bridge& bridge, tfr_can::BusScheduler& scheduler, tfr_can::NodeWatchdog& watchdog, std::string& eds_files_path)
 {
     
     device.load_dictionary_from_library();
     
     device.load_dictionary_from_eds(eds_files_path + "SC_MC630R11_v_0_7_OD.eds");
     
-    PRINT("Set position mode");
-    device.set_entry("modes_of_operation", device.get_constant("profile_position_mode"));
-
-    PRINT("Enable operation");
-    device.execute("enable_operation");
+    enableProfilePosition(device);
+    watchdog.configureHeartbeat(device);
 
 
 	// min: 0 -> 0, 
 	// max: 47104 -> 6.28==2pi
     auto jspub = std::make_shared<kaco::JointStatePublisher>(device, 0, 47104); 
-    bridge.add_publisher(jspub, loop_rate);
+    scheduler.add(jspub, deviceEntryName(device, "joint_state"), device.get_node_id(), loop_rate, tfr_can::Priority::CRITICAL);
     
     auto jssub = std::make_shared<kaco::JointStateSubscriber>(device, 0, 47104);
     bridge.add_subscriber(jssub);
     
     // read the current torque value
     auto iopub_1 = std::make_shared<kaco::EntryPublisher>(device, "torque_actual_value");
-    bridge.add_publisher(iopub_1, loop_rate);
+    scheduler.add(iopub_1, deviceEntryName(device, "torque_actual_value"), device.get_node_id(), loop_rate, tfr_can::Priority::NORMAL);
     
     auto iosub_1 = std::make_shared<kaco::EntrySubscriber>(device, "torque_actual_value");
     bridge.add_subscriber(iosub_1);
     
-    // read/write the max allowed torque value
-    auto iopub_2 = std::make_shared<kaco::EntryPublisher>(device, "max_torque");
-    bridge.add_publisher(iopub_2, slow_loop_rate);
-    
-    auto iosub_2 = std::make_shared<kaco::EntrySubscriber>(device, "max_torque");
-    bridge.add_subscriber(iosub_2);
+    // read/write the max allowed torque value, only read again after a write
+    auto iocache_2 = std::make_shared<tfr_can::CachedEntry<std_msgs::UInt16>>(device, "max_torque");
+    bridge.add_subscriber(iocache_2);
     
     
+    // read the statusword, bit 10 tells when the cylinder reached its target
+    // position, see setupMaxonDevice
+    auto iopub_8 = std::make_shared<kaco::EntryPublisher>(device, "statusword");
+    scheduler.add(iopub_8, deviceEntryName(device, "statusword"), device.get_node_id(), loop_rate, tfr_can::Priority::CRITICAL);
+
     // read the current velocity value
     auto iopub_3 = std::make_shared<kaco::EntryPublisher>(device, "velocity_actual_value");
-    bridge.add_publisher(iopub_3, loop_rate);
+    scheduler.add(iopub_3, deviceEntryName(device, "velocity_actual_value"), device.get_node_id(), loop_rate, tfr_can::Priority::NORMAL);
     
     // read/write max speed
-    auto iopub_4 = std::make_shared<kaco::EntryPublisher>(device, "profile_velocity");
-    bridge.add_publisher(iopub_4, slow_loop_rate);
-    
-    auto iosub_4 = std::make_shared<kaco::EntrySubscriber>(device, "profile_velocity");
-    bridge.add_subscriber(iosub_4);
+    auto iocache_4 = std::make_shared<tfr_can::CachedEntry<std_msgs::UInt32>>(device, "profile_velocity");
+    bridge.add_subscriber(iocache_4);
 
     // read/write heartbeat time interval in milliseconds
-    auto iopub_5 = std::make_shared<kaco::EntryPublisher>(device, "producer_heartbeat_time");
-    bridge.add_publisher(iopub_5, slow_loop_rate);
-    
-    auto iosub_5 = std::make_shared<kaco::EntrySubscriber>(device, "producer_heartbeat_time");
-    bridge.add_subscriber(iosub_5);
+    auto iocache_5 = std::make_shared<tfr_can::CachedEntry<std_msgs::UInt16>>(device, "producer_heartbeat_time");
+    bridge.add_subscriber(iocache_5);
     
     // profile_acceleration
-    auto iopub_6 = std::make_shared<kaco::EntryPublisher>(device, "profile_acceleration");
-    bridge.add_publisher(iopub_6, slow_loop_rate);
-    
-    auto iosub_6 = std::make_shared<kaco::EntrySubscriber>(device, "profile_acceleration");
-    bridge.add_subscriber(iosub_6);
+    auto iocache_6 = std::make_shared<tfr_can::CachedEntry<std_msgs::UInt32>>(device, "profile_acceleration");
+    bridge.add_subscriber(iocache_6);
     
     
     // profile_deceleration
-    auto iopub_7 = std::make_shared<kaco::EntryPublisher>(device, "profile_deceleration");
-    bridge.add_publisher(iopub_7, slow_loop_rate);
-    
-    auto iosub_7 = std::make_shared<kaco::EntrySubscriber>(device, "profile_deceleration");
-    bridge.add_subscriber(iosub_7);
+    auto iocache_7 = std::make_shared<tfr_can::CachedEntry<std_msgs::UInt32>>(device, "profile_deceleration");
+    bridge.add_subscriber(iocache_7);
+
+    // after a reset put back what was written through the set_ topics,
+    // the heartbeat time is set again by the watchdog itself
+    watchdog.watch(device, [&device, iocache_2, iocache_4, iocache_6, iocache_7]()
+    {
+        iocache_2->restore();
+        iocache_4->restore();
+        iocache_6->restore();
+        iocache_7->restore();
+        enableProfilePosition(device);
+    });
 }
 
-void setupMaxonDevice(kaco::Device& device, kaco::Bridge& bridge, std::string& eds_files_path)
+void setupMaxonDevice(kaco::Device& device, kaco::Bridge& bridge, tfr_can::BusScheduler& scheduler, tfr_can::NodeWatchdog& watchdog, std::string& eds_files_path)
 {
     
     device.load_dictionary_from_library();
     
     device.load_dictionary_from_eds(eds_files_path + "tfr_epos4_config.dcf");
     
-    PRINT("Set position mode");
-    device.set_entry("modes_of_operation", device.get_constant("profile_position_mode"));
-
-    PRINT("Enable operation");
-    device.execute("enable_operation");
+    enableProfilePosition(device);
+    watchdog.configureHeartbeat(device);
 
 
     // min: 0 -> 0, 
     // max: 1024 encoder clicks * 4.3 Maxon gear * 70 worm gear = 308224   
     auto jspub = std::make_shared<kaco::JointStatePublisher>(device, -308224, 308224); 
-    bridge.add_publisher(jspub, loop_rate);
+    scheduler.add(jspub, deviceEntryName(device, "joint_state"), device.get_node_id(), loop_rate, tfr_can::Priority::CRITICAL);
     
     auto jssub = std::make_shared<kaco::JointStateSubscriber>(device, -308224, 308224); 
     bridge.add_subscriber(jssub);		
@@ -137,11 +190,15 @@ void setupMaxonDevice(kaco::Device& device, kaco::Bridge& bridge, std::string& e
     // The reason for reading the statusword is to check when the motor reaches the target position.
     // This way, the digging queue can wait until the arm is in the expected position before moving to the next one.
     auto iopub_1 = std::make_shared<kaco::EntryPublisher>(device, "statusword");
-    bridge.add_publisher(iopub_1, loop_rate);
+    scheduler.add(iopub_1, deviceEntryName(device, "statusword"), device.get_node_id(), loop_rate, tfr_can::Priority::CRITICAL);
 
     auto iopub_2 = std::make_shared<kaco::EntryPublisher>(device, "torque_actual_values/torque_actual_value_averaged");
-    bridge.add_publisher(iopub_2, loop_rate);
-    
+    scheduler.add(iopub_2, deviceEntryName(device, "torque_actual_values/torque_actual_value_averaged"), device.get_node_id(), loop_rate, tfr_can::Priority::NORMAL);
+
+    watchdog.watch(device, [&device]()
+    {
+        enableProfilePosition(device);
+    });
 }
 
 // Usage: e.g. intToHexString(10) == "A"
@@ -171,7 +228,29 @@ void resetCanopenNode(std::string busname, int node_id)
 
 int main(int argc, char* argv[]) {
 
-	
+	ros::init(argc, argv, "canopen_bridge");
+	std::string busname;
+	ros::param::param<std::string>("~busname", busname, default_busname);
+
+	// Start recording before anything is sent, so the resets and boot-ups
+	// below are in the recording too. An empty path turns the recorder off.
+	std::string flight_recorder_path;
+	int flight_recorder_frames;
+	ros::param::param<std::string>("~flight_recorder_path", flight_recorder_path, default_flight_recorder_path);
+	ros::param::param<int>("~flight_recorder_frames", flight_recorder_frames, default_flight_recorder_frames);
+	tfr_can::CanRecorder recorder;
+	if (!flight_recorder_path.empty() && flight_recorder_frames > 0)
+	{
+		if (recorder.start(flight_recorder_path, flight_recorder_frames, busname))
+		{
+			PRINT("Recording the bus to " << flight_recorder_path);
+		}
+		else
+		{
+			ERROR("Could not start the flight recorder on " << flight_recorder_path);
+		}
+	}
+
 	kaco::Master master;
 	if (!master.start(busname, baudrate)) {
 		ERROR("Starting master failed.");
@@ -221,8 +300,18 @@ int main(int argc, char* argv[]) {
 	}
 
 	// Create bridge
-	ros::init(argc, argv, "canopen_bridge");
 	kaco::Bridge bridge;
+	ros::NodeHandle n;
+	tfr_can::BusScheduler scheduler(n, bitrate, scheduler_slot_rate, scheduler_load_budget);
+	double setpoint_rate;
+	ros::param::param<double>("~setpoint_rate", setpoint_rate, default_setpoint_rate);
+	for (int node_id : streamed_actuators)
+	{
+		scheduler.reserve("device" + std::to_string(node_id) + "/set_joint_state",
+				setpoint_rate, frames_per_setpoint);
+	}
+	tfr_can::NodeWatchdog watchdog(n, master.core, scheduler, heartbeat_time_ms, missed_heartbeats, boot_timeout);
+	std::unique_ptr<tfr_can::LpmsImuPublisher> imu;
 
 	for (size_t i=0; i<master.num_devices(); ++i) {
 
@@ -242,32 +331,32 @@ int main(int argc, char* argv[]) {
 
         if (deviceId == SERVO_CYLINDER_LOWER_ARM)
         {
-            setupServoCylinderDevice(device, bridge, eds_files_path);
+            setupServoCylinderDevice(device, bridge, scheduler, watchdog, eds_files_path);
         }
 		
 		if (deviceId == SERVO_CYLINDER_UPPER_ARM)
         {
-            setupServoCylinderDevice(device, bridge, eds_files_path);
+            setupServoCylinderDevice(device, bridge, scheduler, watchdog, eds_files_path);
         }
 		
 		if (deviceId == SERVO_CYLINDER_SCOOP)
         {
-            setupServoCylinderDevice(device, bridge, eds_files_path);
+            setupServoCylinderDevice(device, bridge, scheduler, watchdog, eds_files_path);
         }
 		
 		if (deviceId == SERVO_CYLINDER_BIN_LEFT)
        {
-            setupServoCylinderDevice(device, bridge, eds_files_path);
+            setupServoCylinderDevice(device, bridge, scheduler, watchdog, eds_files_path);
        }
 
 		if (deviceId == SERVO_CYLINDER_BIN_RIGHT)
         {
-            setupServoCylinderDevice(device, bridge, eds_files_path);
+            setupServoCylinderDevice(device, bridge, scheduler, watchdog, eds_files_path);
         }
 		
 		if (deviceId == TURNTABLE) //THIS IS WHERE WE LOAD THE EDS LIBRARY
 	{
-	    setupMaxonDevice(device, bridge, eds_files_path);
+	    setupMaxonDevice(device, bridge, scheduler, watchdog, eds_files_path);
 	}
 		
 		
@@ -279,52 +368,79 @@ int main(int argc, char* argv[]) {
 		//	ROS_DEBUG_STREAM("tfr_can: case: Device 8" << std::endl);
 			
 			// Roboteq SBL2360.
+			watchdog.configureHeartbeat(device);
 
 			auto iosub_8_1_1 = std::make_shared<kaco::EntrySubscriber>(device, "cmd_cango/cmd_cango_1");
     		bridge.add_subscriber(iosub_8_1_1);
 
 			auto iopub_8_1_2 = std::make_shared<kaco::EntryPublisher>(device, "qry_motcmd/channel_1");
-    		bridge.add_publisher(iopub_8_1_2, loop_rate);
+    		scheduler.add(iopub_8_1_2, deviceEntryName(device, "qry_motcmd/channel_1"), device.get_node_id(), loop_rate, tfr_can::Priority::NORMAL);
 
 			auto iopub_8_1_3 = std::make_shared<kaco::EntryPublisher>(device, "qry_motamps/channel_1");
-    		bridge.add_publisher(iopub_8_1_3, loop_rate);
+    		scheduler.add(iopub_8_1_3, deviceEntryName(device, "qry_motamps/channel_1"), device.get_node_id(), loop_rate, tfr_can::Priority::NORMAL);
 			
 			//auto iopub_8_1_4 = std::make_shared<kaco::EntryPublisher>(device, "qry_blrspeed/channel_1");
     		//bridge.add_publisher(iopub_8_1_4, loop_rate);
     		
     		auto iopub_8_1_5 = std::make_shared<kaco::EntryPublisher>(device, "qry_blcntr/qry_blcntr_1");
-    		bridge.add_publisher(iopub_8_1_5, loop_rate);
+    		scheduler.add(iopub_8_1_5, deviceEntryName(device, "qry_blcntr/qry_blcntr_1"), device.get_node_id(), loop_rate, tfr_can::Priority::CRITICAL);
 			
             auto iopub_8_1_6 = std::make_shared<kaco::EntryPublisher>(device, "qry_abcntr/channel_1");
-    		bridge.add_publisher(iopub_8_1_6, loop_rate);
+    		scheduler.add(iopub_8_1_6, deviceEntryName(device, "qry_abcntr/channel_1"), device.get_node_id(), loop_rate, tfr_can::Priority::NORMAL);
 			
 			auto iosub_8_2_1 = std::make_shared<kaco::EntrySubscriber>(device, "cmd_cango/cmd_cango_2");
     		bridge.add_subscriber(iosub_8_2_1);
 
 			auto iopub_8_2_2 = std::make_shared<kaco::EntryPublisher>(device, "qry_motcmd/channel_2");
-    		bridge.add_publisher(iopub_8_2_2, loop_rate);
+    		scheduler.add(iopub_8_2_2, deviceEntryName(device, "qry_motcmd/channel_2"), device.get_node_id(), loop_rate, tfr_can::Priority::NORMAL);
 
 			auto iopub_8_2_3 = std::make_shared<kaco::EntryPublisher>(device, "qry_motamps/channel_2");
-    		bridge.add_publisher(iopub_8_2_3, loop_rate);
+    		scheduler.add(iopub_8_2_3, deviceEntryName(device, "qry_motamps/channel_2"), device.get_node_id(), loop_rate, tfr_can::Priority::NORMAL);
 			
 			//auto iopub_8_2_4 = std::make_shared<kaco::EntryPublisher>(device, "qry_blrspeed/channel_2");
     		//bridge.add_publisher(iopub_8_2_4, loop_rate);
     		
     		auto iopub_8_2_5 = std::make_shared<kaco::EntryPublisher>(device, "qry_blcntr/qry_blcntr_2");
-    		bridge.add_publisher(iopub_8_2_5, loop_rate);
+    		scheduler.add(iopub_8_2_5, deviceEntryName(device, "qry_blcntr/qry_blcntr_2"), device.get_node_id(), loop_rate, tfr_can::Priority::CRITICAL);
 
             auto iopub_8_2_6 = std::make_shared<kaco::EntryPublisher>(device, "qry_abcntr/channel_2");
-    		bridge.add_publisher(iopub_8_2_6, loop_rate);
+    		scheduler.add(iopub_8_2_6, deviceEntryName(device, "qry_abcntr/channel_2"), device.get_node_id(), loop_rate, tfr_can::Priority::NORMAL);
+
+			// nothing to configure, cmd_cango is sent continuously by the drivebase
+			watchdog.watch(device, nullptr);
 			
 		}
+
+		else if (deviceId == LPMS_IMU)
+		{
+			// The IMU sends its samples as PDOs on its own, nothing is polled.
+			// It has no heartbeat producer, so it is not watched.
+			device.load_dictionary_from_eds(eds_files_path + "LPMS-CU2_32BitDataSettings.eds");
+			imu.reset(new tfr_can::LpmsImuPublisher(n, master.core, LPMS_IMU,
+						tfr_can::LpmsImuPublisher::loadParameters()));
+		}
 		
 		
 
 	}
+	scheduler.start(busname);
+	watchdog.start();
+	if (imu)
+	{
+		imu->start();
+	}
+
 	PRINT("About to call bridge.run()");
 	bridge.run();
 	
+    if (imu)
+    {
+        imu->stop();
+    }
+    watchdog.stop();
+    scheduler.stop();
     master.stop();
+    recorder.stop();
     
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,194 @@
+/****************************************************************************************
+ * File:            lpms_imu_publisher.cpp
+ *
+ * Purpose:         Implementation of LpmsImuPublisher, see
+ *                  tfr_can/include/tfr_can/lpms_imu_publisher.h for details.
+ ***************************************************************************************/
+#include "lpms_imu_publisher.h"
+#include "logger.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace tfr_can
+{
+    namespace
+    {
+        const uint16_t TPDO1_ID = 0x180;
+
+        // Variances from the LPMS-CU2 data sheet: 2 degrees dynamic orientation
+        // accuracy, about 0.01 rad/s gyroscope and 0.05 m/s^2 accelerometer noise.
+        const double ORIENTATION_VARIANCE = 0.0012;
+        const double ANGULAR_VELOCITY_VARIANCE = 1e-4;
+        const double LINEAR_ACCELERATION_VARIANCE = 2.5e-3;
+        // the vertical acceleration is not sent
+        const double UNKNOWN_VARIANCE = 1e6;
+
+        float littleEndianFloat(const uint8_t* data)
+        {
+            const uint32_t bits = data[0] | (data[1] << 8) | (data[2] << 16)
+                | (static_cast<uint32_t>(data[3]) << 24);
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        void setDiagonal(boost::array<double, 9>& covariance, double x, double y, double z)
+        {
+            covariance.fill(0);
+            covariance[0] = x;
+            covariance[4] = y;
+            covariance[8] = z;
+        }
+    }
+
+    LpmsImuPublisher::LpmsImuPublisher(ros::NodeHandle& n, kaco::Core& core, uint8_t node_id,
+            const Parameters& parameters) :
+        publisher{n.advertise<sensor_msgs::Imu>(parameters.topic, 10)},
+        core(core),
+        node_id{node_id},
+        parameters(parameters),
+        values{},
+        received{0},
+        dropped{0},
+        running{false},
+        callback_registered{false}
+    {
+        sample.header.frame_id = parameters.frame_id;
+        setDiagonal(sample.orientation_covariance,
+                ORIENTATION_VARIANCE, ORIENTATION_VARIANCE, ORIENTATION_VARIANCE);
+        setDiagonal(sample.angular_velocity_covariance,
+                ANGULAR_VELOCITY_VARIANCE, ANGULAR_VELOCITY_VARIANCE, ANGULAR_VELOCITY_VARIANCE);
+        setDiagonal(sample.linear_acceleration_covariance,
+                LINEAR_ACCELERATION_VARIANCE, LINEAR_ACCELERATION_VARIANCE, UNKNOWN_VARIANCE);
+    }
+
+    LpmsImuPublisher::~LpmsImuPublisher()
+    {
+        stop();
+    }
+
+    LpmsImuPublisher::Parameters LpmsImuPublisher::loadParameters()
+    {
+        Parameters parameters;
+        ros::param::param<std::string>("~imu/topic", parameters.topic, parameters.topic);
+        ros::param::param<std::string>("~imu/frame_id", parameters.frame_id, parameters.frame_id);
+        ros::param::param<double>("~imu/gyro_scale", parameters.gyro_scale, parameters.gyro_scale);
+        ros::param::param<double>("~imu/euler_scale", parameters.euler_scale, parameters.euler_scale);
+        ros::param::param<double>("~imu/acceleration_scale", parameters.acceleration_scale, parameters.acceleration_scale);
+        return parameters;
+    }
+
+    void LpmsImuPublisher::start()
+    {
+        if (running)
+        {
+            return;
+        }
+        running = true;
+        // kacanopen can't remove a receive callback, so it is only added once
+        // and ignores frames while stopped
+        if (!callback_registered)
+        {
+            callback_registered = true;
+            core.register_receive_callback([this](const kaco::Message& message)
+                    {
+                        if (running && !message.rtr)
+                        {
+                            receive(message.cob_id, message.data, message.len);
+                        }
+                    });
+        }
+        PRINT("LpmsImuPublisher: publishing device " << static_cast<int>(node_id)
+                << " on " << parameters.topic);
+    }
+
+    void LpmsImuPublisher::stop()
+    {
+        if (!running)
+        {
+            return;
+        }
+        running = false;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (dropped > 0)
+        {
+            PRINT("LpmsImuPublisher: dropped " << dropped << " incomplete samples.");
+        }
+    }
+
+    void LpmsImuPublisher::receive(uint16_t cob_id, const uint8_t* data, uint8_t length)
+    {
+        if ((cob_id & 0x7F) != node_id || length != 8)
+        {
+            return;
+        }
+        const uint16_t function = cob_id & ~0x7F;
+        if (function < TPDO1_ID || function > TPDO1_ID + 0x100 * (PDO_COUNT - 1)
+                || (function - TPDO1_ID) % 0x100 != 0)
+        {
+            return;
+        }
+        const int pdo = (function - TPDO1_ID) / 0x100;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pdo == 0)
+        {
+            // the first pdo starts a new burst
+            if (received != 0)
+            {
+                dropped++;
+            }
+            received = 0;
+            first_frame = ros::Time::now();
+        }
+        else if ((received & (1 << (pdo - 1))) == 0)
+        {
+            // the frames before this one were lost, wait for the next burst
+            if (received != 0)
+            {
+                dropped++;
+                received = 0;
+            }
+            return;
+        }
+        values[pdo][0] = littleEndianFloat(data);
+        values[pdo][1] = littleEndianFloat(data + 4);
+        received |= 1 << pdo;
+
+        if (received == ALL_PDOS)
+        {
+            publishSample();
+            received = 0;
+        }
+    }
+
+    /*
+     * The euler angles are roll, pitch and yaw, applied in z, y, x order.
+     * */
+    void LpmsImuPublisher::publishSample()
+    {
+        const double roll = values[1][1] * parameters.euler_scale;
+        const double pitch = values[2][0] * parameters.euler_scale;
+        const double yaw = values[2][1] * parameters.euler_scale;
+        const double cr = std::cos(roll / 2), sr = std::sin(roll / 2);
+        const double cp = std::cos(pitch / 2), sp = std::sin(pitch / 2);
+        const double cy = std::cos(yaw / 2), sy = std::sin(yaw / 2);
+
+        sample.header.stamp = first_frame;
+        sample.orientation.w = cr * cp * cy + sr * sp * sy;
+        sample.orientation.x = sr * cp * cy - cr * sp * sy;
+        sample.orientation.y = cr * sp * cy + sr * cp * sy;
+        sample.orientation.z = cr * cp * sy - sr * sp * cy;
+
+        sample.angular_velocity.x = values[0][0] * parameters.gyro_scale;
+        sample.angular_velocity.y = values[0][1] * parameters.gyro_scale;
+        sample.angular_velocity.z = values[1][0] * parameters.gyro_scale;
+
+        sample.linear_acceleration.x = values[3][0] * parameters.acceleration_scale;
+        sample.linear_acceleration.y = values[3][1] * parameters.acceleration_scale;
+        sample.linear_acceleration.z = 0;
+
+        publisher.publish(sample);
+    }
+}
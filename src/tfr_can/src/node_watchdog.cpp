@@ -0,0 +1,405 @@
+/****************************************************************************************
+ * File:            node_watchdog.cpp
+ *
+ * Purpose:         Implementation of NodeWatchdog, see
+ *                  tfr_can/include/tfr_can/node_watchdog.h for details.
+ ***************************************************************************************/
+#include "node_watchdog.h"
+#include "diagnostic_values.h"
+#include "logger.h"
+
+#include <std_msgs/Float64.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+namespace tfr_can
+{
+    namespace
+    {
+        const uint16_t EMCY_ID = 0x080;
+        const uint16_t HEARTBEAT_ID = 0x700;
+        const uint8_t NMT_STATE_BOOTUP = 0x00;
+
+        // How long to wait before trying to recover a node again.
+        const std::chrono::seconds RETRY_DELAY{2};
+
+        const char* healthName(NodeWatchdog::Health health)
+        {
+            switch (health)
+            {
+                case NodeWatchdog::Health::OK:
+                    return "ok";
+                case NodeWatchdog::Health::LOST:
+                    return "lost";
+                case NodeWatchdog::Health::FAULTED:
+                    return "faulted";
+                case NodeWatchdog::Health::RECOVERING:
+                    return "recovering";
+            }
+            return "";
+        }
+    }
+
+    NodeWatchdog::NodeWatchdog(ros::NodeHandle& n, kaco::Core& core, BusScheduler& scheduler,
+            uint16_t heartbeat_time_ms, double missed_heartbeats, double boot_timeout) :
+        health_publisher{n.advertise<diagnostic_msgs::DiagnosticArray>("can_bus/node_health", 5)},
+        recovery_time_publisher{n.advertise<std_msgs::Float64>("can_bus/recovery_time", 5)},
+        core(core),
+        scheduler(scheduler),
+        heartbeat_time_ms{heartbeat_time_ms},
+        heartbeat_timeout{std::chrono::duration_cast<clock::duration>(
+                std::chrono::duration<double>(missed_heartbeats * heartbeat_time_ms / 1000.0))},
+        boot_timeout{std::chrono::duration_cast<clock::duration>(
+                std::chrono::duration<double>(boot_timeout))},
+        running{false}
+    {
+    }
+
+    NodeWatchdog::~NodeWatchdog()
+    {
+        stop();
+    }
+
+    void NodeWatchdog::configureHeartbeat(kaco::Device& device)
+    {
+        device.set_entry("producer_heartbeat_time", heartbeat_time_ms, kaco::WriteAccessMethod::sdo);
+    }
+
+    void NodeWatchdog::watch(kaco::Device& device, std::function<void()> reinitialize)
+    {
+        if (running)
+        {
+            ERROR("NodeWatchdog: can't watch device " << static_cast<int>(device.get_node_id())
+                    << " while the watchdog is running.");
+            return;
+        }
+
+        Node node{};
+        node.device = &device;
+        node.reinitialize = reinitialize;
+        node.health = Health::OK;
+        node.nmt_state = NMT_STATE_BOOTUP;
+        node.booted = false;
+        nodes[device.get_node_id()] = node;
+    }
+
+    void NodeWatchdog::start()
+    {
+        if (running)
+        {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            const auto now = clock::now();
+            for (auto& node : nodes)
+            {
+                node.second.last_heartbeat = now;
+            }
+        }
+
+        running = true;
+        core.register_receive_callback([this](const kaco::Message& message)
+                {
+                    if (running && !message.rtr)
+                    {
+                        receive(message.cob_id, message.data, message.len);
+                    }
+                });
+        monitor_thread = std::thread{&NodeWatchdog::monitor, this};
+        recovery_thread = std::thread{&NodeWatchdog::recoverNodes, this};
+        PRINT("NodeWatchdog: watching " << nodes.size() << " nodes, heartbeat every "
+                << heartbeat_time_ms << " ms.");
+    }
+
+    void NodeWatchdog::stop()
+    {
+        if (!running)
+        {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+        }
+        changed.notify_all();
+        if (monitor_thread.joinable())
+        {
+            monitor_thread.join();
+        }
+        if (recovery_thread.joinable())
+        {
+            recovery_thread.join();
+        }
+    }
+
+    /*
+     * Called from kacanopen's receive thread for every frame on the bus.
+     * */
+    void NodeWatchdog::receive(uint16_t cob_id, const uint8_t* data, uint8_t length)
+    {
+        const bool heartbeat = cob_id > HEARTBEAT_ID && cob_id <= HEARTBEAT_ID + 0x7F;
+        const bool emergency = cob_id > EMCY_ID && cob_id <= EMCY_ID + 0x7F;
+        if (!heartbeat && !emergency)
+        {
+            return;
+        }
+
+        const uint8_t node_id = cob_id & 0x7F;
+        const auto now = clock::now();
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = nodes.find(node_id);
+        if (it == nodes.end())
+        {
+            return;
+        }
+        Node& node = it->second;
+
+        if (heartbeat && length >= 1)
+        {
+            node.last_heartbeat = now;
+            node.nmt_state = data[0] & 0x7F;
+            if (node.nmt_state != NMT_STATE_BOOTUP)
+            {
+                return;
+            }
+
+            if (node.health == Health::RECOVERING)
+            {
+                node.booted = true;
+                changed.notify_all();
+            }
+            else if (node.health == Health::OK)
+            {
+                markFaulted(node, "unexpected boot-up", now);
+            }
+        }
+        else if (emergency && length >= 2)
+        {
+            const uint16_t code = data[0] | (data[1] << 8);
+            if (code == 0)
+            {
+                // error reset / no error
+                return;
+            }
+            node.emergencies++;
+            node.last_emergency_code = code;
+            if (node.health == Health::OK)
+            {
+                std::ostringstream reason;
+                reason << "emergency 0x" << std::hex << std::setw(4) << std::setfill('0') << code;
+                markFaulted(node, reason.str(), now);
+            }
+        }
+    }
+
+    /*
+     * Expects the mutex to be held.
+     * */
+    void NodeWatchdog::markFaulted(Node& node, const std::string& reason, clock::time_point now)
+    {
+        node.health = Health::FAULTED;
+        node.reason = reason;
+        node.detected = now;
+        node.next_attempt = now;
+        ERROR("NodeWatchdog: device " << static_cast<int>(node.device->get_node_id()) << " " << reason);
+        changed.notify_all();
+    }
+
+    /*
+     * Looks for nodes that stopped sending heartbeats and publishes the node
+     * health.
+     * */
+    void NodeWatchdog::monitor()
+    {
+        const auto period = std::max<clock::duration>(std::chrono::milliseconds(10),
+                std::chrono::milliseconds(heartbeat_time_ms) / 4);
+        auto last_report = clock::now();
+
+        while (running && ros::ok())
+        {
+            std::this_thread::sleep_for(period);
+            const auto now = clock::now();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (auto& entry : nodes)
+                {
+                    Node& node = entry.second;
+                    if (node.health == Health::OK && now - node.last_heartbeat > heartbeat_timeout)
+                    {
+                        node.health = Health::LOST;
+                        node.reason = "no heartbeat";
+                        node.detected = now;
+                        node.next_attempt = now;
+                        ERROR("NodeWatchdog: device " << static_cast<int>(entry.first) << " lost, no heartbeat for "
+                                << std::chrono::duration<double>(now - node.last_heartbeat).count() << " s.");
+                        changed.notify_all();
+                    }
+                }
+            }
+
+            if (now - last_report >= std::chrono::seconds(1))
+            {
+                publishHealth();
+                last_report = now;
+            }
+        }
+    }
+
+    /*
+     * Recovers one node at a time, so the resets don't all hit the bus at once.
+     * */
+    void NodeWatchdog::recoverNodes()
+    {
+        while (running)
+        {
+            uint8_t node_id = 0;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait_for(lock, std::chrono::milliseconds(heartbeat_time_ms));
+                if (!running)
+                {
+                    return;
+                }
+
+                const auto now = clock::now();
+                for (auto& entry : nodes)
+                {
+                    const Node& node = entry.second;
+                    if ((node.health == Health::LOST || node.health == Health::FAULTED) &&
+                            now >= node.next_attempt)
+                    {
+                        node_id = entry.first;
+                        break;
+                    }
+                }
+            }
+
+            if (node_id != 0)
+            {
+                recover(node_id);
+            }
+        }
+    }
+
+    void NodeWatchdog::recover(uint8_t node_id)
+    {
+        Node* node;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            node = &nodes[node_id];
+            node->health = Health::RECOVERING;
+            node->booted = false;
+        }
+        PRINT("NodeWatchdog: recovering device " << static_cast<int>(node_id) << " (" << node->reason << ").");
+
+        // Stop polling the node, its SDO requests would only time out.
+        scheduler.pauseNode(node_id, true);
+        core.nmt.send_nmt_message(node_id, kaco::NMT::Command::reset_node);
+
+        bool booted;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            booted = changed.wait_for(lock, boot_timeout, [this, node]{ return node->booted || !running; })
+                && node->booted;
+            if (!booted)
+            {
+                node->health = Health::LOST;
+                node->next_attempt = clock::now() + RETRY_DELAY;
+                node->failed_recoveries++;
+            }
+        }
+        if (!booted)
+        {
+            ERROR("NodeWatchdog: device " << static_cast<int>(node_id) << " did not boot after a reset, retrying.");
+            return;
+        }
+
+        try
+        {
+            node->device->start();
+            configureHeartbeat(*node->device);
+            if (node->reinitialize)
+            {
+                node->reinitialize();
+            }
+        }
+        catch (const std::exception& error)
+        {
+            ERROR("NodeWatchdog: reinitializing device " << static_cast<int>(node_id) << " failed: " << error.what());
+            std::lock_guard<std::mutex> lock(mutex);
+            node->health = Health::FAULTED;
+            node->next_attempt = clock::now() + RETRY_DELAY;
+            node->failed_recoveries++;
+            return;
+        }
+
+        double recovery_time;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            const auto now = clock::now();
+            recovery_time = std::chrono::duration<double>(now - node->detected).count();
+            node->health = Health::OK;
+            node->reason.clear();
+            node->last_heartbeat = now;
+            node->recoveries++;
+            node->last_recovery_time = recovery_time;
+            node->max_recovery_time = std::max(node->max_recovery_time, recovery_time);
+        }
+        scheduler.pauseNode(node_id, false);
+
+        std_msgs::Float64 message;
+        message.data = recovery_time;
+        recovery_time_publisher.publish(message);
+        PRINT("NodeWatchdog: device " << static_cast<int>(node_id) << " recovered in " << recovery_time << " s.");
+    }
+
+    void NodeWatchdog::publishHealth()
+    {
+        diagnostic_msgs::DiagnosticArray array;
+        array.header.stamp = ros::Time::now();
+        const auto now = clock::now();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const auto& entry : nodes)
+            {
+                const Node& node = entry.second;
+                diagnostic_msgs::DiagnosticStatus status;
+                status.name = "device" + std::to_string(entry.first) + "/health";
+                status.hardware_id = "device" + std::to_string(entry.first);
+                switch (node.health)
+                {
+                    case Health::OK:
+                        status.level = diagnostic_msgs::DiagnosticStatus::OK;
+                        break;
+                    case Health::RECOVERING:
+                        status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+                        break;
+                    default:
+                        status.level = diagnostic_msgs::DiagnosticStatus::ERROR;
+                        break;
+                }
+                status.message = healthName(node.health);
+                if (!node.reason.empty())
+                {
+                    status.message += ": " + node.reason;
+                }
+                status.values.push_back(keyValue("heartbeat_age_ms",
+                            std::chrono::duration<double, std::milli>(now - node.last_heartbeat).count()));
+                status.values.push_back(keyValue("nmt_state", node.nmt_state));
+                status.values.push_back(keyValue("emergencies", node.emergencies));
+                status.values.push_back(keyValue("last_emergency_code", node.last_emergency_code));
+                status.values.push_back(keyValue("recoveries", node.recoveries));
+                status.values.push_back(keyValue("failed_recoveries", node.failed_recoveries));
+                status.values.push_back(keyValue("last_recovery_time_s", node.last_recovery_time));
+                status.values.push_back(keyValue("max_recovery_time_s", node.max_recovery_time));
+                array.status.push_back(status);
+            }
+        }
+        health_publisher.publish(array);
+    }
+}
@@ -0,0 +1,721 @@
+/****************************************************************************************
+ * File:            simulated_device.cpp
+ *
+ * Purpose:         Implementation of the simulated CANopen devices, see
+ *                  tfr_can/include/tfr_can/simulated_device.h for details.
+ *
+ *                  References for the protocol details:
+ *                  https://en.wikipedia.org/wiki/CANopen#Service_Data_Object_(SDO)_protocol
+ *                  https://us.nanotec.com/products/manual/PD4C_CAN_EN/modes%252Fprofile_position.html/
+ ***************************************************************************************/
+#include "simulated_device.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace tfr_can
+{
+    namespace
+    {
+        // CANopen function codes, the node id is added to these
+        const canid_t NMT_ID = 0x000;
+        const canid_t TPDO1_ID = 0x180;
+        const canid_t RPDO1_ID = 0x200;
+        const canid_t SDO_TX_ID = 0x580;
+        const canid_t SDO_RX_ID = 0x600;
+        const canid_t EMCY_ID = 0x080;
+        const canid_t HEARTBEAT_ID = 0x700;
+
+        // SDO abort codes
+        const uint32_t SDO_ABORT_COMMAND = 0x05040001;
+        const uint32_t SDO_ABORT_UNSUPPORTED = 0x06010000;
+        const uint32_t SDO_ABORT_READ_ONLY = 0x06010002;
+        const uint32_t SDO_ABORT_NO_OBJECT = 0x06020000;
+
+        void putLittleEndian(uint8_t* data, int64_t value, uint8_t size)
+        {
+            for (uint8_t i = 0; i < size; i++)
+            {
+                data[i] = static_cast<uint8_t>((static_cast<uint64_t>(value) >> (8 * i)) & 0xFF);
+            }
+        }
+
+        int64_t getLittleEndian(const uint8_t* data, uint8_t size, bool is_signed)
+        {
+            uint64_t value = 0;
+            for (uint8_t i = 0; i < size; i++)
+            {
+                value |= static_cast<uint64_t>(data[i]) << (8 * i);
+            }
+            if (is_signed && size < 8 && (value & (1ull << (8 * size - 1))))
+            {
+                value |= ~0ull << (8 * size);
+            }
+            return static_cast<int64_t>(value);
+        }
+
+        /*
+         * Wraps a position the way a 32 bit counter would.
+         * */
+        int32_t wrapInt32(double value)
+        {
+            return static_cast<int32_t>(static_cast<uint32_t>(static_cast<int64_t>(std::llround(value))));
+        }
+    }
+
+    SimulatedDevice::SimulatedDevice(uint8_t node_id, uint32_t device_type, const std::string& name) :
+        node_id{node_id},
+        nmt_state{NmtState::BOOTUP},
+        online{true},
+        heartbeat_elapsed{0},
+        feedback_object{0},
+        feedback_read{false},
+        segment_offset{0}
+    {
+        addObject(0x1000, 0, 4, false, false, device_type);
+        addObject(0x1001, 0, 1, false, false, 0);
+        addString(0x1008, 0, name);
+        addString(0x1009, 0, "sim");
+        addString(0x100A, 0, "sim");
+        addObject(0x1017, 0, 2, false, true, 0);
+        addObject(0x1018, 0, 1, false, false, 4);
+        addObject(0x1018, 1, 4, false, false, 0);
+        addObject(0x1018, 2, 4, false, false, 0);
+        addObject(0x1018, 3, 4, false, false, 0);
+        addObject(0x1018, 4, 4, false, false, node_id);
+    }
+
+    uint8_t SimulatedDevice::getNodeId() const
+    {
+        return node_id;
+    }
+
+    uint32_t SimulatedDevice::key(uint16_t index, uint8_t subindex)
+    {
+        return (static_cast<uint32_t>(index) << 8) | subindex;
+    }
+
+    void SimulatedDevice::addObject(uint16_t index, uint8_t subindex, uint8_t size, bool is_signed,
+            bool writable, int64_t value)
+    {
+        dictionary[key(index, subindex)] = Object{size, is_signed, writable, value, ""};
+    }
+
+    void SimulatedDevice::addString(uint16_t index, uint8_t subindex, const std::string& text)
+    {
+        dictionary[key(index, subindex)] = Object{0, false, false, 0, text};
+    }
+
+    int64_t SimulatedDevice::get(uint16_t index, uint8_t subindex) const
+    {
+        auto it = dictionary.find(key(index, subindex));
+        return it == dictionary.end() ? 0 : it->second.value;
+    }
+
+    void SimulatedDevice::set(uint16_t index, uint8_t subindex, int64_t value)
+    {
+        auto it = dictionary.find(key(index, subindex));
+        if (it != dictionary.end())
+        {
+            it->second.value = value;
+        }
+    }
+
+    void SimulatedDevice::mapTransmit(uint16_t index, uint8_t subindex)
+    {
+        transmit_mapping.push_back(key(index, subindex));
+    }
+
+    void SimulatedDevice::mapReceive(uint16_t index, uint8_t subindex)
+    {
+        receive_mapping.push_back(key(index, subindex));
+    }
+
+    void SimulatedDevice::setFeedbackObject(uint16_t index, uint8_t subindex)
+    {
+        feedback_object = key(index, subindex);
+    }
+
+    bool SimulatedDevice::takeFeedbackRead()
+    {
+        bool result = feedback_read;
+        feedback_read = false;
+        return result;
+    }
+
+    void SimulatedDevice::bootUp(std::vector<can_frame>& out)
+    {
+        nmt_state = NmtState::PRE_OPERATIONAL;
+        heartbeat_elapsed = 0;
+
+        can_frame frame{};
+        frame.can_id = HEARTBEAT_ID + node_id;
+        frame.can_dlc = 1;
+        frame.data[0] = static_cast<uint8_t>(NmtState::BOOTUP);
+        out.push_back(frame);
+    }
+
+    void SimulatedDevice::emergency(uint16_t error_code, std::vector<can_frame>& out)
+    {
+        if (!online)
+        {
+            return;
+        }
+        onFault();
+        set(0x1001, 0, 0x01);   // generic error
+
+        can_frame frame{};
+        frame.can_id = EMCY_ID + node_id;
+        frame.can_dlc = 8;
+        putLittleEndian(&frame.data[0], error_code, 2);
+        frame.data[2] = 0x01;
+        out.push_back(frame);
+    }
+
+    void SimulatedDevice::setOnline(bool online, std::vector<can_frame>& out)
+    {
+        if (online == this->online)
+        {
+            return;
+        }
+        this->online = online;
+        if (online)
+        {
+            onReset();
+            set(0x1001, 0, 0);
+            bootUp(out);
+        }
+    }
+
+    bool SimulatedDevice::handleFrame(const can_frame& frame, std::vector<can_frame>& out)
+    {
+        if (!online || (frame.can_id & (CAN_EFF_FLAG | CAN_RTR_FLAG | CAN_ERR_FLAG)))
+        {
+            return false;
+        }
+
+        const canid_t id = frame.can_id & CAN_SFF_MASK;
+        if (id == NMT_ID)
+        {
+            handleNmt(frame, out);
+            return false;
+        }
+        if (nmt_state == NmtState::BOOTUP || nmt_state == NmtState::STOPPED)
+        {
+            return false;
+        }
+        if (id == SDO_RX_ID + node_id)
+        {
+            return handleSdo(frame, out);
+        }
+        if (id == RPDO1_ID + node_id && nmt_state == NmtState::OPERATIONAL)
+        {
+            return handleReceivePdo(frame);
+        }
+        return false;
+    }
+
+    void SimulatedDevice::handleNmt(const can_frame& frame, std::vector<can_frame>& out)
+    {
+        if (frame.can_dlc < 2 || (frame.data[1] != 0 && frame.data[1] != node_id))
+        {
+            return;
+        }
+
+        switch (frame.data[0])
+        {
+            case 0x01:
+                nmt_state = NmtState::OPERATIONAL;
+                break;
+            case 0x02:
+                nmt_state = NmtState::STOPPED;
+                break;
+            case 0x80:
+                nmt_state = NmtState::PRE_OPERATIONAL;
+                break;
+            case 0x81:
+                onReset();
+                set(0x1001, 0, 0);
+                bootUp(out);
+                break;
+            case 0x82:
+                bootUp(out);
+                break;
+            default:
+                break;
+        }
+    }
+
+    can_frame SimulatedDevice::sdoFrame() const
+    {
+        can_frame reply{};
+        reply.can_id = SDO_TX_ID + node_id;
+        reply.can_dlc = 8;
+        return reply;
+    }
+
+    void SimulatedDevice::sdoAbort(uint16_t index, uint8_t subindex, uint32_t code, std::vector<can_frame>& out)
+    {
+        can_frame reply = sdoFrame();
+        reply.data[0] = 0x80;
+        putLittleEndian(&reply.data[1], index, 2);
+        reply.data[3] = subindex;
+        putLittleEndian(&reply.data[4], code, 4);
+        out.push_back(reply);
+    }
+
+    bool SimulatedDevice::handleSdo(const can_frame& frame, std::vector<can_frame>& out)
+    {
+        if (frame.can_dlc < 8)
+        {
+            return false;
+        }
+
+        const uint8_t command = frame.data[0] >> 5;
+        const uint16_t index = static_cast<uint16_t>(getLittleEndian(&frame.data[1], 2, false));
+        const uint8_t subindex = frame.data[3];
+
+        if (command == 3)
+        {
+            // upload segment
+            if (segment_offset >= segment_data.size())
+            {
+                sdoAbort(0, 0, SDO_ABORT_COMMAND, out);
+                return false;
+            }
+            const uint8_t toggle = frame.data[0] & 0x10;
+            const size_t n = std::min<size_t>(7, segment_data.size() - segment_offset);
+            const bool last = segment_offset + n >= segment_data.size();
+            can_frame reply = sdoFrame();
+            reply.data[0] = toggle | static_cast<uint8_t>((7 - n) << 1) | (last ? 1 : 0);
+            std::memcpy(&reply.data[1], segment_data.data() + segment_offset, n);
+            segment_offset += n;
+            out.push_back(reply);
+            return false;
+        }
+
+        if (command == 4)
+        {
+            // abort from the client
+            segment_data.clear();
+            return false;
+        }
+
+        auto it = dictionary.find(key(index, subindex));
+        if (it == dictionary.end())
+        {
+            sdoAbort(index, subindex, SDO_ABORT_NO_OBJECT, out);
+            return false;
+        }
+        Object& object = it->second;
+
+        if (command == 2)
+        {
+            // upload initiate
+            can_frame reply = sdoFrame();
+            putLittleEndian(&reply.data[1], index, 2);
+            reply.data[3] = subindex;
+
+            if (object.size == 0 && object.text.size() > 4)
+            {
+                reply.data[0] = 0x41;
+                putLittleEndian(&reply.data[4], object.text.size(), 4);
+                segment_data = object.text;
+                segment_offset = 0;
+            }
+            else if (object.size == 0)
+            {
+                const uint8_t n = static_cast<uint8_t>(object.text.size());
+                reply.data[0] = 0x43 | static_cast<uint8_t>((4 - n) << 2);
+                std::memcpy(&reply.data[4], object.text.data(), n);
+            }
+            else
+            {
+                reply.data[0] = 0x43 | static_cast<uint8_t>((4 - object.size) << 2);
+                putLittleEndian(&reply.data[4], object.value, object.size);
+            }
+            out.push_back(reply);
+
+            if (it->first == feedback_object)
+            {
+                feedback_read = true;
+            }
+            return false;
+        }
+
+        if (command == 1)
+        {
+            // download initiate, only expedited transfers are needed
+            const bool expedited = frame.data[0] & 0x02;
+            const bool size_set = frame.data[0] & 0x01;
+            if (!expedited || object.size == 0)
+            {
+                sdoAbort(index, subindex, SDO_ABORT_UNSUPPORTED, out);
+                return false;
+            }
+            if (!object.writable)
+            {
+                sdoAbort(index, subindex, SDO_ABORT_READ_ONLY, out);
+                return false;
+            }
+
+            const uint8_t n = size_set ? static_cast<uint8_t>(4 - ((frame.data[0] >> 2) & 0x03)) : object.size;
+            object.value = getLittleEndian(&frame.data[4], std::min(n, object.size), object.is_signed);
+
+            can_frame reply = sdoFrame();
+            reply.data[0] = 0x60;
+            putLittleEndian(&reply.data[1], index, 2);
+            reply.data[3] = subindex;
+            out.push_back(reply);
+
+            return onWrite(index, subindex);
+        }
+
+        sdoAbort(index, subindex, SDO_ABORT_COMMAND, out);
+        return false;
+    }
+
+    bool SimulatedDevice::handleReceivePdo(const can_frame& frame)
+    {
+        bool setpoint_changed = false;
+        uint8_t offset = 0;
+        for (uint32_t mapped : receive_mapping)
+        {
+            Object& object = dictionary[mapped];
+            if (offset + object.size > frame.can_dlc)
+            {
+                break;
+            }
+            object.value = getLittleEndian(&frame.data[offset], object.size, object.is_signed);
+            offset += object.size;
+            setpoint_changed |= onWrite(static_cast<uint16_t>(mapped >> 8), static_cast<uint8_t>(mapped & 0xFF));
+        }
+        return setpoint_changed;
+    }
+
+    void SimulatedDevice::sync(std::vector<can_frame>& out)
+    {
+        if (!online || nmt_state != NmtState::OPERATIONAL || transmit_mapping.empty())
+        {
+            return;
+        }
+
+        can_frame frame{};
+        frame.can_id = TPDO1_ID + node_id;
+        uint8_t offset = 0;
+        for (uint32_t mapped : transmit_mapping)
+        {
+            const Object& object = dictionary[mapped];
+            if (offset + object.size > 8)
+            {
+                break;
+            }
+            putLittleEndian(&frame.data[offset], object.value, object.size);
+            offset += object.size;
+        }
+        frame.can_dlc = offset;
+        out.push_back(frame);
+    }
+
+    void SimulatedDevice::step(double dt, std::vector<can_frame>& out)
+    {
+        if (!online || nmt_state == NmtState::BOOTUP)
+        {
+            return;
+        }
+
+        updateModel(dt);
+
+        const double heartbeat_period = get(0x1017, 0) / 1000.0;
+        if (heartbeat_period > 0)
+        {
+            heartbeat_elapsed += dt;
+            if (heartbeat_elapsed >= heartbeat_period)
+            {
+                heartbeat_elapsed -= heartbeat_period;
+                can_frame frame{};
+                frame.can_id = HEARTBEAT_ID + node_id;
+                frame.can_dlc = 1;
+                frame.data[0] = static_cast<uint8_t>(nmt_state);
+                out.push_back(frame);
+            }
+        }
+    }
+
+    Ds402Axis::Ds402Axis(uint8_t node_id, uint32_t device_type, const std::string& name,
+            int32_t position_min, int32_t position_max, double max_velocity, double time_constant) :
+        SimulatedDevice{node_id, device_type, name},
+        position_min{position_min},
+        position_max{position_max},
+        max_velocity{max_velocity},
+        time_constant{time_constant},
+        has_averaged_torque{false},
+        drive_state{DriveState::SWITCH_ON_DISABLED},
+        position{(position_min + position_max) / 2.0},
+        velocity{0},
+        setpoint{static_cast<int32_t>((position_min + position_max) / 2)},
+        fault{false},
+        last_controlword{0}
+    {
+        addObject(0x6040, 0, 2, false, true, 0);                        // controlword
+        addObject(0x6041, 0, 2, false, false, 0);                       // statusword
+        addObject(0x6060, 0, 1, true, true, 0);                         // modes_of_operation
+        addObject(0x6061, 0, 1, true, false, 0);                        // modes_of_operation_display
+        addObject(0x6064, 0, 4, true, false, setpoint);                 // position_actual_value
+        addObject(0x607A, 0, 4, true, true, setpoint);                  // target_position
+        addObject(0x606C, 0, 4, true, false, 0);                        // velocity_actual_value
+        addObject(0x6077, 0, 2, true, false, 0);                        // torque_actual_value
+        addObject(0x6072, 0, 2, false, true, 1000);                     // max_torque
+        addObject(0x6081, 0, 4, false, true, static_cast<int64_t>(max_velocity));        // profile_velocity
+        addObject(0x6083, 0, 4, false, true, static_cast<int64_t>(4 * max_velocity));    // profile_acceleration
+        addObject(0x6084, 0, 4, false, true, static_cast<int64_t>(4 * max_velocity));    // profile_deceleration
+        addObject(0x6502, 0, 4, false, false, 0x01);                    // supported_drive_modes
+
+        mapTransmit(0x6041, 0);
+        mapTransmit(0x6064, 0);
+        mapReceive(0x6040, 0);
+        mapReceive(0x607A, 0);
+        setFeedbackObject(0x6064, 0);
+
+        updateStatusword();
+    }
+
+    void Ds402Axis::addAveragedTorque()
+    {
+        has_averaged_torque = true;
+        addObject(0x30D2, 0, 1, false, false, 2);
+        addObject(0x30D2, 1, 2, true, false, 0);
+    }
+
+    bool Ds402Axis::onWrite(uint16_t index, uint8_t subindex)
+    {
+        if (index == 0x6060)
+        {
+            set(0x6061, 0, get(0x6060, 0));
+            return false;
+        }
+
+        const bool profile_position = get(0x6061, 0) == 1;
+        const bool enabled = drive_state == DriveState::OPERATION_ENABLED && !fault;
+
+        if (index == 0x607A)
+        {
+            // Drives configured to "change set immediately" take the new
+            // target as soon as the new set-point bit is already up.
+            if (enabled && profile_position && (last_controlword & 0x0030) == 0x0030)
+            {
+                setpoint = static_cast<int32_t>(get(0x607A, 0));
+                return true;
+            }
+            return false;
+        }
+
+        if (index != 0x6040)
+        {
+            return false;
+        }
+
+        const uint16_t controlword = static_cast<uint16_t>(get(0x6040, 0));
+        const bool new_setpoint = (controlword & 0x0010) && !(last_controlword & 0x0010);
+        const bool fault_reset = (controlword & 0x0080) && !(last_controlword & 0x0080);
+        last_controlword = controlword;
+
+        if (fault)
+        {
+            if (fault_reset)
+            {
+                fault = false;
+                drive_state = DriveState::SWITCH_ON_DISABLED;
+            }
+            updateStatusword();
+            return false;
+        }
+
+        if ((controlword & 0x0002) == 0)
+        {
+            drive_state = DriveState::SWITCH_ON_DISABLED;            // disable voltage
+        }
+        else if ((controlword & 0x0006) == 0x0002)
+        {
+            drive_state = DriveState::SWITCH_ON_DISABLED;            // quick stop
+        }
+        else if ((controlword & 0x000F) == 0x0006)
+        {
+            drive_state = DriveState::READY_TO_SWITCH_ON;            // shutdown
+        }
+        else if ((controlword & 0x000F) == 0x0007)
+        {
+            if (drive_state != DriveState::SWITCH_ON_DISABLED)
+                drive_state = DriveState::SWITCHED_ON;              // switch on / disable operation
+        }
+        else if ((controlword & 0x000F) == 0x000F)
+        {
+            if (drive_state != DriveState::SWITCH_ON_DISABLED)
+                drive_state = DriveState::OPERATION_ENABLED;        // enable operation
+        }
+        updateStatusword();
+
+        if (new_setpoint && drive_state == DriveState::OPERATION_ENABLED && profile_position)
+        {
+            int64_t target = get(0x607A, 0);
+            if (controlword & 0x0040)
+            {
+                target += setpoint;     // relative move
+            }
+            setpoint = static_cast<int32_t>(target);
+            return true;
+        }
+        return false;
+    }
+
+    void Ds402Axis::updateModel(double dt)
+    {
+        double target_velocity = 0;
+        if (drive_state == DriveState::OPERATION_ENABLED && !fault)
+        {
+            const double limit = std::min(max_velocity, static_cast<double>(get(0x6081, 0)));
+            const double target = std::max<double>(position_min, std::min<double>(position_max, setpoint));
+            target_velocity = std::max(-limit, std::min(limit, (target - position) / time_constant));
+        }
+
+        const double acceleration = std::max(1.0, static_cast<double>(
+                    std::abs(target_velocity) > std::abs(velocity) ? get(0x6083, 0) : get(0x6084, 0)));
+        const double max_change = acceleration * dt;
+        velocity += std::max(-max_change, std::min(max_change, target_velocity - velocity));
+        position += velocity * dt;
+
+        if (position <= position_min || position >= position_max)
+        {
+            position = std::max<double>(position_min, std::min<double>(position_max, position));
+            velocity = 0;
+        }
+
+        // A made up load: torque rises with speed, in per mille of rated torque.
+        const double max_torque = static_cast<double>(get(0x6072, 0));
+        const int64_t torque = std::llround(std::min(max_torque, 50 + 400 * std::abs(velocity) / max_velocity))
+            * (velocity < 0 ? -1 : 1);
+
+        set(0x6064, 0, std::llround(position));
+        set(0x606C, 0, std::llround(velocity));
+        set(0x6077, 0, torque);
+        if (has_averaged_torque)
+        {
+            set(0x30D2, 1, torque);
+        }
+        updateStatusword();
+    }
+
+    void Ds402Axis::onReset()
+    {
+        drive_state = DriveState::SWITCH_ON_DISABLED;
+        fault = false;
+        velocity = 0;
+        setpoint = static_cast<int32_t>(std::llround(position));
+        last_controlword = 0;
+        set(0x6040, 0, 0);
+        set(0x6060, 0, 0);
+        set(0x6061, 0, 0);
+        set(0x607A, 0, setpoint);
+        updateStatusword();
+    }
+
+    void Ds402Axis::onFault()
+    {
+        fault = true;
+        updateStatusword();
+    }
+
+    void Ds402Axis::updateStatusword()
+    {
+        uint16_t statusword = 0x0200;   // remote
+        if (fault)
+        {
+            statusword |= 0x0008;
+        }
+        else
+        {
+            switch (drive_state)
+            {
+                case DriveState::SWITCH_ON_DISABLED:
+                    statusword |= 0x0040;
+                    break;
+                case DriveState::READY_TO_SWITCH_ON:
+                    statusword |= 0x0021;
+                    break;
+                case DriveState::SWITCHED_ON:
+                    statusword |= 0x0023;
+                    break;
+                case DriveState::OPERATION_ENABLED:
+                    statusword |= 0x0037;
+                    break;
+            }
+        }
+
+        const double window = std::max(1.0, (position_max - position_min) / 1000.0);
+        if (std::abs(setpoint - position) <= window && std::abs(velocity) < window)
+        {
+            statusword |= 0x0400;   // target reached
+        }
+        set(0x6041, 0, statusword);
+    }
+
+    RoboteqController::RoboteqController(uint8_t node_id, double max_counts_per_second, double time_constant) :
+        SimulatedDevice{node_id, 0x000F0191, "SBL2360"},
+        max_counts_per_second{max_counts_per_second},
+        time_constant{time_constant},
+        speed{0, 0},
+        count{0, 0}
+    {
+        for (uint16_t index : {0x2000, 0x2100, 0x2101, 0x2104, 0x2105})
+        {
+            addObject(index, 0, 1, false, false, 2);
+        }
+        for (uint8_t channel = 1; channel <= 2; channel++)
+        {
+            addObject(0x2000, channel, 4, true, true, 0);   // cmd_cango
+            addObject(0x2100, channel, 2, true, false, 0);  // qry_motamps
+            addObject(0x2101, channel, 2, true, false, 0);  // qry_motcmd
+            addObject(0x2104, channel, 4, true, false, 0);  // qry_abcntr
+            addObject(0x2105, channel, 4, true, false, 0);  // qry_blcntr
+        }
+
+        mapTransmit(0x2105, 1);
+        mapTransmit(0x2105, 2);
+        mapReceive(0x2000, 1);
+        mapReceive(0x2000, 2);
+        setFeedbackObject(0x2105, 1);
+    }
+
+    bool RoboteqController::onWrite(uint16_t index, uint8_t subindex)
+    {
+        return index == 0x2000;
+    }
+
+    void RoboteqController::updateModel(double dt)
+    {
+        for (uint8_t channel = 0; channel < 2; channel++)
+        {
+            const double command = std::max(-1000.0, std::min(1000.0,
+                        static_cast<double>(get(0x2000, channel + 1))));
+            const double target = command / 1000.0 * max_counts_per_second;
+            speed[channel] += (target - speed[channel]) * std::min(1.0, dt / time_constant);
+            count[channel] += speed[channel] * dt;
+
+            set(0x2101, channel + 1, std::llround(command));
+            // roughly 20 A at full speed, reported in 0.1 A
+            set(0x2100, channel + 1, std::llround(200 * std::abs(speed[channel]) / max_counts_per_second));
+            set(0x2104, channel + 1, wrapInt32(count[channel]));
+            set(0x2105, channel + 1, wrapInt32(count[channel]));
+        }
+    }
+
+    void RoboteqController::onReset()
+    {
+        for (uint8_t channel = 0; channel < 2; channel++)
+        {
+            speed[channel] = 0;
+            set(0x2000, channel + 1, 0);
+        }
+    }
+}
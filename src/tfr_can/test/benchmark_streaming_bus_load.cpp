@@ -0,0 +1,188 @@
+/**
+ * benchmark_streaming_bus_load.cpp
+ *
+ * Streams setpoints to set_joint_state of the four arm actuators, as the
+ * digging action server does, through the bridge to can_device_simulator,
+ * and measures the bus load the bridge reports on can_bus/load meanwhile.
+ *
+ * The scheduler reserves bus time for the setpoints and gives the polled
+ * entries what is left of its load budget, so the bus should stay within
+ * the budget plus the frames that are not scheduled at all (heartbeats,
+ * boot-ups). Going over it fails the test, so does a saturated bus or an
+ * arm that stopped reporting its position.
+ *
+ * It needs the virtual CAN interface, so it is only built with
+ * -DTFR_BENCHMARKS=ON:
+ *   ./setupVCAN.sh
+ *   catkin_make -DTFR_BENCHMARKS=ON run_tests_tfr_can
+ *
+ * Parameters (streaming_bus_load.test):
+ *  - ~stream_rate: Hz, of the setpoints (double, default 10)
+ *  - ~duration: s, how long to stream (double, default 30)
+ *  - ~startup_timeout: s, how long the bridge may take to find the devices
+ *    (double, default 60)
+ *  - ~load_budget: of the scheduler (double, default 0.8)
+ *  - ~unscheduled_load: allowed on top of the budget (double, default 0.05)
+ */
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+#include <sensor_msgs/JointState.h>
+#include <std_msgs/Float64.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // lower arm, upper arm, scoop, turntable
+    const int streamed_actuators[] = {23, 45, 56, 1};
+
+    std::string deviceTopic(int node_id, const std::string& entry)
+    {
+        return "/device" + std::to_string(node_id) + "/" + entry;
+    }
+
+    class BusLoadMonitor
+    {
+    public:
+        BusLoadMonitor(ros::NodeHandle& n) :
+            expected_subscriber{n.subscribe("can_bus/expected_load", 1, &BusLoadMonitor::expected, this)},
+            load_subscriber{n.subscribe("can_bus/load", 50, &BusLoadMonitor::load, this)},
+            feedback_subscriber{n.subscribe(deviceTopic(streamed_actuators[0], "get_joint_state"), 50,
+                    &BusLoadMonitor::feedback, this)},
+            started{false},
+            recording{false},
+            feedback_count{0},
+            expected_load{0}
+        {
+        }
+        BusLoadMonitor(const BusLoadMonitor&) = delete;
+        BusLoadMonitor& operator=(const BusLoadMonitor&) = delete;
+        BusLoadMonitor(BusLoadMonitor&&) = delete;
+        BusLoadMonitor& operator=(BusLoadMonitor&&) = delete;
+
+        void record(bool on)
+        {
+            recording = on;
+        }
+
+        std::vector<double> samples()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return loads;
+        }
+
+        std::atomic<bool> started;
+        std::atomic<bool> recording;
+        std::atomic<unsigned> feedback_count;
+        std::atomic<double> expected_load;
+
+    private:
+        void expected(const std_msgs::Float64::ConstPtr& msg)
+        {
+            // latched, published once the scheduler is running
+            expected_load = msg->data;
+            started = true;
+        }
+
+        void load(const std_msgs::Float64::ConstPtr& msg)
+        {
+            if (!recording)
+                return;
+            std::lock_guard<std::mutex> lock(mutex);
+            loads.push_back(msg->data);
+        }
+
+        void feedback(const sensor_msgs::JointState::ConstPtr&)
+        {
+            if (recording)
+                feedback_count++;
+        }
+
+        ros::Subscriber expected_subscriber;
+        ros::Subscriber load_subscriber;
+        ros::Subscriber feedback_subscriber;
+        std::mutex mutex;
+        std::vector<double> loads;
+    };
+}
+
+TEST(StreamingBusLoad, StaysInBudget)
+{
+    double stream_rate, duration, startup_timeout, load_budget, unscheduled_load;
+    ros::param::param<double>("~stream_rate", stream_rate, 10.0);
+    ros::param::param<double>("~duration", duration, 30.0);
+    ros::param::param<double>("~startup_timeout", startup_timeout, 60.0);
+    ros::param::param<double>("~load_budget", load_budget, 0.8);
+    ros::param::param<double>("~unscheduled_load", unscheduled_load, 0.05);
+
+    ros::NodeHandle n;
+    ros::AsyncSpinner spinner(2);
+    spinner.start();
+    BusLoadMonitor monitor(n);
+
+    std::vector<ros::Publisher> setpoints;
+    for (int node_id : streamed_actuators)
+    {
+        setpoints.push_back(n.advertise<sensor_msgs::JointState>(
+                    deviceTopic(node_id, "set_joint_state"), 5));
+    }
+
+    const ros::Time timeout = ros::Time::now() + ros::Duration(startup_timeout);
+    while (ros::ok() && !monitor.started && ros::Time::now() < timeout)
+    {
+        ros::Duration(0.1).sleep();
+    }
+    ASSERT_TRUE(monitor.started) << "the bridge did not start its scheduler";
+    // let the load of the first polls settle before measuring
+    ros::Duration(2.0).sleep();
+
+    monitor.record(true);
+    sensor_msgs::JointState setpoint;
+    setpoint.position.resize(1);
+    ros::Rate rate(stream_rate);
+    const ros::Time start = ros::Time::now();
+    while (ros::ok() && (ros::Time::now() - start).toSec() < duration)
+    {
+        // a slow sweep, like a stroke of the arm
+        const double t = (ros::Time::now() - start).toSec();
+        setpoint.header.stamp = ros::Time::now();
+        setpoint.position[0] = 1.0 + 0.5 * std::sin(2 * M_PI * t / 10.0);
+        for (auto& publisher : setpoints)
+        {
+            publisher.publish(setpoint);
+        }
+        rate.sleep();
+    }
+    monitor.record(false);
+
+    const std::vector<double> loads = monitor.samples();
+    ASSERT_FALSE(loads.empty()) << "no can_bus/load while streaming";
+    double mean = 0;
+    for (double load : loads)
+    {
+        mean += load;
+    }
+    mean /= loads.size();
+    const double max = *std::max_element(loads.begin(), loads.end());
+
+    ::testing::Test::RecordProperty("expected_load", std::to_string(monitor.expected_load.load()));
+    ::testing::Test::RecordProperty("load_mean", std::to_string(mean));
+    ::testing::Test::RecordProperty("load_max", std::to_string(max));
+
+    EXPECT_LE(mean, load_budget + unscheduled_load)
+        << "the bus load while streaming is over the budget of the scheduler";
+    EXPECT_LT(max, 1.0) << "the bus saturated while streaming";
+    EXPECT_GT(monitor.feedback_count.load(), duration)
+        << "the lower arm stopped reporting its position while streaming";
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    ros::init(argc, argv, "streaming_bus_load_benchmark");
+    return RUN_ALL_TESTS();
+}
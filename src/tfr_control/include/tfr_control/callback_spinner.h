@@ -0,0 +1,105 @@
+/**
+ * callback_spinner.h
+ *
+ * A callback queue with its own thread, so the control node can keep its
+ * callbacks apart by urgency:
+ *
+ *  - safety: the emergency stop services, which must never wait
+ *  - feedback: encoder, IMU and controller command topics
+ *  - query: state queries and other requests that can wait
+ *
+ * Each spinner thread can be given a SCHED_FIFO priority and pinned to a
+ * CPU. Running with a realtime priority needs CAP_SYS_NICE (or an rtprio
+ * limit), when it is not allowed the thread keeps the normal scheduling and
+ * a warning is logged.
+ *
+ * The spinner measures how long each callback waited in the queue, from when
+ * roscpp queued it to when it started running, so the latency of each queue
+ * can be published and checked.
+ */
+#ifndef CALLBACK_SPINNER_H
+#define CALLBACK_SPINNER_H
+
+#include <ros/ros.h>
+#include <ros/callback_queue.h>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace tfr_control
+{
+    /*
+     * Gives a thread a SCHED_FIFO priority (1-99, 0 keeps the normal
+     * scheduling) and pins it to a cpu (-1 for any cpu). Returns false and
+     * logs a warning if either could not be set.
+     * */
+    bool setThreadScheduling(pthread_t thread, const std::string& name, int priority, int cpu);
+
+    class CallbackSpinner
+    {
+    public:
+        /*
+         * Queue latency since the last takeStats(), in seconds.
+         * */
+        struct LatencyStats
+        {
+            uint64_t callbacks = 0;
+            double mean = 0;
+            double max = 0;
+        };
+
+        CallbackSpinner(const std::string& name, int priority, int cpu);
+        ~CallbackSpinner();
+        CallbackSpinner(const CallbackSpinner&) = delete;
+        CallbackSpinner& operator=(const CallbackSpinner&) = delete;
+        CallbackSpinner(CallbackSpinner&&) = delete;
+        CallbackSpinner& operator=(CallbackSpinner&&) = delete;
+
+        /*
+         * A node handle whose subscriptions, services and timers are served
+         * by this spinner.
+         * */
+        ros::NodeHandle nodeHandle(const ros::NodeHandle& parent);
+
+        void start();
+        void stop();
+
+        LatencyStats takeStats();
+
+        const std::string& getName() const { return name; }
+
+    private:
+        class TimedCallback;
+        class TimedQueue : public ros::CallbackQueueInterface
+        {
+        public:
+            explicit TimedQueue(CallbackSpinner& spinner) : spinner(spinner) {}
+            void addCallback(const ros::CallbackInterfacePtr& callback, uint64_t owner_id = 0) override;
+            void removeByID(uint64_t owner_id) override;
+
+            ros::CallbackQueue queue;
+
+        private:
+            CallbackSpinner& spinner;
+        };
+
+        void spin();
+        void record(double latency);
+
+        const std::string name;
+        const int priority;
+        const int cpu;
+
+        TimedQueue timed_queue;
+        std::thread thread;
+        std::atomic<bool> running;
+
+        std::mutex stats_mutex;
+        LatencyStats stats;
+        double latency_sum;
+    };
+}
+
+#endif // CALLBACK_SPINNER_H
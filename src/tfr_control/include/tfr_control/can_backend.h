@@ -0,0 +1,104 @@
+/**
+ * can_backend.h
+ *
+ * The hardware backend for the real robot, it talks to the actuators through
+ * the topics of the CAN bridge (tfr_can).
+ *
+ *  - The treads are driven by the Roboteq controller (device 8). Their speed
+ *    is estimated from its brushless counters, and commanded through
+ *    cmd_cango.
+ *  - The arm joints are read from the encoders in the joint descriptor table
+ *    (see joint_descriptor.h). They are commanded by the arm nodes, not here.
+ *    Their velocity is the slope of the joint angle over the last encoder
+ *    samples, their effort comes from the torque topics.
+ *  - The bin has no sensor and always reads 0.
+ *
+ * read() and write() run in the control loop and do not allocate memory or
+ * block: the tread commands are handed to realtime publishers, which publish
+ * them from their own thread.
+ *
+ * A traced left tread command (tfr_utilities/command_trace.h) is recorded in
+ * the cycle that writes it, and its trace is announced with the cmd_cango.
+ */
+#ifndef CAN_BACKEND_H
+#define CAN_BACKEND_H
+
+#include <ros/ros.h>
+#include <std_msgs/Int16.h>
+#include <std_msgs/Int32.h>
+#include <sensor_msgs/JointState.h>
+#include <realtime_tools/realtime_publisher.h>
+#include <tfr_msgs/TraceContext.h>
+#include <tfr_utilities/command_trace.h>
+#include "hardware_backend.h"
+#include "joint_descriptor.h"
+#include "tread_velocity_estimator.h"
+#include "slope_estimator.h"
+#include <mutex>
+#include <vector>
+
+namespace tfr_control
+{
+    class CanBackend : public HardwareBackend
+    {
+    public:
+        explicit CanBackend(ros::NodeHandle& n);
+        CanBackend(const CanBackend&) = delete;
+        CanBackend& operator=(const CanBackend&) = delete;
+        CanBackend(CanBackend&&) = delete;
+        CanBackend& operator=(CanBackend&&) = delete;
+
+        void read(const ros::Time& now, double position[], double velocity[],
+                double effort[]) override;
+        void write(const ros::Time& now, const double command[]) override;
+
+    private:
+        // Read the relative velocity counters from the brushless motor controller
+        ros::Subscriber brushless_right_tread_vel;
+        ros::Subscriber brushless_left_tread_vel;
+
+        realtime_tools::RealtimePublisher<std_msgs::Int32> brushless_right_tread_vel_publisher;
+        realtime_tools::RealtimePublisher<std_msgs::Int32> brushless_left_tread_vel_publisher;
+
+        tfr_utilities::TraceListener left_command_trace;
+        realtime_tools::RealtimePublisher<tfr_msgs::TraceContext> left_cango_trace_publisher;
+
+        void setBrushlessLeftEncoder(const ros::MessageEvent<std_msgs::Int32 const> &event);
+        void setBrushlessRightEncoder(const ros::MessageEvent<std_msgs::Int32 const> &event);
+
+        // Fit over the last 0.15 s of counter samples (about 5 at 32 Hz),
+        // report 0 when no sample arrived for 0.25 s.
+        static constexpr double tread_velocity_window = 0.15;
+        static constexpr double tread_velocity_stale_timeout = 0.25;
+        std::mutex brushless_left_tread_mutex;
+        std::mutex brushless_right_tread_mutex;
+        TreadVelocityEstimator left_tread_velocity{tread_velocity_window, tread_velocity_stale_timeout};
+        TreadVelocityEstimator right_tread_velocity{tread_velocity_window, tread_velocity_stale_timeout};
+
+        double readBrushlessRightVel(const ros::Time& now);
+        double readBrushlessLeftVel(const ros::Time& now);
+
+        const int32_t brushless_encoder_count_per_revolution = 3200;
+        double encoderRateToLinearSpeed(double counts_per_second);
+
+        // The joints read from the CAN bridge, loaded from
+        // absolute_position_encoder_limits.yaml (see joint_descriptor.h).
+        std::vector<JointDescriptor> joint_descriptors;
+        std::vector<ros::Subscriber> joint_encoder_subscribers;
+        std::vector<ros::Subscriber> joint_torque_subscribers;
+        // Latest raw values from the bridge, in the same order as
+        // joint_descriptors
+        std::vector<double> joint_encoders;
+        std::vector<double> joint_torques;
+        // joint angle rates, over 0.1 s of encoder samples
+        static constexpr double joint_velocity_window = 0.1;
+        static constexpr double joint_velocity_stale_timeout = 0.25;
+        std::vector<SlopeEstimator> joint_velocities;
+        std::mutex joint_mutex;
+
+        void readJointEncoder(const ros::MessageEvent<sensor_msgs::JointState const> &event, size_t index);
+        void readJointTorque(const std_msgs::Int16::ConstPtr &msg, size_t index);
+    };
+}
+
+#endif // CAN_BACKEND_H
@@ -9,9 +9,17 @@
  *                  one to each motor controller. This class will only publish after
  *                  reading a message on /cmd_vel.
  * 
+ *                  wheel_span is read from the node's dynamic_reconfigure config (see
+ *                  cfg/Drivebase.cfg), so a /cmd_vel message never waits on the master.
+ * 
  * Subscribed To:   /cmd_vel
  * Publishes To:    /left_tread_velocity_controller/command
  *                  /right_tread_velocity_controller/command
+ *                  /left_tread_velocity_controller/setpoint (debug copy of the command)
+ *                  /right_tread_velocity_controller/setpoint (debug copy of the command)
+ *
+ *                  Each command is traced (tfr_utilities/command_trace.h), continuing the
+ *                  trace announced with the cmd_vel or starting a new one.
  ***************************************************************************************/
 #ifndef DRIVEBASE_PUBLISHER_H
 #define DRIVEBASE_PUBLISHER_H
@@ -19,13 +27,16 @@
 #include "ros/ros.h"
 #include "geometry_msgs/Twist.h"
 #include "std_msgs/Float64.h"
+#include <tfr_control/DrivebaseConfig.h>
+#include <tfr_utilities/cached_config.h>
+#include <tfr_utilities/command_trace.h>
 namespace tfr_control
 {
     class DrivebasePublisher
     {
     public:
         DrivebasePublisher() = delete;
-        explicit DrivebasePublisher(ros::NodeHandle& n, double wheel_span, double wheel_radius);
+        explicit DrivebasePublisher(ros::NodeHandle& n, double wheel_radius);
         DrivebasePublisher(const DrivebasePublisher& other) = delete;
         DrivebasePublisher(DrivebasePublisher&&) = delete;
 
@@ -40,11 +51,17 @@ namespace tfr_control
 
         ros::NodeHandle& n;
         double wheel_radius;
-        double wheel_span;
+        tfr_utilities::CachedConfig<DrivebaseConfig> config;
 
         ros::Publisher left_tread_publisher;
         ros::Publisher right_tread_publisher;
+        ros::Publisher left_setpoint_publisher;
+        ros::Publisher right_setpoint_publisher;
         ros::Subscriber subscriber;
+
+        tfr_utilities::TraceListener cmd_vel_trace;
+        tfr_utilities::TraceAnnouncer command_trace;
+        tfr_utilities::TraceExporter trace_exporter;
     };
 }
 
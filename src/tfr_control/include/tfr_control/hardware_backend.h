@@ -0,0 +1,42 @@
+/**
+ * hardware_backend.h
+ *
+ * The part of the hardware layer that talks to the actuators and sensors.
+ *
+ * RobotInterface owns the ros_control handles and the shared command and
+ * state arrays, and hands them to a backend once per control cycle:
+ *
+ *  - CanBackend talks to the robot through the CAN bridge topics.
+ *  - SimulatedBackend integrates a model of the robot in-process, so the
+ *    control node and its controllers can run without hardware or Gazebo.
+ *
+ * The arrays are indexed by tfr_utilities::Joint and have JOINT_COUNT
+ * entries. Tread velocities are in m/s, the bin and arm joints in radians.
+ */
+#ifndef HARDWARE_BACKEND_H
+#define HARDWARE_BACKEND_H
+
+#include <ros/ros.h>
+#include <tfr_utilities/joints.h>
+
+namespace tfr_control
+{
+    class HardwareBackend
+    {
+    public:
+        virtual ~HardwareBackend() = default;
+
+        /*
+         * Fills in the latest known state of every joint at time now.
+         * */
+        virtual void read(const ros::Time& now, double position[], double velocity[],
+                double effort[]) = 0;
+
+        /*
+         * Sends the commands the controllers computed at time now.
+         * */
+        virtual void write(const ros::Time& now, const double command[]) = 0;
+    };
+}
+
+#endif // HARDWARE_BACKEND_H
@@ -0,0 +1,87 @@
+/**
+ * joint_descriptor.h
+ *
+ * Describes how the position of an arm joint is read from its CAN device.
+ *
+ * The bridge publishes the encoder of every actuator on
+ * /device<id>/get_joint_state, and the joint angle is a linear function of
+ * that encoder value. The two points of that line are configured per joint
+ * in config/absolute_position_encoder_limits.yaml, for example:
+ *
+ *  absolute_position_encoder_limits:
+ *      lower_arm_joint:
+ *          device: 23
+ *          encoder_min: 5.2
+ *          encoder_max: 1.2
+ *          joint_at_encoder_min: 0.104
+ *          joint_at_encoder_max: 1.55
+ *          torque_topic: /device23/get_torque_actual_value  # optional
+ *          rated_effort: 1.0  # optional
+ *
+ * The slope and offset of the line are computed once when the table is
+ * loaded, so the conversion in the control loop is a multiply and an add.
+ *
+ * The torque topic carries the actuator's torque in thousandths of its rated
+ * torque (CiA 402 torque_actual_value). rated_effort is the joint effort at
+ * the rated torque, so the reported effort is in the units of rated_effort.
+ * Without it the effort is a fraction of the rated torque.
+ */
+#ifndef JOINT_DESCRIPTOR_H
+#define JOINT_DESCRIPTOR_H
+
+#include <ros/ros.h>
+#include <tfr_utilities/joints.h>
+#include <string>
+#include <vector>
+
+namespace tfr_control
+{
+    struct JointDescriptor
+    {
+        // joint name in the URDF and controller yaml, e.g. "lower_arm_joint"
+        std::string name;
+        tfr_utilities::Joint joint;
+        int device;
+
+        double encoder_min;
+        double encoder_max;
+        double joint_at_encoder_min;
+        double joint_at_encoder_max;
+
+        std::string encoder_topic;
+        std::string torque_topic;
+
+        // joint = slope * encoder + offset
+        double slope;
+        double offset;
+
+        // effort = effort_scale * torque topic value
+        double effort_scale;
+
+        double toJoint(double encoder) const
+        {
+            return slope * encoder + offset;
+        }
+
+        double toEffort(double torque) const
+        {
+            return effort_scale * torque;
+        }
+    };
+
+    /*
+     * Looks up a joint by its URDF name, returns JOINT_COUNT if there is no
+     * joint with that name.
+     * */
+    tfr_utilities::Joint jointFromName(const std::string& name);
+
+    /*
+     * Loads the descriptor table from the parameter server. Entries that are
+     * incomplete, or whose encoder range is empty, are skipped with an error.
+     * Returns false if the parameter is missing.
+     * */
+    bool loadJointDescriptors(ros::NodeHandle& n, const std::string& param,
+            std::vector<JointDescriptor>& descriptors);
+}
+
+#endif // JOINT_DESCRIPTOR_H
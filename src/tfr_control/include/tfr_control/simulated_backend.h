@@ -0,0 +1,98 @@
+/**
+ * simulated_backend.h
+ *
+ * A hardware backend that simulates the robot in-process, for tuning the
+ * controllers, regression tests and benchmarks of the control cycle without
+ * the robot or Gazebo. Select it with the control node's ~backend parameter.
+ *
+ * The model is deliberately simple, but has the effects that matter to the
+ * controllers:
+ *
+ *  - Treads: the effort command is a Roboteq cmd_cango value, which asks for
+ *    a speed proportional to it. The tread speed follows that with a first
+ *    order lag, and its acceleration is limited.
+ *  - Bin: the effort command sets the speed of the bin actuator.
+ *  - Arm: the joints move towards their position command at a limited rate.
+ *  - Every joint is clamped to its URDF limits, unless both are 0.
+ *  - The state read() reports is the one from sensor_latency seconds ago.
+ *
+ * The plant is integrated in steps of at most 5 ms between calls, driven by
+ * the times passed to read() and write(), so it runs at whatever rate the
+ * control loop runs and also works with simulated time. No memory is
+ * allocated after construction.
+ */
+#ifndef SIMULATED_BACKEND_H
+#define SIMULATED_BACKEND_H
+
+#include <ros/ros.h>
+#include <tfr_utilities/joints.h>
+#include "hardware_backend.h"
+#include <array>
+
+namespace tfr_control
+{
+    class SimulatedBackend : public HardwareBackend
+    {
+    public:
+        struct Parameters
+        {
+            // tread speed in m/s at a cango command of tread_full_command
+            double tread_max_speed = 0.6;
+            double tread_full_command = 1000;
+            double tread_time_constant = 0.15;
+            // m/s^2
+            double tread_max_acceleration = 1.5;
+            // rad/s at a bin command of 1
+            double bin_max_rate = 0.3;
+            // rad/s
+            double arm_max_rate = 0.5;
+            // s, the history holds the last HISTORY_SIZE control cycles
+            double sensor_latency = 0.03;
+
+            double lower_limits[tfr_utilities::Joint::JOINT_COUNT]{};
+            double upper_limits[tfr_utilities::Joint::JOINT_COUNT]{};
+        };
+
+        explicit SimulatedBackend(const Parameters& parameters);
+        SimulatedBackend(const SimulatedBackend&) = delete;
+        SimulatedBackend& operator=(const SimulatedBackend&) = delete;
+        SimulatedBackend(SimulatedBackend&&) = delete;
+        SimulatedBackend& operator=(SimulatedBackend&&) = delete;
+
+        void read(const ros::Time& now, double position[], double velocity[],
+                double effort[]) override;
+        void write(const ros::Time& now, const double command[]) override;
+
+    private:
+        struct PlantState
+        {
+            ros::Time stamp;
+            double position[tfr_utilities::Joint::JOINT_COUNT];
+            double velocity[tfr_utilities::Joint::JOINT_COUNT];
+            double effort[tfr_utilities::Joint::JOINT_COUNT];
+        };
+
+        static const size_t HISTORY_SIZE = 256;
+
+        /*
+         * Integrates the plant up to now with the commands held since the
+         * last write, and records the state in the history.
+         * */
+        void advance(const ros::Time& now);
+        void step(double dt);
+        double clampToLimits(int joint, double value) const;
+
+        const Parameters parameters;
+
+        PlantState plant;
+        double command[tfr_utilities::Joint::JOINT_COUNT];
+        bool started;
+
+        // the recorded states, head is the newest
+        std::array<PlantState, HISTORY_SIZE> history;
+        size_t head;
+        size_t count;
+    };
+}
+
+#endif // SIMULATED_BACKEND_H
@@ -0,0 +1,72 @@
+/**
+ * slope_estimator.h
+ *
+ * Estimates the rate of change of a sampled signal, e.g. a joint angle or an
+ * encoder position, from samples that arrive with jittery timestamps.
+ *
+ * The last samples are kept in a fixed size ring buffer. The rate is the
+ * slope of a least squares line through the samples in the last `window`
+ * seconds, which averages out the jitter of the stamps without the lag of a
+ * long filter. The estimate can be asked for at any rate, also faster than
+ * the samples arrive.
+ *
+ * - Samples with a stamp that is not newer than the last one are dropped.
+ * - When no sample arrived for `stale_timeout` seconds the estimate is 0,
+ *   never inf or NaN.
+ *
+ * Not thread safe, the owner serializes addSample() and estimate(). No memory
+ * is allocated after construction.
+ */
+#ifndef SLOPE_ESTIMATOR_H
+#define SLOPE_ESTIMATOR_H
+
+#include <ros/ros.h>
+#include <array>
+#include <cstddef>
+
+namespace tfr_control
+{
+    class SlopeEstimator
+    {
+    public:
+        SlopeEstimator(double window, double stale_timeout);
+
+        /*
+         * Adds the value measured at stamp, returns false if it was dropped.
+         * */
+        bool addSample(double value, const ros::Time& stamp);
+
+        /*
+         * The rate of change at time now in units per second.
+         * */
+        double estimate(const ros::Time& now) const;
+
+        /*
+         * True if no sample arrived within the stale timeout.
+         * */
+        bool isStale(const ros::Time& now) const;
+
+        void reset();
+
+    private:
+        struct Sample
+        {
+            ros::Time stamp;
+            double value;
+        };
+
+        static const size_t CAPACITY = 32;
+
+        // i-th newest sample, 0 is the newest
+        const Sample& newest(size_t i) const;
+
+        std::array<Sample, CAPACITY> samples;
+        size_t head;
+        size_t count;
+
+        ros::Duration window;
+        ros::Duration stale_timeout;
+    };
+}
+
+#endif // SLOPE_ESTIMATOR_H
@@ -0,0 +1,56 @@
+/**
+ * tread_velocity_estimator.h
+ *
+ * Estimates the speed of a tread from the absolute encoder counter the
+ * Roboteq controller reports (qry_blcntr), which arrives at the CAN polling
+ * rate (32 Hz) with a fair amount of jitter.
+ *
+ * The counter is a 32 bit register, a TickUnwrapper (see
+ * tfr_utilities/tick_unwrapper.h) turns it into a 64 bit position that is
+ * not disturbed when it rolls over or the controller resets it. The
+ * unwrapped position goes through a SlopeEstimator (see slope_estimator.h),
+ * which fits a line through the samples of the last `window` seconds and
+ * reports 0 when no sample arrived for `stale_timeout` seconds.
+ *
+ * Not thread safe, the owner serializes addSample() and estimate().
+ */
+#ifndef TREAD_VELOCITY_ESTIMATOR_H
+#define TREAD_VELOCITY_ESTIMATOR_H
+
+#include <ros/ros.h>
+#include <tfr_utilities/tick_unwrapper.h>
+#include "slope_estimator.h"
+#include <cstdint>
+
+namespace tfr_control
+{
+    class TreadVelocityEstimator
+    {
+    public:
+        TreadVelocityEstimator(double window, double stale_timeout);
+
+        /*
+         * Adds the counter value received at stamp.
+         * */
+        void addSample(int32_t count, const ros::Time& stamp);
+
+        /*
+         * The velocity at time now in encoder counts per second.
+         * */
+        double estimate(const ros::Time& now) const;
+
+        /*
+         * True if no sample arrived within the stale timeout.
+         * */
+        bool isStale(const ros::Time& now) const;
+
+        void reset();
+
+    private:
+        SlopeEstimator slope;
+        // unwrapped counter value, it does not roll over
+        tfr_utilities::TickUnwrapper counter;
+    };
+}
+
+#endif // TREAD_VELOCITY_ESTIMATOR_H
@@ -0,0 +1,160 @@
+/**
+ * callback_spinner.cpp
+ *
+ * Prioritized callback queue threads, see callback_spinner.h
+ */
+#include "callback_spinner.h"
+#include <boost/make_shared.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+
+namespace tfr_control
+{
+    bool setThreadScheduling(pthread_t thread, const std::string& name, int priority, int cpu)
+    {
+        bool ok = true;
+        if (priority > 0)
+        {
+            sched_param parameters{};
+            parameters.sched_priority = std::min(priority, sched_get_priority_max(SCHED_FIFO));
+            const int error = pthread_setschedparam(thread, SCHED_FIFO, &parameters);
+            if (error != 0)
+            {
+                ROS_WARN("control: could not give the %s thread priority %d: %s",
+                        name.c_str(), priority, strerror(error));
+                ok = false;
+            }
+        }
+        if (cpu >= 0)
+        {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(cpu, &cpus);
+            const int error = pthread_setaffinity_np(thread, sizeof(cpus), &cpus);
+            if (error != 0)
+            {
+                ROS_WARN("control: could not pin the %s thread to cpu %d: %s",
+                        name.c_str(), cpu, strerror(error));
+                ok = false;
+            }
+        }
+        return ok;
+    }
+
+    /*
+     * Wraps a callback to note when it was queued, and how long it waited
+     * when it is called.
+     * */
+    class CallbackSpinner::TimedCallback : public ros::CallbackInterface
+    {
+    public:
+        TimedCallback(const ros::CallbackInterfacePtr& callback, CallbackSpinner& spinner) :
+            callback(callback),
+            spinner(spinner),
+            queued{std::chrono::steady_clock::now()},
+            recorded{false}
+        {
+        }
+
+        CallResult call() override
+        {
+            if (!recorded)
+            {
+                recorded = true;
+                const std::chrono::duration<double> waited = std::chrono::steady_clock::now() - queued;
+                spinner.record(waited.count());
+            }
+            return callback->call();
+        }
+
+        bool ready() override
+        {
+            return callback->ready();
+        }
+
+    private:
+        const ros::CallbackInterfacePtr callback;
+        CallbackSpinner& spinner;
+        const std::chrono::steady_clock::time_point queued;
+        // a callback that asks to be tried again is queued once
+        bool recorded;
+    };
+
+    void CallbackSpinner::TimedQueue::addCallback(const ros::CallbackInterfacePtr& callback, uint64_t owner_id)
+    {
+        queue.addCallback(boost::make_shared<TimedCallback>(callback, spinner), owner_id);
+    }
+
+    void CallbackSpinner::TimedQueue::removeByID(uint64_t owner_id)
+    {
+        queue.removeByID(owner_id);
+    }
+
+    CallbackSpinner::CallbackSpinner(const std::string& name, int priority, int cpu) :
+        name(name),
+        priority{priority},
+        cpu{cpu},
+        timed_queue{*this},
+        running{false},
+        stats{},
+        latency_sum{0}
+    {
+    }
+
+    CallbackSpinner::~CallbackSpinner()
+    {
+        stop();
+    }
+
+    ros::NodeHandle CallbackSpinner::nodeHandle(const ros::NodeHandle& parent)
+    {
+        ros::NodeHandle n{parent};
+        n.setCallbackQueue(&timed_queue);
+        return n;
+    }
+
+    void CallbackSpinner::start()
+    {
+        if (running)
+            return;
+        running = true;
+        thread = std::thread{&CallbackSpinner::spin, this};
+        setThreadScheduling(thread.native_handle(), name, priority, cpu);
+    }
+
+    void CallbackSpinner::stop()
+    {
+        running = false;
+        if (thread.joinable())
+            thread.join();
+    }
+
+    CallbackSpinner::LatencyStats CallbackSpinner::takeStats()
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        LatencyStats taken = stats;
+        taken.mean = stats.callbacks > 0 ? latency_sum / stats.callbacks : 0;
+        stats = LatencyStats{};
+        latency_sum = 0;
+        return taken;
+    }
+
+    void CallbackSpinner::spin()
+    {
+        while (running && ros::ok())
+        {
+            timed_queue.queue.callAvailable(ros::WallDuration(0.1));
+        }
+    }
+
+    void CallbackSpinner::record(double latency)
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        stats.callbacks++;
+        stats.max = std::max(stats.max, latency);
+        latency_sum += latency;
+    }
+}
@@ -0,0 +1,169 @@
+/**
+ * can_backend.cpp
+ *
+ * Reads and commands the robot through the CAN bridge, see can_backend.h
+ */
+#include "can_backend.h"
+#include <algorithm>
+
+namespace tfr_control
+{
+    CanBackend::CanBackend(ros::NodeHandle &n) :
+        brushless_right_tread_vel{n.subscribe("/device8/get_qry_blcntr/qry_blcntr_2", 5,
+                &CanBackend::setBrushlessRightEncoder, this)},
+        brushless_left_tread_vel{n.subscribe("/device8/get_qry_blcntr/qry_blcntr_1", 5,
+                &CanBackend::setBrushlessLeftEncoder, this)},
+        brushless_right_tread_vel_publisher{n, "/device8/set_cmd_cango/cmd_cango_2", 1},
+        brushless_left_tread_vel_publisher{n, "/device8/set_cmd_cango/cmd_cango_1", 1},
+        left_command_trace{n, "left_tread_velocity_controller/command"},
+        left_cango_trace_publisher{n, "/device8/set_cmd_cango/cmd_cango_1/trace", 4}
+    {
+        // Subscribe to the encoder and torque of every joint in the table
+        loadJointDescriptors(n, "absolute_position_encoder_limits", joint_descriptors);
+        joint_encoders.assign(joint_descriptors.size(), 0.0);
+        joint_torques.assign(joint_descriptors.size(), 0.0);
+        joint_velocities.assign(joint_descriptors.size(),
+                SlopeEstimator{joint_velocity_window, joint_velocity_stale_timeout});
+        for (size_t i = 0; i < joint_descriptors.size(); i++)
+        {
+            boost::function<void(const ros::MessageEvent<sensor_msgs::JointState const>&)> encoder_callback =
+                boost::bind(&CanBackend::readJointEncoder, this, _1, i);
+            joint_encoder_subscribers.push_back(n.subscribe<sensor_msgs::JointState>(
+                        joint_descriptors[i].encoder_topic, 5, encoder_callback));
+            joint_torque_subscribers.push_back(n.subscribe<std_msgs::Int16>(
+                        joint_descriptors[i].torque_topic, 1,
+                        boost::bind(&CanBackend::readJointTorque, this, _1, i)));
+        }
+    }
+
+    void CanBackend::read(const ros::Time& now, double position[], double velocity[],
+            double effort[])
+    {
+        //LEFT_TREAD
+        position[static_cast<int>(tfr_utilities::Joint::LEFT_TREAD)] = 0;
+        velocity[static_cast<int>(tfr_utilities::Joint::LEFT_TREAD)] = readBrushlessLeftVel(now);
+        effort[static_cast<int>(tfr_utilities::Joint::LEFT_TREAD)] = 0;
+
+        //RIGHT_TREAD
+        position[static_cast<int>(tfr_utilities::Joint::RIGHT_TREAD)] = 0;
+        velocity[static_cast<int>(tfr_utilities::Joint::RIGHT_TREAD)] = readBrushlessRightVel(now);
+        effort[static_cast<int>(tfr_utilities::Joint::RIGHT_TREAD)] = 0;
+
+        //BIN, unless it is in the joint table
+        position[static_cast<int>(tfr_utilities::Joint::BIN)] = 0;
+        velocity[static_cast<int>(tfr_utilities::Joint::BIN)] = 0;
+        effort[static_cast<int>(tfr_utilities::Joint::BIN)] = 0;
+
+        //TURNTABLE, LOWER_ARM, UPPER_ARM, SCOOP
+        std::lock_guard<std::mutex> lock(joint_mutex);
+        for (size_t i = 0; i < joint_descriptors.size(); i++)
+        {
+            const int joint = static_cast<int>(joint_descriptors[i].joint);
+            position[joint] = joint_descriptors[i].toJoint(joint_encoders[i]);
+            velocity[joint] = joint_velocities[i].estimate(now);
+            effort[joint] = joint_descriptors[i].toEffort(joint_torques[i]);
+        }
+    }
+
+    /*
+     * If a publisher is still busy with the previous command, this cycle's
+     * command is skipped, the next cycle sends a fresh one.
+     * */
+    void CanBackend::write(const ros::Time& now, const double command[])
+    {
+        //LEFT_TREAD
+        const uint64_t trace_id = left_command_trace.take();
+        if (trace_id != 0)
+        {
+            const ros::WallTime sent = ros::WallTime::now();
+            tfr_utilities::recordTrace(trace_id, "control/write", sent);
+            if (left_cango_trace_publisher.trylock())
+            {
+                left_cango_trace_publisher.msg_.trace_id = trace_id;
+                left_cango_trace_publisher.msg_.stamp = ros::Time(sent.sec, sent.nsec);
+                left_cango_trace_publisher.unlockAndPublish();
+            }
+        }
+        if (brushless_left_tread_vel_publisher.trylock())
+        {
+            double left_tread_command = command[static_cast<int32_t>(tfr_utilities::Joint::LEFT_TREAD)];
+            brushless_left_tread_vel_publisher.msg_.data =
+                std::max(std::min(static_cast<int32_t>(left_tread_command), 2000), -2000);
+            brushless_left_tread_vel_publisher.unlockAndPublish();
+        }
+
+        //RIGHT_TREAD
+        if (brushless_right_tread_vel_publisher.trylock())
+        {
+            double right_tread_command = command[static_cast<int32_t>(tfr_utilities::Joint::RIGHT_TREAD)];
+            brushless_right_tread_vel_publisher.msg_.data =
+                std::max(std::min(static_cast<int32_t>(right_tread_command), 2000), -2000);
+            brushless_right_tread_vel_publisher.unlockAndPublish();
+        }
+    }
+
+    /*
+     * The samples are stamped with the time they were received, not the time
+     * the callback runs, so queueing in the spinner does not add jitter.
+     * */
+    void CanBackend::setBrushlessLeftEncoder(const ros::MessageEvent<std_msgs::Int32 const> &event)
+    {
+        std::lock_guard<std::mutex> lock(brushless_left_tread_mutex);
+        left_tread_velocity.addSample(event.getMessage()->data, event.getReceiptTime());
+    }
+
+    void CanBackend::setBrushlessRightEncoder(const ros::MessageEvent<std_msgs::Int32 const> &event)
+    {
+        std::lock_guard<std::mutex> lock(brushless_right_tread_mutex);
+        right_tread_velocity.addSample(event.getMessage()->data, event.getReceiptTime());
+    }
+
+    double CanBackend::readBrushlessRightVel(const ros::Time& now)
+    {
+        double counts_per_second;
+        {
+            std::lock_guard<std::mutex> lock(brushless_right_tread_mutex);
+            counts_per_second = right_tread_velocity.estimate(now);
+        }
+        return encoderRateToLinearSpeed(counts_per_second);
+    }
+
+    double CanBackend::readBrushlessLeftVel(const ros::Time& now)
+    {
+        double counts_per_second;
+        {
+            std::lock_guard<std::mutex> lock(brushless_left_tread_mutex);
+            counts_per_second = left_tread_velocity.estimate(now);
+        }
+        return encoderRateToLinearSpeed(counts_per_second);
+    }
+
+    // returns the linear speed of the robot (how fast it is moving forwards) in meters / second.
+    double CanBackend::encoderRateToLinearSpeed(double counts_per_second)
+    {
+        const double wheel_radius_meters = 0.15;
+        const double wheel_circumference = 2* 3.1415927 * wheel_radius_meters;
+
+        const double revolutions_per_second = counts_per_second / brushless_encoder_count_per_revolution;
+
+        return wheel_circumference * revolutions_per_second;
+    }
+
+    void CanBackend::readJointEncoder(const ros::MessageEvent<sensor_msgs::JointState const> &event, size_t index)
+    {
+        const sensor_msgs::JointState::ConstPtr &msg = event.getMessage();
+        if (msg->position.empty())
+            return;
+
+        std::lock_guard<std::mutex> lock(joint_mutex);
+        joint_encoders[index] = msg->position[0];
+        joint_velocities[index].addSample(joint_descriptors[index].toJoint(msg->position[0]),
+                event.getReceiptTime());
+    }
+
+    void CanBackend::readJointTorque(const std_msgs::Int16::ConstPtr &msg, size_t index)
+    {
+        std::lock_guard<std::mutex> lock(joint_mutex);
+        joint_torques[index] = msg->data;
+    }
+}
@@ -9,6 +9,23 @@
  *
  * PARAMETERS:
  *  ~rate: in hz how fast we want to run the control loop (double, default:10)
+ *  ~backend: "can" to drive the robot, "simulated" to run the controllers
+ *      against an in-process model of it (string, default:"can")
+ *  ~simulation/...: parameters of the simulated robot, see
+ *      simulated_backend.h (doubles, defaults in SimulatedBackend::Parameters)
+ *  ~threads/<name>/priority: SCHED_FIFO priority of a thread, 0 for normal
+ *      scheduling (int, defaults: control 40, safety 30, feedback 20, query 0)
+ *  ~threads/<name>/cpu: cpu to pin a thread to, -1 for any (int, default: -1)
+ * THREADS:
+ *  control - the read, update, write loop
+ *  safety - toggle_control, toggle_motors
+ *  feedback - hardware feedback, the controllers' command topics and the
+ *      controller manager services, which share its NodeHandle
+ *  query - bin_state, arm_state, zero_turntable, latency and traces
+ * PUBLISHED TOPICS:
+ *  /control/callback_latency - how long callbacks waited in each queue over
+ *      the last second (diagnostic_msgs/DiagnosticArray)
+ *  /command_trace/events - traced tread commands (tfr_msgs/TraceEvents)
  * SERVICES:
  *  /toggle_control - uses the empty service, needs to be explicitly turned on to work
  *  /toggle_motors - uses the empty service, needs to be explicitly turned on to work
@@ -27,28 +44,21 @@
 #include <controller_manager/controller_manager.h>
 #include <tfr_utilities/joints.h>
 #include "robot_interface.h"
+#include "can_backend.h"
+#include "simulated_backend.h"
 #include "bin_control_server.h"
-#include <sensor_msgs/Imu.h>
-#include <geometry_msgs/Vector3.h>
-
-
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include "callback_spinner.h"
+#include <tfr_utilities/command_trace.h>
+#include <atomic>
+#include <sstream>
 
-namespace control_test
-{
-    // ADAM'S TEST CODE
-    // Whether we're running on hardware or using fake values
-    bool use_fake_values = false;
-    // If we're faking the inputs, we need to know the model constraints on
-    // the arm: load them here.
-    // If not, just use zeroes, the limits don't matter. TEST code
-    double lower_limits[tfr_utilities::Joint::JOINT_COUNT] = {};
-    double upper_limits[tfr_utilities::Joint::JOINT_COUNT] = {};
-}
 
-using namespace control_test;
 
-//test code
-void initializeTestCode(ros::NodeHandle& n)
+/*
+ * Loads the joint limits of the simulated robot from the URDF model
+ * */
+void loadJointLimits(ros::NodeHandle& n, double lower_limits[], double upper_limits[])
 {
     // Get the model description 
     std::string desc;
@@ -56,57 +66,89 @@ void initializeTestCode(ros::NodeHandle& n)
 
     if (desc.length() == 0) 
     {
-        ROS_WARN("robot_description is empty and controller_launcher is using fake values, quitting.");
+        ROS_WARN("robot_description is empty, the simulated joints are not limited.");
+        return;
     }
 
     urdf::Model model;
     if (!model.initString(desc)) 
     {
-        ROS_WARN("Couldn't load robot_description.");
+        ROS_WARN("Couldn't load robot_description, the simulated joints are not limited.");
+        return;
     }
 
     ROS_INFO("Model loaded successfully, loading joint limits.");
-    lower_limits[static_cast<int>(tfr_utilities::Joint::BIN)] 
-        = model.getJoint("bin_joint")->limits->lower;
-    upper_limits[static_cast<int>(tfr_utilities::Joint::BIN)] 
-        = model.getJoint("bin_joint")->limits->upper;
-    lower_limits[static_cast<int>(tfr_utilities::Joint::LOWER_ARM)] 
-        = model.getJoint("lower_arm_joint")->limits->lower;
-    upper_limits[static_cast<int>(tfr_utilities::Joint::LOWER_ARM)] 
-        = model.getJoint("lower_arm_joint")->limits->upper;
-    lower_limits[static_cast<int>(tfr_utilities::Joint::UPPER_ARM)] 
-        = model.getJoint("upper_arm_joint")->limits->lower;
-    upper_limits[static_cast<int>(tfr_utilities::Joint::UPPER_ARM)] 
-        = model.getJoint("upper_arm_joint")->limits->upper;
-    lower_limits[static_cast<int>(tfr_utilities::Joint::SCOOP)] 
-        = model.getJoint("scoop_joint")->limits->lower;
-    upper_limits[static_cast<int>(tfr_utilities::Joint::SCOOP)] 
-        = model.getJoint("scoop_joint")->limits->upper;
+    const std::pair<const char*, tfr_utilities::Joint> limited[] =
+    {
+        {"bin_joint", tfr_utilities::Joint::BIN},
+        {"lower_arm_joint", tfr_utilities::Joint::LOWER_ARM},
+        {"upper_arm_joint", tfr_utilities::Joint::UPPER_ARM},
+        {"scoop_joint", tfr_utilities::Joint::SCOOP},
+    };
+    for (const auto& joint : limited)
+    {
+        auto urdf_joint = model.getJoint(joint.first);
+        if (!urdf_joint || !urdf_joint->limits)
+        {
+            ROS_WARN("%s has no limits in robot_description.", joint.first);
+            continue;
+        }
+        lower_limits[static_cast<int>(joint.second)] = urdf_joint->limits->lower;
+        upper_limits[static_cast<int>(joint.second)] = urdf_joint->limits->upper;
+    }
+}
+
+/*
+ * Creates the backend selected by ~backend
+ * */
+std::unique_ptr<tfr_control::HardwareBackend> createBackend(ros::NodeHandle& n)
+{
+    std::string backend;
+    ros::param::param<std::string>("~backend", backend, "can");
+
+    if (backend == "simulated")
+    {
+        tfr_control::SimulatedBackend::Parameters parameters;
+        ros::param::param<double>("~simulation/tread_max_speed", parameters.tread_max_speed, parameters.tread_max_speed);
+        ros::param::param<double>("~simulation/tread_full_command", parameters.tread_full_command, parameters.tread_full_command);
+        ros::param::param<double>("~simulation/tread_time_constant", parameters.tread_time_constant, parameters.tread_time_constant);
+        ros::param::param<double>("~simulation/tread_max_acceleration", parameters.tread_max_acceleration, parameters.tread_max_acceleration);
+        ros::param::param<double>("~simulation/bin_max_rate", parameters.bin_max_rate, parameters.bin_max_rate);
+        ros::param::param<double>("~simulation/arm_max_rate", parameters.arm_max_rate, parameters.arm_max_rate);
+        ros::param::param<double>("~simulation/sensor_latency", parameters.sensor_latency, parameters.sensor_latency);
+        loadJointLimits(n, parameters.lower_limits, parameters.upper_limits);
+        ROS_INFO("control: using the simulated robot");
+        return std::unique_ptr<tfr_control::HardwareBackend>(new tfr_control::SimulatedBackend(parameters));
+    }
+
+    if (backend != "can")
+    {
+        ROS_WARN("control: unknown backend '%s', using the robot", backend.c_str());
+    }
+    return std::unique_ptr<tfr_control::HardwareBackend>(new tfr_control::CanBackend(n));
 }
-//END TEST CODE
 
 
 class Control
 {
     public:
-        Control(ros::NodeHandle &n, double& rate):
-            robot_interface{n, use_fake_values, lower_limits, upper_limits},
-            controller_interface{&robot_interface},
-            eStopControl{n.advertiseService("toggle_control", &Control::toggleControl,this)},
-            eStopMotors{n.advertiseService("toggle_motors", &Control::toggleControl,this)},
-            binService{n.advertiseService("bin_state", &Control::getBinState,this)},
-            armService{n.advertiseService("arm_state", &Control::getArmState,this)},
-            zeroService{n.advertiseService("zero_turntable", &Control::zeroTurntable,this)},
+        /*
+         * Each node handle decides which queue, and so which thread, serves
+         * the callbacks set up with it. The controller manager sets up its
+         * services and the controllers' topics on the one it gets, so they
+         * are all on feedback, where the commands can't wait behind queries.
+         * */
+        Control(ros::NodeHandle &feedback, ros::NodeHandle &safety, ros::NodeHandle &query, double& rate):
+            robot_interface{createBackend(feedback)},
+            controller_interface{&robot_interface, feedback},
+            eStopControl{safety.advertiseService("toggle_control", &Control::toggleControl,this)},
+            eStopMotors{safety.advertiseService("toggle_motors", &Control::toggleControl,this)},
+            binService{query.advertiseService("bin_state", &Control::getBinState,this)},
+            armService{query.advertiseService("arm_state", &Control::getArmState,this)},
+            zeroService{query.advertiseService("zero_turntable", &Control::zeroTurntable,this)},
             cycle{1/rate},
-            enabled{false},
-			quat_x_sub{n.subscribe("/device120/quaternion_x", 5, &Control::updatePrivateLocalVariable1,this)},
-			quat_y_sub{n.subscribe("/device120/quaternion_y", 5, &Control::updatePrivateLocalVariable2,this)},
-			quat_z_sub{n.subscribe("/device120/quaternion_z", 5, &Control::updatePrivateLocalVariable3,this)},
-			quat_w_sub{n.subscribe("/device120/quaternion_w", 5, &Control::updatePrivateLocalVariable4,this)},
-			lin_vel_x_sub{n.subscribe("linear_acceleration_x", 5, &Control::accumulateX,this)},
-			lin_vel_y_sub{n.subscribe("linear_acceleration_y", 5, &Control::accumulateY,this)},
-			lin_vel_z_sub{n.subscribe("linear_acceleration_z", 5, &Control::accumulateZ,this)}
-		{}
+            enabled{false}
+        {}
         
         /*
          * performs one iteration of the control loop
@@ -146,165 +188,8 @@ class Control
         //how fast to spin
         ros::Duration cycle;
 
-		double quat_x = 0;
-		double quat_y = 0;
-		double quat_z = 0;
-		double quat_w = 0;
-		
-		double lin_acc_x = 0;
-		double lin_acc_y = 0;
-		double lin_acc_z = 0;
-		
-		double lin_vel_x = 0;
-		double lin_vel_y = 0;
-		double lin_vel_z = 0;
-		
-		ros::Subscriber quat_x_sub;
-		ros::Subscriber quat_y_sub;
-		ros::Subscriber quat_z_sub;
-		ros::Subscriber quat_w_sub;
-		
-		ros::Subscriber lin_vel_x_sub;
-		ros::Subscriber lin_vel_y_sub;
-		ros::Subscriber lin_vel_z_sub;
-		
-		void updatePrivateLocalVariable1(const std_msgs::Float64 &value)
-		{
-			quat_x = value.data;
-		}
-		
-		void updatePrivateLocalVariable2(const std_msgs::Float64 &value)
-		{
-			quat_y = value.data;
-		}
-		
-		void updatePrivateLocalVariable3(const std_msgs::Float64 &value)
-		{
-			quat_z = value.data;
-		}
-		
-		void updatePrivateLocalVariable4(const std_msgs::Float64 &value)
-		{
-			quat_w = value.data;
-		}
-		
-		
-		void accumulateX(const std_msgs::Float64 &value)
-		{
-			lin_acc_x = value.data;
-			lin_vel_x += value.data;
-		}
-		
-		void accumulateY(const std_msgs::Float64 &value)
-		{
-			lin_acc_y = value.data;
-			lin_vel_y += value.data;
-		}
-		
-		void accumulateZ(const std_msgs::Float64 &value)
-		{
-			lin_acc_z = value.data;
-			lin_vel_z += value.data;
-		}
-		
-		
-        //if our motors are enabled
-        bool enabled;
-
-		/* void publishIMUOdometry()
-		{
-		    //TODO:
-		    ros::NodeHandle n;
-            ros::Publisher odom_pub = n.advertise<sensor_msgs::Imu>("/sensors/mti/sensor/imu", 50);
-            tf::TransformBroadcaster odom_broadcaster;
-            //abcd
-            double imu_x = 0.0;
-            double imu_y = 0.0;
-            double imu_th = 0.0;
-
-            double imu_vx = 0.1;
-            double imu_vy = -0.1;
-            double imu_vth = 0.1;
-
-            ros::Time current_time, last_time;
-            current_time = ros::Time::now();
-            last_time = ros::Time::now();
-
-            //ros::Rate r(1.0);
-            if (n.ok()){
-
-                //ros::spinOnce();               // check for incoming messages
-                current_time = ros::Time::now();
-
-                //compute odometry in a typical way given the velocities of the robot
-                double dt = (current_time - last_time).toSec();
-                double delta_x = 0;//(vx * cos(th) - vy * sin(th)) * dt;
-                double delta_y = 0;//(vx * sin(th) + vy * cos(th)) * dt;
-                double delta_th = 0;//vth * dt;
-
-                //x += delta_x;
-                //y += delta_y;
-                //th += delta_th;
-
-                //since all odometry is 6DOF we'll need a quaternion created from yaw
-                geometry_msgs::Quaternion odom_quat{};// = tf::createQuaternionMsgFromYaw(th);
-
-                odom_quat.x = quat_x;
-                odom_quat.y = quat_y;
-                odom_quat.z = quat_z;
-                odom_quat.w = quat_w;
-
-                //first, we'll publish the transform over tf
-                geometry_msgs::TransformStamped odom_trans;
-                odom_trans.header.stamp = current_time;
-                odom_trans.header.frame_id = "odom";
-                odom_trans.child_frame_id = "base_link";
-
-                //odom_trans.transform.translation.x = x;
-                //odom_trans.transform.translation.y = y;
-                //odom_trans.transform.translation.z = 0.0;
-                //odom_trans.transform.rotation = odom_quat;
-
-                //send the transform
-                //odom_broadcaster.sendTransform(odom_trans);
-
-                //next, we'll publish the odometry message over ROS
-                nav_msgs::Odometry odom;
-                odom.header.stamp = current_time;
-                odom.header.frame_id = "odom";
-
-                //set the position
-                //odom.pose.pose.position.x = x;
-                //odom.pose.pose.position.y = y;
-                //odom.pose.pose.position.z = 0.0;
-                odom.pose.pose.orientation = odom_quat;
-
-                //set the velocity
-                odom.child_frame_id = "base_link";
-                odom.twist.twist.linear.x = lin_vel_x;
-                odom.twist.twist.linear.y = lin_vel_y;
-                odom.twist.twist.linear.z = lin_vel_z;
-                //odom.twist.twist.angular.z = vth;
-
-                //publish the message
-                //odom_pub.publish(odom);
-
-                sensor_msgs::Imu imu_msg;
-                imu_msg.orientation = odom_quat;
-
-                geometry_msgs::Vector3 lin_acc;
-                lin_acc.x = lin_acc_x;
-                lin_acc.y = lin_acc_y;
-                lin_acc.z = lin_acc_z;
-
-                imu_msg.linear_acceleration = lin_acc;
-
-                odom_pub.publish(imu_msg);
-
-                last_time = current_time;
-                //r.sleep();
-            }
-		} */
+        //if our motors are enabled, set from the safety thread
+        std::atomic<bool> enabled;
 
         /*
          * Toggles the emergency stop on and off
@@ -364,6 +249,52 @@ class Control
 
 };
 
+/*
+ * Reads the scheduling of a thread from ~threads/<name>/
+ * */
+void threadParameters(const std::string& name, int default_priority, int& priority, int& cpu)
+{
+    ros::param::param<int>("~threads/" + name + "/priority", priority, default_priority);
+    ros::param::param<int>("~threads/" + name + "/cpu", cpu, -1);
+}
+
+std::unique_ptr<tfr_control::CallbackSpinner> createSpinner(const std::string& name, int default_priority)
+{
+    int priority, cpu;
+    threadParameters(name, default_priority, priority, cpu);
+    return std::unique_ptr<tfr_control::CallbackSpinner>(
+            new tfr_control::CallbackSpinner(name, priority, cpu));
+}
+
+/*
+ * Publishes the queue latency of each spinner since the last call
+ * */
+void publishCallbackLatency(ros::Publisher& publisher,
+        const std::vector<std::unique_ptr<tfr_control::CallbackSpinner>>& spinners)
+{
+    diagnostic_msgs::DiagnosticArray array;
+    array.header.stamp = ros::Time::now();
+    for (const auto& spinner : spinners)
+    {
+        const auto stats = spinner->takeStats();
+        diagnostic_msgs::DiagnosticStatus status;
+        status.level = diagnostic_msgs::DiagnosticStatus::OK;
+        status.name = "control: " + spinner->getName() + " queue";
+        std::ostringstream message;
+        message << stats.callbacks << " callbacks, max wait " << stats.max * 1000 << " ms";
+        status.message = message.str();
+        status.values.resize(3);
+        status.values[0].key = "callbacks";
+        status.values[0].value = std::to_string(stats.callbacks);
+        status.values[1].key = "mean_latency_ms";
+        status.values[1].value = std::to_string(stats.mean * 1000);
+        status.values[2].key = "max_latency_ms";
+        status.values[2].value = std::to_string(stats.max * 1000);
+        array.status.push_back(status);
+    }
+    publisher.publish(array);
+}
+
 int main(int argc, char **argv)
 {
     ros::init(argc, argv, "control");
@@ -372,21 +303,41 @@ int main(int argc, char **argv)
     double rate;
     ros::param::param<double>("~rate", rate, 10.0);
 
-    //test code
-    if (use_fake_values)
-        initializeTestCode(n);
-
-    // Start a spinner for ros node in the background, seperate from this thread
-    // that manages the control loop
-    ros::AsyncSpinner spinner(1);
-    spinner.start();
+    // One queue and thread per kind of callback, so an emergency stop never
+    // waits behind a burst of sensor messages. They are declared before the
+    // control layer so they outlive the subscriptions that use them.
+    std::vector<std::unique_ptr<tfr_control::CallbackSpinner>> spinners;
+    spinners.push_back(createSpinner("safety", 30));
+    spinners.push_back(createSpinner("feedback", 20));
+    spinners.push_back(createSpinner("query", 0));
+    ros::NodeHandle safety = spinners[0]->nodeHandle(n);
+    ros::NodeHandle feedback = spinners[1]->nodeHandle(n);
+    ros::NodeHandle query = spinners[2]->nodeHandle(n);
+
+    ros::Publisher latency_publisher = query.advertise<diagnostic_msgs::DiagnosticArray>("control/callback_latency", 1);
+    ros::WallTimer latency_timer = query.createWallTimer(ros::WallDuration(1.0),
+            [&](const ros::WallTimerEvent&) { publishCallbackLatency(latency_publisher, spinners); });
+
+    Control control{feedback, safety, query, rate};
+    tfr_utilities::TraceExporter trace_exporter{query};
+
+    for (auto& spinner : spinners)
+    {
+        spinner->start();
+    }
 
-    Control control{n, rate};
+    int priority, cpu;
+    threadParameters("control", 40, priority, cpu);
+    tfr_control::setThreadScheduling(pthread_self(), "control", priority, cpu);
 
     while (ros::ok())
     {
-        ros::spinOnce();
         control.execute();
     }
+
+    for (auto& spinner : spinners)
+    {
+        spinner->stop();
+    }
     return 0;
 }
@@ -9,14 +9,21 @@
 namespace tfr_control
 {
     DrivebasePublisher::DrivebasePublisher(
-        ros::NodeHandle& n, double wheel_radius, double wheel_span) : 
-        n{n}, wheel_radius{wheel_radius}, wheel_span{wheel_span}, 
-        left_tread_publisher{}, right_tread_publisher{}
+        ros::NodeHandle& n, double wheel_radius) : 
+        n{n}, wheel_radius{wheel_radius}, config{},
+        left_tread_publisher{}, right_tread_publisher{},
+        cmd_vel_trace{n, "cmd_vel"},
+        command_trace{n, "left_tread_velocity_controller/command"},
+        trace_exporter{n}
     {
         left_tread_publisher = n.advertise<std_msgs::Float64>(
             "left_tread_velocity_controller/command", 5);
         right_tread_publisher = n.advertise<std_msgs::Float64>(
             "right_tread_velocity_controller/command", 5);
+        left_setpoint_publisher = n.advertise<std_msgs::Float64>(
+            "left_tread_velocity_controller/setpoint", 5);
+        right_setpoint_publisher = n.advertise<std_msgs::Float64>(
+            "right_tread_velocity_controller/setpoint", 5);
 
 
         subscriber = n.subscribe("cmd_vel", 100, &DrivebasePublisher::subscriptionCallback, this);
@@ -24,8 +31,15 @@ namespace tfr_control
 
     void DrivebasePublisher::subscriptionCallback(const geometry_msgs::Twist::ConstPtr& msg)
     {
-        ros::param::getCached("~wheel_span", wheel_span);
-        //ROS_INFO("Wheel Span: %f", wheel_span);
+        // a cmd_vel that did not come with a trace (e.g. move_base) starts one
+        uint64_t trace_id = cmd_vel_trace.take();
+        if (trace_id == 0)
+        {
+            trace_id = tfr_utilities::newTraceId();
+        }
+        tfr_utilities::recordTrace(trace_id, "drivebase/cmd_vel");
+
+        const double wheel_span = config.get()->wheel_span;
 
          double left_velocity = msg->linear.x - (wheel_span * msg->angular.z) / 2;
         double right_velocity = msg->linear.x + (wheel_span * msg->angular.z) / 2;
@@ -44,12 +58,14 @@ namespace tfr_control
         left_cmd.data = left_velocity;
         std_msgs::Float64 right_cmd;
         right_cmd.data = right_velocity;
+        tfr_utilities::recordTrace(trace_id, "drivebase/command");
+        command_trace.announce(trace_id);
         left_tread_publisher.publish(left_cmd);
         right_tread_publisher.publish(right_cmd);
         
-        // Debug. Write the setpoints to the parameter server so that other nodes can see them.
-        n.setParam("/left_tread_velocity_controller/setpoint", left_cmd.data);
-        n.setParam("/right_tread_velocity_controller/setpoint", right_cmd.data);
+        // Debug. Publish the setpoints so that other nodes can see them.
+        left_setpoint_publisher.publish(left_cmd);
+        right_setpoint_publisher.publish(right_cmd);
     }
 
 }
@@ -60,14 +76,7 @@ int main(int argc, char **argv)
 
     ros::NodeHandle n;
     
-    double wheel_span, wheel_radius;
-
-    ros::param::param<double>("~wheel_span", wheel_span, 1);
-    if (wheel_span <= 0)
-    {
-        ROS_ERROR("Parameter 'wheel_span' must be a positive value.");
-        return 1;
-    }
+    double wheel_radius;
 
     ros::param::param<double>("~wheel_radius", wheel_radius, 1);
     if (wheel_radius <= 0)
@@ -76,7 +85,8 @@ int main(int argc, char **argv)
         return 1;
     }
     
-    tfr_control::DrivebasePublisher publisher(n, wheel_span, wheel_radius);
+    // wheel_span is checked by the dynamic_reconfigure limits
+    tfr_control::DrivebasePublisher publisher(n, wheel_radius);
     
     ROS_INFO("drivebase started");
 
@@ -0,0 +1,115 @@
+/**
+ * joint_descriptor.cpp
+ *
+ * Loads the joint descriptor table, see joint_descriptor.h
+ */
+#include "joint_descriptor.h"
+#include <XmlRpcValue.h>
+#include <cmath>
+
+namespace tfr_control
+{
+    namespace
+    {
+        /*
+         * yaml numbers come back as ints or doubles depending on how they
+         * were written.
+         * */
+        bool readNumber(XmlRpc::XmlRpcValue& entry, const std::string& key, double& value)
+        {
+            if (!entry.hasMember(key))
+                return false;
+
+            XmlRpc::XmlRpcValue& number = entry[key];
+            if (number.getType() == XmlRpc::XmlRpcValue::TypeInt)
+                value = static_cast<int>(number);
+            else if (number.getType() == XmlRpc::XmlRpcValue::TypeDouble)
+                value = static_cast<double>(number);
+            else
+                return false;
+            return true;
+        }
+    }
+
+    tfr_utilities::Joint jointFromName(const std::string& name)
+    {
+        static const char* names[tfr_utilities::Joint::JOINT_COUNT] =
+        {
+            "left_tread_joint",
+            "right_tread_joint",
+            "bin_joint",
+            "turntable_joint",
+            "lower_arm_joint",
+            "upper_arm_joint",
+            "scoop_joint",
+        };
+        for (int joint = 0; joint < tfr_utilities::Joint::JOINT_COUNT; joint++)
+        {
+            if (name == names[joint])
+                return static_cast<tfr_utilities::Joint>(joint);
+        }
+        return tfr_utilities::Joint::JOINT_COUNT;
+    }
+
+    bool loadJointDescriptors(ros::NodeHandle& n, const std::string& param,
+            std::vector<JointDescriptor>& descriptors)
+    {
+        XmlRpc::XmlRpcValue table;
+        if (!n.getParam(param, table) || table.getType() != XmlRpc::XmlRpcValue::TypeStruct)
+        {
+            ROS_ERROR("Joint descriptor table '%s' is missing, make sure "
+                    "absolute_position_encoder_limits.yaml is loaded.", param.c_str());
+            return false;
+        }
+
+        descriptors.clear();
+        descriptors.reserve(table.size());
+        for (auto& item : table)
+        {
+            const std::string& name = item.first;
+            XmlRpc::XmlRpcValue& entry = item.second;
+
+            JointDescriptor descriptor{};
+            descriptor.name = name;
+            descriptor.joint = jointFromName(name);
+            double device = 0;
+            if (descriptor.joint == tfr_utilities::Joint::JOINT_COUNT ||
+                    entry.getType() != XmlRpc::XmlRpcValue::TypeStruct ||
+                    !readNumber(entry, "device", device) ||
+                    !readNumber(entry, "encoder_min", descriptor.encoder_min) ||
+                    !readNumber(entry, "encoder_max", descriptor.encoder_max) ||
+                    !readNumber(entry, "joint_at_encoder_min", descriptor.joint_at_encoder_min) ||
+                    !readNumber(entry, "joint_at_encoder_max", descriptor.joint_at_encoder_max))
+            {
+                ROS_ERROR("Joint descriptor '%s' is not a known joint or is incomplete, skipping it.", name.c_str());
+                continue;
+            }
+            if (std::abs(descriptor.encoder_max - descriptor.encoder_min) < 1E-9)
+            {
+                ROS_ERROR("Joint descriptor '%s' has an empty encoder range, skipping it.", name.c_str());
+                continue;
+            }
+
+            descriptor.device = static_cast<int>(device);
+            const std::string prefix = "/device" + std::to_string(descriptor.device);
+            descriptor.encoder_topic = prefix + "/get_joint_state";
+            descriptor.torque_topic = prefix + "/get_torque_actual_value";
+            if (entry.hasMember("torque_topic") &&
+                    entry["torque_topic"].getType() == XmlRpc::XmlRpcValue::TypeString)
+            {
+                descriptor.torque_topic = static_cast<std::string>(entry["torque_topic"]);
+            }
+
+            double rated_effort = 1.0;
+            readNumber(entry, "rated_effort", rated_effort);
+            // the torque is reported in thousandths of the rated torque
+            descriptor.effort_scale = rated_effort / 1000.0;
+
+            descriptor.slope = (descriptor.joint_at_encoder_max - descriptor.joint_at_encoder_min) /
+                (descriptor.encoder_max - descriptor.encoder_min);
+            descriptor.offset = descriptor.joint_at_encoder_min - descriptor.slope * descriptor.encoder_min;
+            descriptors.push_back(descriptor);
+        }
+        return true;
+    }
+}
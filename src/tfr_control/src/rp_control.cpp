@@ -6,6 +6,9 @@
 #include <thread>
 #include <ros/ros.h>
 #include <tfr_msgs/PwmCommand.h>
+#include <tfr_control/RpControlConfig.h>
+#include <tfr_utilities/cached_config.h>
+#include <memory>
 
 // The wiringPi library declares its functions directly in the global namespace by default, so we put it inside of a namespace.
 namespace wiringpi
@@ -23,8 +26,8 @@ const int COMMAND_SIZE_BYTES = 2;
 const int MOTOR_RIGHT = 0;
 const int MOTOR_LEFT  = 1;
 int fd;
-int right_power_scale = 100;
-int left_power_scale = 100;
+// right_power_scale and left_power_scale, see cfg/RpControl.cfg
+std::unique_ptr<tfr_utilities::CachedConfig<tfr_control::RpControlConfig>> power_config;
 
 
 void serialWriteCallback(const tfr_msgs::PwmCommand & command) {
@@ -34,12 +37,10 @@ void serialWriteCallback(const tfr_msgs::PwmCommand & command) {
     uint8_t * unsignedPower = (uint8_t *)motorPower;
     
     if(command.enabled) {
-        ros::param::getCached("~right_power_scale", right_power_scale);
-        ros::param::getCached("~left_power_scale", left_power_scale);
-        
+        const auto config = power_config->get();
 
-        motorPower[MOTOR_RIGHT] = command.tread_right * right_power_scale;
-        motorPower[MOTOR_LEFT] = command.tread_left * left_power_scale; // Jon changed this from negative to try and debug the right tread not spinning due to being sent -1 commands randomly
+        motorPower[MOTOR_RIGHT] = command.tread_right * config->right_power_scale;
+        motorPower[MOTOR_LEFT] = command.tread_left * config->left_power_scale; // Jon changed this from negative to try and debug the right tread not spinning due to being sent -1 commands randomly
         
         if (command.tread_right != 0 || command.tread_left != 0) {
             ROS_INFO("writing power: %d, %d", motorPower[MOTOR_RIGHT], motorPower[MOTOR_LEFT]);
@@ -75,6 +76,7 @@ int main (int argc, char** argv)
     }
     
     ros::NodeHandle n;
+    power_config.reset(new tfr_utilities::CachedConfig<tfr_control::RpControlConfig>());
     ros::Subscriber sub_obj = n.subscribe("/motor_output", 4, serialWriteCallback);
     ROS_INFO("About to spin raspberry pi node");
     ros::spin();
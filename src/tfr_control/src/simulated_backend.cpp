@@ -0,0 +1,138 @@
+/**
+ * simulated_backend.cpp
+ *
+ * In-process model of the robot, see simulated_backend.h
+ */
+#include "simulated_backend.h"
+#include <algorithm>
+#include <cmath>
+
+namespace tfr_control
+{
+    namespace
+    {
+        const double max_step = 0.005;
+    }
+
+    SimulatedBackend::SimulatedBackend(const Parameters& parameters) :
+        parameters(parameters),
+        plant{},
+        command{},
+        started{false},
+        history{},
+        head{0},
+        count{0}
+    {
+        for (int joint = 0; joint < tfr_utilities::Joint::JOINT_COUNT; joint++)
+        {
+            plant.position[joint] = clampToLimits(joint, 0);
+            command[joint] = plant.position[joint];
+        }
+        command[tfr_utilities::Joint::LEFT_TREAD] = 0;
+        command[tfr_utilities::Joint::RIGHT_TREAD] = 0;
+        command[tfr_utilities::Joint::BIN] = 0;
+    }
+
+    void SimulatedBackend::read(const ros::Time& now, double position[], double velocity[],
+            double effort[])
+    {
+        advance(now);
+
+        // newest recorded state that is at least sensor_latency old
+        const ros::Time sensed = now - ros::Duration(parameters.sensor_latency);
+        size_t i = 0;
+        while (i + 1 < count && history[(head + HISTORY_SIZE - i) % HISTORY_SIZE].stamp > sensed)
+            i++;
+        const PlantState& state = history[(head + HISTORY_SIZE - i) % HISTORY_SIZE];
+
+        std::copy(state.position, state.position + tfr_utilities::Joint::JOINT_COUNT, position);
+        std::copy(state.velocity, state.velocity + tfr_utilities::Joint::JOINT_COUNT, velocity);
+        std::copy(state.effort, state.effort + tfr_utilities::Joint::JOINT_COUNT, effort);
+    }
+
+    void SimulatedBackend::write(const ros::Time& now, const double command[])
+    {
+        advance(now);
+        std::copy(command, command + tfr_utilities::Joint::JOINT_COUNT, this->command);
+    }
+
+    void SimulatedBackend::advance(const ros::Time& now)
+    {
+        // start over on the first call, and when the clock jumped back
+        if (!started || now < plant.stamp)
+        {
+            started = true;
+            plant.stamp = now;
+            count = 0;
+        }
+        else
+        {
+            double remaining = (now - plant.stamp).toSec();
+            while (remaining > 0)
+            {
+                const double dt = std::min(remaining, max_step);
+                step(dt);
+                remaining -= dt;
+            }
+            plant.stamp = now;
+        }
+
+        if (count > 0 && !(plant.stamp > history[head].stamp))
+        {
+            history[head] = plant;
+            return;
+        }
+        head = (head + 1) % HISTORY_SIZE;
+        history[head] = plant;
+        if (count < HISTORY_SIZE)
+            count++;
+    }
+
+    void SimulatedBackend::step(double dt)
+    {
+        //LEFT_TREAD, RIGHT_TREAD
+        const double lag = 1 - std::exp(-dt / parameters.tread_time_constant);
+        const double max_change = parameters.tread_max_acceleration * dt;
+        for (int joint : {tfr_utilities::Joint::LEFT_TREAD, tfr_utilities::Joint::RIGHT_TREAD})
+        {
+            const double demand = std::max(std::min(command[joint] / parameters.tread_full_command, 1.0), -1.0);
+            const double target = demand * parameters.tread_max_speed;
+            const double change = std::max(std::min((target - plant.velocity[joint]) * lag, max_change), -max_change);
+            plant.velocity[joint] += change;
+            plant.position[joint] += plant.velocity[joint] * dt;
+            plant.effort[joint] = command[joint];
+        }
+
+        //BIN
+        {
+            const int joint = tfr_utilities::Joint::BIN;
+            const double demand = std::max(std::min(command[joint], 1.0), -1.0);
+            const double previous = plant.position[joint];
+            plant.position[joint] = clampToLimits(joint, previous + demand * parameters.bin_max_rate * dt);
+            plant.velocity[joint] = (plant.position[joint] - previous) / dt;
+            plant.effort[joint] = command[joint];
+        }
+
+        //TURNTABLE, LOWER_ARM, UPPER_ARM, SCOOP
+        const double max_move = parameters.arm_max_rate * dt;
+        for (int joint = tfr_utilities::Joint::TURNTABLE; joint <= tfr_utilities::Joint::SCOOP; joint++)
+        {
+            const double previous = plant.position[joint];
+            const double target = clampToLimits(joint, command[joint]);
+            const double move = std::max(std::min(target - previous, max_move), -max_move);
+            plant.position[joint] = previous + move;
+            plant.velocity[joint] = move / dt;
+            plant.effort[joint] = 0;
+        }
+    }
+
+    double SimulatedBackend::clampToLimits(int joint, double value) const
+    {
+        const double lower = parameters.lower_limits[joint];
+        const double upper = parameters.upper_limits[joint];
+        // If this joint has limits, clamp the range down
+        if (std::abs(lower) >= 1E-3 || std::abs(upper) >= 1E-3)
+            return std::max(std::min(value, upper), lower);
+        return value;
+    }
+}
@@ -0,0 +1,78 @@
+/**
+ * slope_estimator.cpp
+ *
+ * Windowed least squares rate estimate, see slope_estimator.h
+ */
+#include "slope_estimator.h"
+
+namespace tfr_control
+{
+    SlopeEstimator::SlopeEstimator(double window, double stale_timeout) :
+        samples{},
+        head{0},
+        count{0},
+        window{window},
+        stale_timeout{stale_timeout}
+    {
+    }
+
+    bool SlopeEstimator::addSample(double value, const ros::Time& stamp)
+    {
+        if (count > 0 && stamp <= newest(0).stamp)
+            return false;
+
+        head = (head + 1) % CAPACITY;
+        samples[head] = Sample{stamp, value};
+        if (count < CAPACITY)
+            count++;
+        return true;
+    }
+
+    double SlopeEstimator::estimate(const ros::Time& now) const
+    {
+        if (count < 2 || isStale(now))
+            return 0;
+
+        // Fit value = a + v * t over the window. The times and values are
+        // taken relative to the newest sample to keep the sums small.
+        const Sample& last = newest(0);
+        double sum_t = 0, sum_v = 0, sum_tt = 0, sum_tv = 0;
+        size_t n = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            const Sample& sample = newest(i);
+            const double t = (sample.stamp - last.stamp).toSec();
+            // always use at least the two newest samples
+            if (n >= 2 && -t > window.toSec())
+                break;
+
+            const double v = sample.value - last.value;
+            sum_t += t;
+            sum_v += v;
+            sum_tt += t * t;
+            sum_tv += t * v;
+            n++;
+        }
+
+        const double denominator = n * sum_tt - sum_t * sum_t;
+        if (denominator <= 0)
+            return 0;
+        return (n * sum_tv - sum_t * sum_v) / denominator;
+    }
+
+    bool SlopeEstimator::isStale(const ros::Time& now) const
+    {
+        return count == 0 || now - newest(0).stamp > stale_timeout;
+    }
+
+    void SlopeEstimator::reset()
+    {
+        head = 0;
+        count = 0;
+    }
+
+    const SlopeEstimator::Sample& SlopeEstimator::newest(size_t i) const
+    {
+        return samples[(head + CAPACITY - i) % CAPACITY];
+    }
+}
@@ -0,0 +1,42 @@
+/**
+ * tread_velocity_estimator.cpp
+ *
+ * Unwraps the tread counter for the slope estimate, see
+ * tread_velocity_estimator.h
+ */
+#include "tread_velocity_estimator.h"
+
+namespace tfr_control
+{
+    TreadVelocityEstimator::TreadVelocityEstimator(double window, double stale_timeout) :
+        slope{window, stale_timeout},
+        counter{tfr_utilities::TickUnwrapper::int32Counter()}
+    {
+    }
+
+    void TreadVelocityEstimator::addSample(int32_t raw_count, const ros::Time& stamp)
+    {
+        // only taken if the slope estimator takes the sample
+        const tfr_utilities::TickUnwrapper::Step step = counter.peek(raw_count);
+        if (slope.addSample(static_cast<double>(step.position), stamp))
+        {
+            counter.accept(step);
+        }
+    }
+
+    double TreadVelocityEstimator::estimate(const ros::Time& now) const
+    {
+        return slope.estimate(now);
+    }
+
+    bool TreadVelocityEstimator::isStale(const ros::Time& now) const
+    {
+        return slope.isStale(now);
+    }
+
+    void TreadVelocityEstimator::reset()
+    {
+        slope.reset();
+        counter.reset(true);
+    }
+}
@@ -0,0 +1,285 @@
+/**
+ * benchmark_control_cycle.cpp
+ *
+ * Benchmark of the control cycle: RobotInterface::read(), a full
+ * controller_manager update with the tread controllers running and
+ * RobotInterface::write(), for a few hundred thousand to millions of
+ * iterations on each backend:
+ *
+ *  - null: a backend that does nothing, so the cost of RobotInterface and
+ *    the controllers alone
+ *  - simulated: the in-process plant
+ *  - can: the CAN bridge backend, publishing to nobody
+ *
+ * For each it reports ns per cycle (mean, and per stage), the tail latency
+ * of whole cycles (p50, p99, p99.9, max) and the allocations per cycle.
+ * The results are recorded as properties of the test, so they end up in
+ * the test results xml. Allocating in the cycle fails the test, and so does
+ * a regression from a baseline run beyond its tolerance. The times depend
+ * on the machine, so there are no fixed limits.
+ *
+ * It takes minutes, so it is only built with -DTFR_BENCHMARKS=ON:
+ *   catkin_make -DTFR_BENCHMARKS=ON run_tests_tfr_control
+ *
+ * Parameters (control_cycle_benchmark.test):
+ *  - ~cycles: iterations measured per backend (int, default 1000000)
+ *  - ~max_allocations_per_cycle: (double, default 0)
+ *  - ~baseline_path: results of an earlier run, see below (string, default "")
+ *  - ~tolerance: allowed increase of the mean over the baseline (double, default 0.25)
+ *  - ~tail_tolerance: allowed increase of the p99 over the baseline (double, default 1.0)
+ *  - ~results_path: where to write the results of this run (string, default "")
+ *
+ * To judge a change to the control layer, write the results of a run
+ * without it to a file with ~results_path on the same machine, then run
+ * with the change and that file as ~baseline_path. The file has one line
+ * per backend: "<backend> <mean_ns> <p99_ns>".
+ *
+ * The times include reading the clock around each stage, tens of ns per
+ * cycle; the overhead is measured and reported alongside.
+ */
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+#include <tfr_utilities/allocation_counter.h>
+#include "control_cycle.h"
+#include "can_backend.h"
+#include "simulated_backend.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    /*
+     * Keeps the joints where they are and ignores the commands.
+     * */
+    class NullBackend : public tfr_control::HardwareBackend
+    {
+    public:
+        void read(const ros::Time&, double position[], double velocity[],
+                double effort[]) override
+        {
+            for (int i = 0; i < tfr_utilities::Joint::JOINT_COUNT; i++)
+            {
+                position[i] = 0;
+                velocity[i] = 0;
+                effort[i] = 0;
+            }
+        }
+
+        void write(const ros::Time&, const double[]) override
+        {
+        }
+    };
+
+    struct Results
+    {
+        double mean_ns = 0;
+        double read_ns = 0;
+        double update_ns = 0;
+        double write_ns = 0;
+        double p50_ns = 0;
+        double p99_ns = 0;
+        double p999_ns = 0;
+        double max_ns = 0;
+        double clock_ns = 0;
+        double allocations_per_cycle = 0;
+    };
+
+    struct Baseline
+    {
+        double mean_ns;
+        double p99_ns;
+    };
+
+    int64_t nanoseconds(Clock::duration duration)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    }
+
+    /*
+     * The value below which the fraction p of the sorted samples lies
+     * */
+    double percentile(const std::vector<int64_t>& sorted, double p)
+    {
+        const size_t index = std::min(sorted.size() - 1,
+                static_cast<size_t>(p * sorted.size()));
+        return static_cast<double>(sorted[index]);
+    }
+
+    /*
+     * How long reading the clock takes
+     * */
+    double clockOverhead()
+    {
+        const int reads = 100000;
+        const Clock::time_point start = Clock::now();
+        Clock::time_point last = start;
+        for (int i = 0; i < reads; i++)
+        {
+            last = Clock::now();
+        }
+        return static_cast<double>(nanoseconds(last - start)) / reads;
+    }
+
+    Results measure(std::unique_ptr<tfr_control::HardwareBackend> backend, int cycles)
+    {
+        tfr_control::ControlCycle cycle{std::move(backend)};
+        cycle.startTreads(10000);
+        tfr_control::RobotInterface& robot = cycle.robotInterface();
+        controller_manager::ControllerManager& controllers = cycle.controllerManager();
+
+        std::vector<int64_t> samples(cycles);
+        int64_t read_total = 0, update_total = 0, write_total = 0;
+
+        tfr_utilities::AllocationCounter counter;
+        for (int i = 0; i < cycles; i++)
+        {
+            const Clock::time_point start = Clock::now();
+            robot.read();
+            const Clock::time_point read = Clock::now();
+            controllers.update(ros::Time::now(), cycle.period);
+            const Clock::time_point update = Clock::now();
+            robot.write();
+            const Clock::time_point end = Clock::now();
+
+            read_total += nanoseconds(read - start);
+            update_total += nanoseconds(update - read);
+            write_total += nanoseconds(end - update);
+            samples[i] = nanoseconds(end - start);
+        }
+        const size_t allocations = counter.allocations();
+
+        Results results;
+        results.read_ns = static_cast<double>(read_total) / cycles;
+        results.update_ns = static_cast<double>(update_total) / cycles;
+        results.write_ns = static_cast<double>(write_total) / cycles;
+        results.mean_ns = results.read_ns + results.update_ns + results.write_ns;
+        std::sort(samples.begin(), samples.end());
+        results.p50_ns = percentile(samples, 0.5);
+        results.p99_ns = percentile(samples, 0.99);
+        results.p999_ns = percentile(samples, 0.999);
+        results.max_ns = static_cast<double>(samples.back());
+        results.clock_ns = clockOverhead();
+        results.allocations_per_cycle = static_cast<double>(allocations) / cycles;
+        return results;
+    }
+
+    std::map<std::string, Baseline> loadBaseline(const std::string& path)
+    {
+        std::map<std::string, Baseline> baseline;
+        if (path.empty())
+        {
+            return baseline;
+        }
+        std::ifstream file{path};
+        if (!file)
+        {
+            ROS_WARN("control cycle benchmark: no baseline at %s", path.c_str());
+            return baseline;
+        }
+        std::string backend;
+        Baseline entry;
+        while (file >> backend >> entry.mean_ns >> entry.p99_ns)
+        {
+            baseline[backend] = entry;
+        }
+        return baseline;
+    }
+
+    void saveResults(const std::string& backend, const Results& results)
+    {
+        std::string path;
+        ros::param::param<std::string>("~results_path", path, "");
+        if (path.empty())
+        {
+            return;
+        }
+        // the tests run one after the other, each adds its line
+        std::ofstream file{path, std::ios::app};
+        file << backend << " " << results.mean_ns << " " << results.p99_ns << "\n";
+    }
+
+    /*
+     * Measures the control cycle on backend and checks the results against
+     * the baseline.
+     * */
+    void benchmark(const std::string& backend_name, std::unique_ptr<tfr_control::HardwareBackend> backend)
+    {
+        int cycles;
+        double max_allocations_per_cycle, tolerance, tail_tolerance;
+        std::string baseline_path;
+        ros::param::param<int>("~cycles", cycles, 1000000);
+        ros::param::param<double>("~max_allocations_per_cycle", max_allocations_per_cycle, 0);
+        ros::param::param<std::string>("~baseline_path", baseline_path, "");
+        ros::param::param<double>("~tolerance", tolerance, 0.25);
+        ros::param::param<double>("~tail_tolerance", tail_tolerance, 1.0);
+        ASSERT_GT(cycles, 0);
+
+        const Results results = measure(std::move(backend), cycles);
+        ROS_INFO("control cycle benchmark, %s backend, %d cycles:", backend_name.c_str(), cycles);
+        ROS_INFO("  mean %.0f ns (read %.0f, update %.0f, write %.0f, clock %.0f per read)",
+                results.mean_ns, results.read_ns, results.update_ns, results.write_ns,
+                results.clock_ns);
+        ROS_INFO("  p50 %.0f ns, p99 %.0f ns, p99.9 %.0f ns, max %.0f ns",
+                results.p50_ns, results.p99_ns, results.p999_ns, results.max_ns);
+        ROS_INFO("  %.3f allocations per cycle", results.allocations_per_cycle);
+
+        ::testing::Test::RecordProperty("mean_ns", std::to_string(results.mean_ns));
+        ::testing::Test::RecordProperty("p99_ns", std::to_string(results.p99_ns));
+        ::testing::Test::RecordProperty("p999_ns", std::to_string(results.p999_ns));
+        ::testing::Test::RecordProperty("max_ns", std::to_string(results.max_ns));
+        ::testing::Test::RecordProperty("allocations_per_cycle",
+                std::to_string(results.allocations_per_cycle));
+        saveResults(backend_name, results);
+
+        EXPECT_LE(results.allocations_per_cycle, max_allocations_per_cycle);
+
+        const std::map<std::string, Baseline> baseline = loadBaseline(baseline_path);
+        const auto entry = baseline.find(backend_name);
+        if (entry != baseline.end())
+        {
+            const double mean_change = 100 * (results.mean_ns / entry->second.mean_ns - 1);
+            const double p99_change = 100 * (results.p99_ns / entry->second.p99_ns - 1);
+            ROS_INFO("  baseline mean %.0f ns (%+.1f%%), p99 %.0f ns (%+.1f%%)",
+                    entry->second.mean_ns, mean_change, entry->second.p99_ns, p99_change);
+            ::testing::Test::RecordProperty("mean_change_percent", std::to_string(mean_change));
+            ::testing::Test::RecordProperty("p99_change_percent", std::to_string(p99_change));
+            EXPECT_LE(results.mean_ns, entry->second.mean_ns * (1 + tolerance))
+                << "the mean cycle time regressed from the baseline";
+            EXPECT_LE(results.p99_ns, entry->second.p99_ns * (1 + tail_tolerance))
+                << "the tail latency regressed from the baseline";
+        }
+    }
+}
+
+TEST(ControlCycleBenchmark, NullBackend)
+{
+    benchmark("null", std::unique_ptr<tfr_control::HardwareBackend>{new NullBackend()});
+}
+
+TEST(ControlCycleBenchmark, SimulatedBackend)
+{
+    tfr_control::SimulatedBackend::Parameters parameters;
+    benchmark("simulated", std::unique_ptr<tfr_control::HardwareBackend>{
+            new tfr_control::SimulatedBackend(parameters)});
+}
+
+TEST(ControlCycleBenchmark, CanBackend)
+{
+    ros::NodeHandle n;
+    benchmark("can", std::unique_ptr<tfr_control::HardwareBackend>{new tfr_control::CanBackend(n)});
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    ros::init(argc, argv, "control_cycle_benchmark");
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,105 @@
+/**
+ * control_cycle.h
+ *
+ * The control loop of the control node without the node around it, shared
+ * by the control cycle tests and the benchmark: a RobotInterface on some
+ * backend and a controller_manager with the tread velocity controllers
+ * running. The controllers and joint limits are read from the parameters
+ * the .test files load.
+ */
+#ifndef CONTROL_CYCLE_H
+#define CONTROL_CYCLE_H
+
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+#include <controller_manager/controller_manager.h>
+#include <controller_manager_msgs/SwitchController.h>
+#include "robot_interface.h"
+#include "hardware_backend.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tfr_control
+{
+    class ControlCycle
+    {
+    public:
+        explicit ControlCycle(std::unique_ptr<HardwareBackend> backend) :
+            n{},
+            robot{std::move(backend)},
+            controllers{&robot, n}
+        {
+        }
+        ControlCycle(const ControlCycle&) = delete;
+        ControlCycle& operator=(const ControlCycle&) = delete;
+        ControlCycle(ControlCycle&&) = delete;
+        ControlCycle& operator=(ControlCycle&&) = delete;
+
+        /*
+         * One iteration of the control loop, as in control.cpp
+         * */
+        void run()
+        {
+            robot.read();
+            controllers.update(ros::Time::now(), period);
+            robot.write();
+        }
+
+        /*
+         * Loads and starts the tread controllers, then runs settle_cycles so
+         * the controllers and publishers reach their steady state.
+         * */
+        void startTreads(int settle_cycles)
+        {
+            const std::vector<std::string> treads{"left_tread_velocity_controller", "right_tread_velocity_controller"};
+            for (const auto& name : treads)
+            {
+                EXPECT_TRUE(controllers.loadController(name));
+            }
+
+            // switchController() waits for the control loop to do the switch
+            std::atomic<bool> switched{false};
+            std::thread switcher{[&]()
+                {
+                    controllers.switchController(treads, {},
+                            controller_manager_msgs::SwitchController::Request::STRICT);
+                    switched = true;
+                }};
+            const ros::WallTime deadline = ros::WallTime::now() + ros::WallDuration(5.0);
+            while (!switched && ros::WallTime::now() < deadline)
+            {
+                run();
+                ros::WallDuration(0.001).sleep();
+            }
+            EXPECT_TRUE(switched);
+            switcher.join();
+
+            for (int i = 0; i < settle_cycles; i++)
+            {
+                run();
+            }
+        }
+
+        RobotInterface& robotInterface()
+        {
+            return robot;
+        }
+
+        controller_manager::ControllerManager& controllerManager()
+        {
+            return controllers;
+        }
+
+        const ros::Duration period{0.001};
+
+    private:
+        ros::NodeHandle n;
+        RobotInterface robot;
+        controller_manager::ControllerManager controllers;
+    };
+}
+
+#endif // CONTROL_CYCLE_H
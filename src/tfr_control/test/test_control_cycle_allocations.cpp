@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+#include <tfr_utilities/allocation_counter.h>
+#include "control_cycle.h"
+#include "can_backend.h"
+#include "simulated_backend.h"
+#include <memory>
+
+namespace
+{
+    const int measured_cycles = 1000;
+
+    /*
+     * Starts the tread controllers, then counts the allocations the control
+     * thread makes in the following cycles.
+     * */
+    size_t countSteadyStateAllocations(std::unique_ptr<tfr_control::HardwareBackend> backend)
+    {
+        tfr_control::ControlCycle cycle{std::move(backend)};
+        // let the controllers and publishers settle
+        cycle.startTreads(measured_cycles);
+
+        tfr_utilities::AllocationCounter counter;
+        for (int i = 0; i < measured_cycles; i++)
+        {
+            cycle.run();
+        }
+        return counter.allocations();
+    }
+}
+
+TEST(ControlCycle, SimulatedBackendDoesNotAllocate)
+{
+    tfr_control::SimulatedBackend::Parameters parameters;
+    std::unique_ptr<tfr_control::HardwareBackend> backend{new tfr_control::SimulatedBackend(parameters)};
+    EXPECT_EQ(countSteadyStateAllocations(std::move(backend)), 0u);
+}
+
+TEST(ControlCycle, CanBackendDoesNotAllocate)
+{
+    ros::NodeHandle n;
+    std::unique_ptr<tfr_control::HardwareBackend> backend{new tfr_control::CanBackend(n)};
+    EXPECT_EQ(countSteadyStateAllocations(std::move(backend)), 0u);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    ros::init(argc, argv, "control_cycle_allocations_test");
+    return RUN_ALL_TESTS();
+}
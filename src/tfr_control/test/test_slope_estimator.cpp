@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+#include "slope_estimator.h"
+#include <random>
+
+using tfr_control::SlopeEstimator;
+
+namespace
+{
+    // the CAN polling rate
+    const double PERIOD = 1.0 / 32;
+
+    /*
+     * Feeds value(t) at the polling rate for duration seconds, with the
+     * stamps off by up to jitter periods, and returns the time of the last.
+     * */
+    template <typename Value>
+    ros::Time feed(SlopeEstimator& estimator, ros::Time start, double duration, double jitter, Value value)
+    {
+        std::mt19937 random{42};
+        std::uniform_real_distribution<double> offset{-jitter * PERIOD, jitter * PERIOD};
+        ros::Time stamp = start;
+        for (double t = 0; t < duration; t += PERIOD)
+        {
+            stamp = start + ros::Duration(t + offset(random));
+            estimator.addSample(value(t), stamp);
+        }
+        return stamp;
+    }
+}
+
+TEST(SlopeEstimator, ConstantIsZero)
+{
+    SlopeEstimator estimator{0.25, 0.5};
+    const ros::Time last = feed(estimator, ros::Time{100}, 2, 0.3, [](double) { return 1.2; });
+    EXPECT_NEAR(0, estimator.estimate(last), 1e-9);
+}
+
+TEST(SlopeEstimator, FollowsALine)
+{
+    SlopeEstimator estimator{0.25, 0.5};
+    const ros::Time last = feed(estimator, ros::Time{100}, 2, 0, [](double t) { return 1.2 - 0.4 * t; });
+    EXPECT_NEAR(-0.4, estimator.estimate(last), 1e-6);
+    // asked for between the samples too
+    EXPECT_NEAR(-0.4, estimator.estimate(last + ros::Duration(0.5 * PERIOD)), 1e-6);
+}
+
+/*
+ * The stamps of the polled samples are off by up to a third of the period,
+ * the slope between two neighbours alone could be off by more than half.
+ * */
+TEST(SlopeEstimator, AveragesOutJitter)
+{
+    SlopeEstimator estimator{0.25, 0.5};
+    std::mt19937 random{7};
+    std::uniform_real_distribution<double> offset{-PERIOD / 3, PERIOD / 3};
+    ros::Time stamp{100};
+    double worst = 0;
+    for (int i = 0; i < 200; i++)
+    {
+        const double t = i * PERIOD;
+        stamp = ros::Time{100} + ros::Duration(t + offset(random));
+        estimator.addSample(2.0 * t, stamp);
+        if (i >= 8)
+            worst = std::max(worst, std::abs(estimator.estimate(stamp) - 2.0));
+    }
+    EXPECT_LT(worst, 2.0 * 0.15);
+}
+
+TEST(SlopeEstimator, NoisyValuesStayNearTheSlope)
+{
+    SlopeEstimator estimator{0.25, 0.5};
+    std::mt19937 random{3};
+    std::normal_distribution<double> noise{0, 0.002};
+    const ros::Time last = feed(estimator, ros::Time{100}, 2, 0,
+            [&](double t) { return 0.5 * t + noise(random); });
+    EXPECT_NEAR(0.5, estimator.estimate(last), 0.05);
+}
+
+TEST(SlopeEstimator, DropsOldAndRepeatedStamps)
+{
+    SlopeEstimator estimator{0.25, 0.5};
+    const ros::Time last = feed(estimator, ros::Time{100}, 1, 0, [](double t) { return t; });
+    EXPECT_FALSE(estimator.addSample(100, last));
+    EXPECT_FALSE(estimator.addSample(100, last - ros::Duration(PERIOD)));
+    EXPECT_NEAR(1, estimator.estimate(last), 1e-6);
+}
+
+TEST(SlopeEstimator, StaleIsZero)
+{
+    SlopeEstimator estimator{0.25, 0.5};
+    EXPECT_TRUE(estimator.isStale(ros::Time{100}));
+    EXPECT_EQ(0, estimator.estimate(ros::Time{100}));
+
+    const ros::Time last = feed(estimator, ros::Time{100}, 1, 0, [](double t) { return t; });
+    EXPECT_FALSE(estimator.isStale(last + ros::Duration(0.4)));
+    EXPECT_TRUE(estimator.isStale(last + ros::Duration(0.6)));
+    EXPECT_EQ(0, estimator.estimate(last + ros::Duration(0.6)));
+
+    estimator.reset();
+    EXPECT_TRUE(estimator.isStale(last));
+    EXPECT_EQ(0, estimator.estimate(last));
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+#include "tread_velocity_estimator.h"
+#include <cstdint>
+#include <random>
+
+using tfr_control::TreadVelocityEstimator;
+
+namespace
+{
+    // the CAN polling rate
+    const double PERIOD = 1.0 / 32;
+
+    /*
+     * Feeds the int32 counter of a tread turning at speed counts per second
+     * from start_count, with jittery stamps, and returns the last stamp.
+     * */
+    ros::Time feed(TreadVelocityEstimator& estimator, ros::Time start, double duration,
+            int64_t start_count, double speed)
+    {
+        std::mt19937 random{42};
+        std::uniform_real_distribution<double> offset{-PERIOD / 4, PERIOD / 4};
+        ros::Time stamp = start;
+        for (double t = 0; t < duration; t += PERIOD)
+        {
+            // the controller counts at the true time, the stamp is when it arrived
+            const int64_t position = start_count + static_cast<int64_t>(speed * t);
+            stamp = start + ros::Duration(t + offset(random));
+            estimator.addSample(static_cast<int32_t>(static_cast<uint32_t>(position)), stamp);
+        }
+        return stamp;
+    }
+}
+
+TEST(TreadVelocityEstimator, StandingStill)
+{
+    TreadVelocityEstimator estimator{0.25, 0.5};
+    const ros::Time last = feed(estimator, ros::Time{100}, 2, 1234, 0);
+    EXPECT_NEAR(0, estimator.estimate(last), 1e-9);
+}
+
+TEST(TreadVelocityEstimator, ConstantSpeed)
+{
+    TreadVelocityEstimator estimator{0.25, 0.5};
+    const ros::Time last = feed(estimator, ros::Time{100}, 2, 0, -5000);
+    EXPECT_NEAR(-5000, estimator.estimate(last), 5000 * 0.1);
+}
+
+TEST(TreadVelocityEstimator, AcrossTheRollover)
+{
+    TreadVelocityEstimator estimator{0.25, 0.5};
+    const ros::Time last = feed(estimator, ros::Time{100}, 2, INT32_MAX - 4000, 8000);
+    EXPECT_NEAR(8000, estimator.estimate(last), 8000 * 0.1);
+}
+
+TEST(TreadVelocityEstimator, StaleIsZero)
+{
+    TreadVelocityEstimator estimator{0.25, 0.5};
+    const ros::Time last = feed(estimator, ros::Time{100}, 1, 0, 3000);
+    EXPECT_FALSE(estimator.isStale(last));
+    EXPECT_TRUE(estimator.isStale(last + ros::Duration(0.6)));
+    EXPECT_EQ(0, estimator.estimate(last + ros::Duration(0.6)));
+
+    estimator.reset();
+    EXPECT_TRUE(estimator.isStale(last));
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
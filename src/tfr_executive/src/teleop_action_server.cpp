@@ -41,6 +41,7 @@
 #include <tfr_msgs/ArmStateSrv.h>
 #include <tfr_msgs/DurationSrv.h>
 #include <tfr_utilities/arm_manipulator.h>
+#include <tfr_utilities/command_trace.h>
 #include <trajectory_msgs/JointTrajectory.h>
 #include <geometry_msgs/Twist.h>
 #include <std_msgs/Int16.h>
@@ -94,7 +95,9 @@ class TeleopExecutive
             scoop_encoder_publisher{n.advertise<std_msgs::Int32>("/device4/set_cmd_sencntr/counter_2", 1)},
             drive_stats{drive},
             frequency{f},
-            use_digging{u_d}
+            use_digging{u_d},
+            drivebase_trace{n, "cmd_vel"},
+            trace_exporter{n}
         {
             if (use_digging){
                 ROS_INFO("Teleop Action Server conecting to digging");
@@ -119,6 +122,17 @@ class TeleopExecutive
 
     private:
     
+        /*
+         * Sends a drive command, carrying on the trace of the goal it came
+         * from.
+         * */
+        void publishDrive(const geometry_msgs::Twist& move_cmd, uint64_t trace_id)
+        {
+            tfr_utilities::recordTrace(trace_id, "teleop/cmd_vel");
+            drivebase_trace.announce(trace_id);
+            drivebase_publisher.publish(move_cmd);
+        }
+
         //dev 4
         void stop_arm_movement(){
             std_msgs::Int32 msg;
@@ -158,6 +172,7 @@ class TeleopExecutive
          * */
         void processCommand(const tfr_msgs::TeleopGoalConstPtr& goal)
         {
+            tfr_utilities::recordTrace(goal->trace_id, "teleop/goal");
             geometry_msgs::Twist move_cmd{};
             auto code = static_cast<tfr_utilities::TeleopCode>(goal->code);
             switch(code)
@@ -167,7 +182,7 @@ class TeleopExecutive
                     {
                         ROS_INFO("Teleop Action Server: Command Recieved, STOP_DRIVEBASE");
                         //all zeros by default
-                        drivebase_publisher.publish(move_cmd);
+                        publishDrive(move_cmd, goal->trace_id);
                         stop_arm_movement();
                         stop_bin_movement();
                         break;
@@ -177,7 +192,7 @@ class TeleopExecutive
                     {
                         ROS_INFO("Teleop Action Server: Command Recieved, FORWARD %f",drive_stats.getLinear());
                         move_cmd.linear.x = drive_stats.getLinear();
-                        drivebase_publisher.publish(move_cmd);
+                        publishDrive(move_cmd, goal->trace_id);
                         break;
                     }
 
@@ -185,7 +200,7 @@ class TeleopExecutive
                     {
                         ROS_INFO("Teleop Action Server: Command Recieved, BACKWARD");
                         move_cmd.linear.x = -drive_stats.getLinear();
-                        drivebase_publisher.publish(move_cmd);
+                        publishDrive(move_cmd, goal->trace_id);
                         break;
                     }
 
@@ -193,7 +208,7 @@ class TeleopExecutive
                     {
                         ROS_INFO("Teleop Action Server: Command Recieved, LEFT");
                         move_cmd.angular.z = drive_stats.getAngular();
-                        drivebase_publisher.publish(move_cmd);
+                        publishDrive(move_cmd, goal->trace_id);
                         break;
                     }
 
@@ -201,7 +216,7 @@ class TeleopExecutive
                     {
                         ROS_INFO("Teleop Action Server: Command Recieved, RIGHT");
                         move_cmd.angular.z = -drive_stats.getAngular();
-                        drivebase_publisher.publish(move_cmd);
+                        publishDrive(move_cmd, goal->trace_id);
                         break;
                     }
 
@@ -322,7 +337,7 @@ class TeleopExecutive
                 case (tfr_utilities::TeleopCode::DRIVING_POSITION):
                     {
                         ROS_INFO("Teleop Action Server: Command Recieved, DRIVING_POSITION");
-                        drivebase_publisher.publish(move_cmd);
+                        publishDrive(move_cmd, goal->trace_id);
                         ROS_INFO("Teleop Action Server: arm raise finished");
                         break;
                     }
@@ -332,7 +347,7 @@ class TeleopExecutive
                         tfr_msgs::ArmStateSrv query;
                         ros::service::call("arm_state", query);
                         //all zeros by default
-                        drivebase_publisher.publish(move_cmd);
+                        publishDrive(move_cmd, goal->trace_id);
                         //first grab the current state of the arm
                         //arm_manipulator.moveArm(query.response.states[0], 0.10, 1.07, 1.6);
                         ros::Duration(5.0).sleep();
@@ -414,6 +429,10 @@ class TeleopExecutive
         ros::Duration frequency;
         bool use_digging;
 
+        //traces drive commands, see tfr_utilities/command_trace.h
+        tfr_utilities::TraceAnnouncer drivebase_trace;
+        tfr_utilities::TraceExporter trace_exporter;
+
 };
 
 
@@ -8,7 +8,8 @@
  * name is specified as a parameter.
  *
  * parameters:
- *  - ~turn_speed: how fast to turn [rad/s] (double, default: 0.0)
+ *  - ~turn_velocity: how fast to turn [rad/s], can be changed while running
+ *      through dynamic_reconfigure, see cfg/Localization.cfg (double, default: 0.5)
  *  - ~turn_duration: how long to turn [s] (double, default: 0.0)
  *
  * published topics:
@@ -23,6 +24,8 @@
 #include <tfr_msgs/WrappedImage.h>
 #include <tfr_msgs/PoseSrv.h>
 #include <tfr_utilities/tf_manipulator.h>
+#include <tfr_utilities/cached_config.h>
+#include <tfr_localization/LocalizationConfig.h>
 #include <geometry_msgs/Twist.h>
 
 class Localizer
@@ -72,6 +75,7 @@ class Localizer
         ros::ServiceClient rear_cam_client;
         ros::ServiceClient front_cam_client;
         TfManipulator tf_manipulator;
+        tfr_utilities::CachedConfig<tfr_localization::LocalizationConfig> config;
         double turn_velocity;
         double turn_duration;
         double threshold;
@@ -96,7 +100,7 @@ class Localizer
                 ROS_INFO("Localization Action Server: iterating");
                 if (checkPreempt(output, success)){break;}
                 
-                if ( not ros::param::getCached("~turn_velocity", turn_velocity)) {turn_velocity = .5;}
+                turn_velocity = config.get()->turn_velocity;
                 
                 tfr_msgs::ArucoResultConstPtr result = getArucoResult();
                 
@@ -0,0 +1,118 @@
+/****************************************************************************************
+ * File:            adaptive_stroke.h
+ *
+ * Purpose:         Moves the arm through a penetrate or scoop state of the
+ *                  digging queue by the torque of the lower arm, upper arm and
+ *                  scoop, instead of sending the state and waiting for the arm.
+ *
+ *                  The setpoint advances along the straight line from the last
+ *                  state to the planned one at speed (planned strokes per
+ *                  second). Every update takes the latest torques, as the
+ *                  load: the largest of them relative to its saturation torque.
+ *
+ *                  - below light the ground is soft, full speed
+ *                  - between light and saturation the setpoint slows down,
+ *                    to min_speed at saturation
+ *                  - saturated for saturation_time (hard ground or a full
+ *                    scoop) the stroke ends where it is, shortened, once it
+ *                    is past min_stroke (the drives start with a spike)
+ *                  - at the planned state with the load still light the stroke
+ *                    goes on past it, deeper, until the load picks up or it is
+ *                    max_extension strokes past it, or any actuator would leave
+ *                    its joint limits (a plan already outside them isn't deepened)
+ *
+ *                  Torques are fractions of the rated torque of each actuator,
+ *                  as the drives report them in thousandths. No ROS, the
+ *                  digging server calls update() at its stream rate.
+ ***************************************************************************************/
+#ifndef ADAPTIVE_STROKE_H
+#define ADAPTIVE_STROKE_H
+
+#include <array>
+
+namespace tfr_mining
+{
+    class AdaptiveStroke
+    {
+    public:
+        // turntable, lower arm, upper arm, scoop, as in the digging queue
+        typedef std::array<double, 4> Position;
+        // lower arm, upper arm, scoop
+        static const int LOADED = 3;
+        typedef std::array<double, LOADED> Torque;
+
+        struct Parameters
+        {
+            // fraction of the rated torque where each actuator is saturated
+            Torque saturation;
+            // fraction of saturation under which the ground is soft
+            double light;
+            // planned strokes per second
+            double speed;
+            // fraction of speed at saturation
+            double min_speed;
+            // s, saturated for this long ends the stroke
+            double saturation_time;
+            // fraction of the planned stroke before saturation may end it
+            double min_stroke;
+            // planned strokes past the planned state a light stroke may go
+            double max_extension;
+            // joint limits of each actuator, in the units of the digging queue
+            Position lower_limits;
+            Position upper_limits;
+        };
+
+        enum class Outcome
+        {
+            RUNNING,
+            // at the planned state
+            COMPLETED,
+            // stopped by saturation before the planned state
+            SHORTENED,
+            // went on past the planned state
+            DEEPENED
+        };
+
+        AdaptiveStroke(const Position &from, const Position &to, const Parameters &parameters);
+        ~AdaptiveStroke() = default;
+
+        /**
+         * Advances the stroke by dt seconds with the latest torques, and
+         * returns the setpoint to send. After the end it stays where the
+         * stroke ended.
+         **/
+        Position update(double dt, const Torque &torque);
+
+        bool done() const;
+        Outcome outcome() const;
+
+        /**
+         * How far along the planned stroke the setpoint is, more than 1 when
+         * deepened.
+         **/
+        double progress() const;
+        Position setpoint() const;
+
+        /**
+         * The largest torque relative to its saturation.
+         **/
+        double load(const Torque &torque) const;
+
+    private:
+        /**
+         * How far past the planned state the stroke may go, with every
+         * actuator inside its limits.
+         **/
+        double farthest() const;
+
+        const Parameters parameters;
+        const Position from;
+        const Position to;
+        const double end;
+        double position;
+        double saturated_for;
+        Outcome result;
+    };
+}
+
+#endif // ADAPTIVE_STROKE_H
@@ -0,0 +1,58 @@
+/****************************************************************************************
+ * File:            dig_deadline.h
+ *
+ * Purpose:         Keeps the digging time of one digging goal: when the goal
+ *                  has to be done, and when the set in progress has to stop
+ *                  so the arm can still be stowed in time (the cutoff).
+ *
+ *                  Every goal starts with start(), which forgets the cutoff
+ *                  of the goal before, however that one ended (preempted
+ *                  goals don't get to clear it). A goal without digging time
+ *                  has no deadline and is never cut.
+ *
+ *                  Seconds on any one clock, no ROS.
+ ***************************************************************************************/
+#ifndef DIG_DEADLINE_H
+#define DIG_DEADLINE_H
+
+namespace tfr_mining
+{
+    class DigDeadline
+    {
+    public:
+        DigDeadline();
+        ~DigDeadline() = default;
+
+        /**
+         * A new goal at now with digging_time seconds, none when it isn't
+         * positive.
+         **/
+        void start(double now, double digging_time);
+
+        bool budgeted() const;
+
+        /**
+         * Seconds until the deadline, negative past it, infinite without
+         * one.
+         **/
+        double left(double now) const;
+
+        /**
+         * Cut the set in progress stow seconds before the deadline, or
+         * never.
+         **/
+        void cutBefore(double stow);
+        void uncut();
+
+        /**
+         * Whether the set in progress has to stop now.
+         **/
+        bool cut(double now) const;
+
+    private:
+        double deadline;
+        double cutoff;
+    };
+}
+
+#endif // DIG_DEADLINE_H
@@ -0,0 +1,109 @@
+/****************************************************************************************
+ * File:            dig_scheduler.h
+ *
+ * Purpose:         Chooses which digging sets still fit in the time left for
+ *                  digging, so the digging server can get the most regolith
+ *                  out of diggingTime and still stow the arm before it runs out.
+ *
+ *                  Every set has an estimate of how long it takes. It starts
+ *                  from the time estimate of the queue, scaled by how much
+ *                  longer or shorter the sets measured so far took than theirs,
+ *                  and follows the measured times of the set itself once it
+ *                  has run. The estimates used for planning are the mean plus
+ *                  confidence standard deviations, so a set that varies a lot
+ *                  gets a margin.
+ *
+ *                  plan() picks the remaining sets with the most expected
+ *                  volume that fit in the budget together (a knapsack over
+ *                  steps of resolution seconds), and orders them either as in
+ *                  the queue or the most volume per second first. It is meant
+ *                  to be called again after every set, with what is left.
+ *                  When no set fits whole but there are at least
+ *                  min_partial_budget seconds, it still starts the first set
+ *                  (the best per second when not keeping the order), for the
+ *                  digging server to cut short when the time runs out.
+ *
+ *                  The stow move at the end has an estimate of its own.
+ *
+ *                  Seconds and plain indices into the digging queue, no ROS.
+ ***************************************************************************************/
+#ifndef DIG_SCHEDULER_H
+#define DIG_SCHEDULER_H
+
+#include <cstddef>
+#include <vector>
+
+namespace tfr_mining
+{
+    class DigScheduler
+    {
+    public:
+        struct Parameters
+        {
+            // the weight of a new measurement in an estimate, once it has a few
+            double learning_rate;
+            // standard deviations of margin on every estimate
+            double confidence;
+            // standard deviation of an estimate without measurements, relative to it
+            double prior_spread;
+            // s, the step of the budget in plan()
+            double resolution;
+            // run the chosen sets in the order of the queue, or the most volume per second first
+            bool keep_order;
+            // s, the least budget to start a set that doesn't fit whole, about one of its states
+            double min_partial_budget;
+        };
+
+        /**
+         * Sets up the estimates of the sets of the queue from their time
+         * estimates and expected volumes, and of the stow move.
+         **/
+        DigScheduler(const std::vector<double> &time_estimates, const std::vector<double> &volumes,
+                double stow_estimate, const Parameters &parameters);
+        ~DigScheduler() = default;
+
+        /**
+         * Records how long a set or the stow move took, when it ran to the
+         * end.
+         **/
+        void measured(size_t set, double seconds);
+        void measuredStow(double seconds);
+
+        /**
+         * The seconds to plan with, margin included.
+         **/
+        double estimate(size_t set) const;
+        double stowEstimate() const;
+
+        /**
+         * The sets of remaining to run in budget seconds, in order, or the
+         * one to start and cut short. The stow move is not included in the
+         * budget.
+         **/
+        std::vector<size_t> plan(const std::vector<size_t> &remaining, double budget) const;
+
+        size_t size() const;
+
+    private:
+        struct Estimate
+        {
+            double prior;
+            double mean;
+            double variance;
+            int count;
+        };
+
+        void update(Estimate &estimate, double seconds);
+        double planned(const Estimate &estimate, double scale) const;
+
+        const Parameters parameters;
+        std::vector<Estimate> sets;
+        std::vector<double> volumes;
+        Estimate stow;
+        // measured over estimated time of the queue, over all sets measured so far
+        double ratio;
+        int ratio_count;
+    };
+}
+
+#endif // DIG_SCHEDULER_H
@@ -56,6 +56,12 @@ namespace tfr_mining
         void generateDigAndDump(ros::NodeHandle &nh, DiggingSet &set, double rotation, int dig_number);
 
         void loadTestingDig(ros::NodeHandle &nh, DiggingSet &set, std::string pos_name);
+
+        /**
+         * Whether state of set is in the list of set in indices, a list of
+         * lists of state indices, one for each set.
+         **/
+        static bool listed(XmlRpc::XmlRpcValue &indices, int set, int state);
     };
 }
 
@@ -14,6 +14,17 @@
 
 namespace tfr_mining
 {
+    /**
+     * What a state of a set does. Penetrate and scoop states are moved to
+     * by the torque of the arm (adaptive_stroke.h), the others directly.
+     **/
+    enum class DiggingPhase
+    {
+        MOVE,
+        PENETRATE,
+        SCOOP
+    };
+
     class DiggingSet
     {
     public:
@@ -23,7 +34,7 @@ namespace tfr_mining
          * Inserts a new state into this set, and increases the time estimate
          * accordingly.
          **/
-        void insertState(std::vector<double> state, double time);
+        void insertState(std::vector<double> state, double time, DiggingPhase phase = DiggingPhase::MOVE);
 
         /**
          * Returns whether this set is empty or not.
@@ -40,10 +51,20 @@ namespace tfr_mining
          * states).
          **/
         double getTimeEstimate();
+
+        /**
+         * How much regolith the set is expected to dig out, relative to the
+         * other sets of the queue.
+         **/
+        void setVolume(double volume);
+        double getVolume();
         std::queue<std::vector<double> > states;
+        // the phase of each of the states
+        std::queue<DiggingPhase> phases;
     private:
         
         double time_estimate;
+        double volume;
     };
 }
 
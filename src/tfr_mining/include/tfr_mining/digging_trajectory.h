@@ -0,0 +1,112 @@
+/****************************************************************************************
+ * File:            digging_trajectory.h
+ *
+ * Purpose:         A time parameterized path of the arm through the states of a
+ *                  DiggingSet, so the digging server can stream setpoints to the
+ *                  actuators instead of stopping the arm at every state.
+ *
+ *                  Every move between two states is a jerk limited (S-curve)
+ *                  profile, with all four actuators on the same time scale so
+ *                  the arm moves along a straight line between the states. The
+ *                  slowest actuator for the distance sets the time. Consecutive
+ *                  moves are blended by starting the next one while the last one
+ *                  is still slowing down, as far as the sum of the two stays in
+ *                  the velocity, acceleration and jerk limits of every actuator
+ *                  (checked every check_step seconds). The arm passes close to
+ *                  the intermediate states without stopping, and ends exactly at
+ *                  the last one.
+ *
+ *                  A state repeated in the queue means wait there: it becomes a
+ *                  dwell of dwell_time, which is never blended.
+ *
+ *                  The limits are in the units of the digging queue per second
+ *                  and must stay at or under the profile_velocity and
+ *                  profile_acceleration the drives are configured with, so they
+ *                  can follow the setpoints.
+ ***************************************************************************************/
+#ifndef DIGGING_TRAJECTORY_H
+#define DIGGING_TRAJECTORY_H
+
+#include <array>
+#include <vector>
+
+namespace tfr_mining
+{
+    class DiggingTrajectory
+    {
+    public:
+        // turntable, lower arm, upper arm, scoop, as in the digging queue
+        static const int ACTUATORS = 4;
+        typedef std::array<double, ACTUATORS> Position;
+
+        struct Limits
+        {
+            double max_velocity;
+            double max_acceleration;
+            double max_jerk;
+        };
+
+        struct Parameters
+        {
+            std::array<Limits, ACTUATORS> limits;
+            // s, the wait of a repeated state
+            double dwell_time;
+            // s, how finely the blends are checked against the limits
+            double check_step;
+            // false for stopping at every state, as the point to point queue
+            bool blend;
+        };
+
+        /**
+         * Plans the path from the first waypoint through the others.
+         **/
+        DiggingTrajectory(const std::vector<Position> &waypoints, const Parameters &parameters);
+        ~DiggingTrajectory() = default;
+
+        /**
+         * Seconds from the first waypoint to the end of the last.
+         **/
+        double duration() const;
+
+        /**
+         * Seconds the same moves take when the arm stops at every waypoint.
+         **/
+        double pointToPointDuration() const;
+
+        /**
+         * The setpoint at t seconds after the start, and its derivatives.
+         * Before the start it is the first waypoint, after the end the last.
+         **/
+        Position position(double t) const;
+        void sample(double t, Position &position, Position &velocity, Position &acceleration) const;
+
+    private:
+        /**
+         * One move, scaled from 0 to 1: jerk +j, 0, -j, 0, -j, 0, +j over
+         * the seven phases. A dwell has no delta.
+         **/
+        struct Move
+        {
+            double start;
+            double duration;
+            // of the accelerating (and the decelerating) part
+            double accel_time;
+            std::array<double, 7> phase_duration;
+            double jerk;
+            Position delta;
+        };
+
+        static Move plan(const Position &from, const Position &to, const Parameters &parameters);
+        static void scale(const Move &move, double t, double &s, double &ds, double &dds, double &ddds);
+        bool withinLimits(const Move &previous, const Move &next) const;
+        void add(const Move &move, double t, Position &position, Position &velocity,
+                Position &acceleration, Position &jerk) const;
+
+        const Parameters parameters;
+        Position start;
+        std::vector<Move> moves;
+        double point_to_point;
+    };
+}
+
+#endif // DIGGING_TRAJECTORY_H
@@ -0,0 +1,114 @@
+#include "adaptive_stroke.h"
+#include <algorithm>
+#include <cmath>
+
+namespace tfr_mining
+{
+    AdaptiveStroke::AdaptiveStroke(const Position &from, const Position &to, const Parameters &parameters) :
+        parameters(parameters), from(from), to(to), end{farthest()}, position{0}, saturated_for{0}, result{Outcome::RUNNING}
+    {
+    }
+
+    AdaptiveStroke::Position AdaptiveStroke::update(double dt, const Torque &torque)
+    {
+        if (done())
+        {
+            return setpoint();
+        }
+
+        const double current = load(torque);
+        saturated_for = current >= 1 ? saturated_for + dt : 0;
+        if (saturated_for >= parameters.saturation_time && position >= parameters.min_stroke)
+        {
+            result = position < 1 ? Outcome::SHORTENED : Outcome::DEEPENED;
+            return setpoint();
+        }
+
+        // past the planned state only while the ground stays soft
+        if (position >= 1 && current > parameters.light)
+        {
+            result = position > 1 ? Outcome::DEEPENED : Outcome::COMPLETED;
+            return setpoint();
+        }
+
+        // slows down from light to saturation
+        double speed = 1;
+        if (current > parameters.light)
+        {
+            const double heavy = std::min(1.0, (current - parameters.light) / (1 - parameters.light));
+            speed = 1 - heavy * (1 - parameters.min_speed);
+        }
+        const double next = position + parameters.speed * speed * dt;
+        if (position < 1 && next >= 1 && current > parameters.light)
+        {
+            position = 1;
+            result = Outcome::COMPLETED;
+        }
+        else if (next >= end)
+        {
+            position = end;
+            result = end > 1 ? Outcome::DEEPENED : Outcome::COMPLETED;
+        }
+        else
+        {
+            position = next;
+        }
+        return setpoint();
+    }
+
+    bool AdaptiveStroke::done() const
+    {
+        return result != Outcome::RUNNING;
+    }
+
+    AdaptiveStroke::Outcome AdaptiveStroke::outcome() const
+    {
+        return result;
+    }
+
+    double AdaptiveStroke::progress() const
+    {
+        return position;
+    }
+
+    AdaptiveStroke::Position AdaptiveStroke::setpoint() const
+    {
+        Position point;
+        for (size_t i = 0; i < point.size(); i++)
+        {
+            point[i] = from[i] + (to[i] - from[i]) * position;
+        }
+        return point;
+    }
+
+    double AdaptiveStroke::farthest() const
+    {
+        double limit = 1 + std::max(0.0, parameters.max_extension);
+        for (size_t i = 0; i < from.size(); i++)
+        {
+            const double step = to[i] - from[i];
+            if (step > 0)
+            {
+                limit = std::min(limit, (parameters.upper_limits[i] - from[i]) / step);
+            }
+            else if (step < 0)
+            {
+                limit = std::min(limit, (parameters.lower_limits[i] - from[i]) / step);
+            }
+        }
+        return std::max(1.0, limit);
+    }
+
+    double AdaptiveStroke::load(const Torque &torque) const
+    {
+        double highest = 0;
+        for (int i = 0; i < LOADED; i++)
+        {
+            if (parameters.saturation[i] > 0)
+            {
+                highest = std::max(highest, std::abs(torque[i]) / parameters.saturation[i]);
+            }
+        }
+        return highest;
+    }
+}
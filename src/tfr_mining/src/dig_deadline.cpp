@@ -0,0 +1,46 @@
+#include "dig_deadline.h"
+#include <limits>
+
+namespace tfr_mining
+{
+    namespace
+    {
+        const double NEVER = std::numeric_limits<double>::infinity();
+    }
+
+    DigDeadline::DigDeadline() :
+        deadline{NEVER}, cutoff{NEVER}
+    {
+    }
+
+    void DigDeadline::start(double now, double digging_time)
+    {
+        deadline = digging_time > 0 ? now + digging_time : NEVER;
+        cutoff = NEVER;
+    }
+
+    bool DigDeadline::budgeted() const
+    {
+        return deadline < NEVER;
+    }
+
+    double DigDeadline::left(double now) const
+    {
+        return deadline - now;
+    }
+
+    void DigDeadline::cutBefore(double stow)
+    {
+        cutoff = deadline - stow;
+    }
+
+    void DigDeadline::uncut()
+    {
+        cutoff = NEVER;
+    }
+
+    bool DigDeadline::cut(double now) const
+    {
+        return now >= cutoff;
+    }
+}
@@ -0,0 +1,157 @@
+#include "dig_scheduler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace tfr_mining
+{
+    DigScheduler::DigScheduler(const std::vector<double> &time_estimates, const std::vector<double> &volumes,
+            double stow_estimate, const Parameters &parameters) :
+        parameters(parameters), sets{}, volumes(volumes), stow{stow_estimate, stow_estimate, 0, 0},
+        ratio{1}, ratio_count{0}
+    {
+        for (double prior : time_estimates)
+        {
+            sets.push_back({prior, prior, 0, 0});
+        }
+        this->volumes.resize(sets.size(), 0);
+    }
+
+    void DigScheduler::measured(size_t set, double seconds)
+    {
+        Estimate &estimate = sets.at(set);
+        if (estimate.prior > 0)
+        {
+            // what the other sets learn from this one
+            ratio_count++;
+            const double weight = std::max(parameters.learning_rate, 1.0 / ratio_count);
+            ratio += weight * (seconds / estimate.prior - ratio);
+        }
+        update(estimate, seconds);
+    }
+
+    void DigScheduler::measuredStow(double seconds)
+    {
+        update(stow, seconds);
+    }
+
+    double DigScheduler::estimate(size_t set) const
+    {
+        return planned(sets.at(set), ratio);
+    }
+
+    double DigScheduler::stowEstimate() const
+    {
+        return planned(stow, 1);
+    }
+
+    std::vector<size_t> DigScheduler::plan(const std::vector<size_t> &remaining, double budget) const
+    {
+        std::vector<size_t> chosen;
+        if (budget <= 0 || remaining.empty())
+        {
+            return chosen;
+        }
+
+        // 0/1 knapsack: the most volume in every whole number of steps
+        const size_t n = remaining.size();
+        std::vector<size_t> steps(n);
+        size_t total = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            steps[i] = static_cast<size_t>(std::ceil(estimate(remaining[i]) / parameters.resolution));
+            total += steps[i];
+        }
+        const size_t capacity = std::min(total, static_cast<size_t>(budget / parameters.resolution));
+        std::vector<double> best(capacity + 1, 0);
+        std::vector<std::vector<bool> > taken(n, std::vector<bool>(capacity + 1, false));
+        for (size_t i = 0; i < n; i++)
+        {
+            const double volume = volumes[remaining[i]];
+            if (volume <= 0)
+            {
+                continue;
+            }
+            for (size_t c = capacity; c >= steps[i] && c <= capacity; c--)
+            {
+                if (best[c - steps[i]] + volume > best[c])
+                {
+                    best[c] = best[c - steps[i]] + volume;
+                    taken[i][c] = true;
+                }
+            }
+        }
+
+        // the least time with the most volume
+        size_t c = capacity;
+        while (c > 0 && best[c - 1] >= best[capacity] - 1e-9)
+        {
+            c--;
+        }
+        for (size_t i = n; i-- > 0;)
+        {
+            if (taken[i][c])
+            {
+                chosen.push_back(remaining[i]);
+                c -= steps[i];
+            }
+        }
+
+        if (parameters.keep_order)
+        {
+            // remaining is in the order of the queue
+            std::reverse(chosen.begin(), chosen.end());
+        }
+        else
+        {
+            std::stable_sort(chosen.begin(), chosen.end(), [this](size_t a, size_t b)
+            {
+                return volumes[a] / estimate(a) > volumes[b] / estimate(b);
+            });
+        }
+
+        // nothing fits whole, part of a set is better than none
+        if (chosen.empty() && budget >= parameters.min_partial_budget)
+        {
+            for (size_t set : remaining)
+            {
+                if (volumes[set] > 0 && (chosen.empty() || (!parameters.keep_order &&
+                        volumes[set] / estimate(set) > volumes[chosen.front()] / estimate(chosen.front()))))
+                {
+                    chosen.assign(1, set);
+                }
+            }
+        }
+        return chosen;
+    }
+
+    size_t DigScheduler::size() const
+    {
+        return sets.size();
+    }
+
+    void DigScheduler::update(Estimate &estimate, double seconds)
+    {
+        estimate.count++;
+        if (estimate.count == 1)
+        {
+            estimate.mean = seconds;
+            estimate.variance = std::pow(parameters.prior_spread * seconds, 2);
+            return;
+        }
+        // exponentially weighted, the plain mean over the first few
+        const double weight = std::max(parameters.learning_rate, 1.0 / estimate.count);
+        const double difference = seconds - estimate.mean;
+        estimate.mean += weight * difference;
+        estimate.variance = (1 - weight) * (estimate.variance + weight * difference * difference);
+    }
+
+    double DigScheduler::planned(const Estimate &estimate, double scale) const
+    {
+        if (estimate.count == 0)
+        {
+            const double mean = estimate.prior * scale;
+            return mean * (1 + parameters.confidence * parameters.prior_spread);
+        }
+        return estimate.mean + parameters.confidence * std::sqrt(estimate.variance);
+    }
+}
@@ -3,6 +3,50 @@
  * Node:    digging_server
  * 
  * Purpose: This is an action server that handles all of the digging subsystem.
+ *
+ * Parameters:
+ *   ~move_timeout: s, the longest a single move of the arm may take before
+ *                  the next one is sent anyway (double, default 8.0)
+ *   ~arrival_tolerance: how close each actuator has to get to its target,
+ *                  in the units of the digging queue (double, default 0.05)
+ *   ~open_loop_wait: s, how long to wait for a move when the arm reports no
+ *                  feedback, as before there was any (double, default 1.35)
+ *   ~blend: stream a blended trajectory through the states of each set
+ *                  (digging_trajectory.h), or stop at every state (bool, default true)
+ *   ~stream_rate: Hz, of the setpoints of the trajectory (double, default 10).
+ *                  Every setpoint is an SDO write to four drives, the CAN bridge
+ *                  reserves bus time for them at its ~setpoint_rate, keep the
+ *                  two the same. The drives move between the setpoints on their
+ *                  own profile.
+ *   ~dwell_time: s, how long a repeated state in a set waits (double, default 1.35)
+ *   ~trajectory/<turntable|lower_arm|upper_arm|scoop>/<max_velocity|max_acceleration|max_jerk>:
+ *                  the limits of the trajectory, in the units of the digging
+ *                  queue per second (data/trajectory_limits.yaml)
+ *   ~volumes: the expected volume of each digging set, relative to the others
+ *                  (double[], default 1 for every set)
+ *   ~stow_position: where the arm ends up after digging, turntable, lower arm,
+ *                  upper arm, scoop (double[4], default [3.14, 4.3, 1.9, 2.4])
+ *   ~stow_time: s, how long stowing the arm takes until measured (double, default 5.0)
+ *   ~schedule/learning_rate, ~schedule/confidence, ~schedule/prior_spread,
+ *   ~schedule/keep_order: of the scheduler, see dig_scheduler.h (double, double,
+ *                  double, bool, defaults 0.3, 1.0, 0.25, true)
+ *   ~schedule/min_partial_budget: s, the least time left to start a set that
+ *                  doesn't fit whole and cut it short (double, default 4.5, the
+ *                  estimate of one state of the digging queue)
+ *   ~penetrate_states, ~scoop_states: for each set of the queue, the indices
+ *                  of its states that penetrate the ground and that scoop
+ *                  (int[][], default none)
+ *   ~adaptive: move through the penetrate and scoop states by the torque of
+ *                  the arm (adaptive_stroke.h), or directly (bool, default true)
+ *   ~<penetrate|scoop>/saturation: fraction of the rated torque of the lower
+ *                  arm, upper arm and scoop where each is saturated
+ *                  (double[3], default [0.8, 0.8, 0.8])
+ *   ~<penetrate|scoop>/light, speed, min_speed, saturation_time, min_stroke,
+ *                  max_extension: see adaptive_stroke.h (double, defaults
+ *                  0.3, 0.5, 0.2, 0.25, 0.2, and 0.3 for penetrate, 0.15 for scoop)
+ *   /absolute_position_encoder_limits/<lower_arm|upper_arm|scoop>_joint/<encoder_min|encoder_max>:
+ *                  the limits a deepened stroke stays inside, loaded by tfr_control
+ *                  (double, defaults those of its absolute_position_encoder_limits.yaml)
  * 
  *          This file includes <tfr_msgs/DiggingAction.h>, which is one of seven headers
  *          built by catkin from `tfr_msgs/action/Digging.action`:
@@ -21,24 +65,57 @@
 #include <tfr_msgs/DiggingAction.h>  // Note: "Action" is appended
 #include <tfr_msgs/ArmMoveAction.h>  // Note: "Action" is appended
 #include <tfr_utilities/arm_manipulator.h>
+#include <tfr_utilities/device_topics.h>
 #include <geometry_msgs/Twist.h>
 #include <tfr_utilities/teleop_code.h>
 #include <actionlib/client/simple_action_client.h>
 #include "digging_queue.h"
+#include "digging_trajectory.h"
+#include "dig_scheduler.h"
+#include "dig_deadline.h"
+#include "adaptive_stroke.h"
+#include <std_msgs/Int16.h>
+#include <algorithm>
+#include <limits>
+#include <mutex>
 
 typedef actionlib::SimpleActionServer<tfr_msgs::DiggingAction> Server;
 typedef actionlib::SimpleActionClient<tfr_msgs::ArmMoveAction> Client;
 
 class DiggingActionServer {
 public:
-    DiggingActionServer(ros::NodeHandle &nh, ros::NodeHandle &p_nh) :
+    DiggingActionServer(ros::NodeHandle &nh, ros::NodeHandle &p_nh,
+            const tfr_utilities::ActuatorArrival::Parameters &arrival,
+            const tfr_mining::DiggingTrajectory::Parameters &trajectory,
+            const tfr_mining::DigScheduler::Parameters &schedule,
+            const tfr_mining::DiggingTrajectory::Position &stow_position, double stow_time,
+            bool adaptive, const tfr_mining::AdaptiveStroke::Parameters &penetrate,
+            const tfr_mining::AdaptiveStroke::Parameters &scoop,
+            double move_timeout, double open_loop_wait, double stream_rate) :
         priv_nh{p_nh}, queue{priv_nh}, 
         drivebase_publisher{nh.advertise<geometry_msgs::Twist>("cmd_vel", 5)},
         server{nh, "dig", boost::bind(&DiggingActionServer::execute, this, _1),
             false},
-        arm_manipulator{nh}
-
+        arm_manipulator{nh, true, arrival},
+        trajectory_parameters(trajectory),
+        move_timeout{move_timeout},
+        open_loop_wait{open_loop_wait},
+        stream_rate{stream_rate},
+        stow_position(stow_position),
+        sets{toVector(queue.sets)},
+        scheduler{timeEstimates(sets), volumes(sets), stow_time, schedule},
+        adaptive{adaptive},
+        penetrate_parameters(penetrate),
+        scoop_parameters(scoop)
     {
+        // the torque of the lower arm, upper arm and scoop, in thousandths of the rated torque
+        const int devices[] = {23, 45, 56};
+        for (int i = 0; i < tfr_mining::AdaptiveStroke::LOADED; i++)
+        {
+            torque_subscribers[i] = nh.subscribe<std_msgs::Int16>(
+                    tfr_utilities::getTopic(devices[i], "torque_actual_value"), 5,
+                    boost::bind(&DiggingActionServer::updateTorque, this, _1, i));
+        }
         server.start();
     }
 
@@ -50,19 +127,22 @@ private:
      * When the digging action server receives a goal, it executes one 
      * iteration of the digging queue. 
      * 
-	 * Currently the digging action server receives the number of seconds 
-     * it is allowed to spend on digging in the goal message. This is not
-     * currently used, but in the future (TODO) it can be used to control the
-     * time spent digging autonomously.
+	 * The goal has the number of seconds it is allowed to spend on
+     * digging. Before every set the scheduler picks the next one out of
+     * those that still fit, with the time it takes to stow the arm left
+     * over, and every set that runs to the end updates the estimates. A set
+     * that runs too long is cut short to stow in time. Without a digging
+     * time (0 or less, e.g. the mission clock wasn't started) it runs the
+     * whole queue in order, as it used to.
 	 * 
 	 * Pre: There must be accurate measurements of the position of the 
      * arm. Digging can start while the arm is turned off-center, but 
      * ROS must be aware of this. In other words, as long as the 
      * position of the arm is not miscalibrated, it's ok.
 	 * 
-	 * Post: The arm will be in the position specified at the end of the 
-     * digging queue, OR in an intermediate state if pre-empted (i.e. the 
-     * goal is cancelled, another goal is sent, or ROS is shutting down).
+	 * Post: The arm will be stowed, OR in an intermediate state if 
+     * pre-empted (i.e. the goal is cancelled, another goal is sent, or ROS 
+     * is shutting down).
 	 * 
 	 * Notes: ROS actionlib seemed to have a bug, and it would take 
      * as much as 10 seconds to cancel a digging goal.
@@ -72,61 +152,594 @@ private:
     {
         ROS_INFO("Start digging queue.");
 
-        std::queue<tfr_mining::DiggingSet> current_queue{queue.sets};
+        // the arm may have been moved since the last goal
+        has_last_state = false;
+        // also forgets the cutoff of a preempted goal
+        deadline.start(ros::Time::now().toSec(), goal->diggingTime.toSec());
+        if (!deadline.budgeted())
+        {
+            ROS_WARN("Digging: no digging time, running the whole queue");
+        }
+
+        std::vector<size_t> remaining;
+        for (size_t i = 0; i < sets.size(); i++)
+        {
+            remaining.push_back(i);
+        }
+        while (!remaining.empty())
+        {
+            size_t next = remaining.front();
+            if (deadline.budgeted())
+            {
+                const double budget = deadline.left(ros::Time::now().toSec()) - scheduler.stowEstimate();
+                const std::vector<size_t> plan = scheduler.plan(remaining, budget);
+                if (plan.empty())
+                {
+                    ROS_INFO("Digging: no set left can start in %.2f s", budget);
+                    break;
+                }
+                next = plan.front();
+                if (scheduler.estimate(next) > budget)
+                    ROS_INFO("Digging: no set left fits whole in %.2f s, cutting set %lu short", budget, next);
+                else
+                    ROS_INFO("Digging: %lu of %lu sets left fit in %.2f s", plan.size(), remaining.size(), budget);
+                deadline.cutBefore(scheduler.stowEstimate());
+            }
+            remaining.erase(std::find(remaining.begin(), remaining.end(), next));
+
+            ROS_INFO("Starting digging set %lu, estimated %.2f s", next, scheduler.estimate(next));
+            const ros::Time start = ros::Time::now();
+            const bool completed = trajectory_parameters.blend ? blendSet(sets[next]) : stopAtEveryState(sets[next]);
+            if (preempted())
+            {
+                ROS_INFO("Preempting digging action server");
+                tfr_msgs::DiggingResult result;
+                server.setPreempted(result);
+                return;
+            }
+            if (!completed)
+            {
+                ROS_WARN("Digging: out of time in digging set %lu, stowing", next);
+                break;
+            }
+            const double took = (ros::Time::now() - start).toSec();
+            scheduler.measured(next, took);
+            ROS_INFO("Digging set %lu took %.2f s", next, took);
+        }
+
+        deadline.uncut();
+        if (!stow())
+        {
+            ROS_INFO("Preempting digging action server");
+            tfr_msgs::DiggingResult result;
+            server.setPreempted(result);
+            return;
+        }
+        const double left = deadline.left(ros::Time::now().toSec());
+        if (left < 0)
+        {
+            ROS_WARN("Digging: stowed %.2f s after the digging time", -left);
+        }
+        ROS_INFO("End digging queue.");
+        tfr_msgs::DiggingResult result;
+        server.setSucceeded(result);
+    }
 
-        while (!current_queue.empty())
+    /*
+     * Moves the arm to the stow position and waits for it. Returns false
+     * if preempted.
+     */
+    bool stow()
+    {
+        const ros::Time start = ros::Time::now();
+        ROS_INFO("Stowing arm: %.2f %.2f %.2f %.2f", stow_position[0], stow_position[1], stow_position[2],
+                stow_position[3]);
+        arm_manipulator.moveArmWithoutPlanningOrLimits(stow_position[0], stow_position[1], stow_position[2],
+                stow_position[3]);
+        last_state = stow_position;
+        has_last_state = true;
+        if (!waitForArm())
         {
-            tfr_mining::DiggingSet set = current_queue.front();
-            current_queue.pop();
-            ros::Time now = ros::Time::now();
+            return false;
+        }
+        scheduler.measuredStow((ros::Time::now() - start).toSec());
+        return true;
+    }
 
-            ROS_INFO("Starting digging set");
-            
-            std::queue<std::vector<double> > current_set{set.states};
+    /*
+     * Whether the goal was preempted, or ROS is shutting down.
+     */
+    bool preempted()
+    {
+        return server.isPreemptRequested() || !ros::ok();
+    }
 
-            while (!current_set.empty())
+    /*
+     * Whether to stop moving the arm, when preempted or out of time.
+     */
+    bool interrupted()
+    {
+        return preempted() || deadline.cut(ros::Time::now().toSec());
+    }
+
+    /*
+     * Sends the arm to each state of the set in turn, and waits for it to
+     * get there, so it stops at every one. A repeated state waits
+     * dwell_time, penetrate and scoop states are strokes. Returns false if
+     * interrupted.
+     */
+    bool stopAtEveryState(const tfr_mining::DiggingSet &set)
+    {
+        std::queue<std::vector<double> > current_set{set.states};
+        std::queue<tfr_mining::DiggingPhase> phases{set.phases};
+        std::vector<double> last;
+        while (!current_set.empty())
+        {
+            std::vector<double> state = current_set.front();
+            const tfr_mining::DiggingPhase phase = phases.front();
+            current_set.pop();
+            phases.pop();
+            if (state == last)
             {
-                std::vector<double> state = current_set.front();
-                current_set.pop();
-                
-                // Use arm_manipulator, and NOT MoveIt, to send commands to the arm. The actuators will just move to each of the points in the digging queue, there is no trajectory or other points being generated. There is also no collision checking, so be careful.
-                ROS_INFO("Moving arm to position: %.2f %.2f %.2f %.2f", state[0], state[1], state[2], state[3]);
-                arm_manipulator.moveArmWithoutPlanningOrLimits(state[0], state[1], state[2], state[3]);
-                ros::Duration(1.25).sleep();
+                if (!dwell(trajectory_parameters.dwell_time))
+                {
+                    return false;
+                }
+                continue;
+            }
 
-                ros::Rate rate(10.0);
+            if (phase != tfr_mining::DiggingPhase::MOVE)
+            {
+                if (!stroke(state, phase))
+                {
+                    return false;
+                }
+                last = state;
+                continue;
+            }
 
-                if (server.isPreemptRequested() || !ros::ok())
+            // Use arm_manipulator, and NOT MoveIt, to send commands to the arm. The actuators will just move to each of the points in the digging queue, there is no trajectory or other points being generated. There is also no collision checking, so be careful.
+            ROS_INFO("Moving arm to position: %.2f %.2f %.2f %.2f", state[0], state[1], state[2], state[3]);
+            arm_manipulator.moveArmWithoutPlanningOrLimits(state[0], state[1], state[2], state[3]);
+            setLastState(state);
+            if (!waitForArm())
+            {
+                return false;
+            }
+            last = state;
+        }
+        return true;
+    }
+
+    /*
+     * Streams the trajectory from the last state the arm was sent to
+     * through the states of the set, then waits for the arm to get to the
+     * last one. Penetrate and scoop states are strokes, the trajectory
+     * stops at the state before one and starts again where it ended. The
+     * first time it moves to the first state on its own, the arm can be
+     * anywhere. Returns false if interrupted.
+     *
+     * There is no collision checking, so be careful.
+     */
+    bool blendSet(const tfr_mining::DiggingSet &set)
+    {
+        std::queue<std::vector<double> > current_set{set.states};
+        std::queue<tfr_mining::DiggingPhase> phases{set.phases};
+        if (current_set.empty())
+        {
+            return true;
+        }
+        if (!has_last_state)
+        {
+            const std::vector<double> &first = current_set.front();
+            ROS_INFO("Moving arm to position: %.2f %.2f %.2f %.2f", first[0], first[1], first[2], first[3]);
+            arm_manipulator.moveArmWithoutPlanningOrLimits(first[0], first[1], first[2], first[3]);
+            setLastState(first);
+            if (!waitForArm())
+            {
+                return false;
+            }
+        }
+        std::vector<tfr_mining::DiggingTrajectory::Position> waypoints{last_state};
+        while (!current_set.empty())
+        {
+            const std::vector<double> state = current_set.front();
+            const tfr_mining::DiggingPhase phase = phases.front();
+            current_set.pop();
+            phases.pop();
+            if (phase != tfr_mining::DiggingPhase::MOVE)
+            {
+                if (!streamTrajectory(waypoints) || !stroke(state, phase))
                 {
-                    ROS_INFO("Preempting digging action server");
-                    tfr_msgs::DiggingResult result;
-                    server.setPreempted(result);
-                    return;
+                    return false;
                 }
+                waypoints = {last_state};
+                continue;
+            }
+            waypoints.push_back({{state[0], state[1], state[2], state[3]}});
+        }
+        return streamTrajectory(waypoints);
+    }
 
-                rate.sleep();
+    /*
+     * Streams the trajectory through the waypoints, the first one where the
+     * arm is, and waits for the arm to get to the last one. Returns false
+     * if interrupted.
+     */
+    bool streamTrajectory(const std::vector<tfr_mining::DiggingTrajectory::Position> &waypoints)
+    {
+        if (waypoints.size() < 2)
+        {
+            return true;
+        }
+        const tfr_mining::DiggingTrajectory trajectory{waypoints, trajectory_parameters};
+        const double point_to_point = trajectory.pointToPointDuration();
+        ROS_INFO("Digging: %lu states in %.2f s, %.2f s stopping at every state (%.0f%% less)",
+                waypoints.size() - 1, trajectory.duration(), point_to_point,
+                point_to_point > 0 ? 100 * (1 - trajectory.duration() / point_to_point) : 0.0);
+
+        ros::Rate rate(stream_rate);
+        const ros::Time start = ros::Time::now();
+        while (true)
+        {
+            if (interrupted())
+            {
+                return false;
             }
+            const double t = (ros::Time::now() - start).toSec();
+            sendPosition(trajectory.position(t));
+            if (t >= trajectory.duration())
+            {
+                break;
+            }
+            rate.sleep();
+        }
+        ROS_DEBUG("Digging: trajectory streamed in %.2f s", (ros::Time::now() - start).toSec());
+        return waitForArm();
+    }
+
+    /*
+     * Moves the arm from the last state to a penetrate or scoop state by
+     * the torque of the arm: shorter on hard ground or with a full scoop,
+     * deeper in soft ground (adaptive_stroke.h). Where it stops short it
+     * holds the arm where it got to, not to push against the ground. Without
+     * torque feedback, or with ~adaptive false, it moves there directly.
+     * Returns false if interrupted.
+     */
+    bool stroke(const std::vector<double> &state, tfr_mining::DiggingPhase phase)
+    {
+        const tfr_mining::DiggingTrajectory::Position target{{state[0], state[1], state[2], state[3]}};
+        const bool penetrate = phase == tfr_mining::DiggingPhase::PENETRATE;
+        tfr_mining::AdaptiveStroke::Torque torque;
+        if (!adaptive || !has_last_state || !latestTorque(torque))
+        {
+            if (adaptive)
+            {
+                ROS_WARN_THROTTLE(10.0, "Digging: no torque feedback from the arm, moving directly");
+            }
+            ROS_INFO("Moving arm to position: %.2f %.2f %.2f %.2f", state[0], state[1], state[2], state[3]);
+            arm_manipulator.moveArmWithoutPlanningOrLimits(state[0], state[1], state[2], state[3]);
+            setLastState(state);
+            return waitForArm();
+        }
+
+        tfr_mining::AdaptiveStroke stroke{last_state, target, penetrate ? penetrate_parameters : scoop_parameters};
+        ros::Rate rate(stream_rate);
+        ros::Time last = ros::Time::now();
+        while (!stroke.done())
+        {
+            if (interrupted())
+            {
+                return false;
+            }
+            if (!latestTorque(torque))
+            {
+                ROS_WARN("Digging: lost the torque feedback of the arm, moving directly");
+                sendPosition(target);
+                return waitForArm();
+            }
+            const ros::Time now = ros::Time::now();
+            sendPosition(stroke.update((now - last).toSec(), torque));
+            last = now;
+            rate.sleep();
+        }
+
+        const char *outcome = "completed";
+        if (stroke.outcome() == tfr_mining::AdaptiveStroke::Outcome::SHORTENED)
+            outcome = "shortened";
+        else if (stroke.outcome() == tfr_mining::AdaptiveStroke::Outcome::DEEPENED)
+            outcome = "deepened";
+        ROS_INFO("Digging: %s stroke %s at %.0f%% of the planned one", penetrate ? "penetrate" : "scoop",
+                outcome, 100 * stroke.progress());
+
+        if (stroke.load(torque) >= 1)
+        {
+            // stopped by the ground, stop pushing where the arm is
+            tfr_mining::DiggingTrajectory::Position position;
+            if (arm_manipulator.getArmPosition(position[0], position[1], position[2], position[3]))
+            {
+                sendPosition(position);
+            }
+        }
+        return waitForArm();
+    }
+
+    /*
+     * Sends each actuator of the arm its setpoint, without waiting.
+     */
+    void sendPosition(const tfr_mining::DiggingTrajectory::Position &position)
+    {
+        arm_manipulator.moveTurntablePosition(position[0]);
+        arm_manipulator.moveLowerArmPosition(position[1]);
+        arm_manipulator.moveUpperArmPosition(position[2]);
+        arm_manipulator.moveScoopPosition(position[3]);
+        last_state = position;
+        has_last_state = true;
+    }
+
+    void updateTorque(const std_msgs::Int16::ConstPtr &msg, int actuator)
+    {
+        std::lock_guard<std::mutex> lock(torque_mutex);
+        // thousandths of the rated torque
+        torque[actuator] = msg->data / 1000.0;
+        torque_stamps[actuator] = ros::Time::now();
+    }
+
+    /*
+     * The latest torques of the lower arm, upper arm and scoop, false if
+     * any of them isn't recent.
+     */
+    bool latestTorque(tfr_mining::AdaptiveStroke::Torque &latest)
+    {
+        const ros::Time now = ros::Time::now();
+        std::lock_guard<std::mutex> lock(torque_mutex);
+        for (int i = 0; i < tfr_mining::AdaptiveStroke::LOADED; i++)
+        {
+            if (torque_stamps[i].isZero() || (now - torque_stamps[i]).toSec() > TORQUE_TIMEOUT)
+            {
+                return false;
+            }
+        }
+        latest = torque;
+        return true;
+    }
+
+    void setLastState(const std::vector<double> &state)
+    {
+        last_state = {{state[0], state[1], state[2], state[3]}};
+        has_last_state = true;
+    }
+
+    /*
+     * Waits at the last state for seconds. Returns false if interrupted.
+     */
+    bool dwell(double seconds)
+    {
+        const ros::Time start = ros::Time::now();
+        ros::Rate rate(50.0);
+        while ((ros::Time::now() - start).toSec() < seconds)
+        {
+            if (interrupted())
+            {
+                return false;
+            }
+            rate.sleep();
+        }
+        return true;
+    }
+
+    /*
+     * Waits until the arm got to the last position it was sent to, or
+     * move_timeout passed. Without feedback from the arm it waits
+     * open_loop_wait instead. Returns false if interrupted while waiting.
+     */
+    bool waitForArm()
+    {
+        const ros::Time start = ros::Time::now();
+        const bool closed_loop = arm_manipulator.hasArmFeedback();
+        if (!closed_loop)
+        {
+            ROS_WARN_THROTTLE(10.0, "Digging: no feedback from the arm, waiting %.2f s per move", open_loop_wait);
+            if (!warned_topics)
+            {
+                warned_topics = !arm_manipulator.checkFeedbackTopics();
+            }
+        }
+        ros::Rate rate(50.0);
+        while (true)
+        {
+            if (interrupted())
+            {
+                return false;
+            }
+            const double elapsed = (ros::Time::now() - start).toSec();
+            if (closed_loop ? arm_manipulator.isArmTargetPositionReached() : elapsed >= open_loop_wait)
+            {
+                ROS_DEBUG("Digging: move took %.2f s", elapsed);
+                return true;
+            }
+            if (elapsed >= move_timeout)
+            {
+                ROS_WARN("Digging: the arm didn't reach its target in %.2f s, moving on", move_timeout);
+                return true;
+            }
+            rate.sleep();
         }
-        ROS_INFO("End digging queue.");
-        tfr_msgs::DiggingResult result;
-        server.setSucceeded(result);
     }
 
     ros::NodeHandle &priv_nh;
+    // whether the feedback topics of the arm were found missing already
+    bool warned_topics = false;
     ros::Publisher drivebase_publisher;
  
     ArmManipulator arm_manipulator;
+    const tfr_mining::DiggingTrajectory::Parameters trajectory_parameters;
+    const double move_timeout;
+    const double open_loop_wait;
+    const double stream_rate;
+    // the last state the arm was sent to
+    tfr_mining::DiggingTrajectory::Position last_state{};
+    bool has_last_state = false;
     tfr_mining::DiggingQueue queue;
+    const tfr_mining::DiggingTrajectory::Position stow_position;
+    std::vector<tfr_mining::DiggingSet> sets;
+    tfr_mining::DigScheduler scheduler;
+    // when to stop digging to stow in time
+    tfr_mining::DigDeadline deadline;
+    const bool adaptive;
+    const tfr_mining::AdaptiveStroke::Parameters penetrate_parameters;
+    const tfr_mining::AdaptiveStroke::Parameters scoop_parameters;
+    // s, torque older than this doesn't count
+    static constexpr double TORQUE_TIMEOUT = 0.5;
+    ros::Subscriber torque_subscribers[tfr_mining::AdaptiveStroke::LOADED];
+    // the latest torque of each, and when it came in, guarded by torque_mutex
+    tfr_mining::AdaptiveStroke::Torque torque{};
+    ros::Time torque_stamps[tfr_mining::AdaptiveStroke::LOADED];
+    std::mutex torque_mutex;
     Server server;
+
+    static std::vector<tfr_mining::DiggingSet> toVector(std::queue<tfr_mining::DiggingSet> queue)
+    {
+        std::vector<tfr_mining::DiggingSet> sets;
+        while (!queue.empty())
+        {
+            sets.push_back(queue.front());
+            queue.pop();
+        }
+        return sets;
+    }
+
+    static std::vector<double> timeEstimates(std::vector<tfr_mining::DiggingSet> &sets)
+    {
+        std::vector<double> estimates;
+        for (tfr_mining::DiggingSet &set : sets)
+        {
+            estimates.push_back(set.getTimeEstimate());
+        }
+        return estimates;
+    }
+
+    static std::vector<double> volumes(std::vector<tfr_mining::DiggingSet> &sets)
+    {
+        std::vector<double> volumes;
+        for (tfr_mining::DiggingSet &set : sets)
+        {
+            volumes.push_back(set.getVolume());
+        }
+        return volumes;
+    }
 };
 
+/*
+ * Reads the encoder limits of the arm that tfr_control loads, the positions
+ * of the digging queue are encoder values. The turntable isn't limited.
+ */
+void jointLimits(tfr_mining::AdaptiveStroke::Position &lower, tfr_mining::AdaptiveStroke::Position &upper)
+{
+    lower.fill(-std::numeric_limits<double>::infinity());
+    upper.fill(std::numeric_limits<double>::infinity());
+    const std::string joints[] = {"lower_arm_joint", "upper_arm_joint", "scoop_joint"};
+    const double defaults[][2] = {{5.2, 1.2}, {5.2, 1.2}, {3.72, 1.2}};
+    for (int i = 0; i < 3; i++)
+    {
+        const std::string prefix = "/absolute_position_encoder_limits/" + joints[i] + "/";
+        if (!ros::param::has(prefix + "encoder_min"))
+            ROS_WARN("Digging: no encoder limits for %s, using the defaults", joints[i].c_str());
+        double encoder_min, encoder_max;
+        ros::param::param<double>(prefix + "encoder_min", encoder_min, defaults[i][0]);
+        ros::param::param<double>(prefix + "encoder_max", encoder_max, defaults[i][1]);
+        lower[i + 1] = std::min(encoder_min, encoder_max);
+        upper[i + 1] = std::max(encoder_min, encoder_max);
+    }
+}
+
+/*
+ * Reads the parameters of the penetrate or scoop strokes under prefix.
+ */
+tfr_mining::AdaptiveStroke::Parameters strokeParameters(const std::string &prefix, double max_extension,
+        const tfr_mining::AdaptiveStroke::Position &lower, const tfr_mining::AdaptiveStroke::Position &upper)
+{
+    tfr_mining::AdaptiveStroke::Parameters parameters;
+    parameters.lower_limits = lower;
+    parameters.upper_limits = upper;
+    parameters.saturation.fill(0.8);
+    std::vector<double> saturation;
+    if (ros::param::get(prefix + "saturation", saturation))
+    {
+        if (saturation.size() == parameters.saturation.size())
+            std::copy(saturation.begin(), saturation.end(), parameters.saturation.begin());
+        else
+            ROS_WARN("Digging: %ssaturation needs 3 values, using the default", prefix.c_str());
+    }
+    ros::param::param<double>(prefix + "light", parameters.light, 0.3);
+    ros::param::param<double>(prefix + "speed", parameters.speed, 0.5);
+    ros::param::param<double>(prefix + "min_speed", parameters.min_speed, 0.2);
+    ros::param::param<double>(prefix + "saturation_time", parameters.saturation_time, 0.25);
+    ros::param::param<double>(prefix + "min_stroke", parameters.min_stroke, 0.2);
+    ros::param::param<double>(prefix + "max_extension", parameters.max_extension, max_extension);
+    return parameters;
+}
+
 int main(int argc, char** argv)
 {
     ros::init(argc, argv, "digging_server");
     ros::NodeHandle n;
     ros::NodeHandle p_n("~");
 
-    DiggingActionServer server(n, p_n);
+    tfr_utilities::ActuatorArrival::Parameters arrival;
+    double move_timeout, open_loop_wait;
+    ros::param::param<double>("~arrival_tolerance", arrival.tolerance, 0.05);
+    ros::param::param<double>("~move_timeout", move_timeout, 8.0);
+    ros::param::param<double>("~open_loop_wait", open_loop_wait, 1.35);
+
+    tfr_mining::DiggingTrajectory::Parameters trajectory;
+    double stream_rate;
+    ros::param::param<bool>("~blend", trajectory.blend, true);
+    ros::param::param<double>("~stream_rate", stream_rate, 10.0);
+    ros::param::param<double>("~dwell_time", trajectory.dwell_time, 1.35);
+    trajectory.check_step = 0.5 / stream_rate;
+    const std::string actuators[] = {"turntable", "lower_arm", "upper_arm", "scoop"};
+    for (int i = 0; i < tfr_mining::DiggingTrajectory::ACTUATORS; i++)
+    {
+        // the turntable swings a heavier arm further
+        const bool turntable = i == 0;
+        tfr_mining::DiggingTrajectory::Limits &limits = trajectory.limits[i];
+        const std::string prefix = "~trajectory/" + actuators[i] + "/";
+        ros::param::param<double>(prefix + "max_velocity", limits.max_velocity, turntable ? 1.0 : 1.5);
+        ros::param::param<double>(prefix + "max_acceleration", limits.max_acceleration, turntable ? 2.0 : 3.0);
+        ros::param::param<double>(prefix + "max_jerk", limits.max_jerk, turntable ? 10.0 : 15.0);
+    }
+
+    tfr_mining::DigScheduler::Parameters schedule;
+    schedule.resolution = 0.1;
+    ros::param::param<double>("~schedule/learning_rate", schedule.learning_rate, 0.3);
+    ros::param::param<double>("~schedule/confidence", schedule.confidence, 1.0);
+    ros::param::param<double>("~schedule/prior_spread", schedule.prior_spread, 0.25);
+    ros::param::param<bool>("~schedule/keep_order", schedule.keep_order, true);
+    ros::param::param<double>("~schedule/min_partial_budget", schedule.min_partial_budget, 4.5);
+
+    // the zero position of the digging queues
+    tfr_mining::DiggingTrajectory::Position stow_position{{3.14, 4.3, 1.9, 2.4}};
+    std::vector<double> stow;
+    if (ros::param::get("~stow_position", stow))
+    {
+        if (stow.size() == stow_position.size())
+            std::copy(stow.begin(), stow.end(), stow_position.begin());
+        else
+            ROS_WARN("Digging: ~stow_position needs 4 values, using the default");
+    }
+    double stow_time;
+    ros::param::param<double>("~stow_time", stow_time, 5.0);
+
+    bool adaptive;
+    ros::param::param<bool>("~adaptive", adaptive, true);
+    tfr_mining::AdaptiveStroke::Position lower, upper;
+    jointLimits(lower, upper);
+    const tfr_mining::AdaptiveStroke::Parameters penetrate = strokeParameters("~penetrate/", 0.3, lower, upper);
+    const tfr_mining::AdaptiveStroke::Parameters scoop = strokeParameters("~scoop/", 0.15, lower, upper);
+
+    DiggingActionServer server(n, p_n, arrival, trajectory, schedule, stow_position, stow_time,
+            adaptive, penetrate, scoop, move_timeout, open_loop_wait, stream_rate);
     ros::spin();
     return 0;
 }
@@ -12,6 +12,17 @@ namespace tfr_mining
             return;
         }
 
+        // optional, the same for every set without it
+        std::vector<double> volumes;
+        if (nh.getParam("volumes", volumes) && static_cast<int>(volumes.size()) != positions.size()) {
+            ROS_WARN("%lu volumes for %d digging sets, ignoring them", volumes.size(), positions.size());
+        }
+
+        // optional, for each set the indices of its penetrate and of its scoop states
+        XmlRpc::XmlRpcValue penetrate_states, scoop_states;
+        nh.getParam("penetrate_states", penetrate_states);
+        nh.getParam("scoop_states", scoop_states);
+
         for (int i = 0; i < positions.size(); i++) {
             DiggingSet toAdd;
             for (int j = 0; j < positions[i].size(); j++)
@@ -20,12 +31,37 @@ namespace tfr_mining
                 for (int angle = 0; angle < 5; angle++) {
                     state.push_back(positions[i][j][angle]);
                 }
-                toAdd.insertState(state, 4.5); // Just use a constant time for simplicity.
+                DiggingPhase phase = DiggingPhase::MOVE;
+                if (listed(penetrate_states, i, j)) {
+                    phase = DiggingPhase::PENETRATE;
+                } else if (listed(scoop_states, i, j)) {
+                    phase = DiggingPhase::SCOOP;
+                }
+                toAdd.insertState(state, 4.5, phase); // Just use a constant time for simplicity.
+            }
+            if (static_cast<int>(volumes.size()) == positions.size())
+            {
+                toAdd.setVolume(volumes[i]);
             }
             sets.push(toAdd);
         }
     }
 
+    bool DiggingQueue::listed(XmlRpc::XmlRpcValue &indices, int set, int state)
+    {
+        if (indices.getType() != XmlRpc::XmlRpcValue::TypeArray || set >= indices.size()
+                || indices[set].getType() != XmlRpc::XmlRpcValue::TypeArray) {
+            return false;
+        }
+        for (int i = 0; i < indices[set].size(); i++) {
+            if (indices[set][i].getType() == XmlRpc::XmlRpcValue::TypeInt
+                    && static_cast<int>(indices[set][i]) == state) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     bool DiggingQueue::isEmpty()
     {
         return sets.empty();
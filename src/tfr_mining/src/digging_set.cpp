@@ -2,14 +2,15 @@
 
 namespace tfr_mining
 {
-    DiggingSet::DiggingSet() : states{}, time_estimate{0}
+    DiggingSet::DiggingSet() : states{}, phases{}, time_estimate{0}, volume{1}
     {
 		
     }
 
-    void DiggingSet::insertState(std::vector<double> state, double time)
+    void DiggingSet::insertState(std::vector<double> state, double time, DiggingPhase phase)
     {
         states.push(state);
+        phases.push(phase);
         time_estimate += time;
     }
 
@@ -22,6 +23,7 @@ namespace tfr_mining
     {
         std::vector<double> state = states.front();
         states.pop();
+        phases.pop();
         return state;
     }
 
@@ -29,4 +31,14 @@ namespace tfr_mining
     {
         return time_estimate;
     }
+
+    void DiggingSet::setVolume(double volume)
+    {
+        this->volume = volume;
+    }
+
+    double DiggingSet::getVolume()
+    {
+        return volume;
+    }
 }
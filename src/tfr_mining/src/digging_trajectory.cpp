@@ -0,0 +1,234 @@
+#include "digging_trajectory.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace tfr_mining
+{
+    namespace
+    {
+        // sign of the jerk in each phase of a move
+        const std::array<double, 7> JERK_PATTERN{{1, 0, -1, 0, -1, 0, 1}};
+        // distances shorter than this don't move an actuator
+        const double MIN_DISTANCE = 1e-9;
+
+        /*
+         * Time to get from rest to speed and back to no acceleration, and
+         * its jerk phase, for the scaled limits.
+         */
+        void accelerate(double speed, double acceleration, double jerk, double &accel_time, double &jerk_time)
+        {
+            if (speed * jerk >= acceleration * acceleration)
+            {
+                jerk_time = acceleration / jerk;
+                accel_time = speed / acceleration + jerk_time;
+            }
+            else
+            {
+                // never gets to the full acceleration
+                jerk_time = std::sqrt(speed / jerk);
+                accel_time = 2 * jerk_time;
+            }
+        }
+    }
+
+    DiggingTrajectory::DiggingTrajectory(const std::vector<Position> &waypoints, const Parameters &parameters) :
+        parameters(parameters), start{}, moves{}, point_to_point{0}
+    {
+        if (waypoints.empty())
+        {
+            return;
+        }
+        start = waypoints.front();
+        for (size_t i = 1; i < waypoints.size(); i++)
+        {
+            Move move = plan(waypoints[i - 1], waypoints[i], parameters);
+            point_to_point += move.duration;
+            if (moves.empty())
+            {
+                move.start = 0;
+                moves.push_back(move);
+                continue;
+            }
+
+            const Move &previous = moves.back();
+            const double previous_end = previous.start + previous.duration;
+            move.start = previous_end;
+            if (parameters.blend && previous.accel_time > 0 && move.accel_time > 0)
+            {
+                // start as early as the limits allow, at most through the
+                // slowing down of the previous move, no overlap always fits
+                const double max_overlap = std::min(previous.accel_time, move.accel_time);
+                for (int step = 20; step > 0; step--)
+                {
+                    move.start = previous_end - max_overlap * step / 20.0;
+                    if (withinLimits(previous, move))
+                    {
+                        break;
+                    }
+                    move.start = previous_end;
+                }
+            }
+            moves.push_back(move);
+        }
+    }
+
+    double DiggingTrajectory::duration() const
+    {
+        return moves.empty() ? 0 : moves.back().start + moves.back().duration;
+    }
+
+    double DiggingTrajectory::pointToPointDuration() const
+    {
+        return point_to_point;
+    }
+
+    DiggingTrajectory::Position DiggingTrajectory::position(double t) const
+    {
+        Position position, velocity, acceleration;
+        sample(t, position, velocity, acceleration);
+        return position;
+    }
+
+    void DiggingTrajectory::sample(double t, Position &position, Position &velocity, Position &acceleration) const
+    {
+        position = start;
+        velocity.fill(0);
+        acceleration.fill(0);
+        Position jerk{};
+        for (const Move &move : moves)
+        {
+            add(move, t, position, velocity, acceleration, jerk);
+        }
+    }
+
+    DiggingTrajectory::Move DiggingTrajectory::plan(const Position &from, const Position &to,
+            const Parameters &parameters)
+    {
+        Move move{};
+        double speed = std::numeric_limits<double>::infinity();
+        double acceleration = speed, jerk = speed;
+        for (int i = 0; i < ACTUATORS; i++)
+        {
+            move.delta[i] = to[i] - from[i];
+            const double distance = std::abs(move.delta[i]);
+            if (distance < MIN_DISTANCE)
+            {
+                move.delta[i] = 0;
+                continue;
+            }
+            // limits of the scale from 0 to 1 that keep this actuator in its limits
+            speed = std::min(speed, parameters.limits[i].max_velocity / distance);
+            acceleration = std::min(acceleration, parameters.limits[i].max_acceleration / distance);
+            jerk = std::min(jerk, parameters.limits[i].max_jerk / distance);
+        }
+
+        if (std::isinf(speed))
+        {
+            // the same state again, wait there
+            move.duration = parameters.dwell_time;
+            move.phase_duration.fill(0);
+            move.phase_duration[3] = parameters.dwell_time;
+            return move;
+        }
+
+        double accel_time, jerk_time;
+        accelerate(speed, acceleration, jerk, accel_time, jerk_time);
+        if (speed * accel_time > 1)
+        {
+            // too short to get to full speed, find the speed that just fits
+            double low = 0, high = speed;
+            for (int i = 0; i < 100; i++)
+            {
+                speed = (low + high) / 2;
+                accelerate(speed, acceleration, jerk, accel_time, jerk_time);
+                if (speed * accel_time > 1)
+                    high = speed;
+                else
+                    low = speed;
+            }
+            speed = low;
+            accelerate(speed, acceleration, jerk, accel_time, jerk_time);
+        }
+        const double cruise_time = std::max(0.0, (1 - speed * accel_time) / speed);
+        const double constant_acceleration = std::max(0.0, accel_time - 2 * jerk_time);
+
+        move.jerk = jerk;
+        move.accel_time = accel_time;
+        move.phase_duration = {{jerk_time, constant_acceleration, jerk_time, cruise_time,
+            jerk_time, constant_acceleration, jerk_time}};
+        move.duration = 2 * accel_time + cruise_time;
+        return move;
+    }
+
+    void DiggingTrajectory::scale(const Move &move, double t, double &s, double &ds, double &dds, double &ddds)
+    {
+        double remaining = t - move.start;
+        s = ds = dds = ddds = 0;
+        if (remaining <= 0)
+        {
+            return;
+        }
+        if (remaining >= move.duration)
+        {
+            s = 1;
+            return;
+        }
+        for (int phase = 0; phase < 7; phase++)
+        {
+            const double jerk = JERK_PATTERN[phase] * move.jerk;
+            const double dt = std::min(remaining, move.phase_duration[phase]);
+            s += ds * dt + dds * dt * dt / 2 + jerk * dt * dt * dt / 6;
+            ds += dds * dt + jerk * dt * dt / 2;
+            dds += jerk * dt;
+            remaining -= dt;
+            if (remaining <= 0)
+            {
+                ddds = jerk;
+                break;
+            }
+        }
+    }
+
+    void DiggingTrajectory::add(const Move &move, double t, Position &position, Position &velocity,
+            Position &acceleration, Position &jerk) const
+    {
+        double s, ds, dds, ddds;
+        scale(move, t, s, ds, dds, ddds);
+        for (int i = 0; i < ACTUATORS; i++)
+        {
+            position[i] += move.delta[i] * s;
+            velocity[i] += move.delta[i] * ds;
+            acceleration[i] += move.delta[i] * dds;
+            jerk[i] += move.delta[i] * ddds;
+        }
+    }
+
+    /*
+     * Whether the two moves together stay in the limits where they overlap.
+     * Each one alone does.
+     */
+    bool DiggingTrajectory::withinLimits(const Move &previous, const Move &next) const
+    {
+        const double end = previous.start + previous.duration;
+        // a little slack for rounding at the phase boundaries
+        const double slack = 1 + 1e-6;
+        for (double t = next.start; t <= end + parameters.check_step; t += parameters.check_step)
+        {
+            Position position{}, velocity{}, acceleration{}, jerk{};
+            add(previous, std::min(t, end), position, velocity, acceleration, jerk);
+            add(next, std::min(t, end), position, velocity, acceleration, jerk);
+            for (int i = 0; i < ACTUATORS; i++)
+            {
+                const Limits &limits = parameters.limits[i];
+                if (std::abs(velocity[i]) > limits.max_velocity * slack
+                        || std::abs(acceleration[i]) > limits.max_acceleration * slack
+                        || std::abs(jerk[i]) > limits.max_jerk * slack)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+}
@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include "adaptive_stroke.h"
+
+using tfr_mining::AdaptiveStroke;
+
+namespace
+{
+    AdaptiveStroke::Parameters parameters()
+    {
+        AdaptiveStroke::Parameters parameters;
+        parameters.saturation = {{0.8, 0.8, 0.5}};
+        parameters.light = 0.3;
+        parameters.speed = 0.5;
+        parameters.min_speed = 0.2;
+        parameters.saturation_time = 0.2;
+        parameters.min_stroke = 0.2;
+        parameters.max_extension = 0.3;
+        // absolute_position_encoder_limits.yaml of tfr_control
+        parameters.lower_limits = {{-6.3, 1.2, 1.2, 1.2}};
+        parameters.upper_limits = {{6.3, 5.2, 5.2, 3.72}};
+        return parameters;
+    }
+
+    // stick into the dirt, from singleScoop.yaml
+    const AdaptiveStroke::Position FROM{{3.14, 3.0, 1.1, 0.3}};
+    const AdaptiveStroke::Position TO{{3.14, 2.0, 1.1, 0.3}};
+
+    const double DT = 0.02;
+    const AdaptiveStroke::Torque NONE{{0, 0, 0}};
+    // half way between light and saturation for the lower arm
+    const AdaptiveStroke::Torque MEDIUM{{0.52, 0.1, 0.1}};
+    const AdaptiveStroke::Torque SATURATED{{0.1, 0.1, -0.55}};
+
+    /*
+     * Runs the stroke with torque until it ends, at most seconds.
+     * */
+    double run(AdaptiveStroke &stroke, const AdaptiveStroke::Torque &torque, double seconds)
+    {
+        double t = 0;
+        for (; t < seconds && !stroke.done(); t += DT)
+            stroke.update(DT, torque);
+        return t;
+    }
+}
+
+TEST(AdaptiveStroke, Load)
+{
+    AdaptiveStroke stroke{FROM, TO, parameters()};
+    EXPECT_DOUBLE_EQ(0, stroke.load(NONE));
+    EXPECT_DOUBLE_EQ(0.65, stroke.load(MEDIUM));
+    EXPECT_DOUBLE_EQ(1.1, stroke.load(SATURATED));
+}
+
+TEST(AdaptiveStroke, CompletesAtThePlannedState)
+{
+    AdaptiveStroke stroke{FROM, TO, parameters()};
+    EXPECT_FALSE(stroke.done());
+    // medium ground is slower, but goes to the planned state and no further
+    const double t = run(stroke, MEDIUM, 10);
+    EXPECT_EQ(AdaptiveStroke::Outcome::COMPLETED, stroke.outcome());
+    EXPECT_DOUBLE_EQ(1, stroke.progress());
+    EXPECT_NEAR(1 / (0.5 * 0.6), t, 2 * DT);
+    for (size_t i = 0; i < TO.size(); i++)
+        EXPECT_DOUBLE_EQ(TO[i], stroke.setpoint()[i]);
+}
+
+TEST(AdaptiveStroke, DeepensInSoftGround)
+{
+    AdaptiveStroke stroke{FROM, TO, parameters()};
+    run(stroke, NONE, 10);
+    EXPECT_EQ(AdaptiveStroke::Outcome::DEEPENED, stroke.outcome());
+    EXPECT_DOUBLE_EQ(1.3, stroke.progress());
+    EXPECT_NEAR(1.7, stroke.setpoint()[1], 1e-9);
+}
+
+/*
+ * Soft past the planned state until the ground gets harder.
+ * */
+TEST(AdaptiveStroke, DeepensUntilTheLoadPicksUp)
+{
+    AdaptiveStroke stroke{FROM, TO, parameters()};
+    run(stroke, NONE, 2.2);
+    EXPECT_FALSE(stroke.done());
+    EXPECT_GT(stroke.progress(), 1);
+    const double progress = stroke.progress();
+    stroke.update(DT, MEDIUM);
+    EXPECT_EQ(AdaptiveStroke::Outcome::DEEPENED, stroke.outcome());
+    EXPECT_DOUBLE_EQ(progress, stroke.progress());
+}
+
+TEST(AdaptiveStroke, ShortensWhenSaturated)
+{
+    AdaptiveStroke stroke{FROM, TO, parameters()};
+    run(stroke, NONE, 1);
+    const double progress = stroke.progress();
+    EXPECT_NEAR(0.5, progress, 0.02);
+
+    // a short spike isn't enough
+    stroke.update(DT, SATURATED);
+    stroke.update(DT, NONE);
+    EXPECT_FALSE(stroke.done());
+
+    run(stroke, SATURATED, 1);
+    EXPECT_EQ(AdaptiveStroke::Outcome::SHORTENED, stroke.outcome());
+    EXPECT_LT(stroke.progress(), progress + 0.05);
+    // and stays there
+    const AdaptiveStroke::Position end = stroke.setpoint();
+    EXPECT_EQ(end, stroke.update(DT, NONE));
+}
+
+/*
+ * The drives start with a spike of torque, saturation at the very start
+ * doesn't end the stroke.
+ * */
+TEST(AdaptiveStroke, NotShortenedAtTheStart)
+{
+    AdaptiveStroke stroke{FROM, TO, parameters()};
+    run(stroke, SATURATED, 0.5);
+    EXPECT_FALSE(stroke.done());
+    run(stroke, SATURATED, 10);
+    EXPECT_EQ(AdaptiveStroke::Outcome::SHORTENED, stroke.outcome());
+    EXPECT_NEAR(0.2, stroke.progress(), 0.01);
+}
+
+TEST(AdaptiveStroke, NoExtension)
+{
+    AdaptiveStroke::Parameters scoop = parameters();
+    scoop.max_extension = 0;
+    AdaptiveStroke stroke{FROM, TO, scoop};
+    run(stroke, NONE, 10);
+    EXPECT_EQ(AdaptiveStroke::Outcome::COMPLETED, stroke.outcome());
+    EXPECT_DOUBLE_EQ(1, stroke.progress());
+}
+
+/*
+ * The deeper strokes of singleScoop.yaml, states 41 and 60, would take the
+ * lower arm under its limit.
+ * */
+TEST(AdaptiveStroke, DeepensOnlyWithinTheJointLimits)
+{
+    const AdaptiveStroke::Parameters limited = parameters();
+    AdaptiveStroke stroke{FROM, {{3.14, 1.4, 1.1, 0.3}}, limited};
+    run(stroke, NONE, 10);
+    EXPECT_EQ(AdaptiveStroke::Outcome::DEEPENED, stroke.outcome());
+    EXPECT_NEAR((1.2 - 3.0) / (1.4 - 3.0), stroke.progress(), 1e-9);
+    EXPECT_GE(stroke.setpoint()[1], limited.lower_limits[1] - 1e-9);
+
+    // planned past the limit already, it goes no further than planned
+    AdaptiveStroke past{FROM, {{3.14, 1.1, 1.1, 0.3}}, limited};
+    run(past, NONE, 10);
+    EXPECT_EQ(AdaptiveStroke::Outcome::COMPLETED, past.outcome());
+    EXPECT_DOUBLE_EQ(1, past.progress());
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+#include "dig_deadline.h"
+#include <cmath>
+
+using tfr_mining::DigDeadline;
+
+TEST(DigDeadline, Budgeted)
+{
+    DigDeadline deadline;
+    deadline.start(100, 60);
+    EXPECT_TRUE(deadline.budgeted());
+    EXPECT_DOUBLE_EQ(50, deadline.left(110));
+    EXPECT_FALSE(deadline.cut(150));
+
+    deadline.cutBefore(5);
+    EXPECT_FALSE(deadline.cut(154.9));
+    EXPECT_TRUE(deadline.cut(155));
+
+    // stowing isn't cut
+    deadline.uncut();
+    EXPECT_FALSE(deadline.cut(170));
+    EXPECT_DOUBLE_EQ(-10, deadline.left(170));
+}
+
+TEST(DigDeadline, WithoutDiggingTime)
+{
+    DigDeadline deadline;
+    deadline.start(100, 0);
+    EXPECT_FALSE(deadline.budgeted());
+    EXPECT_TRUE(std::isinf(deadline.left(1e6)));
+    deadline.cutBefore(5);
+    EXPECT_FALSE(deadline.cut(1e6));
+}
+
+/*
+ * A preempted goal returns with its cutoff set, long past by the time the
+ * next goal without digging time (teleop) comes.
+ * */
+TEST(DigDeadline, PreemptedThenUnbudgeted)
+{
+    DigDeadline deadline;
+    deadline.start(100, 60);
+    deadline.cutBefore(5);
+    // preempted here, nothing clears the cutoff
+
+    deadline.start(300, 0);
+    EXPECT_FALSE(deadline.cut(300));
+    EXPECT_FALSE(deadline.cut(1000));
+}
+
+TEST(DigDeadline, PreemptedThenBudgeted)
+{
+    DigDeadline deadline;
+    deadline.start(100, 60);
+    deadline.cutBefore(5);
+
+    deadline.start(300, 30);
+    EXPECT_FALSE(deadline.cut(300));
+    EXPECT_DOUBLE_EQ(30, deadline.left(300));
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+#include "dig_scheduler.h"
+
+using tfr_mining::DigScheduler;
+
+namespace
+{
+    DigScheduler::Parameters parameters(bool keep_order)
+    {
+        DigScheduler::Parameters parameters;
+        parameters.learning_rate = 0.3;
+        parameters.confidence = 1.0;
+        parameters.prior_spread = 0.25;
+        parameters.resolution = 0.1;
+        parameters.keep_order = keep_order;
+        parameters.min_partial_budget = 15;
+        return parameters;
+    }
+
+    const std::vector<size_t> ALL{0, 1, 2, 3};
+}
+
+TEST(DigScheduler, PriorHasAMargin)
+{
+    DigScheduler scheduler{{40, 20}, {1, 1}, 8, parameters(true)};
+    EXPECT_NEAR(50, scheduler.estimate(0), 1e-9);
+    EXPECT_NEAR(25, scheduler.estimate(1), 1e-9);
+    EXPECT_NEAR(10, scheduler.stowEstimate(), 1e-9);
+}
+
+TEST(DigScheduler, RunsEverythingThatFits)
+{
+    DigScheduler scheduler{{40, 20, 30, 10}, {1, 1, 1, 1}, 8, parameters(true)};
+    EXPECT_EQ(ALL, scheduler.plan(ALL, 1000));
+    EXPECT_TRUE(scheduler.plan(ALL, 0).empty());
+    EXPECT_TRUE(scheduler.plan({}, 1000).empty());
+}
+
+/*
+ * The sets that get the most out together in the time, not the first ones.
+ * */
+TEST(DigScheduler, MostVolumeInTheBudget)
+{
+    DigScheduler scheduler{{40, 20, 30, 10}, {2.2, 1.5, 1, 0.5}, 8, parameters(true)};
+    // 50, 25, 37.5 and 12.5 s with the margin
+    EXPECT_EQ((std::vector<size_t>{0}), scheduler.plan(ALL, 55));
+    EXPECT_EQ((std::vector<size_t>{0, 1}), scheduler.plan(ALL, 80));
+    EXPECT_EQ((std::vector<size_t>{1, 3}), scheduler.plan(ALL, 40));
+    EXPECT_EQ((std::vector<size_t>{1, 2}), scheduler.plan({1, 2, 3}, 65));
+    EXPECT_TRUE(scheduler.plan(ALL, 12).empty());
+}
+
+/*
+ * singleScoop.yaml is one set of 82 states, longer than most digging
+ * times. It starts anyway, to be cut short, once a state fits.
+ * */
+TEST(DigScheduler, StartsASetLongerThanTheBudget)
+{
+    DigScheduler scheduler{{369}, {1}, 8, parameters(true)};
+    EXPECT_EQ((std::vector<size_t>{0}), scheduler.plan({0}, 300));
+    EXPECT_EQ((std::vector<size_t>{0}), scheduler.plan({0}, 15));
+    EXPECT_TRUE(scheduler.plan({0}, 14).empty());
+}
+
+TEST(DigScheduler, StartsTheBestSetLongerThanTheBudget)
+{
+    DigScheduler ordered{{400, 300, 500}, {1, 2, 1}, 8, parameters(true)};
+    EXPECT_EQ((std::vector<size_t>{0}), ordered.plan({0, 1, 2}, 100));
+    EXPECT_EQ((std::vector<size_t>{2}), ordered.plan({2}, 100));
+    DigScheduler best{{400, 300, 500}, {1, 2, 1}, 8, parameters(false)};
+    EXPECT_EQ((std::vector<size_t>{1}), best.plan({0, 1, 2}, 100));
+}
+
+TEST(DigScheduler, MostVolumePerSecondFirst)
+{
+    DigScheduler scheduler{{40, 20, 30, 10}, {1, 1, 1, 1}, 8, parameters(false)};
+    EXPECT_EQ((std::vector<size_t>{3, 1, 2, 0}), scheduler.plan(ALL, 1000));
+}
+
+TEST(DigScheduler, NothingForSetsWithoutVolume)
+{
+    DigScheduler scheduler{{40, 20}, {1, 0}, 8, parameters(true)};
+    EXPECT_EQ((std::vector<size_t>{0}), scheduler.plan({0, 1}, 1000));
+}
+
+/*
+ * A set that took longer than the queue said makes every set it hasn't
+ * measured yet longer, and follows its own measurements.
+ * */
+TEST(DigScheduler, LearnsFromMeasurements)
+{
+    DigScheduler scheduler{{40, 20, 30, 10}, {1, 1, 1, 1}, 8, parameters(true)};
+    scheduler.measured(0, 60);
+    EXPECT_NEAR(60 + 0.25 * 60, scheduler.estimate(0), 1e-9);
+    EXPECT_NEAR(1.5 * 20 * 1.25, scheduler.estimate(1), 1e-9);
+
+    // the same time again and again, the margin shrinks
+    for (int i = 0; i < 20; i++)
+        scheduler.measured(0, 60);
+    EXPECT_NEAR(60, scheduler.estimate(0), 1);
+    EXPECT_GT(scheduler.estimate(0), 60);
+
+    // it follows a change
+    for (int i = 0; i < 20; i++)
+        scheduler.measured(0, 45);
+    EXPECT_NEAR(45, scheduler.estimate(0), 1);
+
+    scheduler.measuredStow(12);
+    EXPECT_NEAR(15, scheduler.stowEstimate(), 1e-9);
+}
+
+/*
+ * A set that varies a lot gets a bigger margin than one that doesn't.
+ * */
+TEST(DigScheduler, MarginFollowsTheSpread)
+{
+    DigScheduler scheduler{{40, 40}, {1, 1}, 8, parameters(true)};
+    for (int i = 0; i < 20; i++)
+    {
+        scheduler.measured(0, 40);
+        scheduler.measured(1, i % 2 ? 30 : 50);
+    }
+    EXPECT_GT(scheduler.estimate(1), scheduler.estimate(0) + 5);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <string>
+#include "digging_trajectory.h"
+
+using tfr_mining::DiggingTrajectory;
+
+namespace
+{
+    DiggingTrajectory::Parameters parameters(bool blend)
+    {
+        DiggingTrajectory::Parameters parameters;
+        parameters.limits[0] = {1.0, 2.0, 10.0};
+        for (int i = 1; i < DiggingTrajectory::ACTUATORS; i++)
+            parameters.limits[i] = {1.5, 3.0, 15.0};
+        parameters.dwell_time = 1.35;
+        parameters.check_step = 0.005;
+        parameters.blend = blend;
+        return parameters;
+    }
+
+    // penetrate, scoop, lift and swing from singleScoop.yaml
+    const std::vector<DiggingTrajectory::Position> SCOOP{
+        {{3.14, 4.3, 1.9, 2.4}},
+        {{3.14, 3.0, 1.1, 0.3}},
+        {{3.14, 2.0, 1.1, 0.3}},
+        {{3.14, 2.1, 2.8, 1.1}},
+        {{3.14, 4.2, 3.0, 2.7}},
+        {{3.14, 5.0, 4.2, 2.7}},
+        {{4.5, 5.0, 4.2, 2.7}}
+    };
+
+    void expectNear(const DiggingTrajectory::Position &expected, const DiggingTrajectory::Position &actual)
+    {
+        for (int i = 0; i < DiggingTrajectory::ACTUATORS; i++)
+            EXPECT_NEAR(expected[i], actual[i], 1e-6) << "actuator " << i;
+    }
+}
+
+TEST(DiggingTrajectory, StartsAndEndsAtTheWaypoints)
+{
+    DiggingTrajectory trajectory{SCOOP, parameters(true)};
+    expectNear(SCOOP.front(), trajectory.position(-1));
+    expectNear(SCOOP.front(), trajectory.position(0));
+    expectNear(SCOOP.back(), trajectory.position(trajectory.duration()));
+    expectNear(SCOOP.back(), trajectory.position(trajectory.duration() + 1));
+}
+
+/*
+ * Blended, with the slowest actuator of every move at its limits, no
+ * actuator goes over its limits anywhere along the way.
+ * */
+TEST(DiggingTrajectory, StaysWithinTheLimits)
+{
+    const DiggingTrajectory::Parameters limits = parameters(true);
+    DiggingTrajectory trajectory{SCOOP, limits};
+    DiggingTrajectory::Position position, velocity, acceleration;
+    DiggingTrajectory::Position last_acceleration{};
+    const double dt = 1e-3;
+    for (double t = 0; t <= trajectory.duration(); t += dt)
+    {
+        trajectory.sample(t, position, velocity, acceleration);
+        for (int i = 0; i < DiggingTrajectory::ACTUATORS; i++)
+        {
+            EXPECT_LE(std::abs(velocity[i]), limits.limits[i].max_velocity * 1.001);
+            EXPECT_LE(std::abs(acceleration[i]), limits.limits[i].max_acceleration * 1.001);
+            EXPECT_LE(std::abs(acceleration[i] - last_acceleration[i]) / dt, limits.limits[i].max_jerk * 1.001);
+        }
+        last_acceleration = acceleration;
+    }
+}
+
+TEST(DiggingTrajectory, BlendingIsFaster)
+{
+    DiggingTrajectory blended{SCOOP, parameters(true)};
+    DiggingTrajectory stopping{SCOOP, parameters(false)};
+    EXPECT_NEAR(stopping.duration(), stopping.pointToPointDuration(), 1e-9);
+    EXPECT_NEAR(stopping.pointToPointDuration(), blended.pointToPointDuration(), 1e-9);
+    EXPECT_LT(blended.duration(), 0.9 * stopping.duration());
+    RecordProperty("point_to_point_s", std::to_string(stopping.duration()));
+    RecordProperty("blended_s", std::to_string(blended.duration()));
+}
+
+/*
+ * Without blending the arm stops at every waypoint.
+ * */
+TEST(DiggingTrajectory, StopsAtTheWaypointsWithoutBlending)
+{
+    DiggingTrajectory trajectory{SCOOP, parameters(false)};
+    DiggingTrajectory::Position position, velocity, acceleration;
+    double t = 0;
+    DiggingTrajectory::Parameters limits = parameters(false);
+    for (size_t i = 1; i < SCOOP.size(); i++)
+    {
+        // the time of each move alone
+        DiggingTrajectory move{{SCOOP[i - 1], SCOOP[i]}, limits};
+        t += move.duration();
+        trajectory.sample(t, position, velocity, acceleration);
+        expectNear(SCOOP[i], position);
+        expectNear({}, velocity);
+    }
+}
+
+TEST(DiggingTrajectory, RepeatedStateIsADwell)
+{
+    const std::vector<DiggingTrajectory::Position> waypoints{
+        {{3.14, 4.3, 1.9, 2.4}},
+        {{3.14, 3.0, 1.1, 0.3}},
+        {{3.14, 3.0, 1.1, 0.3}},
+        {{3.14, 2.0, 1.1, 0.3}}
+    };
+    DiggingTrajectory trajectory{waypoints, parameters(true)};
+    DiggingTrajectory first{{waypoints[0], waypoints[1]}, parameters(true)};
+    DiggingTrajectory last{{waypoints[2], waypoints[3]}, parameters(true)};
+    EXPECT_NEAR(first.duration() + 1.35 + last.duration(), trajectory.duration(), 1e-9);
+
+    // still at the repeated state all through the dwell
+    expectNear(waypoints[1], trajectory.position(first.duration()));
+    expectNear(waypoints[1], trajectory.position(first.duration() + 1.35));
+}
+
+TEST(DiggingTrajectory, Empty)
+{
+    DiggingTrajectory none{{}, parameters(true)};
+    EXPECT_EQ(0, none.duration());
+    DiggingTrajectory one{{SCOOP.front()}, parameters(true)};
+    EXPECT_EQ(0, one.duration());
+    expectNear(SCOOP.front(), one.position(1));
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
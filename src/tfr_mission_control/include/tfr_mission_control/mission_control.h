@@ -21,8 +21,10 @@
 
 #include <tfr_utilities/teleop_code.h>
 #include <tfr_utilities/status_code.h>
+#include <tfr_utilities/command_trace.h>
 
 #include <cstddef>
+#include <memory>
 #include <mutex>
 
 #include <QWidget>
@@ -99,6 +101,10 @@ namespace tfr_mission_control {
             // Constants for joy array indices are defined in joy_indices.h.
       	    ros::Subscriber joySub;
 
+            // Publishes the traces of the teleop commands, for
+            // command_latency_test.
+            std::unique_ptr<tfr_utilities::TraceExporter> traceExporter;
+
             // Flag for accepting teleop commands.
             std::atomic<bool> teleopEnabled;
 
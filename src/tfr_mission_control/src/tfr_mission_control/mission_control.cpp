@@ -78,6 +78,8 @@ namespace tfr_mission_control {
         inputReadTimer = getMTNodeHandle().createTimer(ros::Duration(0.1),
             &MissionControl::inputReadTimerCallback, this);
 
+        traceExporter.reset(new tfr_utilities::TraceExporter(getMTNodeHandle()));
+
         /* Sets up all the signal/slot connections.
          *
          * For those unfamilair with qt this is the backbone of event driven
@@ -208,6 +210,7 @@ namespace tfr_mission_control {
     {
         // Using a Qt plugin means we must manually kill ROS entities.
         inputReadTimer.stop();
+        traceExporter.reset();
         com.shutdown();
         joySub.shutdown();
         autonomy.cancelAllGoals();
@@ -630,6 +633,8 @@ namespace tfr_mission_control {
     {
         tfr_msgs::TeleopGoal goal;
         goal.code = static_cast<uint8_t>(code);
+        goal.trace_id = tfr_utilities::newTraceId();
+        tfr_utilities::recordTrace(goal.trace_id, "mission_control/teleop");
         teleop.sendGoal(goal);
     }
 
@@ -0,0 +1,54 @@
+/*
+ * Dead reckoning of the drivebase from the distances the treads travel.
+ *
+ * Every update moves the robot along the circular arc the two tread
+ * distances describe, which is exact as long as the treads keep a constant
+ * ratio of speeds between two updates, however long the update took and
+ * however fast the robot turns. Updates carry their own timestamps, the
+ * velocities are the ones of the last update.
+ *
+ * Poses are in the odometry frame, yaw in radians counterclockwise.
+ * */
+#ifndef DRIVEBASE_ODOMETRY_H
+#define DRIVEBASE_ODOMETRY_H
+
+#include <ros/ros.h>
+
+class DrivebaseOdometry
+{
+public:
+    explicit DrivebaseOdometry(double wheelSpan);
+
+    /*
+     * The treads moved left and right meters since the last update, which
+     * ended at stamp. The distances of the first update are integrated,
+     * but give no velocity.
+     * */
+    void update(const ros::Time& stamp, double left, double right);
+
+    /*
+     * Moves the robot along the arc of the two tread distances, without
+     * touching the time or the velocities.
+     * */
+    void integrate(double left, double right);
+
+    void setPose(double x, double y, double yaw);
+
+    double x() const { return poseX; }
+    double y() const { return poseY; }
+    double yaw() const { return poseYaw; }
+    // m/s along the heading of the robot
+    double linearVelocity() const { return vLinear; }
+    // rad/s
+    double angularVelocity() const { return vAngular; }
+    // time of the last update, invalid before the first
+    const ros::Time& stamp() const { return lastStamp; }
+
+private:
+    const double wheelSpan;
+    double poseX, poseY, poseYaw;
+    double vLinear, vAngular;
+    ros::Time lastStamp;
+};
+
+#endif // DRIVEBASE_ODOMETRY_H
@@ -0,0 +1,139 @@
+/*
+ * Extended Kalman filter for the drivebase on the flat arena floor.
+ *
+ * The state is the pose in the odometry frame, the speed and turn rate
+ * along the heading, and the bias of the gyroscope:
+ *
+ *     x, y, yaw, v, w, gyro bias
+ *
+ * all in fixed size Eigen matrices, sized at compile time, so the algebra
+ * of an update stays on the stack and takes a few microseconds. Between
+ * measurements the robot keeps its speed and turn rate
+ * (x += v cos(yaw) dt, ...).
+ *
+ * Measurements:
+ *  - treads: v and w of the drivebase odometry
+ *  - gyro: w + gyro bias of the IMU
+ *  - fiducial: x, y and yaw from the fiducial markers
+ *
+ * The measurements are applied in the order of their stamps. Every applied
+ * measurement is kept with the state after it for history_length seconds:
+ * one that comes in older than the latest (the fiducials take a while to
+ * process) rolls the filter back to the last state before it and applies
+ * it and everything after it again. Older than the history it is dropped.
+ *
+ * Not thread safe.
+ * */
+#ifndef PLANAR_EKF_H
+#define PLANAR_EKF_H
+
+#include <ros/ros.h>
+#include <Eigen/Core>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+class PlanarEkf
+{
+public:
+    enum Index
+    {
+        X, Y, YAW, V, W, GYRO_BIAS,
+        SIZE
+    };
+
+    typedef Eigen::Matrix<double, SIZE, 1> State;
+    typedef Eigen::Matrix<double, SIZE, SIZE> Covariance;
+
+    enum class Sensor
+    {
+        TREADS,
+        GYRO,
+        FIDUCIAL
+    };
+
+    /*
+     * The values and variances of a sensor, only the first 1 (gyro), 2
+     * (treads) or 3 (fiducial) are used.
+     * */
+    struct Measurement
+    {
+        Sensor sensor;
+        ros::Time stamp;
+        Eigen::Vector3d value;
+        Eigen::Vector3d variance;
+    };
+
+    struct Parameters
+    {
+        // variance added per second of prediction, in the order of the state
+        State process_noise = (State() << 0.05, 0.05, 0.06, 0.025, 0.02, 1e-4).finished();
+        // variance of the state at the start and after reset()
+        State initial_variance = (State() << 1e-9, 1e-9, 1e-9, 1e-2, 1e-2, 1e-2).finished();
+        // s, how far back a late measurement is applied
+        double history_length = 2.0;
+    };
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    explicit PlanarEkf(const Parameters& parameters);
+    PlanarEkf(const PlanarEkf&) = delete;
+    PlanarEkf& operator=(const PlanarEkf&) = delete;
+    PlanarEkf(PlanarEkf&&) = delete;
+    PlanarEkf& operator=(PlanarEkf&&) = delete;
+
+    /*
+     * Applies the measurement in the order of its stamp. Returns false if
+     * it was older than the history and dropped.
+     * */
+    bool add(const Measurement& measurement);
+
+    bool addTreads(const ros::Time& stamp, double v, double w, double vVariance, double wVariance);
+    bool addGyro(const ros::Time& stamp, double rate, double variance);
+    bool addFiducial(const ros::Time& stamp, double x, double y, double yaw,
+            double positionVariance, double yawVariance);
+
+    /*
+     * Starts over at the pose, at rest, and forgets the history.
+     * */
+    void reset(double x, double y, double yaw);
+
+    const State& state() const { return x; }
+    const Covariance& covariance() const { return P; }
+    // the stamp of the latest measurement applied, zero before the first
+    const ros::Time& stamp() const { return now; }
+
+    // measurements that were applied out of order, and dropped
+    uint64_t rollbacks() const { return rollbackCount; }
+    uint64_t dropped() const { return droppedCount; }
+
+private:
+    struct Entry
+    {
+        Measurement measurement;
+        State x;
+        Covariance P;
+    };
+
+    void predict(double dt);
+    void correct(const Measurement& measurement);
+    template <int M>
+    void correct(const Eigen::Matrix<double, M, 1>& residual,
+            const Eigen::Matrix<double, M, SIZE>& H,
+            const Eigen::Matrix<double, M, 1>& variance);
+    void apply(const Measurement& measurement);
+
+    const Parameters parameters;
+
+    State x;
+    Covariance P;
+    ros::Time now;
+
+    std::deque<Entry, Eigen::aligned_allocator<Entry>> history;
+    // the measurements being applied again, kept to not allocate each time
+    std::vector<Measurement> replay;
+    uint64_t rollbackCount;
+    uint64_t droppedCount;
+};
+
+#endif // PLANAR_EKF_H
@@ -0,0 +1,101 @@
+/*
+ * Estimates how much the treads slip, to tell the sensor fusion how far to
+ * trust the drivebase odometry.
+ *
+ * Two independent measures:
+ *  - yaw: the yaw rate of the treads against the gyroscope of the IMU. The
+ *    mean square of the difference, averaged over yaw_time_constant, is
+ *    added to the variance of the yaw rate.
+ *  - linear: between two fiducial fixes, the distance the treads say the
+ *    robot moved against the distance between the fixes. The treads are
+ *    dead reckoned here from their speeds alone, the pose of the odometry
+ *    is pulled toward the fixes and would hide the slip. The relative
+ *    error, smoothed over fixes, scales the variance of the speed. Without
+ *    new fixes it fades over linear_time_constant.
+ *
+ * So the variances stay at their base values while the treads grip, and
+ * grow while they slip or the robot spins in place in loose regolith.
+ *
+ * The gyroscope is expected to turn counterclockwise positive about the
+ * vertical axis, as the yaw of the odometry. Not thread safe.
+ * */
+#ifndef SLIP_ESTIMATOR_H
+#define SLIP_ESTIMATOR_H
+
+#include <ros/ros.h>
+
+class SlipEstimator
+{
+public:
+    struct Parameters
+    {
+        // (m/s)^2 and (rad/s)^2 while the treads grip
+        double base_linear_variance = 5e-2;
+        double base_angular_variance = 5e-2;
+        double max_variance = 10;
+        // s, averaging of the squared yaw rate difference
+        double yaw_time_constant = 1.0;
+        // s, smoothing of the gyroscope to the tread update intervals
+        double gyro_time_constant = 0.05;
+        // s, a gyroscope quieter than this is not compared
+        double gyro_timeout = 0.5;
+        // weight of a new fix in the linear slip
+        double fiducial_weight = 0.3;
+        // m, fixes closer than this are too noisy to compare
+        double min_fiducial_distance = 0.3;
+        // s, fixes further apart than this are not compared
+        double max_fiducial_interval = 5.0;
+        // s, fading of the linear slip without fixes
+        double linear_time_constant = 20.0;
+    };
+
+    explicit SlipEstimator(const Parameters& parameters);
+
+    /*
+     * A yaw rate of the gyroscope in rad/s
+     * */
+    void addGyro(const ros::Time& stamp, double yawRate);
+
+    /*
+     * The speeds of the treads after an update, see DrivebaseOdometry.
+     * */
+    void addTreads(const ros::Time& stamp, double linear, double angular);
+
+    /*
+     * A position of the robot from the fiducials, in any fixed frame.
+     * */
+    void addFiducial(const ros::Time& stamp, double x, double y);
+
+    // relative error of the tread distance, 0 while the treads grip
+    double linearSlip() const { return linearSlipRatio; }
+    // rms difference of the tread and gyroscope yaw rates in rad/s
+    double yawRateError() const;
+
+    /*
+     * The variance of the speed at speed m/s, and of the yaw rate.
+     * */
+    double linearVariance(double speed) const;
+    double angularVariance() const;
+
+private:
+    struct Fix
+    {
+        ros::Time stamp;
+        double x, y;
+        double treadX, treadY;
+    };
+
+    const Parameters parameters;
+
+    double gyroRate;
+    ros::Time gyroStamp;
+    double yawResidualSquared;
+    double linearSlipRatio;
+    ros::Time treadStamp;
+    // dead reckoned from the tread speeds only, never corrected
+    double treadX, treadY, treadYaw;
+    bool hasFix;
+    Fix lastFix;
+};
+
+#endif // SLIP_ESTIMATOR_H
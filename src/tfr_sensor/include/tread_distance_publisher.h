@@ -1,3 +1,8 @@
+#ifndef TREAD_DISTANCE_PUBLISHER_H
+#define TREAD_DISTANCE_PUBLISHER_H
+
+#include <tfr_utilities/tick_unwrapper.h>
+#include <cstdint>
 
 class TreadDistance {
 public:
@@ -6,13 +11,18 @@ public:
     TreadDistance(const int ticksPerRevolution, const int maxTicks, const double wheelRadius, const int prevTickCount = 0);
 
     void updateFromNewCount(const int newCount);
+
+    // distance traveled since construction, across wraps of the counter
+    double totalDistance() const;
     
 private:
 
-    int calcTickDiff(const int newCount);
+    int64_t calcTickDiff(const int newCount);
 
-    int prevTickCount; // last recorded position of wheel
     const int ticksPerRevolution; // number of ticks counted each revolution of the measured wheel
-    const int maxTicks; // number of ticks counted before rolling over back to 0
+    const int maxTicks; // the counter counts from -maxTicks - 1 to maxTicks before rolling over
     const double wheelCircumference; // circumference of wheel (for which ticks are being counted) in meters
+    tfr_utilities::TickUnwrapper ticks; // unwraps rollovers, recentering and resets of the counter
 };
+
+#endif // TREAD_DISTANCE_PUBLISHER_H
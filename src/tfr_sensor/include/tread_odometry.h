@@ -0,0 +1,66 @@
+/*
+ * The whole path from the counts of the tread encoders to the pose of the
+ * drivebase, in one object: TreadDistance turns the counts of each tread
+ * into distances, the readings of the two treads are paired up and every
+ * pair is integrated by DrivebaseOdometry.
+ *
+ * The motor controller counts both treads in the same query, so a left and
+ * a right reading make up one update, stamped with the later of the two. If
+ * one side reports twice before the other, the first is integrated on its
+ * own so nothing is held back.
+ *
+ * Readings are applied in the order they are added. Not thread safe, feed
+ * it from one thread (a single threaded spinner).
+ * */
+#ifndef TREAD_ODOMETRY_H
+#define TREAD_ODOMETRY_H
+
+#include <ros/ros.h>
+#include "drivebase_odometry.h"
+#include "tread_distance_publisher.h"
+
+class TreadOdometry
+{
+public:
+    TreadOdometry(double wheelSpan, int ticksPerRevolution, int maxTicks, double wheelRadius);
+    TreadOdometry(const TreadOdometry&) = delete;
+    TreadOdometry& operator=(const TreadOdometry&) = delete;
+    TreadOdometry(TreadOdometry&&) = delete;
+    TreadOdometry& operator=(TreadOdometry&&) = delete;
+
+    /*
+     * A count of the encoder of a tread, read at stamp. The first count of
+     * each tread only sets where it starts, the odometry starts at the
+     * later of the two. Returns true if the odometry was updated.
+     * */
+    bool addLeftCount(const ros::Time& stamp, int count);
+    bool addRightCount(const ros::Time& stamp, int count);
+
+    /*
+     * The distance a tread moved since its last reading, for readings that
+     * were already converted. Returns true if the odometry was updated.
+     * */
+    bool addLeftDistance(const ros::Time& stamp, double distance);
+    bool addRightDistance(const ros::Time& stamp, double distance);
+
+    DrivebaseOdometry& odometry() { return pose; }
+    const DrivebaseOdometry& odometry() const { return pose; }
+
+private:
+    struct Side
+    {
+        double distance;
+        ros::Time stamp;
+        bool pending;
+        bool counted;
+    };
+
+    bool add(Side& side, const Side& other, const ros::Time& stamp, double distance);
+    void integratePending();
+
+    TreadDistance leftTread, rightTread;
+    Side left, right;
+    DrivebaseOdometry pose;
+};
+
+#endif // TREAD_ODOMETRY_H
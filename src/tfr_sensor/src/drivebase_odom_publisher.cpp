@@ -9,10 +9,39 @@
  *   - ~child_frame: the frame of the robot (string, default: "base_footprint")
  *   - ~wheel_span: the separation of the treads of the robot. (double,
  *   default)
- *   - ~rate: how quickly to publish hz. (double, default 10)
+ *   - ~rate: how quickly to publish hz, 0 publishes every update. (double, default 32)
+ *   - ~input: "distances" to follow tread_distance_publisher, "counts" to
+ *   read the encoder counts directly (string, default "distances")
+ *   - ~wheelRadius, ~ticksPerRevolution, ~maxTicks: the treads, see
+ *   tread_distance_publisher, only with ~input "counts" (double)
+ *   - ~slip/imu_topic: the IMU to compare the yaw rate with, "" to not
+ *   compare (string, default "/sensors/imu")
+ *   - ~slip/fiducial_topic: the fiducial odometry to compare the distance
+ *   with, "" to not compare (string, default "/fiducial_odom")
+ *   - ~slip/...: the rest of SlipEstimator::Parameters, see slip_estimator.h
+ *
+ * The twist covariance grows with the slip of the treads, estimated from
+ * the IMU and the fiducials (slip_estimator.h), so the sensor fusion leans
+ * on the odometry while the treads grip and on the other sensors while
+ * they slip.
+ *
+ * Every left and right tread reading is integrated when it arrives, see
+ * tread_odometry.h, instead of summing them up until the next publish. The
+ * pose is published at ~rate, stamped with the time of the last update.
+ *
+ * With ~input "counts" this node replaces tread_distance_publisher: the
+ * counts go straight into the odometry in this process, without the hop
+ * through the distance topics. Callbacks and the publish timer run on one
+ * thread, in the order the readings arrive.
+ *
  * Subscribed topics:
- *   - /left_tread_count & /right_tread_count :(tfr_sensor/src/tread_distance_publisher) The most current information coming
- *   in from the treads.
+ *   - /left_tread_distance & /right_tread_distance : (std_msgs/Float64,
+ *   tfr_sensor/src/tread_distance_publisher) the distance each tread moved
+ *   since its last reading, with ~input "distances"
+ *   - /left_tread_count & /right_tread_count : (std_msgs/Int32) the counts
+ *   of the tread encoders, with ~input "counts"
+ *   - ~slip/imu_topic : (sensor_msgs/Imu) the yaw rate of the gyroscope
+ *   - ~slip/fiducial_topic : (nav_msgs/Odometry) the position from the fiducials
  * Published topics: 
  *   - /drivebase_odom : (nav_msgs/Odometry) the location of the
  *   base_footprint tracked by tread motion.
@@ -21,11 +50,11 @@
  *  odometry to a new position
  * */
 #include <ros/ros.h>
-#include <boost/function.hpp>
 #include <tfr_msgs/SetOdometry.h>
 #include <tfr_msgs/PoseSrv.h>
 #include <geometry_msgs/Quaternion.h>
 #include <nav_msgs/Odometry.h>
+#include <sensor_msgs/Imu.h>
 #include <std_srvs/Empty.h>
 #include <tf/transform_datatypes.h>
 #include <tf2_ros/transform_broadcaster.h>
@@ -34,6 +63,10 @@
 #include <tf2/LinearMath/Quaternion.h>
 #include <tf2/LinearMath/Scalar.h>
 #include "std_msgs/Float64.h"
+#include "std_msgs/Int32.h"
+#include <cmath>
+#include "tread_odometry.h"
+#include "slip_estimator.h"
 
 class DrivebaseOdometryPublisher
 {
@@ -48,24 +81,39 @@ class DrivebaseOdometryPublisher
     DrivebaseOdometryPublisher(ros::NodeHandle &n, 
                 const std::string& p_frame, 
                 const std::string& c_frame,
-                const double& wheel_sep) :
+                const double& wheel_sep,
+                bool counts,
+                int ticksPerRevolution,
+                int maxTicks,
+                double wheelRadius,
+                bool publishEveryUpdate,
+                const SlipEstimator::Parameters& slipParameters,
+                const std::string& imuTopic,
+                const std::string& fiducialTopic) :
+            tf_broadcaster{},
             parent_frame{p_frame},
             child_frame{c_frame},
-            wheel_span{wheel_sep},
-            x{},
-            y{},
-            angle{},
-            tf_broadcaster{},
-            leftTreadDistance{},
-            rightTreadDistance{}
+            treads{wheel_sep, ticksPerRevolution, maxTicks, wheelRadius},
+            publishEveryUpdate{publishEveryUpdate},
+            slip{slipParameters}
     {
-        //get most current sensor infromation
-        boost::function<void(const std_msgs::Float64&)> leftTreadCallback = [this](const std_msgs::Float64& msg) {this->leftTreadDistance += msg.data; };
-        boost::function<void(const std_msgs::Float64&)> rightTreadCallback = [this](const std_msgs::Float64& msg) {this->rightTreadDistance += msg.data; };
+        //integrate the sensor information as it comes in
+        if (counts)
+        {
+            leftTreadSub = n.subscribe("/left_tread_count", 15, &DrivebaseOdometryPublisher::leftTreadCount, this);
+            rightTreadSub = n.subscribe("/right_tread_count", 15, &DrivebaseOdometryPublisher::rightTreadCount, this);
+        }
+        else
+        {
+            leftTreadSub = n.subscribe("/left_tread_distance", 15, &DrivebaseOdometryPublisher::leftTreadDistance, this);
+            rightTreadSub = n.subscribe("/right_tread_distance", 15, &DrivebaseOdometryPublisher::rightTreadDistance, this);
+        }
         
-
-		leftTreadDistanceSub = n.subscribe<std_msgs::Float64>("/left_tread_distance", 15, leftTreadCallback);
-        rightTreadDistanceSub = n.subscribe<std_msgs::Float64>("/right_tread_distance", 15, rightTreadCallback);
+        //the other sensors tell how much the treads slip
+        if (!imuTopic.empty())
+            imuSub = n.subscribe(imuTopic, 50, &DrivebaseOdometryPublisher::imuReceived, this);
+        if (!fiducialTopic.empty())
+            fiducialSub = n.subscribe(fiducialTopic, 5, &DrivebaseOdometryPublisher::fiducialReceived, this);
         
         //odometry_publisher: publish to the location of the base_footprint tracked by tread motion.
         odometry_publisher = n.advertise<nav_msgs::Odometry>("/drivebase_odom", 15); 
@@ -73,10 +121,6 @@ class DrivebaseOdometryPublisher
         ///set_drivebase_odometry : resets the basis of odometry to a new position
         set_odometry = n.advertiseService("set_drivebase_odometry", &DrivebaseOdometryPublisher::setOdometry, this);
         reset_odometry = n.advertiseService("reset_drivebase_odometry", &DrivebaseOdometryPublisher::resetOdometry, this);
-        angle.x = 0;
-        angle.y = 0;
-        angle.z = 0;
-        angle.w = 1;
     }
 
     ~DrivebaseOdometryPublisher() = default;
@@ -86,62 +130,100 @@ class DrivebaseOdometryPublisher
     DrivebaseOdometryPublisher& operator=(DrivebaseOdometryPublisher&) = delete;
 
     /*****************************************************************************************
-    * processOdometry: Main business logic for the node, takes in readings from the controller,
-    *       and publishes them across the network.
+    * processOdometry: Main business logic for the node, publishes the odometry integrated
+    *       from the readings of the treads across the network.
     * Preconditions: is subscribed to recieve information from the treads (tfr_sensor/src/tread_distance_publisher)
-    * Postconditions: Velocities from the treads are published across the network
+    * Postconditions: The latest pose and velocities from the treads are published across the network
     *****************************************************************************************/
-    void processOdometry()
+    void processOdometry(const ros::TimerEvent& event)
     {
-        //first we process the data
-        auto t_1 = ros::Time::now();
-        double d_t = (t_1 - t_0).toSec();
-        
-        //if this is the first message we skip it to initialize time
-        //properly
-        if (!t_0.isValid())
-        {
-            t_0 = ros::Time::now();
-            return;
-        }
+        publishOdometry();
+    }
 
-        double v_l = leftTreadDistance/d_t;
-        double v_r = rightTreadDistance/d_t;
+    private:
 
-        //zero out aggregate distances
-        rightTreadDistance = 0;
-        leftTreadDistance = 0;
+        ros::Subscriber leftTreadSub, rightTreadSub; //the encoder data sub
+        ros::Subscriber imuSub, fiducialSub; //the slip references
+        ros::Publisher odometry_publisher; //the pub for our processed data
+        ros::ServiceServer set_odometry;
+        ros::ServiceServer reset_odometry;
+        tf2_ros::TransformBroadcaster tf_broadcaster;
+        const std::string& parent_frame; //the parent frame of the robot
+        const std::string& child_frame; //the child frame of the robot
+        TreadOdometry treads; //the pose of the robot from the treads
+        const bool publishEveryUpdate;
+        SlipEstimator slip; //how far to trust the treads
+        const double MAX_XY_DELTA = 0.25;
+        const double MAX_THETA_DELTA = 0.65;
 
-        //basic differential kinematics to get combined velocities
-        double v_ang = ((v_r-v_l)/wheel_span);
-        double v_lin = (v_r+v_l)/2;
-        
-        //break into xy components and increment
-        double d_angle = v_ang * d_t;
-        rotateQuaternionByYaw(angle, d_angle);
-        // yaw (z-axis rotation)
-        auto yaw = quaternionToYaw(angle);
-        double v_x = v_lin*cos(yaw);
-        double v_y = v_lin*sin(yaw);
+    /*************************************************************************
+     * leftTreadCount, rightTreadCount, leftTreadDistance, rightTreadDistance:
+     *      integrate a reading of a tread as soon as it comes in
+     * Preconditions: subscribed to the tread topics of ~input
+     * Postconditions: the odometry is updated once both treads reported
+     *************************************************************************/
+    void leftTreadCount(const std_msgs::Int32::ConstPtr& msg)
+    {
+        updated(treads.addLeftCount(ros::Time::now(), msg->data));
+    }
 
+    void rightTreadCount(const std_msgs::Int32::ConstPtr& msg)
+    {
+        updated(treads.addRightCount(ros::Time::now(), msg->data));
+    }
 
-        double d_x = v_x * d_t;
-        x += d_x;
+    void leftTreadDistance(const std_msgs::Float64::ConstPtr& msg)
+    {
+        updated(treads.addLeftDistance(ros::Time::now(), msg->data));
+    }
 
-        double d_y = v_y * d_t;
-        y += d_y;
-        t_0 = t_1;
+    void rightTreadDistance(const std_msgs::Float64::ConstPtr& msg)
+    {
+        updated(treads.addRightDistance(ros::Time::now(), msg->data));
+    }
+
+    void updated(bool update)
+    {
+        if (!update)
+            return;
+        const DrivebaseOdometry& odometry = treads.odometry();
+        slip.addTreads(odometry.stamp(), odometry.linearVelocity(), odometry.angularVelocity());
+        if (publishEveryUpdate)
+            publishOdometry();
+    }
+
+    void imuReceived(const sensor_msgs::Imu::ConstPtr& msg)
+    {
+        slip.addGyro(msg->header.stamp, msg->angular_velocity.z);
+    }
+
+    void fiducialReceived(const nav_msgs::Odometry::ConstPtr& msg)
+    {
+        slip.addFiducial(msg->header.stamp, msg->pose.pose.position.x, msg->pose.pose.position.y);
+    }
+
+    /*************************************************************************
+     * publishOdometry: publishes the latest pose and velocities
+     * Preconditions: none
+     * Postconditions: the odometry is published if there was a reading yet
+     *************************************************************************/
+    void publishOdometry()
+    {
+        const DrivebaseOdometry& odometry = treads.odometry();
+        //nothing to report before the first reading
+        if (odometry.stamp().isZero())
+            return;
 
         //let's package up the message
         nav_msgs::Odometry msg;
-        msg.header.stamp = ros::Time::now();
+        msg.header.stamp = odometry.stamp();
         msg.header.frame_id = parent_frame;
         msg.child_frame_id = child_frame;
         //Drivebase odometry should not be reporting position to our kalman filter to reduce error. This information can be extrapolated from the velocities.  
-        msg.pose.pose.position.x = x;
-        msg.pose.pose.position.y = y;
+        msg.pose.pose.position.x = odometry.x();
+        msg.pose.pose.position.y = odometry.y();
         msg.pose.pose.position.z = 0;
-        msg.pose.pose.orientation = angle;
+        msg.pose.pose.orientation = yawToQuaternion(odometry.yaw());
         msg.pose.covariance = { 
             1e-1, 0,    0,    0,    0,    0,
             0, 1e-1,    0,    0,    0,    0,
@@ -150,43 +232,28 @@ class DrivebaseOdometryPublisher
             0,    0,    0,    0, 1e-1,    0,
             0,    0,    0,    0,    0, 1e-1 }; 
 
-        msg.twist.twist.linear.x = v_x;
-        msg.twist.twist.linear.y = v_y;
+        //the twist is in the frame of the robot, which only drives forward and turns
+        msg.twist.twist.linear.x = odometry.linearVelocity();
+        msg.twist.twist.linear.y = 0;
         msg.twist.twist.linear.z = 0;
         msg.twist.twist.angular.x = 0;
         msg.twist.twist.angular.y = 0;
-        msg.twist.twist.angular.z = v_ang;
-        msg.twist.covariance = { 5e-2,    0,    0,    0,    0,    0,
-            0, 5e-2,    0,    0,    0,    0,
+        msg.twist.twist.angular.z = odometry.angularVelocity();
+        //trust the treads as far as they grip, sideways motion is all slip
+        const double linearVariance = slip.linearVariance(std::abs(odometry.linearVelocity()));
+        const double angularVariance = slip.angularVariance();
+        msg.twist.covariance = { linearVariance,    0,    0,    0,    0,    0,
+            0, linearVariance,    0,    0,    0,    0,
             0,    0, 5e-2,    0,    0,    0,
             0,    0,    0, 5e-2,    0,    0,
             0,    0,    0,    0, 5e-2,    0,
-            0,    0,    0,    0,    0, 5e-2 };
+            0,    0,    0,    0,    0, angularVariance };
+        ROS_DEBUG_THROTTLE(1.0, "Drivebase Odometry Publisher: slip %.2f, yaw rate error %.3f rad/s",
+                slip.linearSlip(), slip.yawRateError());
         //publish the message 
         odometry_publisher.publish(msg);
     }
 
-
-
-    private:
-
-        ros::Subscriber leftTreadDistanceSub, rightTreadDistanceSub; //the encoder data sub
-        ros::Publisher odometry_publisher; //the pub for our processed data
-        ros::ServiceServer set_odometry;
-        ros::ServiceServer reset_odometry;
-        tf2_ros::TransformBroadcaster tf_broadcaster;
-        const std::string& parent_frame; //the parent frame of the robot
-        const std::string& child_frame; //the child frame of the robot
-        const double& wheel_span;
-        double leftTreadDistance, rightTreadDistance;
-        double x; //the x coordinate of the robot (meters)
-        double y; //the y coordinate of the robot (meters)
-        geometry_msgs::Quaternion angle; 
-        const double MAX_XY_DELTA = 0.25;
-        const double MAX_THETA_DELTA = 0.65;
-        ros::Time t_0;
-
-       
     /******************************************************************************************************
     * setOdometry: Set odometry from fiducial markers, provides smoothing
     * Preconditions: can advertise to set_drivebase_odometry topic, can provide service to 
@@ -197,15 +264,18 @@ class DrivebaseOdometryPublisher
             tfr_msgs::SetOdometry::Response& response)
     {
 
+        DrivebaseOdometry& odometry = treads.odometry();
+        const double x = odometry.x();
+        const double y = odometry.y();
+        geometry_msgs::Quaternion angle = yawToQuaternion(odometry.yaw());
+
         auto dx = request.pose.position.x - x;
         if (std::abs(dx) >= MAX_XY_DELTA)
             dx = (dx >= 0) ? MAX_XY_DELTA : -MAX_XY_DELTA;
-        x += dx;
 
         auto dy = request.pose.position.y - y;
         if (std::abs(dy) > MAX_XY_DELTA)
             dy = (dy >= 0) ? MAX_XY_DELTA : -MAX_XY_DELTA;
-        y += dy;
 
         auto new_q = getTfQuaternion(request.pose.orientation);
         auto old_q = getTfQuaternion(angle);
@@ -219,6 +289,7 @@ class DrivebaseOdometryPublisher
         }
         else
             angle = request.pose.orientation;
+        odometry.setPose(x + dx, y + dy, quaternionToYaw(angle));
         return true;
     }
 
@@ -234,9 +305,9 @@ class DrivebaseOdometryPublisher
     {
         ROS_INFO("Drivebase Odometry Publisher: resetting drivebase odometry");
 
-        x = request.pose.position.x;
-        y = request.pose.position.y;
-        angle = request.pose.orientation;
+        geometry_msgs::Quaternion angle = request.pose.orientation;
+        treads.odometry().setPose(request.pose.position.x, request.pose.position.y,
+                quaternionToYaw(angle));
         return true;
     }
     
@@ -281,20 +352,15 @@ class DrivebaseOdometryPublisher
     }
         
     /*************************************************************************
-     * rotateQuaternionByYaw: rotates a quaternion value by a yaw (z-axis rotation)
-     * Preconditions: quaternion and yaw parameters are initalized
-     * Postconditions: quaternion paramater is updated with the new values
+     * yawToQuaternion: converts a yaw (z-axis rotation) to a quaternion value
+     * Preconditions: none
+     * Postconditions: quaternion value is returned
      *************************************************************************/
-    void rotateQuaternionByYaw(geometry_msgs::Quaternion& q, double yaw)
+    geometry_msgs::Quaternion yawToQuaternion(double yaw)
     {
-        tf2::Quaternion q_0{q.x, q.y, q.z, q.w};
-        tf2::Quaternion q_1{};
-        q_1.setRPY(0, 0, yaw);
-        q_0 *= q_1;
-        q.x = q_0.getX();
-        q.y = q_0.getY();
-        q.z = q_0.getZ();
-        q.w = q_0.getW();
+        tf2::Quaternion q_0{};
+        q_0.setRPY(0, 0, yaw);
+        return getStdQuaternion(q_0);
     }
 };
 
@@ -310,14 +376,40 @@ int main(int argc, char **argv)
     ros::param::param<std::string>("~child_frame", child_frame, "base_footprint");
     ros::param::param<double>("~wheel_span", wheel_span, 0.36);
     ros::param::param<double>("~rate", rate, 32);
-    DrivebaseOdometryPublisher publisher{n, parent_frame, child_frame, wheel_span};
-    ros::Rate loop_rate(rate);
-    while(ros::ok())
+    std::string input;
+    ros::param::param<std::string>("~input", input, "distances");
+    double wheelRadius, ticksPerRevolution, maxTicks;
+    ros::param::param<double>("~wheelRadius", wheelRadius, 0.15);
+    ros::param::param<double>("~ticksPerRevolution", ticksPerRevolution, 2400);
+    ros::param::param<double>("~maxTicks", maxTicks, 2147483647);
+    if (input != "counts" && input != "distances")
     {
-        publisher.processOdometry(); //readings are published across the network
-        ros::spinOnce();
-        loop_rate.sleep();
-
+        ROS_WARN("Drivebase Odometry Publisher: unknown input %s, using distances", input.c_str());
+    }
+    std::string imuTopic, fiducialTopic;
+    ros::param::param<std::string>("~slip/imu_topic", imuTopic, "/sensors/imu");
+    ros::param::param<std::string>("~slip/fiducial_topic", fiducialTopic, "/fiducial_odom");
+    SlipEstimator::Parameters slip;
+    ros::param::param<double>("~slip/base_linear_variance", slip.base_linear_variance, slip.base_linear_variance);
+    ros::param::param<double>("~slip/base_angular_variance", slip.base_angular_variance, slip.base_angular_variance);
+    ros::param::param<double>("~slip/max_variance", slip.max_variance, slip.max_variance);
+    ros::param::param<double>("~slip/yaw_time_constant", slip.yaw_time_constant, slip.yaw_time_constant);
+    ros::param::param<double>("~slip/gyro_time_constant", slip.gyro_time_constant, slip.gyro_time_constant);
+    ros::param::param<double>("~slip/gyro_timeout", slip.gyro_timeout, slip.gyro_timeout);
+    ros::param::param<double>("~slip/fiducial_weight", slip.fiducial_weight, slip.fiducial_weight);
+    ros::param::param<double>("~slip/min_fiducial_distance", slip.min_fiducial_distance, slip.min_fiducial_distance);
+    ros::param::param<double>("~slip/max_fiducial_interval", slip.max_fiducial_interval, slip.max_fiducial_interval);
+    ros::param::param<double>("~slip/linear_time_constant", slip.linear_time_constant, slip.linear_time_constant);
+    DrivebaseOdometryPublisher publisher{n, parent_frame, child_frame, wheel_span,
+        input == "counts", static_cast<int>(ticksPerRevolution), static_cast<int>(maxTicks),
+        wheelRadius, rate <= 0, slip, imuTopic, fiducialTopic};
+    //readings are integrated as they arrive and published across the network at rate
+    ros::Timer timer;
+    if (rate > 0)
+    {
+        timer = n.createTimer(ros::Duration(1 / rate),
+                &DrivebaseOdometryPublisher::processOdometry, &publisher);
     }
+    ros::spin();
     return 0;
 }
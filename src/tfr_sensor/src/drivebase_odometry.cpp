@@ -0,0 +1,76 @@
+#include "drivebase_odometry.h"
+#include <cmath>
+
+namespace
+{
+    // below this turn the arc is integrated with a series that stays exact
+    // to double precision, the radius of the arc would blow up
+    const double SMALL_TURN = 1e-6;
+
+    double normalize(double angle)
+    {
+        return std::atan2(std::sin(angle), std::cos(angle));
+    }
+}
+
+DrivebaseOdometry::DrivebaseOdometry(double wheelSpan) :
+    wheelSpan{wheelSpan},
+    poseX{0},
+    poseY{0},
+    poseYaw{0},
+    vLinear{0},
+    vAngular{0},
+    lastStamp{}
+{
+}
+
+void DrivebaseOdometry::update(const ros::Time& stamp, double left, double right)
+{
+    integrate(left, right);
+
+    const double dt = lastStamp.isZero() ? 0 : (stamp - lastStamp).toSec();
+    if (dt > 0)
+    {
+        vLinear = (left + right) / 2 / dt;
+        vAngular = (right - left) / wheelSpan / dt;
+    }
+    if (dt >= 0)
+    {
+        lastStamp = stamp;
+    }
+}
+
+/*
+ * The robot turns by theta while its center travels distance along an arc
+ * of radius distance / theta, which moves it by
+ *   dx = distance * (sin(yaw + theta) - sin(yaw)) / theta
+ *   dy = distance * (cos(yaw) - cos(yaw + theta)) / theta
+ * or, the same written without the division,
+ *   distance * sinc(theta / 2) * (cos, sin)(yaw + theta / 2)
+ * */
+void DrivebaseOdometry::integrate(double left, double right)
+{
+    const double distance = (left + right) / 2;
+    const double theta = (right - left) / wheelSpan;
+
+    double chord;
+    if (std::abs(theta) < SMALL_TURN)
+    {
+        chord = distance * (1 - theta * theta / 24);
+    }
+    else
+    {
+        chord = distance * std::sin(theta / 2) / (theta / 2);
+    }
+    const double heading = poseYaw + theta / 2;
+    poseX += chord * std::cos(heading);
+    poseY += chord * std::sin(heading);
+    poseYaw = normalize(poseYaw + theta);
+}
+
+void DrivebaseOdometry::setPose(double x, double y, double yaw)
+{
+    poseX = x;
+    poseY = y;
+    poseYaw = normalize(yaw);
+}
@@ -9,6 +9,9 @@
  *   ~odom_frame: The reference frame of odom  (string, default="odom")
  *   ~debug: print debugging info (bool, default: false)
  *   ~rate: how fast to process images
+ *   ~image_stamp: stamp the odometry with the time of the image instead of
+ *   when it was processed, for filters that apply late measurements at
+ *   their stamp, like planar_ekf (bool, default: false)
  * subscribed topics:
  *   image (sensor_msgs/Image) - the camera topic
  * published topics:
@@ -39,12 +42,14 @@ class FiducialOdom
         FiducialOdom(ros::NodeHandle& n, 
                 const std::string& f_frame, 
                 const std::string& b_frame,
-                const std::string& o_frame) :
+                const std::string& o_frame,
+                bool image_stamp) :
             aruco{"aruco_action_server", true},
             tf_manipulator{},
             footprint_frame{f_frame},
             bin_frame{b_frame},
             odometry_frame{o_frame},
+            image_stamp{image_stamp},
             reset_service{n.advertiseService("/reset_fusion", &FiducialOdom::resetFusion, this)}
         {
             rear_cam_client = n.serviceClient<tfr_msgs::WrappedImage>("/on_demand/rear_cam/image_raw");
@@ -134,6 +139,8 @@ class FiducialOdom
                 nav_msgs::Odometry odom;
                 odom.header.frame_id = odometry_frame;
                 odom.header.stamp = ros::Time::now();
+                if (image_stamp && !unprocessed_pose.header.stamp.isZero())
+                    odom.header.stamp = unprocessed_pose.header.stamp;
                 odom.child_frame_id = footprint_frame;
 
                 //get our pose and fudge some covariances
@@ -177,6 +184,7 @@ class FiducialOdom
         const std::string& footprint_frame;
         const std::string& bin_frame;
         const std::string& odometry_frame;
+        const bool image_stamp;
 
         tfr_msgs::ArucoResultConstPtr sendAruco(const tfr_msgs::WrappedImage& msg)
         {
@@ -198,13 +206,15 @@ int main(int argc, char** argv)
 
     std::string footprint_frame, bin_frame, odometry_frame;
     double rate;
+    bool image_stamp;
     ros::param::param<std::string>("~footprint_frame", footprint_frame, "footprint");
     ros::param::param<std::string>("~bin_frame", bin_frame, "bin_footprint");
     ros::param::param<std::string>("~odometry_frame", odometry_frame, "odom");
     ros::param::param<double>("~rate",rate, 10);
+    ros::param::param<bool>("~image_stamp", image_stamp, false);
 
     FiducialOdom fiducial_odom{n, footprint_frame, bin_frame,
-        odometry_frame};
+        odometry_frame, image_stamp};
 
     ros::Rate r(rate);
     while(ros::ok())
@@ -0,0 +1,171 @@
+/*
+ * Measures how long a tread count takes to come out of the drivebase
+ * odometry, to compare the two node chain (tread_distance_publisher and
+ * drivebase_odom_publisher with ~input distances) with the single node
+ * (drivebase_odom_publisher with ~input counts). See
+ * launch/odometry_latency_test.launch.
+ *
+ * Publishes counts that drive both treads straight ahead by the same
+ * number of ticks every sample, so the x of the odometry tells which sample
+ * it includes. The latency of a sample is the time from publishing its
+ * counts to receiving the first odometry that includes it. Publish
+ * the odometry on every update (~rate 0 of drivebase_odom_publisher) to
+ * measure the chain rather than its publish timer.
+ *
+ * Don't run it with the robot, it publishes the tread counts.
+ *
+ * PARAMETERS
+ *  ~samples: counts to send before reporting (int, default: 500)
+ *  ~stimulus_rate: counts per second (double, default: 50)
+ *  ~ticks_per_sample: ticks each tread moves per sample (int, default: 10)
+ *  ~wheelRadius, ~ticksPerRevolution: as given to the odometry (double,
+ *      default: 0.15, 2400)
+ *
+ * PUBLISHED TOPICS
+ *  /left_tread_count, /right_tread_count (std_msgs/Int32)
+ *
+ * SUBSCRIBED TOPICS
+ *  /drivebase_odom (nav_msgs/Odometry)
+ */
+#include <ros/ros.h>
+#include <nav_msgs/Odometry.h>
+#include <std_msgs/Int32.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+    /*
+     * Nearest rank percentile of sorted values.
+     * */
+    double percentile(const std::vector<double>& sorted, double p)
+    {
+        if (sorted.empty())
+            return 0;
+        const size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+        return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+    }
+
+    class OdometryLatencyTest
+    {
+    public:
+        OdometryLatencyTest(ros::NodeHandle& n, int samples, int ticks_per_sample,
+                double distance_per_sample) :
+            left_publisher{n.advertise<std_msgs::Int32>("/left_tread_count", 10)},
+            right_publisher{n.advertise<std_msgs::Int32>("/right_tread_count", 10)},
+            odometry_subscriber{n.subscribe("/drivebase_odom", 100,
+                    &OdometryLatencyTest::odometryReceived, this)},
+            samples{samples},
+            ticks_per_sample{ticks_per_sample},
+            distance_per_sample{distance_per_sample},
+            sent(samples + 1),
+            received(samples + 1, false),
+            next{0}
+        {
+        }
+        OdometryLatencyTest(const OdometryLatencyTest&) = delete;
+        OdometryLatencyTest& operator=(const OdometryLatencyTest&) = delete;
+        OdometryLatencyTest(OdometryLatencyTest&&) = delete;
+        OdometryLatencyTest& operator=(OdometryLatencyTest&&) = delete;
+
+        bool connected() const
+        {
+            return left_publisher.getNumSubscribers() > 0 && right_publisher.getNumSubscribers() > 0
+                && odometry_subscriber.getNumPublishers() > 0;
+        }
+
+        /*
+         * Sends the next sample, returns false once all are sent. Sample 0
+         * sets where the counts start.
+         * */
+        bool sendNext()
+        {
+            if (next > samples)
+                return false;
+            std_msgs::Int32 count;
+            count.data = next * ticks_per_sample;
+            sent[next] = ros::WallTime::now();
+            next++;
+            left_publisher.publish(count);
+            right_publisher.publish(count);
+            return true;
+        }
+
+        void report()
+        {
+            std::sort(latencies.begin(), latencies.end());
+            std::ostringstream text;
+            text << std::fixed << std::setprecision(2)
+                << "odometry latency over " << latencies.size() << " of " << samples
+                << " samples [ms]: p50 " << percentile(latencies, 50) * 1000
+                << ", p90 " << percentile(latencies, 90) * 1000
+                << ", p99 " << percentile(latencies, 99) * 1000
+                << ", max " << percentile(latencies, 100) * 1000;
+            ROS_INFO_STREAM(text.str());
+        }
+
+    private:
+        void odometryReceived(const nav_msgs::Odometry::ConstPtr& odometry)
+        {
+            const ros::WallTime now = ros::WallTime::now();
+            const int sample = static_cast<int>(std::round(odometry->pose.pose.position.x / distance_per_sample));
+            if (sample < 1 || sample >= next || received[sample])
+                return;
+            received[sample] = true;
+            latencies.push_back((now - sent[sample]).toSec());
+        }
+
+        ros::Publisher left_publisher, right_publisher;
+        ros::Subscriber odometry_subscriber;
+        const int samples;
+        const int ticks_per_sample;
+        const double distance_per_sample;
+        std::vector<ros::WallTime> sent;
+        std::vector<bool> received;
+        std::vector<double> latencies;
+        // the samples below next are sent, read by the callback thread
+        std::atomic<int> next;
+    };
+}
+
+int main(int argc, char** argv)
+{
+    ros::init(argc, argv, "odometry_latency_test");
+    ros::NodeHandle n;
+
+    int samples, ticks_per_sample;
+    double stimulus_rate, wheel_radius, ticks_per_revolution;
+    ros::param::param<int>("~samples", samples, 500);
+    ros::param::param<double>("~stimulus_rate", stimulus_rate, 50);
+    ros::param::param<int>("~ticks_per_sample", ticks_per_sample, 10);
+    ros::param::param<double>("~wheelRadius", wheel_radius, 0.15);
+    ros::param::param<double>("~ticksPerRevolution", ticks_per_revolution, 2400);
+
+    OdometryLatencyTest test{n, samples, ticks_per_sample,
+        2 * M_PI * wheel_radius * ticks_per_sample / ticks_per_revolution};
+
+    ros::AsyncSpinner spinner{1};
+    spinner.start();
+    while (ros::ok() && !test.connected())
+    {
+        ros::WallDuration(0.1).sleep();
+    }
+    // let the odometry see where the counts start
+    test.sendNext();
+    ros::WallDuration(0.5).sleep();
+
+    ros::WallRate rate{stimulus_rate};
+    while (ros::ok() && test.sendNext())
+    {
+        rate.sleep();
+    }
+    // the last odometry may still be on its way
+    ros::WallDuration(1.0).sleep();
+    spinner.stop();
+    test.report();
+    return 0;
+}
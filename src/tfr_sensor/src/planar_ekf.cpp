@@ -0,0 +1,176 @@
+#include "planar_ekf.h"
+#include <Eigen/LU>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    double normalizeAngle(double angle)
+    {
+        return std::atan2(std::sin(angle), std::cos(angle));
+    }
+}
+
+PlanarEkf::PlanarEkf(const Parameters& parameters) :
+    parameters(parameters),
+    x{State::Zero()},
+    P{parameters.initial_variance.asDiagonal()},
+    now{},
+    history{},
+    replay{},
+    rollbackCount{0},
+    droppedCount{0}
+{
+}
+
+bool PlanarEkf::add(const Measurement& measurement)
+{
+    if (now.isZero() || !(now > measurement.stamp))
+    {
+        apply(measurement);
+    }
+    else if (history.empty() || history.front().measurement.stamp > measurement.stamp)
+    {
+        // older than the history
+        droppedCount++;
+        return false;
+    }
+    else
+    {
+        // roll back to the last state before the measurement
+        replay.clear();
+        while (history.back().measurement.stamp > measurement.stamp)
+        {
+            replay.push_back(history.back().measurement);
+            history.pop_back();
+        }
+        rollbackCount++;
+        x = history.back().x;
+        P = history.back().P;
+        now = history.back().measurement.stamp;
+        apply(measurement);
+        for (auto it = replay.rbegin(); it != replay.rend(); ++it)
+            apply(*it);
+    }
+
+    const ros::Time oldest{std::max(0.0, now.toSec() - parameters.history_length)};
+    while (history.size() > 1 && oldest > history.front().measurement.stamp)
+        history.pop_front();
+    return true;
+}
+
+bool PlanarEkf::addTreads(const ros::Time& stamp, double v, double w, double vVariance, double wVariance)
+{
+    return add(Measurement{Sensor::TREADS, stamp, Eigen::Vector3d{v, w, 0},
+            Eigen::Vector3d{vVariance, wVariance, 0}});
+}
+
+bool PlanarEkf::addGyro(const ros::Time& stamp, double rate, double variance)
+{
+    return add(Measurement{Sensor::GYRO, stamp, Eigen::Vector3d{rate, 0, 0},
+            Eigen::Vector3d{variance, 0, 0}});
+}
+
+bool PlanarEkf::addFiducial(const ros::Time& stamp, double x, double y, double yaw,
+        double positionVariance, double yawVariance)
+{
+    return add(Measurement{Sensor::FIDUCIAL, stamp, Eigen::Vector3d{x, y, yaw},
+            Eigen::Vector3d{positionVariance, positionVariance, yawVariance}});
+}
+
+void PlanarEkf::reset(double x, double y, double yaw)
+{
+    this->x = State::Zero();
+    this->x(X) = x;
+    this->x(Y) = y;
+    this->x(YAW) = normalizeAngle(yaw);
+    P = parameters.initial_variance.asDiagonal();
+    history.clear();
+    // keep the time, so older measurements in flight don't roll it back
+}
+
+void PlanarEkf::apply(const Measurement& measurement)
+{
+    if (!now.isZero())
+        predict((measurement.stamp - now).toSec());
+    if (now.isZero() || measurement.stamp > now)
+        now = measurement.stamp;
+    correct(measurement);
+    history.push_back(Entry{measurement, x, P});
+}
+
+void PlanarEkf::predict(double dt)
+{
+    if (dt <= 0)
+        return;
+    const double c = std::cos(x(YAW));
+    const double s = std::sin(x(YAW));
+
+    Covariance F = Covariance::Identity();
+    F(X, YAW) = -x(V) * s * dt;
+    F(X, V) = c * dt;
+    F(Y, YAW) = x(V) * c * dt;
+    F(Y, V) = s * dt;
+    F(YAW, W) = dt;
+
+    x(X) += x(V) * c * dt;
+    x(Y) += x(V) * s * dt;
+    x(YAW) = normalizeAngle(x(YAW) + x(W) * dt);
+
+    P = F * P * F.transpose();
+    P.diagonal() += parameters.process_noise * dt;
+}
+
+void PlanarEkf::correct(const Measurement& measurement)
+{
+    switch (measurement.sensor)
+    {
+        case Sensor::TREADS:
+        {
+            Eigen::Matrix<double, 2, SIZE> H = Eigen::Matrix<double, 2, SIZE>::Zero();
+            H(0, V) = 1;
+            H(1, W) = 1;
+            const Eigen::Vector2d residual{measurement.value(0) - x(V), measurement.value(1) - x(W)};
+            correct<2>(residual, H, measurement.variance.head<2>());
+            break;
+        }
+        case Sensor::GYRO:
+        {
+            Eigen::Matrix<double, 1, SIZE> H = Eigen::Matrix<double, 1, SIZE>::Zero();
+            H(0, W) = 1;
+            H(0, GYRO_BIAS) = 1;
+            Eigen::Matrix<double, 1, 1> residual;
+            residual(0) = measurement.value(0) - x(W) - x(GYRO_BIAS);
+            correct<1>(residual, H, measurement.variance.head<1>());
+            break;
+        }
+        case Sensor::FIDUCIAL:
+        {
+            Eigen::Matrix<double, 3, SIZE> H = Eigen::Matrix<double, 3, SIZE>::Zero();
+            H(0, X) = 1;
+            H(1, Y) = 1;
+            H(2, YAW) = 1;
+            const Eigen::Vector3d residual{measurement.value(0) - x(X), measurement.value(1) - x(Y),
+                normalizeAngle(measurement.value(2) - x(YAW))};
+            correct<3>(residual, H, measurement.variance);
+            break;
+        }
+    }
+}
+
+template <int M>
+void PlanarEkf::correct(const Eigen::Matrix<double, M, 1>& residual,
+        const Eigen::Matrix<double, M, SIZE>& H,
+        const Eigen::Matrix<double, M, 1>& variance)
+{
+    typedef Eigen::Matrix<double, M, M> Innovation;
+    Innovation S = H * P * H.transpose();
+    S.diagonal() += variance;
+    const Eigen::Matrix<double, SIZE, M> K = P * H.transpose() * S.inverse();
+
+    x += K * residual;
+    x(YAW) = normalizeAngle(x(YAW));
+    // Joseph form, keeps P symmetric and positive
+    const Covariance IKH = Covariance::Identity() - K * H;
+    P = IKH * P * IKH.transpose() + K * variance.asDiagonal() * K.transpose();
+}
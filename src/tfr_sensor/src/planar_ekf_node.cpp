@@ -0,0 +1,243 @@
+/**
+ * Fuses the drivebase odometry, the IMU and the fiducials into the pose of
+ * the robot with PlanarEkf (planar_ekf.h), in place of the robot_localization
+ * ekf_localization_node of fusion.launch.
+ *
+ * It runs at the rate of the IMU: every gyroscope reading is an update of
+ * the filter, followed by the estimate and the transform. While the IMU is
+ * quiet for longer than ~imu_timeout the tread updates publish instead.
+ *
+ * parameters:
+ *   ~odom_frame: the frame the pose is in (string, default "odom")
+ *   ~base_frame: the frame of the robot (string, default "base_footprint")
+ *   ~publish_tf: publish the odom_frame -> base_frame transform (bool, default true)
+ *   ~odom_topic, ~imu_topic, ~fiducial_topic: the inputs (string, defaults
+ *   "/drivebase_odom", "/sensors/imu", "/fiducial_odom")
+ *   ~imu_timeout: s (double, default 0.1)
+ *   ~history_length: s, how late a measurement may come in (double, default 2.0)
+ *   ~process_noise: variance per second of x, y, yaw, v, w and the gyro bias
+ *   (double[6], default [0.05, 0.05, 0.06, 0.025, 0.02, 1e-4])
+ *   ~initial_variance: of the same (double[6], default [1e-9, 1e-9, 1e-9, 1e-2, 1e-2, 1e-2])
+ *   ~tread_variance, ~gyro_variance, ~fiducial_position_variance,
+ *   ~fiducial_yaw_variance: used when the message carries no covariance
+ *   (double, defaults 5e-2, 1e-4, 1e-1, 1e-1)
+ * subscribed topics:
+ *   ~odom_topic (nav_msgs/Odometry) - the twist of the treads and its covariance
+ *   ~imu_topic (sensor_msgs/Imu) - the yaw rate, counterclockwise positive
+ *   ~fiducial_topic (nav_msgs/Odometry) - the pose from the fiducials, in odom_frame
+ * published topics:
+ *   odometry/filtered (nav_msgs/Odometry) - the estimate, as robot_localization
+ *   /tf (odom_frame -> base_frame)
+ * services:
+ *   ~reset (tfr_msgs/SetOdometry) - starts the filter over at a pose
+ * */
+#include <ros/ros.h>
+#include <nav_msgs/Odometry.h>
+#include <sensor_msgs/Imu.h>
+#include <geometry_msgs/TransformStamped.h>
+#include <tfr_msgs/SetOdometry.h>
+#include <tf2_ros/transform_broadcaster.h>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "planar_ekf.h"
+
+class PlanarEkfNode
+{
+public:
+    PlanarEkfNode(ros::NodeHandle& n,
+            const PlanarEkf::Parameters& parameters,
+            const std::string& odomFrame,
+            const std::string& baseFrame,
+            bool publishTf,
+            double imuTimeout) :
+        ekf{parameters},
+        odomFrame{odomFrame},
+        baseFrame{baseFrame},
+        publishTf{publishTf},
+        imuTimeout{imuTimeout},
+        lastImu{}
+    {
+        ros::param::param<double>("~tread_variance", treadVariance, 5e-2);
+        ros::param::param<double>("~gyro_variance", gyroVariance, 1e-4);
+        ros::param::param<double>("~fiducial_position_variance", fiducialPositionVariance, 1e-1);
+        ros::param::param<double>("~fiducial_yaw_variance", fiducialYawVariance, 1e-1);
+
+        std::string odomTopic, imuTopic, fiducialTopic;
+        ros::param::param<std::string>("~odom_topic", odomTopic, "/drivebase_odom");
+        ros::param::param<std::string>("~imu_topic", imuTopic, "/sensors/imu");
+        ros::param::param<std::string>("~fiducial_topic", fiducialTopic, "/fiducial_odom");
+        // the filter keeps its own history, no need to queue up much
+        odomSub = n.subscribe(odomTopic, 15, &PlanarEkfNode::odomReceived, this);
+        imuSub = n.subscribe(imuTopic, 15, &PlanarEkfNode::imuReceived, this);
+        fiducialSub = n.subscribe(fiducialTopic, 5, &PlanarEkfNode::fiducialReceived, this);
+
+        publisher = n.advertise<nav_msgs::Odometry>("odometry/filtered", 15);
+        resetService = n.advertiseService("~reset", &PlanarEkfNode::reset, this);
+    }
+
+    ~PlanarEkfNode() = default;
+    PlanarEkfNode(const PlanarEkfNode&) = delete;
+    PlanarEkfNode& operator=(const PlanarEkfNode&) = delete;
+    PlanarEkfNode(PlanarEkfNode&&) = delete;
+    PlanarEkfNode& operator=(PlanarEkfNode&&) = delete;
+
+private:
+    PlanarEkf ekf;
+    const std::string& odomFrame;
+    const std::string& baseFrame;
+    const bool publishTf;
+    const double imuTimeout;
+    double treadVariance, gyroVariance, fiducialPositionVariance, fiducialYawVariance;
+    ros::Time lastImu;
+
+    ros::Subscriber odomSub, imuSub, fiducialSub;
+    ros::Publisher publisher;
+    ros::ServiceServer resetService;
+    tf2_ros::TransformBroadcaster broadcaster;
+
+    void odomReceived(const nav_msgs::Odometry::ConstPtr& msg)
+    {
+        const auto& covariance = msg->twist.covariance;
+        ekf.addTreads(msg->header.stamp, msg->twist.twist.linear.x, msg->twist.twist.angular.z,
+                covariance[0] > 0 ? covariance[0] : treadVariance,
+                covariance[35] > 0 ? covariance[35] : treadVariance);
+        if (lastImu.isZero() || (msg->header.stamp - lastImu).toSec() > imuTimeout)
+            publish();
+    }
+
+    void imuReceived(const sensor_msgs::Imu::ConstPtr& msg)
+    {
+        // a negative first element means no angular velocity, 0 an unknown covariance
+        const double variance = msg->angular_velocity_covariance[8];
+        if (msg->angular_velocity_covariance[0] < 0)
+            return;
+        lastImu = msg->header.stamp;
+        ekf.addGyro(msg->header.stamp, msg->angular_velocity.z,
+                variance > 0 ? variance : gyroVariance);
+        publish();
+    }
+
+    void fiducialReceived(const nav_msgs::Odometry::ConstPtr& msg)
+    {
+        const auto& covariance = msg->pose.covariance;
+        const double positionVariance = std::max(covariance[0], covariance[7]);
+        const double yawVariance = covariance[35];
+        if (!ekf.addFiducial(msg->header.stamp, msg->pose.pose.position.x, msg->pose.pose.position.y,
+                    quaternionToYaw(msg->pose.pose.orientation),
+                    positionVariance > 0 ? positionVariance : fiducialPositionVariance,
+                    yawVariance > 0 ? yawVariance : fiducialYawVariance))
+        {
+            ROS_WARN_THROTTLE(5.0, "planar ekf: dropped a fiducial %.2f s old",
+                    (ekf.stamp() - msg->header.stamp).toSec());
+        }
+    }
+
+    bool reset(tfr_msgs::SetOdometry::Request& request, tfr_msgs::SetOdometry::Response& response)
+    {
+        ekf.reset(request.pose.position.x, request.pose.position.y,
+                quaternionToYaw(request.pose.orientation));
+        return true;
+    }
+
+    /*
+     * Publishes the estimate at the latest measurement.
+     * */
+    void publish()
+    {
+        if (ekf.stamp().isZero())
+            return;
+        const PlanarEkf::State& state = ekf.state();
+        const PlanarEkf::Covariance& P = ekf.covariance();
+        const geometry_msgs::Quaternion orientation = yawToQuaternion(state(PlanarEkf::YAW));
+
+        nav_msgs::Odometry msg;
+        msg.header.stamp = ekf.stamp();
+        msg.header.frame_id = odomFrame;
+        msg.child_frame_id = baseFrame;
+        msg.pose.pose.position.x = state(PlanarEkf::X);
+        msg.pose.pose.position.y = state(PlanarEkf::Y);
+        msg.pose.pose.orientation = orientation;
+        msg.twist.twist.linear.x = state(PlanarEkf::V);
+        msg.twist.twist.angular.z = state(PlanarEkf::W);
+
+        // x, y and yaw of the pose are 0, 1 and 5 of the 6x6 covariance
+        const int pose[] = {PlanarEkf::X, PlanarEkf::Y, PlanarEkf::YAW};
+        const int index[] = {0, 1, 5};
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++)
+                msg.pose.covariance[index[i] * 6 + index[j]] = P(pose[i], pose[j]);
+        msg.twist.covariance[0] = P(PlanarEkf::V, PlanarEkf::V);
+        msg.twist.covariance[5] = P(PlanarEkf::V, PlanarEkf::W);
+        msg.twist.covariance[30] = P(PlanarEkf::W, PlanarEkf::V);
+        msg.twist.covariance[35] = P(PlanarEkf::W, PlanarEkf::W);
+        publisher.publish(msg);
+
+        if (publishTf)
+        {
+            geometry_msgs::TransformStamped transform;
+            transform.header = msg.header;
+            transform.child_frame_id = baseFrame;
+            transform.transform.translation.x = state(PlanarEkf::X);
+            transform.transform.translation.y = state(PlanarEkf::Y);
+            transform.transform.rotation = orientation;
+            broadcaster.sendTransform(transform);
+        }
+    }
+
+    static double quaternionToYaw(const geometry_msgs::Quaternion& q)
+    {
+        return std::atan2(2.0 * (q.w * q.z + q.x * q.y), 1.0 - 2.0 * (q.y * q.y + q.z * q.z));
+    }
+
+    static geometry_msgs::Quaternion yawToQuaternion(double yaw)
+    {
+        geometry_msgs::Quaternion q;
+        q.z = std::sin(yaw / 2);
+        q.w = std::cos(yaw / 2);
+        return q;
+    }
+};
+
+namespace
+{
+    /*
+     * Reads the 6 values of the state into vector, if the parameter is there.
+     * */
+    void stateParam(const std::string& name, PlanarEkf::State& vector)
+    {
+        std::vector<double> values;
+        if (!ros::param::get(name, values))
+            return;
+        if (values.size() != PlanarEkf::SIZE)
+        {
+            ROS_WARN("planar ekf: %s needs %d values, using the defaults", name.c_str(), PlanarEkf::SIZE);
+            return;
+        }
+        for (int i = 0; i < PlanarEkf::SIZE; i++)
+            vector(i) = values[i];
+    }
+}
+
+int main(int argc, char** argv)
+{
+    ros::init(argc, argv, "planar_ekf");
+    ros::NodeHandle n{};
+
+    std::string odomFrame, baseFrame;
+    bool publishTf;
+    double imuTimeout;
+    PlanarEkf::Parameters parameters;
+    ros::param::param<std::string>("~odom_frame", odomFrame, "odom");
+    ros::param::param<std::string>("~base_frame", baseFrame, "base_footprint");
+    ros::param::param<bool>("~publish_tf", publishTf, true);
+    ros::param::param<double>("~imu_timeout", imuTimeout, 0.1);
+    ros::param::param<double>("~history_length", parameters.history_length, parameters.history_length);
+    stateParam("~process_noise", parameters.process_noise);
+    stateParam("~initial_variance", parameters.initial_variance);
+
+    PlanarEkfNode node{n, parameters, odomFrame, baseFrame, publishTf, imuTimeout};
+    ros::spin();
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include "slip_estimator.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    /*
+     * Weight of a new sample dt after the last one in an exponential
+     * average over time_constant
+     * */
+    double smoothing(double dt, double time_constant)
+    {
+        if (time_constant <= 0)
+            return 1;
+        return 1 - std::exp(-std::max(dt, 0.0) / time_constant);
+    }
+}
+
+SlipEstimator::SlipEstimator(const Parameters& parameters) :
+    parameters(parameters),
+    gyroRate{0},
+    gyroStamp{},
+    yawResidualSquared{0},
+    linearSlipRatio{0},
+    treadStamp{},
+    treadX{0},
+    treadY{0},
+    treadYaw{0},
+    hasFix{false},
+    lastFix{}
+{
+}
+
+void SlipEstimator::addGyro(const ros::Time& stamp, double yawRate)
+{
+    if (gyroStamp.isZero() || (stamp - gyroStamp).toSec() > parameters.gyro_timeout)
+    {
+        gyroRate = yawRate;
+    }
+    else
+    {
+        gyroRate += smoothing((stamp - gyroStamp).toSec(), parameters.gyro_time_constant)
+            * (yawRate - gyroRate);
+    }
+    gyroStamp = stamp;
+}
+
+void SlipEstimator::addTreads(const ros::Time& stamp, double linear, double angular)
+{
+    const double dt = treadStamp.isZero() ? 0 : (stamp - treadStamp).toSec();
+    const bool gyroFresh = !gyroStamp.isZero()
+        && std::abs((stamp - gyroStamp).toSec()) <= parameters.gyro_timeout;
+    if (gyroFresh && dt > 0)
+    {
+        const double residual = angular - gyroRate;
+        yawResidualSquared += smoothing(dt, parameters.yaw_time_constant)
+            * (residual * residual - yawResidualSquared);
+    }
+    if (dt > 0)
+    {
+        linearSlipRatio *= 1 - smoothing(dt, parameters.linear_time_constant);
+        const double heading = treadYaw + angular * dt / 2;
+        treadX += linear * std::cos(heading) * dt;
+        treadY += linear * std::sin(heading) * dt;
+        treadYaw += angular * dt;
+    }
+    if (dt >= 0)
+    {
+        treadStamp = stamp;
+    }
+}
+
+void SlipEstimator::addFiducial(const ros::Time& stamp, double x, double y)
+{
+    const Fix fix{stamp, x, y, treadX, treadY};
+    if (!hasFix)
+    {
+        hasFix = true;
+        lastFix = fix;
+        return;
+    }
+
+    const double interval = (stamp - lastFix.stamp).toSec();
+    if (interval <= 0 || interval > parameters.max_fiducial_interval)
+    {
+        lastFix = fix;
+        return;
+    }
+    const double treadDistance = std::hypot(fix.treadX - lastFix.treadX, fix.treadY - lastFix.treadY);
+    const double fiducialDistance = std::hypot(fix.x - lastFix.x, fix.y - lastFix.y);
+    // wait until the robot moved far enough for the fixes to tell
+    if (std::max(treadDistance, fiducialDistance) < parameters.min_fiducial_distance)
+        return;
+
+    const double error = std::abs(treadDistance - fiducialDistance) / std::max(treadDistance, fiducialDistance);
+    linearSlipRatio += parameters.fiducial_weight * (error - linearSlipRatio);
+    lastFix = fix;
+}
+
+double SlipEstimator::yawRateError() const
+{
+    return std::sqrt(yawResidualSquared);
+}
+
+double SlipEstimator::linearVariance(double speed) const
+{
+    const double error = linearSlipRatio * speed;
+    return std::min(parameters.max_variance, parameters.base_linear_variance + error * error);
+}
+
+double SlipEstimator::angularVariance() const
+{
+    return std::min(parameters.max_variance, parameters.base_angular_variance + yawResidualSquared);
+}
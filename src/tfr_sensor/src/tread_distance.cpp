@@ -0,0 +1,36 @@
+#include "tread_distance_publisher.h"
+#include <cmath>
+
+namespace
+{
+    tfr_utilities::TickUnwrapper::Parameters signedCounter(const int maxTicks)
+    {
+        tfr_utilities::TickUnwrapper::Parameters parameters;
+        parameters.min_count = -static_cast<int64_t>(maxTicks) - 1;
+        parameters.max_count = maxTicks;
+        return parameters;
+    }
+}
+
+TreadDistance::TreadDistance(const int ticksPerRevolution, const int maxTicks, const double wheelRadius, const int prevTickCount) :
+    distanceTraveled{ 0 }, ticksPerRevolution{ ticksPerRevolution }, maxTicks{ maxTicks }, wheelCircumference{ wheelRadius * 2 * M_PI},
+    ticks{ signedCounter(maxTicks) }
+{
+    ticks.update(prevTickCount);
+}
+
+void TreadDistance::updateFromNewCount(const int newCount) {
+    auto ticksMoved = calcTickDiff(newCount);
+    distanceTraveled = (wheelCircumference * ticksMoved) / ticksPerRevolution;
+}
+
+double TreadDistance::totalDistance() const {
+    return (wheelCircumference * ticks.position()) / ticksPerRevolution;
+}
+
+
+int64_t TreadDistance::calcTickDiff(const int newCount) {
+    // the difference modulo the counter range, so a rollover past maxTicks is
+    // a small step, and a recentered or reset counter does not spike
+    return ticks.update(newCount).delta;
+}
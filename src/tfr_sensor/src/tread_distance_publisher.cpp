@@ -6,23 +6,6 @@
 #include "tread_distance_publisher.h"
 #include <cmath>
 
-TreadDistance::TreadDistance(const int ticksPerRevolution, const int maxTicks, const double wheelRadius, const int prevTickCount) :
-    distanceTraveled{ 0 }, prevTickCount{ prevTickCount }, ticksPerRevolution{ ticksPerRevolution }, maxTicks{ maxTicks }, wheelCircumference{ wheelRadius * 2 * M_PI} {}
-
-void TreadDistance::updateFromNewCount(const int newCount) {
-    auto ticksMoved = calcTickDiff(newCount);
-    distanceTraveled = (wheelCircumference * ticksMoved) / ticksPerRevolution;
-    prevTickCount = newCount;
-}
-
-
-int TreadDistance::calcTickDiff(const int newCount) {
-    //TODO: handle rollover from going past maxTicks
-
-    // otherwise its a simple difference
-    return newCount - prevTickCount;
-}
-
 int main(int argc, char** argv) {
     ros::init(argc, argv, "tread_distance_publisher");
     ros::NodeHandle n; //NodeHandle is the main access point to communications with the ROS system.
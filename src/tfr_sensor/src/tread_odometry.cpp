@@ -0,0 +1,83 @@
+#include "tread_odometry.h"
+
+TreadOdometry::TreadOdometry(double wheelSpan, int ticksPerRevolution, int maxTicks, double wheelRadius) :
+    leftTread{ticksPerRevolution, maxTicks, wheelRadius},
+    rightTread{ticksPerRevolution, maxTicks, wheelRadius},
+    left{0, ros::Time{}, false, false},
+    right{0, ros::Time{}, false, false},
+    pose{wheelSpan}
+{
+}
+
+bool TreadOdometry::addLeftCount(const ros::Time& stamp, int count)
+{
+    leftTread.updateFromNewCount(count);
+    if (!left.counted)
+    {
+        left.counted = true;
+        // both treads know where they start, the odometry starts now
+        if (right.counted)
+        {
+            pose.update(stamp, 0, 0);
+            return true;
+        }
+        return false;
+    }
+    return addLeftDistance(stamp, leftTread.distanceTraveled);
+}
+
+bool TreadOdometry::addRightCount(const ros::Time& stamp, int count)
+{
+    rightTread.updateFromNewCount(count);
+    if (!right.counted)
+    {
+        right.counted = true;
+        // both treads know where they start, the odometry starts now
+        if (left.counted)
+        {
+            pose.update(stamp, 0, 0);
+            return true;
+        }
+        return false;
+    }
+    return addRightDistance(stamp, rightTread.distanceTraveled);
+}
+
+bool TreadOdometry::addLeftDistance(const ros::Time& stamp, double distance)
+{
+    return add(left, right, stamp, distance);
+}
+
+bool TreadOdometry::addRightDistance(const ros::Time& stamp, double distance)
+{
+    return add(right, left, stamp, distance);
+}
+
+bool TreadOdometry::add(Side& side, const Side& other, const ros::Time& stamp, double distance)
+{
+    bool updated = false;
+    // the other tread missed a reading, don't hold this one back
+    if (side.pending)
+    {
+        integratePending();
+        updated = true;
+    }
+    side.distance = distance;
+    side.stamp = stamp;
+    side.pending = true;
+    if (other.pending)
+    {
+        integratePending();
+        updated = true;
+    }
+    return updated;
+}
+
+void TreadOdometry::integratePending()
+{
+    const ros::Time& stamp = (left.pending && (!right.pending || left.stamp > right.stamp))
+        ? left.stamp : right.stamp;
+    pose.update(stamp, left.pending ? left.distance : 0, right.pending ? right.distance : 0);
+    left.pending = false;
+    right.pending = false;
+}
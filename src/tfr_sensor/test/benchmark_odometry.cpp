@@ -0,0 +1,393 @@
+/**
+ * benchmark_odometry.cpp
+ *
+ * Offline accuracy and throughput benchmark of the drivebase odometry: the
+ * counts of the tread encoders are generated from known trajectories and
+ * fed through TreadOdometry (TreadDistance and DrivebaseOdometry), as the
+ * drivebase_odom_publisher does, without any nodes running.
+ *
+ * Trajectories, driven from the origin:
+ *  - straight: both treads at the same speed
+ *  - arc: a constant turn
+ *  - spin: the treads in opposite directions, turning in place
+ *  - s_curve: constant speed, the turn rate swinging from side to side
+ *
+ * The encoders are quantized to whole ticks and start near the top of the
+ * counter so it rolls over. They are read at ~rate Hz, each reading jittered
+ * by up to ~jitter of the period, and each reading of a tread is dropped
+ * with probability ~drop_probability, as a lost message.
+ *
+ * For each trajectory it reports:
+ *  - drift: the final position error per metre the treads moved (the mean
+ *    of the distances of the two treads, so spinning in place counts too)
+ *  - heading error: final and largest along the way, rad
+ *  - ns of processing per reading
+ * and fails if the drift or the heading error is beyond its limit. The
+ * results are recorded as properties of the test as well. The cost depends
+ * on the machine, so it has no fixed limit, it is only compared with a
+ * baseline run on the same machine.
+ *
+ * Parameters (odometry_benchmark.test):
+ *  - ~rate: readings per second of each tread (double, default 1000)
+ *  - ~jitter: of the reading times, fraction of the period (double, default 0.2)
+ *  - ~drop_probability: of each reading (double, default 0.01)
+ *  - ~seed: of the jitter and drops (int, default 42)
+ *  - ~wheel_span, ~ticksPerRevolution, ~maxTicks, ~wheelRadius: the
+ *    drivebase, see drivebase_odom_publisher
+ *  - ~<trajectory>/max_drift: m per m (double, default 0.01)
+ *  - ~<trajectory>/max_heading_error: rad (double, default 0.02)
+ *  - ~baseline_path, ~results_path, ~tolerance: compare with an earlier run,
+ *    as benchmark_control_cycle in tfr_control. The file has one line per
+ *    trajectory: "<trajectory> <drift> <heading_error> <ns_per_sample>".
+ */
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+#include "tread_odometry.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    // the truth is integrated in steps this long, s
+    const double TRUTH_STEP = 1e-5;
+    const double START = 1000;
+
+    struct Drivebase
+    {
+        double wheelSpan;
+        int ticksPerRevolution;
+        int maxTicks;
+        double wheelRadius;
+    };
+
+    /*
+     * The speeds of the treads over time, m/s
+     * */
+    struct Trajectory
+    {
+        std::string name;
+        double duration;
+        std::function<void(double t, double& left, double& right)> speeds;
+    };
+
+    struct Pose
+    {
+        double x, y, yaw;
+    };
+
+    /*
+     * A reading of the counter of one tread, and where the robot really was.
+     * */
+    struct Sample
+    {
+        ros::Time stamp;
+        bool left;
+        int count;
+        Pose truth;
+    };
+
+    struct Results
+    {
+        double distance = 0;
+        double drift = 0;
+        double heading_error = 0;
+        double max_heading_error = 0;
+        double ns_per_sample = 0;
+        size_t samples = 0;
+    };
+
+    double angleDifference(double a, double b)
+    {
+        return std::atan2(std::sin(a - b), std::cos(a - b));
+    }
+
+    /*
+     * The counter reading at ticks from where it started, wrapped as the
+     * motor controller does.
+     * */
+    int wrap(int64_t ticks, int maxTicks)
+    {
+        const int64_t range = static_cast<int64_t>(maxTicks) * 2 + 2;
+        int64_t offset = (ticks + maxTicks + 1) % range;
+        if (offset < 0)
+            offset += range;
+        return static_cast<int>(offset - maxTicks - 1);
+    }
+
+    /*
+     * Drives the trajectory in small steps, along exact arcs, and reads the
+     * encoders along the way.
+     * */
+    std::vector<Sample> generate(const Trajectory& trajectory, const Drivebase& drivebase,
+            double rate, double jitter, double dropProbability, std::mt19937& random)
+    {
+        const double metersPerTick = 2 * M_PI * drivebase.wheelRadius / drivebase.ticksPerRevolution;
+        // close to the top of the counter, so it rolls over early
+        const int64_t startTicks = static_cast<int64_t>(drivebase.maxTicks) - 1000;
+
+        std::uniform_real_distribution<double> jitterDistribution{-jitter, jitter};
+        std::bernoulli_distribution drop{dropProbability};
+
+        std::vector<Sample> samples;
+        samples.reserve(static_cast<size_t>(2 * rate * trajectory.duration) + 2);
+        Pose pose{0, 0, 0};
+        double leftDistance = 0, rightDistance = 0;
+        double t = 0;
+        const double period = 1 / rate;
+        for (int k = 0; ; k++)
+        {
+            const double readTime = (k == 0) ? 0 : (k + jitterDistribution(random)) * period;
+            if (readTime > trajectory.duration)
+                break;
+            while (t < readTime)
+            {
+                const double dt = std::min(TRUTH_STEP, readTime - t);
+                double vLeft, vRight;
+                trajectory.speeds(t + dt / 2, vLeft, vRight);
+                const double v = (vLeft + vRight) / 2;
+                const double w = (vRight - vLeft) / drivebase.wheelSpan;
+                if (std::abs(w * dt) < 1e-12)
+                {
+                    pose.x += v * dt * std::cos(pose.yaw);
+                    pose.y += v * dt * std::sin(pose.yaw);
+                }
+                else
+                {
+                    pose.x += v / w * (std::sin(pose.yaw + w * dt) - std::sin(pose.yaw));
+                    pose.y -= v / w * (std::cos(pose.yaw + w * dt) - std::cos(pose.yaw));
+                }
+                pose.yaw += w * dt;
+                leftDistance += vLeft * dt;
+                rightDistance += vRight * dt;
+                t += dt;
+            }
+
+            const ros::Time stamp{START + readTime};
+            const int64_t leftTicks = static_cast<int64_t>(std::floor(leftDistance / metersPerTick));
+            const int64_t rightTicks = static_cast<int64_t>(std::floor(rightDistance / metersPerTick));
+            // the first readings set where the counters start, never drop them
+            if (k == 0 || !drop(random))
+                samples.push_back(Sample{stamp, true, wrap(startTicks + leftTicks, drivebase.maxTicks), pose});
+            if (k == 0 || !drop(random))
+                samples.push_back(Sample{stamp, false, wrap(startTicks + rightTicks, drivebase.maxTicks), pose});
+        }
+        return samples;
+    }
+
+    double trackDistance(const Trajectory& trajectory)
+    {
+        double distance = 0;
+        for (double t = 0; t < trajectory.duration; t += TRUTH_STEP)
+        {
+            const double dt = std::min(TRUTH_STEP, trajectory.duration - t);
+            double vLeft, vRight;
+            trajectory.speeds(t + dt / 2, vLeft, vRight);
+            distance += (std::abs(vLeft) + std::abs(vRight)) / 2 * dt;
+        }
+        return distance;
+    }
+
+    bool add(TreadOdometry& odometry, const Sample& sample)
+    {
+        return sample.left ? odometry.addLeftCount(sample.stamp, sample.count)
+            : odometry.addRightCount(sample.stamp, sample.count);
+    }
+
+    Results measure(const Trajectory& trajectory, const Drivebase& drivebase,
+            const std::vector<Sample>& samples)
+    {
+        Results results;
+        results.samples = samples.size();
+        results.distance = trackDistance(trajectory);
+
+        // accuracy, against the truth after every update
+        {
+            TreadOdometry odometry{drivebase.wheelSpan, drivebase.ticksPerRevolution,
+                drivebase.maxTicks, drivebase.wheelRadius};
+            for (const Sample& sample : samples)
+            {
+                if (add(odometry, sample))
+                {
+                    const double error = std::abs(angleDifference(odometry.odometry().yaw(), sample.truth.yaw));
+                    results.max_heading_error = std::max(results.max_heading_error, error);
+                }
+            }
+            const Pose& truth = samples.back().truth;
+            const DrivebaseOdometry& pose = odometry.odometry();
+            results.drift = std::hypot(pose.x() - truth.x, pose.y() - truth.y) / results.distance;
+            results.heading_error = std::abs(angleDifference(pose.yaw(), truth.yaw));
+        }
+
+        // processing cost, nothing else in the loop
+        {
+            TreadOdometry odometry{drivebase.wheelSpan, drivebase.ticksPerRevolution,
+                drivebase.maxTicks, drivebase.wheelRadius};
+            size_t updates = 0;
+            const Clock::time_point start = Clock::now();
+            for (const Sample& sample : samples)
+            {
+                updates += add(odometry, sample);
+            }
+            const Clock::time_point end = Clock::now();
+            results.ns_per_sample = static_cast<double>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()) / samples.size();
+            // keep the loop from being optimized away
+            EXPECT_GT(updates, 0u);
+        }
+        return results;
+    }
+
+    std::map<std::string, Results> loadBaseline(const std::string& path)
+    {
+        std::map<std::string, Results> baseline;
+        if (path.empty())
+        {
+            return baseline;
+        }
+        std::ifstream file{path};
+        if (!file)
+        {
+            ROS_WARN("odometry benchmark: no baseline at %s", path.c_str());
+            return baseline;
+        }
+        std::string name;
+        Results entry;
+        while (file >> name >> entry.drift >> entry.heading_error >> entry.ns_per_sample)
+        {
+            baseline[name] = entry;
+        }
+        return baseline;
+    }
+
+    void saveResults(const std::string& name, const Results& results)
+    {
+        std::string path;
+        ros::param::param<std::string>("~results_path", path, "");
+        if (path.empty())
+        {
+            return;
+        }
+        // the tests run one after the other, each adds its line
+        std::ofstream file{path, std::ios::app};
+        file << name << " " << results.drift << " " << results.heading_error << " "
+            << results.ns_per_sample << "\n";
+    }
+
+    /*
+     * Runs the trajectory and checks the results against the limits and
+     * the baseline.
+     * */
+    void benchmark(const Trajectory& trajectory)
+    {
+        double rate, jitter, dropProbability, wheelSpan, ticksPerRevolution, maxTicks, wheelRadius;
+        double maxDrift, maxHeadingError, tolerance;
+        int seed;
+        std::string baselinePath;
+        ros::param::param<double>("~rate", rate, 1000);
+        ros::param::param<double>("~jitter", jitter, 0.2);
+        ros::param::param<double>("~drop_probability", dropProbability, 0.01);
+        ros::param::param<int>("~seed", seed, 42);
+        ros::param::param<double>("~wheel_span", wheelSpan, 0.74);
+        ros::param::param<double>("~ticksPerRevolution", ticksPerRevolution, 2400);
+        ros::param::param<double>("~maxTicks", maxTicks, INT_MAX);
+        ros::param::param<double>("~wheelRadius", wheelRadius, 0.15);
+        ros::param::param<double>("~" + trajectory.name + "/max_drift", maxDrift, 0.01);
+        ros::param::param<double>("~" + trajectory.name + "/max_heading_error", maxHeadingError, 0.02);
+        ros::param::param<std::string>("~baseline_path", baselinePath, "");
+        ros::param::param<double>("~tolerance", tolerance, 0.25);
+        ASSERT_GT(rate, 0);
+        ASSERT_LT(jitter, 0.5) << "the readings would come out of order";
+
+        const Drivebase drivebase{wheelSpan, static_cast<int>(ticksPerRevolution),
+            static_cast<int>(maxTicks), wheelRadius};
+        std::mt19937 random{static_cast<std::mt19937::result_type>(seed)};
+        const std::vector<Sample> samples = generate(trajectory, drivebase, rate, jitter,
+                dropProbability, random);
+        const Results results = measure(trajectory, drivebase, samples);
+
+        ROS_INFO("odometry benchmark, %s, %.1f m at %.0f Hz, %zu readings:",
+                trajectory.name.c_str(), results.distance, rate, results.samples);
+        ROS_INFO("  drift %.2e m/m, heading error %.2e rad (largest %.2e)",
+                results.drift, results.heading_error, results.max_heading_error);
+        ROS_INFO("  %.0f ns per reading", results.ns_per_sample);
+
+        ::testing::Test::RecordProperty("drift", std::to_string(results.drift));
+        ::testing::Test::RecordProperty("heading_error", std::to_string(results.heading_error));
+        ::testing::Test::RecordProperty("max_heading_error", std::to_string(results.max_heading_error));
+        ::testing::Test::RecordProperty("ns_per_sample", std::to_string(results.ns_per_sample));
+        saveResults(trajectory.name, results);
+
+        EXPECT_LE(results.drift, maxDrift);
+        EXPECT_LE(results.max_heading_error, maxHeadingError);
+
+        const std::map<std::string, Results> baseline = loadBaseline(baselinePath);
+        const auto entry = baseline.find(trajectory.name);
+        if (entry != baseline.end())
+        {
+            ROS_INFO("  baseline drift %.2e m/m, heading error %.2e rad, %.0f ns per reading",
+                    entry->second.drift, entry->second.heading_error, entry->second.ns_per_sample);
+            // the accuracy is deterministic for a seed, allow for rounding only
+            EXPECT_LE(results.drift, entry->second.drift * (1 + tolerance) + 1e-9)
+                << "the drift regressed from the baseline";
+            EXPECT_LE(results.heading_error, entry->second.heading_error * (1 + tolerance) + 1e-9)
+                << "the heading error regressed from the baseline";
+            EXPECT_LE(results.ns_per_sample, entry->second.ns_per_sample * (1 + tolerance))
+                << "the processing cost regressed from the baseline";
+        }
+    }
+}
+
+TEST(OdometryBenchmark, Straight)
+{
+    benchmark(Trajectory{"straight", 30, [](double t, double& left, double& right)
+            {
+                left = 0.5;
+                right = 0.5;
+            }});
+}
+
+TEST(OdometryBenchmark, Arc)
+{
+    benchmark(Trajectory{"arc", 30, [](double t, double& left, double& right)
+            {
+                left = 0.3;
+                right = 0.5;
+            }});
+}
+
+TEST(OdometryBenchmark, Spin)
+{
+    benchmark(Trajectory{"spin", 20, [](double t, double& left, double& right)
+            {
+                left = -0.3;
+                right = 0.3;
+            }});
+}
+
+TEST(OdometryBenchmark, SCurve)
+{
+    benchmark(Trajectory{"s_curve", 40, [](double t, double& left, double& right)
+            {
+                const double turn = 0.2 * std::sin(2 * M_PI * t / 10);
+                left = 0.4 - turn;
+                right = 0.4 + turn;
+            }});
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    ros::init(argc, argv, "odometry_benchmark");
+    return RUN_ALL_TESTS();
+}
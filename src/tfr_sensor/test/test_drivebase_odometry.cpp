@@ -0,0 +1,202 @@
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+#include "drivebase_odometry.h"
+#include "tread_odometry.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    const double WHEEL_SPAN = 0.74;
+
+    /*
+     * Drives at constant tread speeds for duration seconds, in steps of the
+     * given lengths, repeated until the duration is covered.
+     * */
+    void drive(DrivebaseOdometry& odometry, ros::Time& now, double vLeft, double vRight,
+            double duration, const std::vector<double>& steps)
+    {
+        double elapsed = 0;
+        for (size_t i = 0; elapsed < duration; i = (i + 1) % steps.size())
+        {
+            const double dt = std::min(steps[i], duration - elapsed);
+            now += ros::Duration(dt);
+            odometry.update(now, vLeft * dt, vRight * dt);
+            elapsed += dt;
+        }
+    }
+
+    double angleDifference(double a, double b)
+    {
+        return std::atan2(std::sin(a - b), std::cos(a - b));
+    }
+}
+
+TEST(DrivebaseOdometry, StraightLine)
+{
+    DrivebaseOdometry odometry{WHEEL_SPAN};
+    odometry.setPose(1, 2, M_PI / 6);
+    ros::Time now{100};
+    odometry.update(now, 0, 0);
+    drive(odometry, now, 0.4, 0.4, 10, {0.01, 0.2, 0.031, 1.0});
+
+    EXPECT_NEAR(odometry.x(), 1 + 4 * std::cos(M_PI / 6), 1e-9);
+    EXPECT_NEAR(odometry.y(), 2 + 4 * std::sin(M_PI / 6), 1e-9);
+    EXPECT_NEAR(odometry.yaw(), M_PI / 6, 1e-12);
+    EXPECT_NEAR(odometry.linearVelocity(), 0.4, 1e-9);
+    EXPECT_NEAR(odometry.angularVelocity(), 0, 1e-9);
+}
+
+TEST(DrivebaseOdometry, SpinInPlace)
+{
+    DrivebaseOdometry odometry{WHEEL_SPAN};
+    ros::Time now{100};
+    odometry.update(now, 0, 0);
+    drive(odometry, now, -0.3, 0.3, 7, {0.05, 0.5});
+
+    const double rate = 0.6 / WHEEL_SPAN;
+    EXPECT_NEAR(odometry.x(), 0, 1e-12);
+    EXPECT_NEAR(odometry.y(), 0, 1e-12);
+    EXPECT_NEAR(angleDifference(odometry.yaw(), rate * 7), 0, 1e-9);
+    EXPECT_NEAR(odometry.angularVelocity(), rate, 1e-9);
+}
+
+/*
+ * Constant tread speeds drive a circle, which the arcs follow exactly no
+ * matter how coarse or irregular the updates are.
+ * */
+TEST(DrivebaseOdometry, CircleIsExactForAnyStep)
+{
+    const double vLeft = 0.2, vRight = 0.5;
+    const double rate = (vRight - vLeft) / WHEEL_SPAN;
+    const double radius = (vLeft + vRight) / 2 / rate;
+
+    for (const std::vector<double>& steps : std::vector<std::vector<double>>{
+            {0.001}, {0.03125}, {0.5}, {2.0}, {0.013, 0.4, 0.07, 1.3}})
+    {
+        DrivebaseOdometry odometry{WHEEL_SPAN};
+        ros::Time now{100};
+        odometry.update(now, 0, 0);
+        const double duration = 20;
+        drive(odometry, now, vLeft, vRight, duration, steps);
+
+        const double yaw = rate * duration;
+        EXPECT_NEAR(odometry.x(), radius * std::sin(yaw), 1e-9);
+        EXPECT_NEAR(odometry.y(), radius * (1 - std::cos(yaw)), 1e-9);
+        EXPECT_NEAR(angleDifference(odometry.yaw(), yaw), 0, 1e-9);
+        EXPECT_NEAR(odometry.linearVelocity(), (vLeft + vRight) / 2, 1e-9);
+        EXPECT_NEAR(odometry.angularVelocity(), rate, 1e-9);
+    }
+}
+
+/*
+ * Turns so slight the small angle series is used still end up on the
+ * circle.
+ * */
+TEST(DrivebaseOdometry, GentleCurve)
+{
+    const double vLeft = 0.5, vRight = 0.5 + 1e-5;
+    const double rate = (vRight - vLeft) / WHEEL_SPAN;
+    const double radius = (vLeft + vRight) / 2 / rate;
+
+    DrivebaseOdometry odometry{WHEEL_SPAN};
+    ros::Time now{100};
+    odometry.update(now, 0, 0);
+    drive(odometry, now, vLeft, vRight, 30, {0.01});
+
+    const double yaw = rate * 30;
+    EXPECT_NEAR(odometry.x(), radius * std::sin(yaw), 1e-9);
+    EXPECT_NEAR(odometry.y(), radius * (1 - std::cos(yaw)), 1e-9);
+}
+
+/*
+ * When the curvature changes between updates the arcs are an
+ * approximation, whose error shrinks with the square of the step.
+ * */
+TEST(DrivebaseOdometry, ChangingCurvatureConvergesQuadratically)
+{
+    // the left tread speeds up linearly, the closed form is a Fresnel
+    // integral, so compare against a very fine integration instead
+    auto endPose = [](double step, double& x, double& y)
+    {
+        DrivebaseOdometry odometry{WHEEL_SPAN};
+        ros::Time now{100};
+        odometry.update(now, 0, 0);
+        const int steps = static_cast<int>(std::round(4 / step));
+        for (int i = 0; i < steps; i++)
+        {
+            const double t0 = i * step, t1 = (i + 1) * step;
+            // distance of v = 0.1 + 0.1 t over [t0, t1]
+            const double left = 0.1 * (t1 - t0) + 0.05 * (t1 * t1 - t0 * t0);
+            now += ros::Duration(step);
+            odometry.update(now, left, 0.4 * step);
+        }
+        x = odometry.x();
+        y = odometry.y();
+    };
+
+    double xRef, yRef;
+    endPose(1e-5, xRef, yRef);
+    double x, y;
+    endPose(0.1, x, y);
+    const double coarse = std::hypot(x - xRef, y - yRef);
+    endPose(0.05, x, y);
+    const double fine = std::hypot(x - xRef, y - yRef);
+
+    EXPECT_LT(coarse, 1e-3);
+    EXPECT_GT(coarse / fine, 3.5);
+}
+
+TEST(DrivebaseOdometry, OutOfOrderUpdateKeepsTime)
+{
+    DrivebaseOdometry odometry{WHEEL_SPAN};
+    odometry.update(ros::Time{100}, 0, 0);
+    odometry.update(ros::Time{101}, 0.5, 0.5);
+    odometry.update(ros::Time{100.5}, 0.5, 0.5);
+
+    EXPECT_NEAR(odometry.x(), 1, 1e-12);
+    EXPECT_EQ(odometry.stamp(), ros::Time{101});
+    EXPECT_NEAR(odometry.linearVelocity(), 0.5, 1e-12);
+}
+
+/*
+ * Counts go in one tread at a time, each pair is one arc.
+ * */
+TEST(TreadOdometry, PairsTreadCounts)
+{
+    // a tick is 0.1 m
+    TreadOdometry treads{WHEEL_SPAN, 10, 1 << 30, 1 / (2 * M_PI)};
+    EXPECT_FALSE(treads.addLeftCount(ros::Time{100}, 500));
+    EXPECT_TRUE(treads.addRightCount(ros::Time{100}, -20));
+    EXPECT_NEAR(treads.odometry().x(), 0, 1e-12);
+
+    EXPECT_FALSE(treads.addLeftCount(ros::Time{101}, 504));
+    EXPECT_TRUE(treads.addRightCount(ros::Time{101.01}, -16));
+    EXPECT_NEAR(treads.odometry().x(), 0.4, 1e-9);
+    EXPECT_EQ(treads.odometry().stamp(), ros::Time{101.01});
+    EXPECT_NEAR(treads.odometry().linearVelocity(), 0.4 / 1.01, 1e-9);
+}
+
+/*
+ * A tread that misses a reading doesn't hold back the other.
+ * */
+TEST(TreadOdometry, MissedReading)
+{
+    TreadOdometry treads{WHEEL_SPAN, 10, 1 << 30, 1 / (2 * M_PI)};
+    treads.addLeftDistance(ros::Time{100}, 0);
+    treads.addRightDistance(ros::Time{100}, 0);
+
+    EXPECT_FALSE(treads.addLeftDistance(ros::Time{101}, 0.2));
+    EXPECT_TRUE(treads.addLeftDistance(ros::Time{102}, 0.2));
+    EXPECT_NEAR(treads.odometry().yaw(), -0.2 / WHEEL_SPAN, 1e-12);
+    // pairs with the second left reading, straight ahead
+    EXPECT_TRUE(treads.addRightDistance(ros::Time{102}, 0.2));
+    EXPECT_NEAR(treads.odometry().yaw(), -0.2 / WHEEL_SPAN, 1e-12);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
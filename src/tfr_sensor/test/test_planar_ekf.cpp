@@ -0,0 +1,172 @@
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+#include "planar_ekf.h"
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+    const double START = 100;
+    const double IMU_PERIOD = 0.005;
+    const double TREAD_VARIANCE = 1e-3;
+    const double GYRO_VARIANCE = 1e-4;
+
+    /*
+     * Drives the robot at v and w, the IMU at 200 Hz with its bias and
+     * the treads at 50 Hz, and returns the true pose at the end.
+     * */
+    struct Drive
+    {
+        double x = 0, y = 0, yaw = 0;
+        double t = START;
+
+        void run(PlanarEkf& ekf, double v, double w, double bias, double duration)
+        {
+            const int steps = static_cast<int>(std::round(duration / IMU_PERIOD));
+            for (int i = 0; i < steps; i++)
+            {
+                x += v * std::cos(yaw + w * IMU_PERIOD / 2) * IMU_PERIOD;
+                y += v * std::sin(yaw + w * IMU_PERIOD / 2) * IMU_PERIOD;
+                yaw += w * IMU_PERIOD;
+                t += IMU_PERIOD;
+                ekf.addGyro(ros::Time{t}, w + bias, GYRO_VARIANCE);
+                if (i % 4 == 3)
+                    ekf.addTreads(ros::Time{t}, v, w, TREAD_VARIANCE, TREAD_VARIANCE);
+            }
+        }
+    };
+
+    double angleDifference(double a, double b)
+    {
+        return std::atan2(std::sin(a - b), std::cos(a - b));
+    }
+}
+
+TEST(PlanarEkf, FollowsTheTreads)
+{
+    PlanarEkf ekf{PlanarEkf::Parameters{}};
+    Drive drive;
+    drive.run(ekf, 0.4, 0.2, 0, 10.0);
+
+    const PlanarEkf::State& state = ekf.state();
+    EXPECT_NEAR(state(PlanarEkf::V), 0.4, 1e-3);
+    EXPECT_NEAR(state(PlanarEkf::W), 0.2, 1e-3);
+    EXPECT_NEAR(state(PlanarEkf::X), drive.x, 0.02);
+    EXPECT_NEAR(state(PlanarEkf::Y), drive.y, 0.02);
+    EXPECT_NEAR(angleDifference(state(PlanarEkf::YAW), drive.yaw), 0, 0.01);
+    EXPECT_EQ(ekf.stamp(), ros::Time{drive.t});
+}
+
+/*
+ * A gyroscope that reads 0.05 rad/s too much leaves the yaw rate to the
+ * treads and ends up in the bias.
+ * */
+TEST(PlanarEkf, EstimatesGyroBias)
+{
+    PlanarEkf ekf{PlanarEkf::Parameters{}};
+    Drive drive;
+    drive.run(ekf, 0.3, 0, 0.05, 20.0);
+    EXPECT_NEAR(ekf.state()(PlanarEkf::GYRO_BIAS), 0.05, 2e-3);
+    EXPECT_NEAR(ekf.state()(PlanarEkf::W), 0, 2e-3);
+}
+
+TEST(PlanarEkf, FiducialCorrectsPose)
+{
+    PlanarEkf ekf{PlanarEkf::Parameters{}};
+    Drive drive;
+    drive.run(ekf, 0.3, 0, 0, 1.0);
+    // the fiducials see the robot somewhere else, across the wrap of the yaw
+    ekf.addFiducial(ros::Time{drive.t}, 2.0, -1.0, M_PI - 0.01, 1e-4, 1e-4);
+    const PlanarEkf::State& state = ekf.state();
+    EXPECT_NEAR(state(PlanarEkf::X), 2.0, 0.01);
+    EXPECT_NEAR(state(PlanarEkf::Y), -1.0, 0.01);
+    EXPECT_NEAR(angleDifference(state(PlanarEkf::YAW), M_PI - 0.01), 0, 0.01);
+}
+
+/*
+ * A fiducial that comes in late ends up exactly where it would have if it
+ * came in on time.
+ * */
+TEST(PlanarEkf, LateFiducialIsReplayed)
+{
+    PlanarEkf onTime{PlanarEkf::Parameters{}};
+    PlanarEkf late{PlanarEkf::Parameters{}};
+    Drive first, second;
+    first.run(onTime, 0.3, 0.1, 0, 1.0);
+    second.run(late, 0.3, 0.1, 0, 1.0);
+    const ros::Time seen{first.t};
+
+    onTime.addFiducial(seen, 0.5, 0.2, 0.3, 1e-2, 1e-2);
+    first.run(onTime, 0.3, 0.1, 0, 0.5);
+    second.run(late, 0.3, 0.1, 0, 0.5);
+    EXPECT_TRUE(late.addFiducial(seen, 0.5, 0.2, 0.3, 1e-2, 1e-2));
+
+    EXPECT_EQ(late.rollbacks(), 1u);
+    EXPECT_EQ(late.stamp(), onTime.stamp());
+    for (int i = 0; i < PlanarEkf::SIZE; i++)
+    {
+        EXPECT_NEAR(late.state()(i), onTime.state()(i), 1e-9) << "state " << i;
+        for (int j = 0; j < PlanarEkf::SIZE; j++)
+            EXPECT_NEAR(late.covariance()(i, j), onTime.covariance()(i, j), 1e-9);
+    }
+}
+
+TEST(PlanarEkf, TooLateIsDropped)
+{
+    PlanarEkf::Parameters parameters;
+    parameters.history_length = 1.0;
+    PlanarEkf ekf{parameters};
+    Drive drive;
+    drive.run(ekf, 0.3, 0, 0, 3.0);
+    const PlanarEkf::State before = ekf.state();
+    EXPECT_FALSE(ekf.addFiducial(ros::Time{START + 0.5}, 5, 5, 0, 1e-4, 1e-4));
+    EXPECT_EQ(ekf.dropped(), 1u);
+    EXPECT_EQ(ekf.state(), before);
+}
+
+TEST(PlanarEkf, CovarianceStaysSymmetric)
+{
+    PlanarEkf ekf{PlanarEkf::Parameters{}};
+    Drive drive;
+    std::mt19937 random{3};
+    std::uniform_real_distribution<double> lateness{0, 0.5};
+    for (int i = 0; i < 50; i++)
+    {
+        drive.run(ekf, 0.3, (i % 2) ? 0.3 : -0.3, 0.01, 0.5);
+        ekf.addFiducial(ros::Time{drive.t - lateness(random)}, drive.x, drive.y, drive.yaw, 1e-2, 1e-2);
+    }
+    const PlanarEkf::Covariance& P = ekf.covariance();
+    EXPECT_LT((P - P.transpose()).cwiseAbs().maxCoeff(), 1e-12);
+    for (int i = 0; i < PlanarEkf::SIZE; i++)
+        EXPECT_GT(P(i, i), 0);
+    EXPECT_NEAR(ekf.state()(PlanarEkf::X), drive.x, 0.05);
+    EXPECT_NEAR(ekf.state()(PlanarEkf::Y), drive.y, 0.05);
+}
+
+/*
+ * The cost of an IMU update in order, recorded in the test results. Only
+ * recorded, it depends on the machine and the build type.
+ * */
+TEST(PlanarEkf, UpdateCost)
+{
+    PlanarEkf ekf{PlanarEkf::Parameters{}};
+    Drive drive;
+    drive.run(ekf, 0.3, 0.1, 0, 3.0);
+    const int updates = 100000;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 1; i <= updates; i++)
+        ekf.addGyro(ros::Time{drive.t + i * IMU_PERIOD}, 0.1, GYRO_VARIANCE);
+    const double us = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count() / updates;
+    RecordProperty("us_per_update", std::to_string(us));
+    // it still has to be a sane filter after all of them
+    EXPECT_TRUE(ekf.state().allFinite());
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
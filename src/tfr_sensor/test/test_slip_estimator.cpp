@@ -0,0 +1,188 @@
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+#include "slip_estimator.h"
+#include <cmath>
+
+namespace
+{
+    const double DT = 0.02;
+
+    struct Pose
+    {
+        double x = 0, y = 0, yaw = 0;
+    };
+
+    /*
+     * Drives straight and turning for duration seconds: the treads report
+     * treadRate while the robot really turns at gyroRate, and the robot
+     * really moves at speed while the treads say treadSpeed.
+     * */
+    void drive(SlipEstimator& slip, ros::Time& now, double treadSpeed, double speed,
+            double treadRate, double gyroRate, double duration, Pose& truth)
+    {
+        for (double t = 0; t < duration; t += DT)
+        {
+            now += ros::Duration(DT);
+            truth.x += speed * std::cos(truth.yaw) * DT;
+            truth.y += speed * std::sin(truth.yaw) * DT;
+            truth.yaw += gyroRate * DT;
+            slip.addGyro(now, gyroRate);
+            slip.addTreads(now, treadSpeed, treadRate);
+        }
+        slip.addFiducial(now, truth.x, truth.y);
+    }
+}
+
+/*
+ * While the treads agree with the gyroscope and the fiducials the
+ * variances stay at their base.
+ * */
+TEST(SlipEstimator, GripKeepsBaseVariance)
+{
+    SlipEstimator::Parameters parameters;
+    SlipEstimator slip{parameters};
+    ros::Time now{100};
+    Pose truth;
+    for (int i = 0; i < 10; i++)
+        drive(slip, now, 0.5, 0.5, 0.3, 0.3, 1.0, truth);
+
+    EXPECT_NEAR(slip.linearSlip(), 0, 1e-9);
+    EXPECT_NEAR(slip.yawRateError(), 0, 1e-9);
+    EXPECT_NEAR(slip.linearVariance(0.5), parameters.base_linear_variance, 1e-9);
+    EXPECT_NEAR(slip.angularVariance(), parameters.base_angular_variance, 1e-9);
+}
+
+/*
+ * Spinning in place in loose regolith: the treads turn twice as fast as
+ * the robot does.
+ * */
+TEST(SlipEstimator, GyroMismatchInflatesAngularVariance)
+{
+    SlipEstimator::Parameters parameters;
+    SlipEstimator slip{parameters};
+    ros::Time now{100};
+    Pose truth;
+    drive(slip, now, 0, 0, 1.0, 0.5, 10.0, truth);
+
+    EXPECT_NEAR(slip.yawRateError(), 0.5, 0.01);
+    EXPECT_NEAR(slip.angularVariance(), parameters.base_angular_variance + 0.25, 0.01);
+    EXPECT_NEAR(slip.linearVariance(0), parameters.base_linear_variance, 1e-9);
+}
+
+/*
+ * Without a gyroscope there is nothing to compare the yaw rate with.
+ * */
+TEST(SlipEstimator, StaleGyroIsIgnored)
+{
+    SlipEstimator::Parameters parameters;
+    SlipEstimator slip{parameters};
+    ros::Time now{100};
+    slip.addGyro(now, 0);
+    now += ros::Duration(5.0);
+    for (int i = 1; i <= 100; i++)
+        slip.addTreads(now + ros::Duration(i * DT), 0, 1.0);
+    EXPECT_NEAR(slip.angularVariance(), parameters.base_angular_variance, 1e-9);
+}
+
+/*
+ * The treads say 1 m while the fiducials see 0.5 m.
+ * */
+TEST(SlipEstimator, FiducialMismatchInflatesLinearVariance)
+{
+    SlipEstimator::Parameters parameters;
+    SlipEstimator slip{parameters};
+    ros::Time now{100};
+    Pose truth;
+    slip.addTreads(now, 0, 0);
+    slip.addFiducial(now, 0, 0);
+    for (int i = 0; i < 20; i++)
+        drive(slip, now, 1.0, 0.5, 0, 0, 1.0, truth);
+
+    // a little under the error, it fades between the fixes
+    EXPECT_NEAR(slip.linearSlip(), 0.45, 0.03);
+    EXPECT_GT(slip.linearVariance(1.0), parameters.base_linear_variance + 0.15);
+    // standing still the slip doesn't matter
+    EXPECT_NEAR(slip.linearVariance(0), parameters.base_linear_variance, 1e-9);
+    EXPECT_LE(slip.linearVariance(100.0), parameters.max_variance);
+}
+
+/*
+ * Turning on an arc the treads cover the same chord as the fixes.
+ * */
+TEST(SlipEstimator, ArcWithGripIsNotSlip)
+{
+    SlipEstimator::Parameters parameters;
+    SlipEstimator slip{parameters};
+    ros::Time now{100};
+    const double radius = 2.0, speed = 0.5, rate = speed / radius;
+    slip.addTreads(now, 0, 0);
+    slip.addFiducial(now, 0, 0);
+    for (int i = 1; i <= 200; i++)
+    {
+        now += ros::Duration(DT);
+        slip.addTreads(now, speed, rate);
+        if (i % 50 == 0)
+        {
+            const double yaw = rate * i * DT;
+            slip.addFiducial(now, radius * std::sin(yaw), radius * (1 - std::cos(yaw)));
+        }
+    }
+    EXPECT_NEAR(slip.linearSlip(), 0, 1e-3);
+}
+
+/*
+ * Fixes too close together don't tell the slip apart from their noise.
+ * */
+TEST(SlipEstimator, ShortMovesAreNotCompared)
+{
+    SlipEstimator::Parameters parameters;
+    SlipEstimator slip{parameters};
+    ros::Time now{100};
+    Pose truth;
+    slip.addTreads(now, 0, 0);
+    slip.addFiducial(now, 0, 0);
+    drive(slip, now, 0.1, 0.05, 0, 0, 1.0, truth);
+    EXPECT_NEAR(slip.linearSlip(), 0, 1e-9);
+}
+
+/*
+ * Once the treads grip again both variances fall back to their base.
+ * */
+TEST(SlipEstimator, SlipFades)
+{
+    SlipEstimator::Parameters parameters;
+    SlipEstimator slip{parameters};
+    ros::Time now{100};
+    Pose truth;
+    slip.addTreads(now, 0, 0);
+    slip.addFiducial(now, 0, 0);
+    for (int i = 0; i < 10; i++)
+        drive(slip, now, 1.0, 0.5, 1.0, 0.0, 1.0, truth);
+    const double slipped = slip.linearSlip();
+    ASSERT_GT(slipped, 0.3);
+    ASSERT_GT(slip.yawRateError(), 0.5);
+
+    // no new fixes, the treads agree with the gyroscope
+    for (int i = 0; i < 10; i++)
+    {
+        for (int j = 0; j < 50; j++)
+        {
+            now += ros::Duration(DT);
+            slip.addGyro(now, 0.2);
+            slip.addTreads(now, 0, 0.2);
+        }
+    }
+    EXPECT_LT(slip.yawRateError(), 1e-2);
+    EXPECT_NEAR(slip.linearSlip(), slipped * std::exp(-10.0 / parameters.linear_time_constant), 1e-6);
+
+    // fixes that agree bring the linear slip down
+    for (int i = 0; i < 20; i++)
+        drive(slip, now, 0.5, 0.5, 0, 0, 1.0, truth);
+    EXPECT_LT(slip.linearSlip(), 0.01);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include "tread_distance_publisher.h"
+#include <climits>
 #include <cmath>
 
 TEST(TreadDistance, Basic)
@@ -15,6 +16,17 @@ TEST(TreadDistance, Basic)
 	EXPECT_EQ(treadDistance.distanceTraveled, -2*M_PI);
 }
 
+TEST(TreadDistance, Rollover)
+{
+    double wheelRadius=1, ticksPerRevolution=4;
+    TreadDistance treadDistance(ticksPerRevolution, INT_MAX, wheelRadius, INT_MAX - 2);
+    treadDistance.updateFromNewCount(INT_MIN + 1);
+	EXPECT_EQ(treadDistance.distanceTraveled, 2*M_PI);
+    treadDistance.updateFromNewCount(INT_MAX);
+	EXPECT_EQ(treadDistance.distanceTraveled, -M_PI);
+	EXPECT_EQ(treadDistance.totalDistance(), M_PI);
+}
+
 int main(int argc, char **argv)
 {
     testing::InitGoogleTest(&argc, argv);
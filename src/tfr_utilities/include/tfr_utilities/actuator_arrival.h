@@ -0,0 +1,96 @@
+/*
+ * Tells when an actuator of the arm got to the position it was last sent
+ * to, from the feedback the CAN bridge publishes for it:
+ *
+ *  - the DS402 statusword, bit 10 (target reached) set
+ *  - the position of its encoder, within a tolerance of the target
+ *
+ * Either one is enough. Right after a new target the drive may still report
+ * target reached for the old one, so a statusword only counts if it was
+ * read at least settle_time after the command. A position only counts if it
+ * was read after the command.
+ *
+ * The positions are in the units of the commands, the bridge converts both
+ * with the same range.
+ *
+ *  tfr_utilities::ActuatorArrival arrival{parameters};
+ *  arrival.command(target, ros::Time::now());
+ *  ... arrival.statusword(msg.data, ros::Time::now()) in the callbacks
+ *  while (!arrival.reached()) ...
+ *
+ * Not thread safe.
+ * */
+#ifndef ACTUATOR_ARRIVAL_H
+#define ACTUATOR_ARRIVAL_H
+
+#include <ros/ros.h>
+#include <cstdint>
+
+namespace tfr_utilities
+{
+    class ActuatorArrival
+    {
+    public:
+        struct Parameters
+        {
+            // how close the encoder has to be to the target
+            double tolerance = 0.05;
+            // s, how long a new target takes to clear the target reached bit
+            double settle_time = 0.2;
+            // s, feedback older than this doesn't count
+            double feedback_timeout = 1.0;
+        };
+
+        // DS402 statusword bit 10, target reached
+        static const uint16_t TARGET_REACHED = 1 << 10;
+
+        ActuatorArrival();
+        explicit ActuatorArrival(const Parameters& parameters);
+
+        /*
+         * A new target was sent at stamp.
+         * */
+        void command(double target, const ros::Time& stamp);
+
+        /*
+         * Feedback from the bridge, read at stamp.
+         * */
+        void statusword(uint16_t word, const ros::Time& stamp);
+        void position(double value, const ros::Time& stamp);
+
+        /*
+         * Whether the actuator got to its last target, by now. True before
+         * the first command.
+         * */
+        bool reached(const ros::Time& now) const;
+
+        /*
+         * Whether there is recent feedback at all, without it reached()
+         * can't tell.
+         * */
+        bool hasFeedback(const ros::Time& now) const;
+
+        /*
+         * Whether lastPosition() is recent.
+         * */
+        bool hasPosition(const ros::Time& now) const;
+
+        // the latest position, and its target
+        double lastPosition() const { return last_position; }
+        double target() const { return target_position; }
+
+    private:
+        const Parameters parameters;
+
+        bool commanded;
+        double target_position;
+        ros::Time command_stamp;
+
+        bool target_reached;
+        ros::Time statusword_stamp;
+        double last_position;
+        ros::Time position_stamp;
+    };
+}
+
+#endif // ACTUATOR_ARRIVAL_H
@@ -0,0 +1,72 @@
+/*
+ * Counts the heap allocations made by a thread, for tests that check a hot
+ * path does not allocate.
+ *
+ * This header replaces the global operator new and delete, so include it in
+ * exactly one source file of a test executable, and never in a library or
+ * node. Only allocations of the calling thread are counted, so background
+ * threads (spinners, publishers) do not disturb the measurement.
+ *
+ *  tfr_utilities::AllocationCounter counter;
+ *  runOneCycle();
+ *  EXPECT_EQ(counter.allocations(), 0u);
+ * */
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace tfr_utilities
+{
+    inline std::size_t& threadAllocationCount()
+    {
+        static thread_local std::size_t allocations = 0;
+        return allocations;
+    }
+
+    /*
+     * Number of allocations the calling thread made since construction.
+     * */
+    class AllocationCounter
+    {
+    public:
+        AllocationCounter() : start{threadAllocationCount()} {}
+
+        std::size_t allocations() const
+        {
+            return threadAllocationCount() - start;
+        }
+
+        void reset()
+        {
+            start = threadAllocationCount();
+        }
+
+    private:
+        std::size_t start;
+    };
+}
+
+/*
+ * The default operator new[] and the nothrow versions forward to these, so
+ * they are counted as well.
+ * */
+void* operator new(std::size_t size)
+{
+    tfr_utilities::threadAllocationCount()++;
+    void* memory = std::malloc(size == 0 ? 1 : size);
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+#endif // ALLOCATION_COUNTER_H
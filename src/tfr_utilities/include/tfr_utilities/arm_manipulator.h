@@ -10,15 +10,27 @@
 #include <urdf/model.h>
 #include <actionlib/client/simple_action_client.h>
 #include <sensor_msgs/JointState.h>
+#include <actuator_arrival.h>
+#include <mutex>
 
 /**
  * Provides a simple method for moving the arm.
  * This is a regular ole' class, just instantiate it and call moveArm.
+ *
+ * The commands are written into messages allocated once in the constructor,
+ * so moving an actuator does not allocate memory for the message.
+ *
+ * The moves don't block. isArmTargetPositionReached() tells when the
+ * turntable, lower arm, upper arm and scoop got to their last commands, from
+ * the statusword and encoder of each (see actuator_arrival.h). The callbacks
+ * run in the spinner of the node, so ask from another thread, like an action
+ * server callback.
  * */
 class ArmManipulator
 {
     public:
-        ArmManipulator(ros::NodeHandle &n, bool init_joints=true);
+        ArmManipulator(ros::NodeHandle &n, bool init_joints=true,
+                const tfr_utilities::ActuatorArrival::Parameters &arrival=tfr_utilities::ActuatorArrival::Parameters{});
         ~ArmManipulator(){};
         ArmManipulator(const ArmManipulator&) = delete;
         ArmManipulator& operator=(const ArmManipulator&) = delete;
@@ -37,7 +49,14 @@ class ArmManipulator
         void moveRightBinPosition(double rightBin);
         void moveLeftBinPosition(double leftBin);
 
-        bool isArmTargetPositionReached(); // TODO
+        // whether the arm actuators got to their last commands
+        bool isArmTargetPositionReached();
+        // whether there is recent feedback from all of the arm actuators
+        bool hasArmFeedback();
+        // whether the bridge publishes every feedback topic, warns about the ones it doesn't
+        bool checkFeedbackTopics();
+        // the latest encoder positions, false if any of them isn't recent
+        bool getArmPosition(double &turntable, double &lower_arm, double &upper_arm, double &scoop);
 
         bool turntable_target_position_reached = false;
 
@@ -49,7 +68,35 @@ class ArmManipulator
         ros::Publisher left_bin_publisher;
         ros::Publisher right_bin_publisher;
         ros::Subscriber turntable_statusword_subscriber;
+        ros::Subscriber lower_arm_statusword_subscriber;
+        ros::Subscriber upper_arm_statusword_subscriber;
+        ros::Subscriber scoop_statusword_subscriber;
+        ros::Subscriber turntable_position_subscriber;
+        ros::Subscriber lower_arm_position_subscriber;
+        ros::Subscriber upper_arm_position_subscriber;
+        ros::Subscriber scoop_position_subscriber;
         void updateTurntableTargetPosition(const std_msgs::UInt16 &value);
+        void updateStatusword(const std_msgs::UInt16::ConstPtr &value, tfr_utilities::ActuatorArrival *arrival);
+        void updatePosition(const sensor_msgs::JointState::ConstPtr &state, tfr_utilities::ActuatorArrival *arrival);
+
+        // feedback of the arm actuators, guarded by arrival_mutex
+        tfr_utilities::ActuatorArrival turntable_arrival;
+        tfr_utilities::ActuatorArrival lower_arm_arrival;
+        tfr_utilities::ActuatorArrival upper_arm_arrival;
+        tfr_utilities::ActuatorArrival scoop_arrival;
+        std::mutex arrival_mutex;
+
+        // the last command sent to each actuator, with room for one position
+        sensor_msgs::JointState turntable_command;
+        sensor_msgs::JointState lower_arm_command;
+        sensor_msgs::JointState upper_arm_command;
+        sensor_msgs::JointState scoop_command;
+        sensor_msgs::JointState left_bin_command;
+        sensor_msgs::JointState right_bin_command;
+        std::mutex command_mutex;
+
+        void publishPosition(const ros::Publisher &publisher, sensor_msgs::JointState &command, double position,
+                tfr_utilities::ActuatorArrival *arrival = nullptr);
  };
 
 #endif
@@ -0,0 +1,62 @@
+/*
+ * Node configuration that can be changed at runtime without touching the
+ * parameter server from the hot path.
+ *
+ * Wraps a dynamic_reconfigure server for a generated Config type. The
+ * server starts from the private parameters of the node (so launch files
+ * keep working) and every reconfigure request replaces an immutable
+ * snapshot of the whole config. Callbacks read the current snapshot with
+ * get(), an atomic pointer load, instead of ros::param::getCached() or
+ * ros::param::get(), which go to the master when the cache is cold.
+ *
+ *  tfr_utilities::CachedConfig<tfr_control::DrivebaseConfig> config;
+ *  ...
+ *  double span = config.get()->wheel_span;
+ *
+ * A snapshot is never changed once published, keep the pointer for as long
+ * as the values must be consistent with each other.
+ * */
+#ifndef CACHED_CONFIG_H
+#define CACHED_CONFIG_H
+
+#include <ros/ros.h>
+#include <dynamic_reconfigure/server.h>
+#include <boost/bind.hpp>
+#include <memory>
+
+namespace tfr_utilities
+{
+    template<class Config>
+    class CachedConfig
+    {
+    public:
+        explicit CachedConfig(const ros::NodeHandle& n = ros::NodeHandle("~")) :
+            snapshot{std::make_shared<const Config>(Config::__getDefault__())},
+            server{n}
+        {
+            // the server calls update() right away with the initial values
+            server.setCallback(boost::bind(&CachedConfig::update, this, _1, _2));
+        }
+        ~CachedConfig() = default;
+        CachedConfig(const CachedConfig&) = delete;
+        CachedConfig& operator=(const CachedConfig&) = delete;
+        CachedConfig(CachedConfig&&) = delete;
+        CachedConfig& operator=(CachedConfig&&) = delete;
+
+        std::shared_ptr<const Config> get() const
+        {
+            return std::atomic_load(&snapshot);
+        }
+
+    private:
+        void update(Config& config, uint32_t level)
+        {
+            std::atomic_store(&snapshot, std::make_shared<const Config>(config));
+        }
+
+        std::shared_ptr<const Config> snapshot;
+        dynamic_reconfigure::Server<Config> server;
+    };
+}
+
+#endif // CACHED_CONFIG_H
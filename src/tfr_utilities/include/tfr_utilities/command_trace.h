@@ -0,0 +1,140 @@
+/*
+ * Lightweight tracing of commands as they pass through the nodes, used to
+ * find where the time goes between a teleop key press (or a move_base
+ * cmd_vel) and the tread command on the CAN bus.
+ *
+ * A command gets a trace id where it starts (newTraceId()). Every hop it
+ * passes records the id, the hop name and the wall clock time with
+ * recordTrace(). Records go into a fixed size buffer owned by the recording
+ * thread, so recording takes no lock and, after the first record of a
+ * thread, does not allocate. A full buffer drops records instead of
+ * blocking.
+ *
+ * The messages the commands travel in (Twist, Float64, Int32) have no room
+ * for the id, so a hop that sends a traced command announces the id on
+ * <topic>/trace (tfr_msgs/TraceContext) just before it publishes on <topic>.
+ * The next hop keeps the last announced id with a TraceListener and takes it
+ * when it handles the command. The two messages travel on separate
+ * connections, so this is best effort: a command that overtakes its
+ * announcement is not attributed to the trace.
+ *
+ * A TraceExporter in each node publishes the recorded events, and
+ * command_latency_test puts the hops of each trace back together.
+ *
+ * Wall clock stamps are only comparable between nodes on machines with
+ * synchronized clocks.
+ *
+ * Published Topics:
+ *  - /command_trace/events (tfr_msgs/TraceEvents) by the TraceExporter
+ * */
+#ifndef COMMAND_TRACE_H
+#define COMMAND_TRACE_H
+
+#include <ros/ros.h>
+#include <tfr_msgs/TraceContext.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tfr_utilities
+{
+    struct TraceRecord
+    {
+        uint64_t trace_id;
+        // a string literal, records keep only the pointer
+        const char* hop;
+        ros::WallTime stamp;
+    };
+
+    /*
+     * A new trace id, unique across the nodes of a run. Never 0, which
+     * stands for "not traced".
+     * */
+    uint64_t newTraceId();
+
+    /*
+     * Records that trace_id passed hop now. Does nothing for trace id 0.
+     * */
+    void recordTrace(uint64_t trace_id, const char* hop);
+    void recordTrace(uint64_t trace_id, const char* hop, const ros::WallTime& stamp);
+
+    /*
+     * Moves the records of all threads into records, returns how many
+     * records were dropped because a buffer was full since the last call.
+     * */
+    uint64_t drainTraces(std::vector<TraceRecord>& records);
+
+    /*
+     * Publishes the records of this process every period.
+     * */
+    class TraceExporter
+    {
+    public:
+        TraceExporter(ros::NodeHandle& n, double period = 0.5);
+        ~TraceExporter() = default;
+        TraceExporter(const TraceExporter&) = delete;
+        TraceExporter& operator=(const TraceExporter&) = delete;
+        TraceExporter(TraceExporter&&) = delete;
+        TraceExporter& operator=(TraceExporter&&) = delete;
+
+        void shutdown();
+
+    private:
+        void exportTraces(const ros::WallTimerEvent& event);
+
+        ros::Publisher publisher;
+        ros::WallTimer timer;
+        std::vector<TraceRecord> records;
+    };
+
+    /*
+     * Announces the trace of the next command published on topic.
+     * */
+    class TraceAnnouncer
+    {
+    public:
+        TraceAnnouncer(ros::NodeHandle& n, const std::string& topic);
+        ~TraceAnnouncer() = default;
+        TraceAnnouncer(const TraceAnnouncer&) = delete;
+        TraceAnnouncer& operator=(const TraceAnnouncer&) = delete;
+        TraceAnnouncer(TraceAnnouncer&&) = delete;
+        TraceAnnouncer& operator=(TraceAnnouncer&&) = delete;
+
+        /*
+         * Does nothing for trace id 0.
+         * */
+        void announce(uint64_t trace_id);
+
+    private:
+        ros::Publisher publisher;
+    };
+
+    /*
+     * Keeps the trace announced for the next command on topic.
+     * */
+    class TraceListener
+    {
+    public:
+        TraceListener(ros::NodeHandle& n, const std::string& topic);
+        ~TraceListener() = default;
+        TraceListener(const TraceListener&) = delete;
+        TraceListener& operator=(const TraceListener&) = delete;
+        TraceListener(TraceListener&&) = delete;
+        TraceListener& operator=(TraceListener&&) = delete;
+
+        /*
+         * The announced trace id, or 0 if none was announced since the last
+         * call. Lock free, safe to call from the control thread.
+         * */
+        uint64_t take();
+
+    private:
+        void announced(const tfr_msgs::TraceContext::ConstPtr& context);
+
+        std::atomic<uint64_t> trace_id;
+        ros::Subscriber subscriber;
+    };
+}
+
+#endif // COMMAND_TRACE_H
@@ -0,0 +1,46 @@
+/*
+ * Names of the topics the kacanopen bridge (tfr_can) reads and writes the
+ * entries of a CANopen device on:
+ *
+ *     /device<node id>/get_<entry>   the value read from the device
+ *     /device<node id>/set_<entry>   values to write to it
+ *
+ * with the entry name escaped as kacanopen does: lower case, spaces and
+ * dashes as underscores. Subscribing to anything else gets no messages
+ * and no error, so build the names here.
+ *
+ *  n.subscribe(tfr_utilities::getTopic(23, "statusword"), ...)  // /device23/get_statusword
+ * */
+#ifndef DEVICE_TOPICS_H
+#define DEVICE_TOPICS_H
+
+#include <cctype>
+#include <string>
+
+namespace tfr_utilities
+{
+    inline std::string escapeEntry(const std::string& entry)
+    {
+        std::string escaped = entry;
+        for (char& c : escaped)
+        {
+            if (c == ' ' || c == '-')
+                c = '_';
+            else
+                c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        return escaped;
+    }
+
+    inline std::string getTopic(int device, const std::string& entry)
+    {
+        return "/device" + std::to_string(device) + "/get_" + escapeEntry(entry);
+    }
+
+    inline std::string setTopic(int device, const std::string& entry)
+    {
+        return "/device" + std::to_string(device) + "/set_" + escapeEntry(entry);
+    }
+}
+
+#endif // DEVICE_TOPICS_H
@@ -0,0 +1,112 @@
+/*
+ * Turns the readings of an encoder counter that wraps around, gets
+ * recentered or reset into a 64 bit count that only moves by the ticks the
+ * encoder really turned.
+ *
+ * The counter counts from min_count to max_count and wraps around to the
+ * other end, like the int32 qry_blcntr register of the Roboteq. The
+ * difference between two readings is taken modulo the range, so a wrap is
+ * a small step like any other.
+ *
+ * A step larger than max_step can't be motion between two readings. The
+ * counter was set to a new value: recentered (the arduino VelocityQuadrature
+ * writes 0 near 0.8 * INT_MAX) or reset (a controller reboot). If the new
+ * reading is within max_step of recenter_value, the ticks since then are
+ * counted, otherwise the reading only sets the new base. Either way the
+ * count does not jump.
+ *
+ *  tfr_utilities::TickUnwrapper unwrapper{tfr_utilities::TickUnwrapper::int32Counter()};
+ *  ...
+ *  auto step = unwrapper.update(raw_count);
+ *  distance += step.delta * meters_per_tick;
+ *
+ * Not thread safe.
+ * */
+#ifndef TICK_UNWRAPPER_H
+#define TICK_UNWRAPPER_H
+
+#include <cstdint>
+
+namespace tfr_utilities
+{
+    class TickUnwrapper
+    {
+    public:
+        struct Parameters
+        {
+            int64_t min_count = INT32_MIN;
+            int64_t max_count = INT32_MAX;
+            // the most ticks the encoder turns between readings, 0 for a
+            // quarter of the range
+            int64_t max_step = 0;
+            // the value the counter is recentered or reset to
+            int64_t recenter_value = 0;
+        };
+
+        enum class Kind
+        {
+            // the first reading, sets where the count starts
+            FIRST,
+            // normal motion, possibly across a wrap of the counter
+            STEP,
+            // the counter was recentered or reset, counted from recenter_value
+            RECENTER,
+            // the counter jumped somewhere unexpected, not counted
+            JUMP
+        };
+
+        struct Step
+        {
+            Kind kind;
+            // ticks since the last reading
+            int64_t delta;
+            // the unwrapped count after this reading
+            int64_t position;
+            int64_t raw;
+        };
+
+        static Parameters int32Counter();
+
+        explicit TickUnwrapper(const Parameters& parameters = int32Counter());
+
+        /*
+         * What the reading raw would do, without taking it.
+         * */
+        Step peek(int64_t raw) const;
+
+        /*
+         * Takes a step from peek().
+         * */
+        void accept(const Step& step);
+
+        /*
+         * peek() and accept() the reading raw.
+         * */
+        Step update(int64_t raw);
+
+        /*
+         * Forgets the readings, the next one is FIRST again. The position
+         * is kept unless clear_position.
+         * */
+        void reset(bool clear_position = false);
+
+        int64_t position() const { return count; }
+        bool hasReading() const { return has_reading; }
+        // readings that were RECENTER or JUMP
+        uint64_t recenters() const { return recenter_count; }
+        uint64_t jumps() const { return jump_count; }
+
+    private:
+        const int64_t range;
+        const int64_t max_step;
+        const int64_t recenter_value;
+
+        bool has_reading;
+        int64_t last_raw;
+        int64_t count;
+        uint64_t recenter_count;
+        uint64_t jump_count;
+    };
+}
+
+#endif // TICK_UNWRAPPER_H
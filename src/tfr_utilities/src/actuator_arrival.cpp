@@ -0,0 +1,74 @@
+#include <actuator_arrival.h>
+#include <cmath>
+
+namespace tfr_utilities
+{
+    ActuatorArrival::ActuatorArrival() :
+        ActuatorArrival(Parameters{})
+    {
+    }
+
+    ActuatorArrival::ActuatorArrival(const Parameters& parameters) :
+        parameters(parameters),
+        commanded{false},
+        target_position{0},
+        command_stamp{},
+        target_reached{false},
+        statusword_stamp{},
+        last_position{0},
+        position_stamp{}
+    {
+    }
+
+    void ActuatorArrival::command(double target, const ros::Time& stamp)
+    {
+        commanded = true;
+        target_position = target;
+        command_stamp = stamp;
+    }
+
+    void ActuatorArrival::statusword(uint16_t word, const ros::Time& stamp)
+    {
+        target_reached = (word & TARGET_REACHED) != 0;
+        statusword_stamp = stamp;
+    }
+
+    void ActuatorArrival::position(double value, const ros::Time& stamp)
+    {
+        last_position = value;
+        position_stamp = stamp;
+    }
+
+    bool ActuatorArrival::reached(const ros::Time& now) const
+    {
+        if (!commanded)
+        {
+            return true;
+        }
+
+        const bool fresh_position = !position_stamp.isZero()
+            && !(command_stamp > position_stamp)
+            && (now - position_stamp).toSec() <= parameters.feedback_timeout;
+        if (fresh_position && std::abs(last_position - target_position) <= parameters.tolerance)
+        {
+            return true;
+        }
+
+        const bool settled_statusword = !statusword_stamp.isZero()
+            && (statusword_stamp - command_stamp).toSec() >= parameters.settle_time
+            && (now - statusword_stamp).toSec() <= parameters.feedback_timeout;
+        return settled_statusword && target_reached;
+    }
+
+    bool ActuatorArrival::hasFeedback(const ros::Time& now) const
+    {
+        const bool statusword_feedback = !statusword_stamp.isZero()
+            && (now - statusword_stamp).toSec() <= parameters.feedback_timeout;
+        return hasPosition(now) || statusword_feedback;
+    }
+
+    bool ActuatorArrival::hasPosition(const ros::Time& now) const
+    {
+        return !position_stamp.isZero() && (now - position_stamp).toSec() <= parameters.feedback_timeout;
+    }
+}
@@ -1,15 +1,42 @@
 #include <arm_manipulator.h>
-
-ArmManipulator::ArmManipulator(ros::NodeHandle &n, bool init_joints):
-            turntable_publisher{n.advertise<sensor_msgs::JointState>("/device1/set_joint_state", 5)},
-            lower_arm_publisher{n.advertise<sensor_msgs::JointState>("/device23/set_joint_state", 5)},
-            upper_arm_publisher{n.advertise<sensor_msgs::JointState>("/device45/set_joint_state", 5)},
-            scoop_publisher{n.advertise<sensor_msgs::JointState>("/device56/set_joint_state", 5)},
-            left_bin_publisher{n.advertise<sensor_msgs::JointState>("/device77/set_joint_state", 5)},
-            right_bin_publisher{n.advertise<sensor_msgs::JointState>("/device88/set_joint_state", 5)},
-            turntable_statusword_subscriber{n.subscribe("/device1/statusword", 5, &ArmManipulator::updateTurntableTargetPosition, this)}
+#include <device_topics.h>
+
+ArmManipulator::ArmManipulator(ros::NodeHandle &n, bool init_joints,
+        const tfr_utilities::ActuatorArrival::Parameters &arrival):
+            turntable_publisher{n.advertise<sensor_msgs::JointState>(tfr_utilities::setTopic(1, "joint_state"), 5)},
+            lower_arm_publisher{n.advertise<sensor_msgs::JointState>(tfr_utilities::setTopic(23, "joint_state"), 5)},
+            upper_arm_publisher{n.advertise<sensor_msgs::JointState>(tfr_utilities::setTopic(45, "joint_state"), 5)},
+            scoop_publisher{n.advertise<sensor_msgs::JointState>(tfr_utilities::setTopic(56, "joint_state"), 5)},
+            left_bin_publisher{n.advertise<sensor_msgs::JointState>(tfr_utilities::setTopic(77, "joint_state"), 5)},
+            right_bin_publisher{n.advertise<sensor_msgs::JointState>(tfr_utilities::setTopic(88, "joint_state"), 5)},
+            turntable_statusword_subscriber{n.subscribe(tfr_utilities::getTopic(1, "statusword"), 5, &ArmManipulator::updateTurntableTargetPosition, this)},
+            turntable_arrival{arrival},
+            lower_arm_arrival{arrival},
+            upper_arm_arrival{arrival},
+            scoop_arrival{arrival}
 {
   ROS_INFO("Initializing Arm Manipulator");
+  for (sensor_msgs::JointState* command : {&turntable_command, &lower_arm_command, &upper_arm_command,
+          &scoop_command, &left_bin_command, &right_bin_command})
+  {
+      command->position.resize(1);
+  }
+
+  // target reached and encoder feedback of the arm, the turntable statusword is above
+  lower_arm_statusword_subscriber = n.subscribe<std_msgs::UInt16>(tfr_utilities::getTopic(23, "statusword"), 5,
+          boost::bind(&ArmManipulator::updateStatusword, this, _1, &lower_arm_arrival));
+  upper_arm_statusword_subscriber = n.subscribe<std_msgs::UInt16>(tfr_utilities::getTopic(45, "statusword"), 5,
+          boost::bind(&ArmManipulator::updateStatusword, this, _1, &upper_arm_arrival));
+  scoop_statusword_subscriber = n.subscribe<std_msgs::UInt16>(tfr_utilities::getTopic(56, "statusword"), 5,
+          boost::bind(&ArmManipulator::updateStatusword, this, _1, &scoop_arrival));
+  turntable_position_subscriber = n.subscribe<sensor_msgs::JointState>(tfr_utilities::getTopic(1, "joint_state"), 5,
+          boost::bind(&ArmManipulator::updatePosition, this, _1, &turntable_arrival));
+  lower_arm_position_subscriber = n.subscribe<sensor_msgs::JointState>(tfr_utilities::getTopic(23, "joint_state"), 5,
+          boost::bind(&ArmManipulator::updatePosition, this, _1, &lower_arm_arrival));
+  upper_arm_position_subscriber = n.subscribe<sensor_msgs::JointState>(tfr_utilities::getTopic(45, "joint_state"), 5,
+          boost::bind(&ArmManipulator::updatePosition, this, _1, &upper_arm_arrival));
+  scoop_position_subscriber = n.subscribe<sensor_msgs::JointState>(tfr_utilities::getTopic(56, "joint_state"), 5,
+          boost::bind(&ArmManipulator::updatePosition, this, _1, &scoop_arrival));
 }
 
 void ArmManipulator::moveArm(const double& turntable, const double& lower_arm ,const double& upper_arm,  const double& scoop )
@@ -24,61 +51,49 @@ void ArmManipulator::moveArm(const double& turntable, const double& lower_arm ,c
 
 void ArmManipulator::moveTurntablePosition(double turntable)
 {
-    sensor_msgs::JointState turntable_joint_state;
-
-    turntable_joint_state.header.stamp = ros::Time::now();
-    turntable_joint_state.position.push_back(turntable);
-    
-    turntable_publisher.publish(turntable_joint_state);
+    publishPosition(turntable_publisher, turntable_command, turntable, &turntable_arrival);
 }
 
 void ArmManipulator::moveLowerArmPosition(double lower_arm)
 {
-    sensor_msgs::JointState lower_arm_joint_state;
-
-    lower_arm_joint_state.header.stamp = ros::Time::now();
-    lower_arm_joint_state.position.push_back(lower_arm);
-
-    lower_arm_publisher.publish(lower_arm_joint_state);
+    publishPosition(lower_arm_publisher, lower_arm_command, lower_arm, &lower_arm_arrival);
 }
 
 void ArmManipulator::moveUpperArmPosition(double upper_arm)
 {
-    sensor_msgs::JointState upper_arm_joint_state;
-
-    upper_arm_joint_state.header.stamp = ros::Time::now();
-    upper_arm_joint_state.position.push_back(upper_arm);
-
-    upper_arm_publisher.publish(upper_arm_joint_state);
+    publishPosition(upper_arm_publisher, upper_arm_command, upper_arm, &upper_arm_arrival);
 }
 
 void ArmManipulator::moveScoopPosition(double scoop)
 {
-    sensor_msgs::JointState scoop_joint_state;
-
-    scoop_joint_state.header.stamp = ros::Time::now();
-    scoop_joint_state.position.push_back(scoop);
-
-    scoop_publisher.publish(scoop_joint_state);
+    publishPosition(scoop_publisher, scoop_command, scoop, &scoop_arrival);
 }
 void ArmManipulator::moveLeftBinPosition(double leftBin)
 {
-    sensor_msgs::JointState left_bin_joint_state;
-
-    left_bin_joint_state.header.stamp = ros::Time::now();
-    left_bin_joint_state.position.push_back(leftBin);
-    
-    left_bin_publisher.publish(left_bin_joint_state);
+    publishPosition(left_bin_publisher, left_bin_command, leftBin);
 }
 
 void ArmManipulator::moveRightBinPosition(double rightBin)
 {
-    sensor_msgs::JointState right_bin_joint_state;
+    publishPosition(right_bin_publisher, right_bin_command, rightBin);
+}
 
-    right_bin_joint_state.header.stamp = ros::Time::now();
-    right_bin_joint_state.position.push_back(rightBin);
-    
-    right_bin_publisher.publish(right_bin_joint_state);
+/*
+ * Writes the position into the preallocated command and publishes it, and
+ * starts waiting for the actuator to get there.
+ * */
+void ArmManipulator::publishPosition(const ros::Publisher &publisher, sensor_msgs::JointState &command, double position,
+        tfr_utilities::ActuatorArrival *arrival)
+{
+    std::lock_guard<std::mutex> lock(command_mutex);
+    command.header.stamp = ros::Time::now();
+    command.position[0] = position;
+    if (arrival != nullptr)
+    {
+        std::lock_guard<std::mutex> arrival_lock(arrival_mutex);
+        arrival->command(position, command.header.stamp);
+    }
+    publisher.publish(command);
 }
 
 /*
@@ -87,8 +102,8 @@ void ArmManipulator::moveRightBinPosition(double rightBin)
  * Notes:
  *  - Careful what parameters are passed in, the arm could collide with the robot.
  *
- *  - The method is not blocking, so the caller needs to wait for the arm to move.
- *    See digging_action_server.cpp for example.
+ *  - The method is not blocking, so the caller needs to wait for the arm to move,
+ *    see isArmTargetPositionReached() and digging_action_server.cpp.
  */
 void ArmManipulator::moveArmWithoutPlanningOrLimits(
             const double& turntable, const double& lower_arm, const double& upper_arm, const double& scoop)
@@ -106,8 +121,66 @@ void ArmManipulator::moveArmWithoutPlanningOrLimits(
 // return true if all the arm actuators have reached the positions they were asked to move to.
 bool ArmManipulator::isArmTargetPositionReached() 
 {
-    // TODO add lower arm, upper arm, and scoop.
-    return turntable_target_position_reached;
+    const ros::Time now = ros::Time::now();
+    std::lock_guard<std::mutex> lock(arrival_mutex);
+    return turntable_arrival.reached(now) && lower_arm_arrival.reached(now)
+        && upper_arm_arrival.reached(now) && scoop_arrival.reached(now);
+}
+
+bool ArmManipulator::hasArmFeedback()
+{
+    const ros::Time now = ros::Time::now();
+    std::lock_guard<std::mutex> lock(arrival_mutex);
+    return turntable_arrival.hasFeedback(now) && lower_arm_arrival.hasFeedback(now)
+        && upper_arm_arrival.hasFeedback(now) && scoop_arrival.hasFeedback(now);
+}
+
+bool ArmManipulator::checkFeedbackTopics()
+{
+    bool advertised = true;
+    for (const ros::Subscriber* subscriber : {&turntable_statusword_subscriber, &lower_arm_statusword_subscriber,
+            &upper_arm_statusword_subscriber, &scoop_statusword_subscriber, &turntable_position_subscriber,
+            &lower_arm_position_subscriber, &upper_arm_position_subscriber, &scoop_position_subscriber})
+    {
+        if (subscriber->getNumPublishers() == 0)
+        {
+            ROS_WARN("Arm manipulator: nothing publishes %s, is the CAN bridge up?", subscriber->getTopic().c_str());
+            advertised = false;
+        }
+    }
+    return advertised;
+}
+
+bool ArmManipulator::getArmPosition(double &turntable, double &lower_arm, double &upper_arm, double &scoop)
+{
+    const ros::Time now = ros::Time::now();
+    std::lock_guard<std::mutex> lock(arrival_mutex);
+    if (!turntable_arrival.hasPosition(now) || !lower_arm_arrival.hasPosition(now)
+            || !upper_arm_arrival.hasPosition(now) || !scoop_arrival.hasPosition(now))
+    {
+        return false;
+    }
+    turntable = turntable_arrival.lastPosition();
+    lower_arm = lower_arm_arrival.lastPosition();
+    upper_arm = upper_arm_arrival.lastPosition();
+    scoop = scoop_arrival.lastPosition();
+    return true;
+}
+
+void ArmManipulator::updateStatusword(const std_msgs::UInt16::ConstPtr &value, tfr_utilities::ActuatorArrival *arrival)
+{
+    std::lock_guard<std::mutex> lock(arrival_mutex);
+    arrival->statusword(value->data, ros::Time::now());
+}
+
+void ArmManipulator::updatePosition(const sensor_msgs::JointState::ConstPtr &state, tfr_utilities::ActuatorArrival *arrival)
+{
+    if (state->position.empty())
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(arrival_mutex);
+    arrival->position(state->position[0], ros::Time::now());
 }
 
 void ArmManipulator::updateTurntableTargetPosition(const std_msgs::UInt16 &value)
@@ -124,4 +197,7 @@ void ArmManipulator::updateTurntableTargetPosition(const std_msgs::UInt16 &value
     {
         turntable_target_position_reached = false;
     }
+
+    std::lock_guard<std::mutex> lock(arrival_mutex);
+    turntable_arrival.statusword(value.data, ros::Time::now());
 }
@@ -0,0 +1,485 @@
+/*
+ * Measures how long a tread command takes from where it starts until it is
+ * on the CAN bus, hop by hop, using the traces of command_trace.h.
+ *
+ * A traced command passes:
+ *  - mission_control/teleop: the operator pressed a drive key
+ *  - teleop/goal, teleop/cmd_vel: the teleop action server got the goal and
+ *    published cmd_vel
+ *  - drivebase/cmd_vel, drivebase/command: the drivebase got cmd_vel and
+ *    published the tread velocity commands
+ *  - control/write: the first control cycle that wrote the new command
+ *  - can/frame: the cmd_cango SDO to the Roboteq seen on the bus
+ *
+ * The stimulus commands start their traces at latency_test/cmd_vel or
+ * latency_test/teleop, a cmd_vel from move_base starts its trace at the
+ * drivebase. The trace follows the left tread, the right one is sent in the
+ * same cycle.
+ *
+ * The test can make its own commands (stimulus), they drive the robot, so
+ * put it on blocks. Every report gives, for each hop, the percentiles of the
+ * time since the hop before it and since the start of the trace.
+ *
+ * PARAMETERS
+ *  ~stimulus: "none" to trace the commands the robot gets anyway, "cmd_vel"
+ *      to publish cmd_vel, "teleop" to send teleop goals (string, default: none)
+ *  ~stimulus_period: seconds between stimulus commands (double, default: 0.5)
+ *  ~stimulus_speed: speed of the stimulus commands [m/s] (double, default: 0.1)
+ *  ~samples: report and exit after this many traces, 0 to run until
+ *      shutdown (int, default: 200)
+ *  ~report_period: seconds between reports (double, default: 10)
+ *  ~busname: interface to watch for the cmd_cango frames, empty to end the
+ *      traces at the control node (string, default: can1)
+ *  ~output_path: csv file every event is written to, empty for none
+ *      (string, default: "")
+ *
+ * SUBSCRIBED TOPICS
+ *  /command_trace/events (tfr_msgs/TraceEvents)
+ *  /device8/set_cmd_cango/cmd_cango_1/trace (tfr_msgs/TraceContext)
+ */
+#include <ros/ros.h>
+#include <actionlib/client/simple_action_client.h>
+#include <geometry_msgs/Twist.h>
+#include <tfr_msgs/TeleopAction.h>
+#include <tfr_msgs/TraceEvents.h>
+#include <tfr_utilities/teleop_code.h>
+#include <command_trace.h>
+
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <linux/sockios.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+    const char* const CAN_FRAME_HOP = "can/frame";
+    const std::string CANGO_TOPIC = "/device8/set_cmd_cango/cmd_cango_1";
+    const uint16_t ROBOTEQ_SDO_RECEIVE = 0x600 + 8;
+    const uint16_t CMD_CANGO_INDEX = 0x2000;
+    const uint8_t CMD_CANGO_LEFT = 1;
+
+    // events of a trace may come up to an export period late, a trace is
+    // complete once it is this old
+    const double TRACE_COMPLETE_AGE = 2.0;
+    // a frame that did not show up by then never will
+    const double FRAME_TIMEOUT = 1.0;
+
+    struct Event
+    {
+        std::string hop;
+        std::string node;
+        ros::WallTime stamp;
+    };
+
+    /*
+     * Nearest rank percentile of sorted values.
+     * */
+    double percentile(const std::vector<double>& sorted, double p)
+    {
+        if (sorted.empty())
+            return 0;
+        const size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+        return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+    }
+
+    std::string formatMs(double seconds)
+    {
+        std::ostringstream text;
+        text << std::fixed << std::setprecision(2) << seconds * 1000;
+        return text.str();
+    }
+}
+
+class CommandLatencyTest
+{
+    public:
+        CommandLatencyTest(ros::NodeHandle& n, const std::string& busname,
+                const std::string& output_path) :
+            events_subscriber{n.subscribe("/command_trace/events", 50,
+                    &CommandLatencyTest::addEvents, this)},
+            cango_trace_subscriber{n.subscribe(CANGO_TOPIC + "/trace", 50,
+                    &CommandLatencyTest::addCangoTrace, this)},
+            can_fd{-1},
+            running{false},
+            completed{0}
+        {
+            if (!output_path.empty())
+            {
+                output.open(output_path);
+                if (output)
+                    output << "trace_id,hop,node,stamp" << std::endl;
+                else
+                    ROS_ERROR("command latency test: could not open %s", output_path.c_str());
+            }
+            if (!busname.empty())
+            {
+                can_fd = openCanSocket(busname);
+                if (can_fd < 0)
+                {
+                    ROS_ERROR("command latency test: could not open %s, traces end at the control node",
+                            busname.c_str());
+                }
+                else
+                {
+                    running = true;
+                    can_thread = std::thread{&CommandLatencyTest::watchBus, this};
+                }
+            }
+        }
+
+        ~CommandLatencyTest()
+        {
+            running = false;
+            if (can_thread.joinable())
+                can_thread.join();
+            if (can_fd >= 0)
+                close(can_fd);
+        }
+        CommandLatencyTest(const CommandLatencyTest&) = delete;
+        CommandLatencyTest& operator=(const CommandLatencyTest&) = delete;
+        CommandLatencyTest(CommandLatencyTest&&) = delete;
+        CommandLatencyTest& operator=(CommandLatencyTest&&) = delete;
+
+        /*
+         * Takes in the records of this node (the stimulus), matches the bus
+         * frames and closes the traces that are complete.
+         * */
+        void update()
+        {
+            std::vector<tfr_utilities::TraceRecord> records;
+            tfr_utilities::drainTraces(records);
+            const std::string node = ros::this_node::getName();
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const auto& record : records)
+            {
+                traces[record.trace_id].push_back(Event{record.hop, node, record.stamp});
+            }
+            matchFrames();
+            completeTraces();
+        }
+
+        size_t getCompleted() const
+        {
+            return completed;
+        }
+
+        void report()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (hop_latencies.empty())
+            {
+                ROS_INFO("command latency test: no complete traces yet");
+                return;
+            }
+
+            // hops in the order they are passed
+            std::vector<std::pair<double, std::string>> order;
+            for (auto& hop : hop_latencies)
+            {
+                std::sort(hop.second.since_start.begin(), hop.second.since_start.end());
+                std::sort(hop.second.since_previous.begin(), hop.second.since_previous.end());
+                order.emplace_back(percentile(hop.second.since_start, 50), hop.first);
+            }
+            std::sort(order.begin(), order.end());
+
+            std::ostringstream table;
+            table << "command latency over " << completed << " traces [ms]\n"
+                << std::left << std::setw(26) << "hop" << std::right
+                << std::setw(7) << "count"
+                << std::setw(9) << "p50" << std::setw(9) << "p90"
+                << std::setw(9) << "p99" << std::setw(9) << "max"
+                << std::setw(12) << "total p50" << std::setw(10) << "total p99" << "\n";
+            for (const auto& entry : order)
+            {
+                const HopLatency& hop = hop_latencies[entry.second];
+                table << std::left << std::setw(26) << entry.second << std::right
+                    << std::setw(7) << hop.since_start.size()
+                    << std::setw(9) << formatMs(percentile(hop.since_previous, 50))
+                    << std::setw(9) << formatMs(percentile(hop.since_previous, 90))
+                    << std::setw(9) << formatMs(percentile(hop.since_previous, 99))
+                    << std::setw(9) << formatMs(percentile(hop.since_previous, 100))
+                    << std::setw(12) << formatMs(percentile(hop.since_start, 50))
+                    << std::setw(10) << formatMs(percentile(hop.since_start, 99)) << "\n";
+            }
+            ROS_INFO_STREAM(table.str());
+        }
+
+    private:
+        struct HopLatency
+        {
+            std::vector<double> since_previous;
+            std::vector<double> since_start;
+        };
+
+        struct PendingFrame
+        {
+            uint64_t trace_id;
+            ros::WallTime sent;
+        };
+
+        void addEvents(const tfr_msgs::TraceEvents::ConstPtr& events)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const auto& event : events->events)
+            {
+                traces[event.trace_id].push_back(Event{event.hop, events->node,
+                        ros::WallTime(event.stamp.sec, event.stamp.nsec)});
+            }
+        }
+
+        /*
+         * The control node sent a traced command to the bridge, the frame
+         * carrying it is the first cmd_cango frame after it was sent.
+         * */
+        void addCangoTrace(const tfr_msgs::TraceContext::ConstPtr& context)
+        {
+            if (can_fd < 0)
+                return;
+            std::lock_guard<std::mutex> lock(mutex);
+            pending_frames.push_back(PendingFrame{context->trace_id,
+                    ros::WallTime(context->stamp.sec, context->stamp.nsec)});
+        }
+
+        void matchFrames()
+        {
+            const ros::WallTime now = ros::WallTime::now();
+            for (auto pending = pending_frames.begin(); pending != pending_frames.end();)
+            {
+                auto frame = std::find_if(frames.begin(), frames.end(),
+                        [&pending](const ros::WallTime& stamp) { return stamp >= pending->sent; });
+                if (frame != frames.end())
+                {
+                    traces[pending->trace_id].push_back(Event{CAN_FRAME_HOP, "can bus", *frame});
+                    pending = pending_frames.erase(pending);
+                }
+                else if ((now - pending->sent).toSec() > FRAME_TIMEOUT)
+                {
+                    pending = pending_frames.erase(pending);
+                }
+                else
+                {
+                    ++pending;
+                }
+            }
+            while (!frames.empty() && (now - frames.front()).toSec() > FRAME_TIMEOUT)
+            {
+                frames.pop_front();
+            }
+        }
+
+        void completeTraces()
+        {
+            const ros::WallTime now = ros::WallTime::now();
+            for (auto trace = traces.begin(); trace != traces.end();)
+            {
+                std::vector<Event>& events = trace->second;
+                const auto first = std::min_element(events.begin(), events.end(),
+                        [](const Event& a, const Event& b) { return a.stamp < b.stamp; });
+                if ((now - first->stamp).toSec() < TRACE_COMPLETE_AGE)
+                {
+                    ++trace;
+                    continue;
+                }
+
+                std::sort(events.begin(), events.end(),
+                        [](const Event& a, const Event& b) { return a.stamp < b.stamp; });
+                if (events.size() > 1)
+                {
+                    completed++;
+                    for (size_t i = 1; i < events.size(); i++)
+                    {
+                        HopLatency& hop = hop_latencies[events[i].hop];
+                        hop.since_previous.push_back((events[i].stamp - events[i - 1].stamp).toSec());
+                        hop.since_start.push_back((events[i].stamp - events.front().stamp).toSec());
+                    }
+                }
+                if (output)
+                {
+                    for (const auto& event : events)
+                    {
+                        output << trace->first << "," << event.hop << "," << event.node << ","
+                            << event.stamp.sec << "." << std::setw(9) << std::setfill('0')
+                            << event.stamp.nsec << std::setfill(' ') << "\n";
+                    }
+                }
+                trace = traces.erase(trace);
+            }
+        }
+
+        int openCanSocket(const std::string& busname)
+        {
+            const int fd = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+            if (fd < 0)
+                return -1;
+            ifreq request{};
+            std::strncpy(request.ifr_name, busname.c_str(), IFNAMSIZ - 1);
+            sockaddr_can address{};
+            address.can_family = AF_CAN;
+            if (ioctl(fd, SIOCGIFINDEX, &request) < 0)
+            {
+                close(fd);
+                return -1;
+            }
+            address.can_ifindex = request.ifr_ifindex;
+            // only the SDO requests to the Roboteq
+            can_filter filter{ROBOTEQ_SDO_RECEIVE, CAN_SFF_MASK | CAN_EFF_FLAG | CAN_RTR_FLAG};
+            setsockopt(fd, SOL_CAN_RAW, CAN_RAW_FILTER, &filter, sizeof(filter));
+            timeval timeout{0, 100000};
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0)
+            {
+                close(fd);
+                return -1;
+            }
+            return fd;
+        }
+
+        /*
+         * Keeps the kernel receive time of every cmd_cango download to the
+         * left tread.
+         * */
+        void watchBus()
+        {
+            can_frame frame;
+            while (running)
+            {
+                if (read(can_fd, &frame, sizeof(frame)) != sizeof(frame))
+                    continue;
+                // expedited or normal initiate download of 0x2000 sub 1
+                const bool download = (frame.data[0] & 0xE0) == 0x20;
+                const uint16_t index = frame.data[1] | (frame.data[2] << 8);
+                if (!download || index != CMD_CANGO_INDEX || frame.data[3] != CMD_CANGO_LEFT)
+                    continue;
+                timeval received;
+                if (ioctl(can_fd, SIOCGSTAMP, &received) < 0)
+                    continue;
+                std::lock_guard<std::mutex> lock(mutex);
+                frames.push_back(ros::WallTime(received.tv_sec, received.tv_usec * 1000));
+            }
+        }
+
+        ros::Subscriber events_subscriber;
+        ros::Subscriber cango_trace_subscriber;
+
+        int can_fd;
+        std::atomic<bool> running;
+        std::thread can_thread;
+
+        std::mutex mutex;
+        std::map<uint64_t, std::vector<Event>> traces;
+        std::deque<ros::WallTime> frames;
+        std::vector<PendingFrame> pending_frames;
+        std::map<std::string, HopLatency> hop_latencies;
+        size_t completed;
+        std::ofstream output;
+};
+
+int main(int argc, char** argv)
+{
+    ros::init(argc, argv, "command_latency_test");
+    ros::NodeHandle n;
+
+    std::string stimulus, busname, output_path;
+    double stimulus_period, stimulus_speed, report_period;
+    int samples;
+    ros::param::param<std::string>("~stimulus", stimulus, "none");
+    ros::param::param<double>("~stimulus_period", stimulus_period, 0.5);
+    ros::param::param<double>("~stimulus_speed", stimulus_speed, 0.1);
+    ros::param::param<int>("~samples", samples, 200);
+    ros::param::param<double>("~report_period", report_period, 10.0);
+    ros::param::param<std::string>("~busname", busname, "can1");
+    ros::param::param<std::string>("~output_path", output_path, "");
+
+    CommandLatencyTest test{n, busname, output_path};
+
+    ros::Publisher cmd_publisher;
+    std::unique_ptr<tfr_utilities::TraceAnnouncer> cmd_announcer;
+    std::unique_ptr<actionlib::SimpleActionClient<tfr_msgs::TeleopAction>> teleop;
+    if (stimulus == "cmd_vel")
+    {
+        cmd_publisher = n.advertise<geometry_msgs::Twist>("cmd_vel", 5);
+        cmd_announcer.reset(new tfr_utilities::TraceAnnouncer(n, "cmd_vel"));
+    }
+    else if (stimulus == "teleop")
+    {
+        teleop.reset(new actionlib::SimpleActionClient<tfr_msgs::TeleopAction>(n, "teleop_action_server"));
+        ROS_INFO("command latency test: waiting for the teleop action server");
+        teleop->waitForServer();
+    }
+    else if (stimulus != "none")
+    {
+        ROS_WARN("command latency test: unknown stimulus '%s', only watching", stimulus.c_str());
+    }
+    ROS_INFO("command latency test: started");
+
+    ros::Rate rate(100);
+    ros::WallTime next_stimulus = ros::WallTime::now();
+    ros::WallTime next_report = ros::WallTime::now() + ros::WallDuration(report_period);
+    bool moving = false;
+    while (ros::ok() && (samples <= 0 || test.getCompleted() < static_cast<size_t>(samples)))
+    {
+        const ros::WallTime now = ros::WallTime::now();
+        if ((cmd_announcer || teleop) && now >= next_stimulus)
+        {
+            // alternate between driving and stopping so every command changes
+            // the tread set-point
+            moving = !moving;
+            const uint64_t trace_id = tfr_utilities::newTraceId();
+            if (cmd_announcer)
+            {
+                geometry_msgs::Twist cmd;
+                cmd.linear.x = moving ? stimulus_speed : 0.0;
+                tfr_utilities::recordTrace(trace_id, "latency_test/cmd_vel");
+                cmd_announcer->announce(trace_id);
+                cmd_publisher.publish(cmd);
+            }
+            else
+            {
+                tfr_msgs::TeleopGoal goal;
+                goal.code = static_cast<uint8_t>(moving ?
+                        tfr_utilities::TeleopCode::FORWARD : tfr_utilities::TeleopCode::STOP_DRIVEBASE);
+                goal.trace_id = trace_id;
+                tfr_utilities::recordTrace(trace_id, "latency_test/teleop");
+                teleop->sendGoal(goal);
+            }
+            next_stimulus = now + ros::WallDuration(stimulus_period);
+        }
+        if (now >= next_report)
+        {
+            test.report();
+            next_report = now + ros::WallDuration(report_period);
+        }
+        ros::spinOnce();
+        test.update();
+        rate.sleep();
+    }
+
+    if (cmd_announcer)
+    {
+        cmd_publisher.publish(geometry_msgs::Twist{});
+    }
+    else if (teleop)
+    {
+        tfr_msgs::TeleopGoal goal;
+        goal.code = static_cast<uint8_t>(tfr_utilities::TeleopCode::STOP_DRIVEBASE);
+        teleop->sendGoal(goal);
+    }
+    test.report();
+    return 0;
+}
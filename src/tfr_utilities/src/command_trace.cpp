@@ -0,0 +1,162 @@
+#include <command_trace.h>
+#include <tfr_msgs/TraceEvents.h>
+#include <memory>
+#include <mutex>
+#include <random>
+
+namespace tfr_utilities
+{
+    namespace
+    {
+        const size_t BUFFER_SIZE = 1024;
+
+        /*
+         * Single producer, single consumer ring of the records of one
+         * thread. The owning thread writes at head, drainTraces() reads at
+         * tail.
+         * */
+        struct TraceBuffer
+        {
+            TraceRecord records[BUFFER_SIZE];
+            std::atomic<uint64_t> head{0};
+            std::atomic<uint64_t> tail{0};
+            std::atomic<uint64_t> dropped{0};
+        };
+
+        std::mutex registry_mutex;
+        std::vector<std::shared_ptr<TraceBuffer>> registry;
+
+        TraceBuffer& threadBuffer()
+        {
+            static thread_local std::shared_ptr<TraceBuffer> buffer;
+            if (!buffer)
+            {
+                buffer = std::make_shared<TraceBuffer>();
+                std::lock_guard<std::mutex> lock(registry_mutex);
+                registry.push_back(buffer);
+            }
+            return *buffer;
+        }
+
+        std::atomic<uint64_t> next_trace{1};
+
+        // the upper bits keep the ids of different processes apart
+        uint64_t processPrefix()
+        {
+            std::random_device random;
+            return (static_cast<uint64_t>(random()) & 0xFFFFFF) << 40;
+        }
+    }
+
+    uint64_t newTraceId()
+    {
+        static const uint64_t prefix = processPrefix();
+        return prefix | (next_trace++ & 0xFFFFFFFFFF);
+    }
+
+    void recordTrace(uint64_t trace_id, const char* hop)
+    {
+        recordTrace(trace_id, hop, ros::WallTime::now());
+    }
+
+    void recordTrace(uint64_t trace_id, const char* hop, const ros::WallTime& stamp)
+    {
+        if (trace_id == 0)
+            return;
+        TraceBuffer& buffer = threadBuffer();
+        const uint64_t head = buffer.head.load(std::memory_order_relaxed);
+        if (head - buffer.tail.load(std::memory_order_acquire) >= BUFFER_SIZE)
+        {
+            buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        buffer.records[head % BUFFER_SIZE] = TraceRecord{trace_id, hop, stamp};
+        buffer.head.store(head + 1, std::memory_order_release);
+    }
+
+    uint64_t drainTraces(std::vector<TraceRecord>& records)
+    {
+        uint64_t dropped = 0;
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        for (auto& buffer : registry)
+        {
+            const uint64_t head = buffer->head.load(std::memory_order_acquire);
+            uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+            for (; tail != head; tail++)
+            {
+                records.push_back(buffer->records[tail % BUFFER_SIZE]);
+            }
+            buffer->tail.store(tail, std::memory_order_release);
+            dropped += buffer->dropped.exchange(0, std::memory_order_relaxed);
+        }
+        return dropped;
+    }
+
+    TraceExporter::TraceExporter(ros::NodeHandle& n, double period) :
+        publisher{n.advertise<tfr_msgs::TraceEvents>("/command_trace/events", 10)},
+        timer{n.createWallTimer(ros::WallDuration(period), &TraceExporter::exportTraces, this)}
+    {
+    }
+
+    void TraceExporter::shutdown()
+    {
+        timer.stop();
+        publisher.shutdown();
+    }
+
+    void TraceExporter::exportTraces(const ros::WallTimerEvent& event)
+    {
+        records.clear();
+        const uint64_t dropped = drainTraces(records);
+        if (dropped > 0)
+        {
+            ROS_WARN("command trace: dropped %lu records, a trace buffer was full",
+                    static_cast<unsigned long>(dropped));
+        }
+        if (records.empty())
+            return;
+
+        tfr_msgs::TraceEvents events;
+        events.node = ros::this_node::getName();
+        events.events.resize(records.size());
+        for (size_t i = 0; i < records.size(); i++)
+        {
+            events.events[i].trace_id = records[i].trace_id;
+            events.events[i].hop = records[i].hop;
+            events.events[i].stamp = ros::Time(records[i].stamp.sec, records[i].stamp.nsec);
+        }
+        publisher.publish(events);
+    }
+
+    TraceAnnouncer::TraceAnnouncer(ros::NodeHandle& n, const std::string& topic) :
+        publisher{n.advertise<tfr_msgs::TraceContext>(topic + "/trace", 10)}
+    {
+    }
+
+    void TraceAnnouncer::announce(uint64_t trace_id)
+    {
+        if (trace_id == 0)
+            return;
+        tfr_msgs::TraceContext context;
+        context.trace_id = trace_id;
+        const ros::WallTime now = ros::WallTime::now();
+        context.stamp = ros::Time(now.sec, now.nsec);
+        publisher.publish(context);
+    }
+
+    TraceListener::TraceListener(ros::NodeHandle& n, const std::string& topic) :
+        trace_id{0},
+        subscriber{n.subscribe(topic + "/trace", 10, &TraceListener::announced, this)}
+    {
+    }
+
+    uint64_t TraceListener::take()
+    {
+        return trace_id.exchange(0);
+    }
+
+    void TraceListener::announced(const tfr_msgs::TraceContext::ConstPtr& context)
+    {
+        trace_id = context->trace_id;
+    }
+}
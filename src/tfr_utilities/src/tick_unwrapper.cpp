@@ -0,0 +1,83 @@
+#include <tick_unwrapper.h>
+
+namespace tfr_utilities
+{
+    TickUnwrapper::Parameters TickUnwrapper::int32Counter()
+    {
+        return Parameters{};
+    }
+
+    TickUnwrapper::TickUnwrapper(const Parameters& parameters) :
+        range{parameters.max_count - parameters.min_count + 1},
+        max_step{parameters.max_step > 0 ? parameters.max_step : range / 4},
+        recenter_value{parameters.recenter_value},
+        has_reading{false},
+        last_raw{0},
+        count{0},
+        recenter_count{0},
+        jump_count{0}
+    {
+    }
+
+    TickUnwrapper::Step TickUnwrapper::peek(int64_t raw) const
+    {
+        if (!has_reading)
+        {
+            return Step{Kind::FIRST, 0, count, raw};
+        }
+
+        // the difference modulo the range, in [-range / 2, range / 2)
+        int64_t delta = (raw - last_raw) % range;
+        if (delta < -range / 2)
+        {
+            delta += range;
+        }
+        else if (delta >= range - range / 2)
+        {
+            delta -= range;
+        }
+        if (delta >= -max_step && delta <= max_step)
+        {
+            return Step{Kind::STEP, delta, count + delta, raw};
+        }
+
+        const int64_t since_recenter = raw - recenter_value;
+        if (since_recenter >= -max_step && since_recenter <= max_step)
+        {
+            return Step{Kind::RECENTER, since_recenter, count + since_recenter, raw};
+        }
+        return Step{Kind::JUMP, 0, count, raw};
+    }
+
+    void TickUnwrapper::accept(const Step& step)
+    {
+        has_reading = true;
+        last_raw = step.raw;
+        count = step.position;
+        if (step.kind == Kind::RECENTER)
+        {
+            recenter_count++;
+        }
+        else if (step.kind == Kind::JUMP)
+        {
+            jump_count++;
+        }
+    }
+
+    TickUnwrapper::Step TickUnwrapper::update(int64_t raw)
+    {
+        const Step step = peek(raw);
+        accept(step);
+        return step;
+    }
+
+    void TickUnwrapper::reset(bool clear_position)
+    {
+        has_reading = false;
+        last_raw = 0;
+        if (clear_position)
+        {
+            count = 0;
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+#include "actuator_arrival.h"
+
+using tfr_utilities::ActuatorArrival;
+
+namespace
+{
+    const uint16_t ENABLED = 0x0237;
+    const uint16_t REACHED = ENABLED | ActuatorArrival::TARGET_REACHED;
+}
+
+TEST(ActuatorArrival, ReachedBeforeAnyCommand)
+{
+    ActuatorArrival arrival;
+    EXPECT_TRUE(arrival.reached(ros::Time{10}));
+    EXPECT_FALSE(arrival.hasFeedback(ros::Time{10}));
+}
+
+/*
+ * The encoder gets within the tolerance of the target.
+ * */
+TEST(ActuatorArrival, ByPosition)
+{
+    ActuatorArrival arrival;
+    arrival.position(0.5, ros::Time{9.9});
+    arrival.command(1.0, ros::Time{10});
+    // the reading from before the command doesn't count, even if it were close
+    EXPECT_FALSE(arrival.reached(ros::Time{10}));
+    arrival.position(0.8, ros::Time{10.5});
+    EXPECT_FALSE(arrival.reached(ros::Time{10.5}));
+    arrival.position(0.97, ros::Time{11});
+    EXPECT_TRUE(arrival.reached(ros::Time{11}));
+    EXPECT_TRUE(arrival.hasFeedback(ros::Time{11}));
+    EXPECT_TRUE(arrival.hasPosition(ros::Time{11}));
+    EXPECT_DOUBLE_EQ(0.97, arrival.lastPosition());
+
+    // stale feedback doesn't count
+    EXPECT_FALSE(arrival.reached(ros::Time{13}));
+    EXPECT_FALSE(arrival.hasFeedback(ros::Time{13}));
+    EXPECT_FALSE(arrival.hasPosition(ros::Time{13}));
+}
+
+/*
+ * The statusword still says target reached for the last target right after
+ * the command.
+ * */
+TEST(ActuatorArrival, ByStatusword)
+{
+    ActuatorArrival arrival;
+    arrival.statusword(REACHED, ros::Time{9.95});
+    arrival.command(3.0, ros::Time{10});
+    arrival.statusword(REACHED, ros::Time{10.05});
+    EXPECT_FALSE(arrival.reached(ros::Time{10.05}));
+    arrival.statusword(ENABLED, ros::Time{10.3});
+    EXPECT_FALSE(arrival.reached(ros::Time{10.3}));
+    arrival.statusword(REACHED, ros::Time{12});
+    EXPECT_TRUE(arrival.reached(ros::Time{12}));
+    // feedback, but no position
+    EXPECT_TRUE(arrival.hasFeedback(ros::Time{12}));
+    EXPECT_FALSE(arrival.hasPosition(ros::Time{12}));
+}
+
+/*
+ * A short move can be over before the bit was ever seen cleared.
+ * */
+TEST(ActuatorArrival, ShortMoveBySettledStatusword)
+{
+    ActuatorArrival arrival;
+    arrival.command(3.0, ros::Time{10});
+    arrival.statusword(REACHED, ros::Time{10.25});
+    EXPECT_TRUE(arrival.reached(ros::Time{10.25}));
+}
+
+TEST(ActuatorArrival, NewCommandStartsOver)
+{
+    ActuatorArrival arrival;
+    arrival.command(1.0, ros::Time{10});
+    arrival.position(1.0, ros::Time{11});
+    EXPECT_TRUE(arrival.reached(ros::Time{11}));
+    arrival.command(2.0, ros::Time{11.1});
+    EXPECT_FALSE(arrival.reached(ros::Time{11.1}));
+    EXPECT_DOUBLE_EQ(arrival.target(), 2.0);
+    EXPECT_DOUBLE_EQ(arrival.lastPosition(), 1.0);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
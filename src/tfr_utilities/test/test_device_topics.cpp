@@ -0,0 +1,31 @@
+#include <gtest/gtest.h>
+#include "device_topics.h"
+
+using tfr_utilities::getTopic;
+using tfr_utilities::setTopic;
+
+/*
+ * The names the bridge advertises, see tfr_can/cached_entry.h and the
+ * kacanopen EntryPublisher and JointStatePublisher.
+ * */
+TEST(DeviceTopics, BridgeNames)
+{
+    EXPECT_EQ("/device23/get_statusword", getTopic(23, "statusword"));
+    EXPECT_EQ("/device1/get_joint_state", getTopic(1, "joint_state"));
+    EXPECT_EQ("/device56/set_joint_state", setTopic(56, "joint_state"));
+    EXPECT_EQ("/device45/get_torque_actual_value", getTopic(45, "torque_actual_value"));
+    EXPECT_EQ("/device1/get_torque_actual_values/torque_actual_value_averaged",
+            getTopic(1, "torque_actual_values/torque_actual_value_averaged"));
+}
+
+TEST(DeviceTopics, EscapesLikeKacanopen)
+{
+    EXPECT_EQ("/device77/get_profile_velocity", getTopic(77, "Profile Velocity"));
+    EXPECT_EQ("/device88/set_max_torque", setTopic(88, "max-torque"));
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
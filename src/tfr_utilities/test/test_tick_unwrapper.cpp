@@ -0,0 +1,226 @@
+#include <gtest/gtest.h>
+#include "tick_unwrapper.h"
+#include <climits>
+#include <cstdint>
+#include <random>
+
+using tfr_utilities::TickUnwrapper;
+
+namespace
+{
+    /*
+     * The reading of a counter from min to max at the true position.
+     * */
+    int64_t wrap(int64_t position, int64_t min, int64_t max)
+    {
+        const int64_t range = max - min + 1;
+        int64_t offset = (position - min) % range;
+        if (offset < 0)
+            offset += range;
+        return min + offset;
+    }
+
+    TickUnwrapper::Parameters counter(int64_t min, int64_t max, int64_t max_step)
+    {
+        TickUnwrapper::Parameters parameters;
+        parameters.min_count = min;
+        parameters.max_count = max;
+        parameters.max_step = max_step;
+        return parameters;
+    }
+}
+
+/*
+ * Every start reading and every step up to max_step of a small counter
+ * gives back the step.
+ * */
+TEST(TickUnwrapper, ExhaustiveSmallCounter)
+{
+    for (int64_t min : {-8, 0, 3})
+    {
+        for (int64_t size : {8, 16, 17})
+        {
+            const int64_t max = min + size - 1;
+            // steps up to just below half the range are unambiguous
+            const int64_t max_step = (size - 1) / 2;
+            for (int64_t start = min; start <= max; start++)
+            {
+                for (int64_t step = -max_step; step <= max_step; step++)
+                {
+                    TickUnwrapper unwrapper{counter(min, max, max_step)};
+                    unwrapper.update(start);
+                    const TickUnwrapper::Step result = unwrapper.update(wrap(start + step, min, max));
+                    ASSERT_EQ(result.kind, TickUnwrapper::Kind::STEP)
+                        << "min " << min << " size " << size << " start " << start << " step " << step;
+                    ASSERT_EQ(result.delta, step);
+                    ASSERT_EQ(unwrapper.position(), step);
+                }
+            }
+        }
+    }
+}
+
+/*
+ * Steps around both ends of the int32 counter, where the Roboteq wraps.
+ * */
+TEST(TickUnwrapper, Int32Boundaries)
+{
+    for (int64_t start : {int64_t{INT32_MAX}, int64_t{INT32_MIN}, int64_t{0}, int64_t{-1}})
+    {
+        for (int64_t offset = -300; offset <= 300; offset++)
+        {
+            for (int64_t step = -1000; step <= 1000; step += 7)
+            {
+                const int64_t from = wrap(start + offset, INT32_MIN, INT32_MAX);
+                TickUnwrapper unwrapper;
+                unwrapper.update(static_cast<int32_t>(from));
+                const int32_t to = static_cast<int32_t>(wrap(from + step, INT32_MIN, INT32_MAX));
+                const TickUnwrapper::Step result = unwrapper.update(to);
+                ASSERT_EQ(result.kind, TickUnwrapper::Kind::STEP);
+                ASSERT_EQ(result.delta, step) << "from " << from << " step " << step;
+            }
+        }
+    }
+}
+
+/*
+ * Random walks that wrap the counter many times end up exactly where the
+ * encoder is, beyond the range of the counter.
+ * */
+TEST(TickUnwrapper, RandomWalkTracksTruePosition)
+{
+    std::mt19937_64 random{42};
+    struct Case { int64_t min, max, max_step; };
+    for (const Case& c : {Case{INT32_MIN, INT32_MAX, 1 << 28}, Case{0, 999, 200},
+            Case{-1, 0, 0}, Case{-50, 49, 49}, Case{0, 65535, 16000}})
+    {
+        const int64_t max_step = c.max_step > 0 ? c.max_step : (c.max - c.min + 1) / 4;
+        std::uniform_int_distribution<int64_t> steps{-max_step, max_step};
+        // mostly in one direction, so the count leaves the range of the counter
+        std::uniform_int_distribution<int64_t> drift{0, max_step};
+
+        TickUnwrapper unwrapper{counter(c.min, c.max, c.max_step)};
+        int64_t position = 12345;
+        unwrapper.update(wrap(position, c.min, c.max));
+        const int64_t start = unwrapper.position();
+        for (int i = 0; i < 100000; i++)
+        {
+            const int64_t step = (i % 3 == 0) ? steps(random) : std::min(max_step, drift(random));
+            position += step;
+            unwrapper.update(wrap(position, c.min, c.max));
+            ASSERT_EQ(unwrapper.position() - start, position - 12345)
+                << "counter " << c.min << ".." << c.max << " reading " << i;
+        }
+        EXPECT_EQ(unwrapper.recenters(), 0u);
+        EXPECT_EQ(unwrapper.jumps(), 0u);
+    }
+}
+
+/*
+ * A long run in one direction at full speed goes far past 2^32 ticks.
+ * */
+TEST(TickUnwrapper, CountsPastThirtyTwoBits)
+{
+    TickUnwrapper unwrapper;
+    int64_t position = 0;
+    unwrapper.update(0);
+    const int64_t step = 1 << 28;
+    for (int i = 0; i < 1000; i++)
+    {
+        position += step;
+        unwrapper.update(static_cast<int32_t>(wrap(position, INT32_MIN, INT32_MAX)));
+    }
+    EXPECT_EQ(unwrapper.position(), position);
+    EXPECT_GT(unwrapper.position(), int64_t{1} << 36);
+}
+
+/*
+ * The arduino writes 0 to its counter near 0.8 * INT_MAX, the ticks after
+ * that keep counting.
+ * */
+TEST(TickUnwrapper, Recentering)
+{
+    TickUnwrapper::Parameters parameters;
+    parameters.max_step = 100000;
+    TickUnwrapper unwrapper{parameters};
+
+    int64_t position = 0;
+    int32_t reading = static_cast<int32_t>(0.8 * INT_MAX) - 50000;
+    unwrapper.update(reading);
+    std::mt19937_64 random{7};
+    std::uniform_int_distribution<int32_t> steps{0, 90000};
+    int recentered = 0;
+    for (int i = 0; i < 10000; i++)
+    {
+        const int32_t step = (i % 5 == 0) ? -steps(random) / 2 : steps(random);
+        position += step;
+        reading += step;
+        const TickUnwrapper::Step result = unwrapper.update(reading);
+        ASSERT_NE(result.kind, TickUnwrapper::Kind::JUMP);
+        ASSERT_EQ(unwrapper.position(), position);
+        // what the arduino does after the read
+        if (reading > 0.8 * INT_MAX || reading < 0.8 * INT_MIN)
+        {
+            reading = 0;
+            recentered++;
+        }
+    }
+    EXPECT_GT(recentered, 0);
+    EXPECT_EQ(unwrapper.recenters(), static_cast<uint64_t>(recentered));
+}
+
+/*
+ * A controller that reboots starts counting from 0 again.
+ * */
+TEST(TickUnwrapper, Reset)
+{
+    TickUnwrapper unwrapper;
+    unwrapper.update(1500000000);
+    unwrapper.update(1500000300);
+    const TickUnwrapper::Step result = unwrapper.update(40);
+    EXPECT_EQ(result.kind, TickUnwrapper::Kind::RECENTER);
+    EXPECT_EQ(result.delta, 40);
+    EXPECT_EQ(unwrapper.position(), 340);
+}
+
+/*
+ * A reading that is neither motion nor a recenter only moves the base.
+ * */
+TEST(TickUnwrapper, JumpDoesNotSpike)
+{
+    TickUnwrapper::Parameters parameters;
+    parameters.max_step = 10000;
+    TickUnwrapper unwrapper{parameters};
+    unwrapper.update(100);
+    unwrapper.update(200);
+    const TickUnwrapper::Step jump = unwrapper.update(-900000000);
+    EXPECT_EQ(jump.kind, TickUnwrapper::Kind::JUMP);
+    EXPECT_EQ(jump.delta, 0);
+    EXPECT_EQ(unwrapper.position(), 100);
+    unwrapper.update(-899999990);
+    EXPECT_EQ(unwrapper.position(), 110);
+    EXPECT_EQ(unwrapper.jumps(), 1u);
+}
+
+TEST(TickUnwrapper, PeekDoesNotTake)
+{
+    TickUnwrapper unwrapper;
+    unwrapper.update(10);
+    const TickUnwrapper::Step step = unwrapper.peek(25);
+    EXPECT_EQ(step.delta, 15);
+    EXPECT_EQ(unwrapper.position(), 0);
+    unwrapper.accept(step);
+    EXPECT_EQ(unwrapper.position(), 15);
+
+    unwrapper.reset();
+    EXPECT_EQ(unwrapper.update(-7000).kind, TickUnwrapper::Kind::FIRST);
+    EXPECT_EQ(unwrapper.position(), 15);
+    unwrapper.reset(true);
+    EXPECT_EQ(unwrapper.position(), 0);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}